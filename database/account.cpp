@@ -18,6 +18,8 @@
 
 #include "account.hpp"
 
+#include "statechanges.hpp"
+
 namespace pxd
 {
 
@@ -61,6 +63,9 @@ Account::~Account ()
   stmt.BindProto (3, data);
 
   stmt.Execute ();
+
+  if (db.GetTrackedChanges () != nullptr)
+    db.GetTrackedChanges ()->accounts.insert (name);
 }
 
 void
@@ -18,6 +18,8 @@
 
 #include "building.hpp"
 
+#include "statechanges.hpp"
+
 #include <glog/logging.h>
 
 namespace pxd
@@ -103,6 +105,8 @@ Building::~Building ()
 
       stmt.BindProto (15, data);
       stmt.Execute ();
+      if (db.GetTrackedChanges () != nullptr)
+        db.GetTrackedChanges ()->buildings.insert (id);
 
       return;
     }
@@ -175,6 +179,21 @@ BuildingsTable::QueryAll ()
   return stmt.Query<BuildingResult> ();
 }
 
+Database::Result<BuildingResult>
+BuildingsTable::QueryInRange (const HexCoord& centre,
+                              const HexCoord::IntT l1range)
+{
+  auto stmt = db.Prepare (R"(
+    SELECT *
+      FROM `buildings`
+      WHERE
+  )" + L1RangeCondition (1) + R"(
+      ORDER BY `id`
+  )");
+  BindL1RangeParameters (stmt, 1, centre, l1range);
+  return stmt.Query<BuildingResult> ();
+}
+
 void
 BuildingsTable::DeleteById (const Database::IdT id)
 {
@@ -186,6 +205,9 @@ BuildingsTable::DeleteById (const Database::IdT id)
   )");
   stmt.Bind (1, id);
   stmt.Execute ();
+
+  if (db.GetTrackedChanges () != nullptr)
+    db.GetTrackedChanges ()->buildings.insert (id);
 }
 
 Database::Result<BuildingResult>
@@ -229,6 +251,19 @@ BuildingsTable::ClearAllEffects ()
 {
   VLOG (1) << "Clearing all combat effects on buildings";
 
+  auto* changes = db.GetTrackedChanges ();
+  if (changes != nullptr)
+    {
+      auto stmt = db.Prepare (R"(
+        SELECT `id`
+          FROM `buildings`
+          WHERE `effects` IS NOT NULL
+      )");
+      auto res = stmt.Query<BuildingResult> ();
+      while (res.Step ())
+        changes->buildings.insert (res.Get<BuildingResult::id> ());
+    }
+
   auto stmt = db.Prepare (R"(
     UPDATE `buildings`
       SET `effects` = NULL
@@ -245,6 +245,13 @@ public:
    */
   Database::Result<BuildingResult> QueryAll ();
 
+  /**
+   * Queries for all buildings whose centre is within the given L1 range
+   * of some coordinate, ordered by ID.
+   */
+  Database::Result<BuildingResult> QueryInRange (const HexCoord& centre,
+                                                 HexCoord::IntT l1range);
+
   /**
    * Queries for all buildings with attacks (including friendly ones).
    */
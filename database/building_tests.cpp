@@ -206,6 +206,31 @@ TEST_F (BuildingsTableTests, QueryAll)
   ASSERT_FALSE (res.Step ());
 }
 
+TEST_F (BuildingsTableTests, QueryInRange)
+{
+  auto h = tbl.CreateNew ("turret", "domob", Faction::RED);
+  h->SetCentre (HexCoord (0, 0));
+  const auto id1 = h->GetId ();
+  h = tbl.CreateNew ("turret", "andy", Faction::RED);
+  h->SetCentre (HexCoord (-1, -1));
+  const auto id2 = h->GetId ();
+  h = tbl.CreateNew ("turret", "andy", Faction::RED);
+  h->SetCentre (HexCoord (10, -5));
+  h.reset ();
+
+  auto res = tbl.QueryInRange (HexCoord (0, 0), 2);
+  ASSERT_TRUE (res.Step ());
+  EXPECT_EQ (tbl.GetFromResult (res)->GetId (), id1);
+  ASSERT_TRUE (res.Step ());
+  EXPECT_EQ (tbl.GetFromResult (res)->GetId (), id2);
+  ASSERT_FALSE (res.Step ());
+
+  res = tbl.QueryInRange (HexCoord (0, 0), 1);
+  ASSERT_TRUE (res.Step ());
+  EXPECT_EQ (tbl.GetFromResult (res)->GetId (), id1);
+  ASSERT_FALSE (res.Step ());
+}
+
 TEST_F (BuildingsTableTests, QueryWithAttacks)
 {
   tbl.CreateNew ("checkmark", "domob", Faction::RED);
@@ -18,6 +18,8 @@
 
 #include "character.hpp"
 
+#include "statechanges.hpp"
+
 #include <glog/logging.h>
 
 namespace pxd
@@ -116,6 +118,8 @@ Character::~Character ()
       stmt.BindProto (108, inv.GetProtoForBinding ());
       stmt.BindProto (110, data);
       stmt.Execute ();
+      if (db.GetTrackedChanges () != nullptr)
+        db.GetTrackedChanges ()->characters.insert (id);
 
       return;
     }
@@ -141,6 +145,8 @@ Character::~Character ()
 
       BindFieldValues (stmt);
       stmt.Execute ();
+      if (db.GetTrackedChanges () != nullptr)
+        db.GetTrackedChanges ()->characters.insert (id);
       return;
     }
 
@@ -296,6 +302,23 @@ CharacterTable::QueryForOwner (const std::string& owner)
   return stmt.Query<CharacterResult> ();
 }
 
+Database::Result<CharacterResult>
+CharacterTable::QueryInRange (const HexCoord& centre,
+                              const HexCoord::IntT l1range)
+{
+  /* Characters inside buildings have NULL coordinates, so they will
+     never match the condition.  */
+  auto stmt = db.Prepare (R"(
+    SELECT *
+      FROM `characters`
+      WHERE
+  )" + L1RangeCondition (1) + R"(
+      ORDER BY `id`
+  )");
+  BindL1RangeParameters (stmt, 1, centre, l1range);
+  return stmt.Query<CharacterResult> ();
+}
+
 Database::Result<CharacterResult>
 CharacterTable::QueryForBuilding (const Database::IdT building)
 {
@@ -412,6 +435,9 @@ CharacterTable::DeleteById (const Database::IdT id)
   )");
   stmt.Bind (1, id);
   stmt.Execute ();
+
+  if (db.GetTrackedChanges () != nullptr)
+    db.GetTrackedChanges ()->characters.insert (id);
 }
 
 namespace
@@ -448,6 +474,19 @@ CharacterTable::ClearAllEffects ()
 {
   VLOG (1) << "Clearing all combat effects on characters";
 
+  auto* changes = db.GetTrackedChanges ();
+  if (changes != nullptr)
+    {
+      auto stmt = db.Prepare (R"(
+        SELECT `id`
+          FROM `characters`
+          WHERE `effects` IS NOT NULL
+      )");
+      auto res = stmt.Query<CharacterResult> ();
+      while (res.Step ())
+        changes->characters.insert (res.Get<CharacterResult::id> ());
+    }
+
   auto stmt = db.Prepare (R"(
     UPDATE `characters`
       SET `effects` = NULL
@@ -366,6 +366,14 @@ public:
    */
   Database::Result<CharacterResult> QueryForOwner (const std::string& owner);
 
+  /**
+   * Queries for all characters on the map within the given L1 range
+   * of a centre, ordered by ID.  Characters inside buildings are not
+   * returned.
+   */
+  Database::Result<CharacterResult> QueryInRange (const HexCoord& centre,
+                                                  HexCoord::IntT l1range);
+
   /**
    * Queries all characters that are in a given building.
    */
@@ -320,6 +320,29 @@ TEST_F (CharacterTableTests, QueryForOwner)
   ASSERT_FALSE (res.Step ());
 }
 
+TEST_F (CharacterTableTests, QueryInRange)
+{
+  const auto id1 = tbl.CreateNew ("domob", Faction::RED)->GetId ();
+  const auto id2 = tbl.CreateNew ("domob", Faction::RED)->GetId ();
+  const auto id3 = tbl.CreateNew ("domob", Faction::RED)->GetId ();
+  const auto id4 = tbl.CreateNew ("domob", Faction::RED)->GetId ();
+
+  tbl.GetById (id1)->SetPosition (HexCoord (5, 0));
+  tbl.GetById (id2)->SetPosition (HexCoord (2, 3));
+  tbl.GetById (id3)->SetPosition (HexCoord (3, 3));
+  tbl.GetById (id4)->SetBuildingId (10);
+
+  auto res = tbl.QueryInRange (HexCoord (0, 0), 5);
+  ASSERT_TRUE (res.Step ());
+  EXPECT_EQ (tbl.GetFromResult (res)->GetId (), id1);
+  ASSERT_TRUE (res.Step ());
+  EXPECT_EQ (tbl.GetFromResult (res)->GetId (), id2);
+  ASSERT_FALSE (res.Step ());
+
+  res = tbl.QueryInRange (HexCoord (-10, 0), 3);
+  ASSERT_FALSE (res.Step ());
+}
+
 TEST_F (CharacterTableTests, QueryForBuilding)
 {
   tbl.CreateNew ("domob", Faction::RED)->GetId ();
@@ -18,6 +18,8 @@
 
 #include "coord.hpp"
 
+#include <sstream>
+
 namespace pxd
 {
 
@@ -30,4 +32,31 @@ BindCoordParameter (Database::Statement& stmt,
   stmt.Bind (indY, coord.GetY ());
 }
 
+std::string
+L1RangeCondition (const unsigned ind)
+{
+  const std::string cx = "?" + std::to_string (ind);
+  const std::string cy = "?" + std::to_string (ind + 1);
+  const std::string r = "?" + std::to_string (ind + 2);
+
+  /* The L1 distance on the hex grid is half the sum of the absolute
+     differences in all three cube coordinates, where z = -x - y.  */
+  std::ostringstream sql;
+  sql << "(`x` BETWEEN " << cx << " - " << r << " AND " << cx << " + " << r
+      << ") AND (`y` BETWEEN " << cy << " - " << r << " AND " << cy << " + "
+      << r << ") AND (abs (`x` - " << cx << ") + abs (`y` - " << cy << ")"
+      << " + abs (`x` + `y` - " << cx << " - " << cy << ") <= 2 * " << r
+      << ")";
+
+  return sql.str ();
+}
+
+void
+BindL1RangeParameters (Database::Statement& stmt, const unsigned ind,
+                       const HexCoord& centre, const HexCoord::IntT l1range)
+{
+  BindCoordParameter (stmt, ind, ind + 1, centre);
+  stmt.Bind (ind + 2, l1range);
+}
+
 } // namespace pxd
@@ -24,6 +24,7 @@
 #include "hexagonal/coord.hpp"
 
 #include <cstdint>
+#include <string>
 
 namespace pxd
 {
@@ -53,6 +54,24 @@ void BindCoordParameter (Database::Statement& stmt,
                          unsigned indX, unsigned indY,
                          const HexCoord& coord);
 
+/**
+ * Returns an SQL condition (for use in a WHERE clause) that matches rows
+ * whose `x` and `y` columns are within some L1 range of a centre.
+ * The condition uses the three parameters starting at ind for the
+ * centre's x and y coordinates and the range, which should be bound with
+ * BindL1RangeParameters.
+ *
+ * The condition first restricts to the enclosing L-infinity box, so that
+ * SQLite can use an index on (`x`, `y`) for it.
+ */
+std::string L1RangeCondition (unsigned ind);
+
+/**
+ * Binds the parameters used by a L1RangeCondition.
+ */
+void BindL1RangeParameters (Database::Statement& stmt, unsigned ind,
+                            const HexCoord& centre, HexCoord::IntT l1range);
+
 } // namespace pxd
 
 #include "coord.tpp"
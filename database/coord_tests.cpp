@@ -22,6 +22,7 @@
 
 #include <gtest/gtest.h>
 
+#include <set>
 #include <vector>
 
 namespace pxd
@@ -29,6 +30,11 @@ namespace pxd
 namespace
 {
 
+struct IdResult : public Database::ResultType
+{
+  RESULT_COLUMN (int64_t, id, 1);
+};
+
 class CoordDatabaseTests : public DBTestFixture
 {
 
@@ -82,5 +88,47 @@ TEST_F (CoordDatabaseTests, RoundTrip)
     }
 }
 
+TEST_F (CoordDatabaseTests, L1Range)
+{
+  const HexCoord centre(3, -2);
+  constexpr HexCoord::IntT range = 4;
+
+  std::set<Database::IdT> expected;
+  for (HexCoord::IntT x = -10; x <= 10; ++x)
+    for (HexCoord::IntT y = -10; y <= 10; ++y)
+      {
+        const HexCoord c(x, y);
+        const auto id = db.GetNextId ();
+        auto stmt = db.Prepare (R"(
+          INSERT INTO `test`
+            (`id`, `x`, `y`)
+            VALUES (?1, ?2, ?3)
+        )");
+        stmt.Bind (1, id);
+        BindCoordParameter (stmt, 2, 3, c);
+        stmt.Execute ();
+
+        if (HexCoord::DistanceL1 (c, centre) <= range)
+          expected.insert (id);
+      }
+
+  auto stmt = db.Prepare (R"(
+    SELECT `id`
+      FROM `test`
+      WHERE
+  )" + L1RangeCondition (2) + R"(
+      AND `id` > ?1
+  )");
+  stmt.Bind (1, 0);
+  BindL1RangeParameters (stmt, 2, centre, range);
+  auto res = stmt.Query<IdResult> ();
+
+  std::set<Database::IdT> actual;
+  while (res.Step ())
+    actual.insert (res.Get<IdResult::id> ());
+
+  EXPECT_EQ (actual, expected);
+}
+
 } // anonymous namespace
 } // namespace pxd
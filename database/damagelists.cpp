@@ -18,11 +18,39 @@
 
 #include "damagelists.hpp"
 
+#include "statechanges.hpp"
+
 #include <glog/logging.h>
 
 namespace pxd
 {
 
+namespace
+{
+
+struct VictimResult : public Database::ResultType
+{
+  RESULT_COLUMN (int64_t, victim, 1);
+};
+
+struct AttackerResult : public Database::ResultType
+{
+  RESULT_COLUMN (int64_t, attacker, 1);
+};
+
+/**
+ * Records all victims returned by the given query as modified characters,
+ * since their list of attackers changes.
+ */
+void
+RecordVictims (StateChanges& changes, Database::Result<VictimResult> res)
+{
+  while (res.Step ())
+    changes.characters.insert (res.Get<VictimResult::victim> ());
+}
+
+} // anonymous namespace
+
 void
 DamageLists::RemoveOld (const unsigned n)
 {
@@ -34,6 +62,18 @@ DamageLists::RemoveOld (const unsigned n)
   if (n > height)
     return;
 
+  auto* changes = db.GetTrackedChanges ();
+  if (changes != nullptr)
+    {
+      auto stmt = db.Prepare (R"(
+        SELECT DISTINCT `victim`
+          FROM `damage_lists`
+          WHERE `height` <= ?1
+      )");
+      stmt.Bind (1, height - n);
+      RecordVictims (*changes, stmt.Query<VictimResult> ());
+    }
+
   auto stmt = db.Prepare (R"(
     DELETE FROM `damage_lists`
       WHERE `height` <= ?1
@@ -62,6 +102,9 @@ DamageLists::AddEntry (const Database::IdT victim, const Database::IdT attacker)
   stmt.Bind (3, height);
 
   stmt.Execute ();
+
+  if (db.GetTrackedChanges () != nullptr)
+    db.GetTrackedChanges ()->characters.insert (victim);
 }
 
 void
@@ -69,6 +112,20 @@ DamageLists::RemoveCharacter (const Database::IdT id)
 {
   VLOG (1) << "Removing character " << id << " from damage lists...";
 
+  auto* changes = db.GetTrackedChanges ();
+  if (changes != nullptr)
+    {
+      changes->characters.insert (id);
+
+      auto stmt = db.Prepare (R"(
+        SELECT `victim`
+          FROM `damage_lists`
+          WHERE `attacker` = ?1
+      )");
+      stmt.Bind (1, id);
+      RecordVictims (*changes, stmt.Query<VictimResult> ());
+    }
+
   auto stmt = db.Prepare (R"(
     DELETE FROM `damage_lists`
       WHERE `victim` = ?1 OR `attacker` = ?1
@@ -78,16 +135,6 @@ DamageLists::RemoveCharacter (const Database::IdT id)
   stmt.Execute ();
 }
 
-namespace
-{
-
-struct AttackerResult : public Database::ResultType
-{
-  RESULT_COLUMN (int64_t, attacker, 1);
-};
-
-} // anonymous namespace
-
 DamageLists::Attackers
 DamageLists::GetAttackers (const Database::IdT victim) const
 {
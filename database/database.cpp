@@ -55,6 +55,7 @@ Database::Statement::Execute ()
 {
   CHECK (!executed && !queried) << "Database statement has already been run";
   executed = true;
+  ++db->numExecuted;
   stmt.Execute ();
 }
 
@@ -30,12 +30,15 @@
 #include <sqlite3.h>
 
 #include <array>
+#include <cstdint>
 #include <string>
 #include <type_traits>
 
 namespace pxd
 {
 
+struct StateChanges;
+
 /**
  * Basic class that is used to provide connectivity to the database
  * and related services provided by SQLiteGame (e.g. AutoId's and prepared
@@ -56,6 +59,18 @@ private:
   /** Protocol buffer arena used for protos extracted from the database.  */
   google::protobuf::Arena arena;
 
+  /** Number of statements executed so far (for statistics).  */
+  uint64_t numExecuted = 0;
+
+  /** Number of result rows read so far (for statistics).  */
+  uint64_t numRowsRead = 0;
+
+  /**
+   * If not null, the keys of modified game-state entries are recorded
+   * here by the database handles.
+   */
+  StateChanges* changes = nullptr;
+
 protected:
 
   Database () = default;
@@ -104,6 +119,57 @@ public:
    */
   Statement Prepare (const std::string& sql);
 
+  /**
+   * Returns the number of statements executed (with Execute or Query)
+   * through this instance so far.
+   */
+  uint64_t
+  GetNumExecuted () const
+  {
+    return numExecuted;
+  }
+
+  /**
+   * Returns the number of result rows read from queries through this
+   * instance so far.
+   */
+  uint64_t
+  GetNumRowsRead () const
+  {
+    return numRowsRead;
+  }
+
+  /**
+   * Enables recording the keys of all modified game-state entries into the
+   * given instance, or disables it if null is passed.
+   */
+  void
+  TrackChanges (StateChanges* c)
+  {
+    changes = c;
+  }
+
+  /**
+   * Returns the instance into which modified entries should be recorded,
+   * or null if changes are not tracked.
+   */
+  StateChanges*
+  GetTrackedChanges ()
+  {
+    return changes;
+  }
+
+  /**
+   * Returns the number of bytes allocated so far by the arena used for
+   * protos extracted from the database.  The arena is only freed when the
+   * instance is destructed, so this grows over its lifetime.
+   */
+  uint64_t
+  GetArenaBytes () const
+  {
+    return arena.SpaceAllocated ();
+  }
+
   /**
    * Gives access to the underlying libxayagame Database instance.
    */
@@ -312,7 +378,11 @@ public:
   inline bool
   Step ()
   {
-    return stmt.Step ();
+    if (!stmt.Step ())
+      return false;
+
+    ++db->numRowsRead;
+    return true;
   }
 
   /**
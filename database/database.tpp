@@ -31,6 +31,7 @@ template <typename T>
 {
   CHECK (!executed && !queried) << "Database statement has already been run";
   queried = true;
+  ++db->numExecuted;
   return Result<T> (*db, std::move (stmt));
 }
 
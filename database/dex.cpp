@@ -18,6 +18,8 @@
 
 #include "dex.hpp"
 
+#include "statechanges.hpp"
+
 #include <glog/logging.h>
 
 namespace pxd
@@ -58,6 +60,15 @@ DexOrder::~DexOrder ()
       return;
     }
 
+  /* The order affects both the building's order book and (for bids) the
+     reserved balance of the account.  */
+  auto* changes = db.GetTrackedChanges ();
+  if (changes != nullptr && (isNew || dirty))
+    {
+      changes->buildings.insert (buildingId);
+      changes->accounts.insert (account);
+    }
+
   if (isNew)
     {
       VLOG (1) << "Inserting new DEX order " << id << " into the database";
@@ -343,6 +354,15 @@ DexOrderTable::GetReservedQuantities (const Database::IdT building) const
 void
 DexOrderTable::DeleteForBuilding (const Database::IdT building)
 {
+  auto* changes = db.GetTrackedChanges ();
+  if (changes != nullptr)
+    {
+      changes->buildings.insert (building);
+      auto res = QueryForBuilding (building);
+      while (res.Step ())
+        changes->accounts.insert (res.Get<DexOrderResult::account> ());
+    }
+
   auto stmt = db.Prepare (R"(
     DELETE FROM `dex_orders`
       WHERE `building` = ?1
@@ -18,6 +18,8 @@
 
 #include "inventory.hpp"
 
+#include "statechanges.hpp"
+
 #include <glog/logging.h>
 #include <google/protobuf/util/message_differencer.h>
 
@@ -270,6 +272,9 @@ GroundLoot::~GroundLoot ()
       return;
     }
 
+  if (db.GetTrackedChanges () != nullptr)
+    db.GetTrackedChanges ()->groundLoot.insert (coord);
+
   if (inventory.IsEmpty ())
     {
       VLOG (1) << "Ground loot at " << coord << " is now empty, updating DB";
@@ -329,6 +334,21 @@ GroundLootTable::QueryNonEmpty ()
   return stmt.Query<GroundLootResult> ();
 }
 
+Database::Result<GroundLootResult>
+GroundLootTable::QueryInRange (const HexCoord& centre,
+                               const HexCoord::IntT l1range)
+{
+  auto stmt = db.Prepare (R"(
+    SELECT *
+      FROM `ground_loot`
+      WHERE
+  )" + L1RangeCondition (1) + R"(
+      ORDER BY `x`, `y`
+  )");
+  BindL1RangeParameters (stmt, 1, centre, l1range);
+  return stmt.Query<GroundLootResult> ();
+}
+
 /* ************************************************************************** */
 
 BuildingInventory::BuildingInventory (Database& d, const Database::IdT b,
@@ -362,6 +382,9 @@ BuildingInventory::~BuildingInventory ()
       return;
     }
 
+  if (db.GetTrackedChanges () != nullptr)
+    db.GetTrackedChanges ()->buildings.insert (building);
+
   if (inventory.IsEmpty ())
     {
       VLOG (1)
@@ -447,6 +470,20 @@ BuildingInventoriesTable::QueryForBuilding (const Database::IdT building)
   return stmt.Query<BuildingInventoryResult> ();
 }
 
+Database::Result<BuildingInventoryResult>
+BuildingInventoriesTable::QueryForAccount (const std::string& account)
+{
+  auto stmt = db.Prepare (R"(
+    SELECT *
+      FROM `building_inventories`
+      WHERE `account` = ?1
+      ORDER BY `building`
+  )");
+  stmt.Bind (1, account);
+
+  return stmt.Query<BuildingInventoryResult> ();
+}
+
 void
 BuildingInventoriesTable::RemoveBuilding (const Database::IdT building)
 {
@@ -456,6 +493,9 @@ BuildingInventoriesTable::RemoveBuilding (const Database::IdT building)
   )");
   stmt.Bind (1, building);
   stmt.Execute ();
+
+  if (db.GetTrackedChanges () != nullptr)
+    db.GetTrackedChanges ()->buildings.insert (building);
 }
 
 /* ************************************************************************** */
@@ -363,6 +363,13 @@ public:
    */
   Database::Result<GroundLootResult> QueryNonEmpty ();
 
+  /**
+   * Queries the database for all non-empty piles of loot within the
+   * given L1 range of a coordinate.
+   */
+  Database::Result<GroundLootResult> QueryInRange (const HexCoord& centre,
+                                                   HexCoord::IntT l1range);
+
 };
 
 /* ************************************************************************** */
@@ -497,6 +504,13 @@ public:
    */
   Database::Result<BuildingInventoryResult> QueryForBuilding (Database::IdT b);
 
+  /**
+   * Queries the database for all inventories of a given account,
+   * ordered by building.
+   */
+  Database::Result<BuildingInventoryResult> QueryForAccount (
+      const std::string& account);
+
   /**
    * Removes all entries for inventories in the given building.  This is used
    * to clean up data when a building is destroyed.
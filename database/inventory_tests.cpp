@@ -360,6 +360,25 @@ TEST_F (GroundLootTableTests, QueryNonEmpty)
   ASSERT_FALSE (res.Step ());
 }
 
+TEST_F (GroundLootTableTests, QueryInRange)
+{
+  const HexCoord c1(1, 2);
+  const HexCoord c2(-5, 0);
+  const HexCoord c3(2, 2);
+
+  tbl.GetByCoord (c1)->GetInventory ().SetFungibleCount ("foo", 1);
+  tbl.GetByCoord (c2)->GetInventory ().SetFungibleCount ("foo", 2);
+  tbl.GetByCoord (c3)->GetInventory ().SetFungibleCount ("foo", 3);
+
+  auto res = tbl.QueryInRange (HexCoord (0, 0), 4);
+
+  ASSERT_TRUE (res.Step ());
+  EXPECT_EQ (tbl.GetFromResult (res)->GetPosition (), c1);
+  ASSERT_TRUE (res.Step ());
+  EXPECT_EQ (tbl.GetFromResult (res)->GetPosition (), c3);
+  ASSERT_FALSE (res.Step ());
+}
+
 /* ************************************************************************** */
 
 class BuildingInventoryTests : public InventoryRowTests
@@ -478,6 +497,31 @@ TEST_F (BuildingInventoriesTableTests, QueryForBuilding)
   ASSERT_FALSE (res.Step ());
 }
 
+TEST_F (BuildingInventoriesTableTests, QueryForAccount)
+{
+  tbl.Get (124, "domob")->GetInventory ().SetFungibleCount ("foo", 1);
+  tbl.Get (123, "domob")->GetInventory ().SetFungibleCount ("foo", 2);
+  tbl.Get (123, "andy")->GetInventory ().SetFungibleCount ("foo", 3);
+
+  auto res = tbl.QueryForAccount ("bob");
+  ASSERT_FALSE (res.Step ());
+  res = tbl.QueryForAccount ("domob");
+
+  ASSERT_TRUE (res.Step ());
+  auto h = tbl.GetFromResult (res);
+  EXPECT_EQ (h->GetBuildingId (), 123);
+  EXPECT_EQ (h->GetAccount (), "domob");
+  EXPECT_EQ (h->GetInventory ().GetFungibleCount ("foo"), 2);
+
+  ASSERT_TRUE (res.Step ());
+  h = tbl.GetFromResult (res);
+  EXPECT_EQ (h->GetBuildingId (), 124);
+  EXPECT_EQ (h->GetAccount (), "domob");
+  EXPECT_EQ (h->GetInventory ().GetFungibleCount ("foo"), 1);
+
+  ASSERT_FALSE (res.Step ());
+}
+
 TEST_F (BuildingInventoriesTableTests, RemoveBuilding)
 {
   tbl.Get (123, "domob")->GetInventory ().SetFungibleCount ("foo", 1);
@@ -18,6 +18,8 @@
 
 #include "region.hpp"
 
+#include "statechanges.hpp"
+
 namespace pxd
 {
 
@@ -67,6 +69,8 @@ Region::~Region ()
       stmt.Bind (3, resourceLeft);
       stmt.BindProto (4, data);
       stmt.Execute ();
+      if (db.GetTrackedChanges () != nullptr)
+        db.GetTrackedChanges ()->regions.insert (id);
 
       return;
     }
@@ -87,6 +91,8 @@ Region::~Region ()
       stmt.Bind (2, currentHeight);
       stmt.Bind (3, resourceLeft);
       stmt.Execute ();
+      if (db.GetTrackedChanges () != nullptr)
+        db.GetTrackedChanges ()->regions.insert (id);
 
       return;
     }
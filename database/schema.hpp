@@ -30,6 +30,13 @@ namespace pxd
  */
 void SetupDatabaseSchema (xaya::SQLiteDatabase& db);
 
+/**
+ * Drops the indices that are only needed to serve RPC queries, but not
+ * for processing blocks.  This is used to speed up the initial sync.
+ * The indices are recreated by SetupDatabaseSchema.
+ */
+void DropRpcIndices (xaya::SQLiteDatabase& db);
+
 } // namespace pxd
 
 #endif // DATABASE_SCHEMA_HPP
@@ -288,6 +288,8 @@ CREATE TABLE IF NOT EXISTS `regions` (
 
 );
 
+-- This index is only used for RPC queries, and is dropped during the
+-- initial sync (see RPC_INDICES in schema_tail.cpp).
 CREATE INDEX IF NOT EXISTS `regions_by_modifiedheight`
   ON `regions` (`modifiedheight`);
 
@@ -326,6 +328,8 @@ CREATE TABLE IF NOT EXISTS `building_inventories` (
 
 );
 
+-- This index is only used for RPC queries, and is dropped during the
+-- initial sync (see RPC_INDICES in schema_tail.cpp).
 CREATE INDEX IF NOT EXISTS `building_inventories_by_account`
   ON `building_inventories` (`account`);
 
@@ -421,7 +425,9 @@ CREATE TABLE IF NOT EXISTS `dex_trade_history` (
 
 );
 
--- Querying of the price history by item and optionally building.
+-- Querying of the price history by item and optionally building.  This is
+-- only used for RPC queries, and is dropped during the initial sync (see
+-- RPC_INDICES in schema_tail.cpp).
 CREATE INDEX IF NOT EXISTS `dex_trade_history_by_item_building`
   ON `dex_trade_history` (`item`, `building`, `id`);
 
@@ -18,6 +18,8 @@
 
 #include "schema.hpp"
 
+#include <string>
+
 namespace pxd
 {
 namespace
@@ -1,5 +1,15 @@
 )";
 
+/**
+ * Indices that are only used by queries for RPC methods and the REST API.
+ * Queries done during block processing must not depend on them.
+ */
+const char* const RPC_INDICES[] = {
+  "building_inventories_by_account",
+  "dex_trade_history_by_item_building",
+  "regions_by_modifiedheight",
+};
+
 } // anonymous namespace
 
 void
@@ -8,4 +18,11 @@ SetupDatabaseSchema (xaya::SQLiteDatabase& db)
   db.Execute (SCHEMA_SQL);
 }
 
+void
+DropRpcIndices (xaya::SQLiteDatabase& db)
+{
+  for (const char* idx : RPC_INDICES)
+    db.Execute (std::string ("DROP INDEX IF EXISTS `") + idx + "`");
+}
+
 } // namespace pxd
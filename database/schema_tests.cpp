@@ -22,6 +22,8 @@
 
 #include <gtest/gtest.h>
 
+#include <glog/logging.h>
+
 namespace pxd
 {
 namespace
@@ -40,5 +42,28 @@ TEST_F (SchemaTests, TwiceIsOk)
   SetupDatabaseSchema (*db);
 }
 
+TEST_F (SchemaTests, RpcIndices)
+{
+  SetupDatabaseSchema (*db);
+
+  const auto countIndices = [this] ()
+    {
+      auto stmt = (*db).Prepare (R"(
+        SELECT COUNT(*) FROM `sqlite_master` WHERE `type` = 'index'
+      )");
+      CHECK (stmt.Step ());
+      return stmt.Get<int> (0);
+    };
+
+  const int before = countIndices ();
+  DropRpcIndices (*db);
+  EXPECT_EQ (countIndices (), before - 3);
+  DropRpcIndices (*db);
+  EXPECT_EQ (countIndices (), before - 3);
+
+  SetupDatabaseSchema (*db);
+  EXPECT_EQ (countIndices (), before);
+}
+
 } // anonymous namespace
 } // namespace pxd
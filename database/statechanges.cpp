@@ -0,0 +1,41 @@
+/*
+    GSP for the Taurion blockchain game
+    Copyright (C) 2021  Autonomous Worlds Ltd
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "statechanges.hpp"
+
+namespace pxd
+{
+
+void
+StateChanges::Merge (const StateChanges& other)
+{
+  accounts.insert (other.accounts.begin (), other.accounts.end ());
+  buildings.insert (other.buildings.begin (), other.buildings.end ());
+  characters.insert (other.characters.begin (), other.characters.end ());
+  groundLoot.insert (other.groundLoot.begin (), other.groundLoot.end ());
+  regions.insert (other.regions.begin (), other.regions.end ());
+}
+
+size_t
+StateChanges::Size () const
+{
+  return accounts.size () + buildings.size () + characters.size ()
+            + groundLoot.size () + regions.size ();
+}
+
+} // namespace pxd
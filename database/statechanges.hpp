@@ -0,0 +1,67 @@
+/*
+    GSP for the Taurion blockchain game
+    Copyright (C) 2021  Autonomous Worlds Ltd
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef DATABASE_STATECHANGES_HPP
+#define DATABASE_STATECHANGES_HPP
+
+#include "database.hpp"
+
+#include "hexagonal/coord.hpp"
+#include "mapdata/regionmap.hpp"
+
+#include <cstddef>
+#include <set>
+#include <string>
+
+namespace pxd
+{
+
+/**
+ * The keys of entries in the main sections of the game state (accounts,
+ * buildings, characters, ground loot and regions) whose JSON data may have
+ * changed.  The database handles record them here while a block is being
+ * processed (if enabled with Database::TrackChanges), so that deltas of
+ * the game state can be computed by just looking at those entries.
+ *
+ * The sets may contain entries that did not actually change, but they never
+ * miss one that did.  Entries that were deleted are included as well.
+ */
+struct StateChanges
+{
+
+  std::set<std::string> accounts;
+  std::set<Database::IdT> buildings;
+  std::set<Database::IdT> characters;
+  std::set<HexCoord> groundLoot;
+  std::set<RegionMap::IdT> regions;
+
+  /**
+   * Adds all entries from the other instance to this one.
+   */
+  void Merge (const StateChanges& other);
+
+  /**
+   * Returns the total number of entries in all sections.
+   */
+  size_t Size () const;
+
+};
+
+} // namespace pxd
+
+#endif // DATABASE_STATECHANGES_HPP
@@ -0,0 +1,193 @@
+/*
+    GSP for the Taurion blockchain game
+    Copyright (C) 2021  Autonomous Worlds Ltd
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "statechanges.hpp"
+
+#include "account.hpp"
+#include "building.hpp"
+#include "character.hpp"
+#include "damagelists.hpp"
+#include "dbtest.hpp"
+#include "dex.hpp"
+#include "fighter.hpp"
+#include "inventory.hpp"
+#include "region.hpp"
+
+#include <gtest/gtest.h>
+
+namespace pxd
+{
+namespace
+{
+
+class StateChangesTests : public DBTestWithSchema
+{
+
+protected:
+
+  /** The changes being recorded.  */
+  StateChanges changes;
+
+  AccountsTable accounts;
+  BuildingsTable buildings;
+  CharacterTable characters;
+
+  StateChangesTests ()
+    : accounts(db), buildings(db), characters(db)
+  {
+    db.TrackChanges (&changes);
+  }
+
+  ~StateChangesTests ()
+  {
+    db.TrackChanges (nullptr);
+  }
+
+};
+
+TEST_F (StateChangesTests, Merge)
+{
+  StateChanges other;
+  other.accounts = {"domob"};
+  other.characters = {1, 2};
+  changes.characters = {2, 3};
+  changes.regions = {10};
+
+  changes.Merge (other);
+  EXPECT_EQ (changes.accounts, std::set<std::string> ({"domob"}));
+  EXPECT_EQ (changes.characters, std::set<Database::IdT> ({1, 2, 3}));
+  EXPECT_EQ (changes.regions, std::set<RegionMap::IdT> ({10}));
+  EXPECT_EQ (changes.Size (), 5);
+}
+
+TEST_F (StateChangesTests, NotTracking)
+{
+  db.TrackChanges (nullptr);
+  accounts.CreateNew ("domob");
+  characters.CreateNew ("domob", Faction::RED);
+  EXPECT_EQ (changes.Size (), 0);
+}
+
+TEST_F (StateChangesTests, OnlyDirtyEntries)
+{
+  accounts.CreateNew ("domob")->AddBalance (10);
+  const auto id = characters.CreateNew ("domob", Faction::RED)->GetId ();
+  changes = StateChanges ();
+
+  accounts.GetByName ("domob");
+  characters.GetById (id);
+  EXPECT_EQ (changes.Size (), 0);
+
+  characters.GetById (id)->MutableHP ().set_armour (42);
+  EXPECT_EQ (changes.characters, std::set<Database::IdT> ({id}));
+  EXPECT_TRUE (changes.accounts.empty ());
+}
+
+TEST_F (StateChangesTests, CreatedAndDeleted)
+{
+  accounts.CreateNew ("domob");
+  const auto c = characters.CreateNew ("domob", Faction::RED)->GetId ();
+  const auto b = buildings.CreateNew ("checkmark", "domob", Faction::RED)
+                    ->GetId ();
+  EXPECT_EQ (changes.accounts, std::set<std::string> ({"domob"}));
+  EXPECT_EQ (changes.characters, std::set<Database::IdT> ({c}));
+  EXPECT_EQ (changes.buildings, std::set<Database::IdT> ({b}));
+
+  changes = StateChanges ();
+  characters.DeleteById (c);
+  buildings.DeleteById (b);
+  EXPECT_EQ (changes.characters, std::set<Database::IdT> ({c}));
+  EXPECT_EQ (changes.buildings, std::set<Database::IdT> ({b}));
+}
+
+TEST_F (StateChangesTests, GroundLootAndRegions)
+{
+  const HexCoord pos(1, 2);
+  GroundLootTable loot(db);
+  loot.GetByCoord (pos)->GetInventory ().AddFungibleCount ("foo", 1);
+  EXPECT_EQ (changes.groundLoot, std::set<HexCoord> ({pos}));
+
+  RegionsTable regions(db, 10);
+  regions.GetById (42)->MutableProto ().set_prospecting_character (5);
+  regions.GetById (43)->MutableProto ().mutable_prospection ();
+  EXPECT_EQ (changes.regions, std::set<RegionMap::IdT> ({42, 43}));
+
+  changes = StateChanges ();
+  regions.GetById (43)->SetResourceLeft (5);
+  EXPECT_EQ (changes.regions, std::set<RegionMap::IdT> ({43}));
+}
+
+TEST_F (StateChangesTests, BuildingInventoriesAndOrders)
+{
+  BuildingInventoriesTable inv(db);
+  inv.Get (10, "domob")->GetInventory ().AddFungibleCount ("foo", 1);
+  EXPECT_EQ (changes.buildings, std::set<Database::IdT> ({10}));
+
+  changes = StateChanges ();
+  DexOrderTable orders(db);
+  orders.CreateNew (11, "andy", DexOrder::Type::BID, "foo", 1, 2);
+  EXPECT_EQ (changes.buildings, std::set<Database::IdT> ({11}));
+  EXPECT_EQ (changes.accounts, std::set<std::string> ({"andy"}));
+
+  changes = StateChanges ();
+  inv.RemoveBuilding (12);
+  orders.DeleteForBuilding (11);
+  EXPECT_EQ (changes.buildings, std::set<Database::IdT> ({11, 12}));
+  EXPECT_EQ (changes.accounts, std::set<std::string> ({"andy"}));
+}
+
+TEST_F (StateChangesTests, DamageLists)
+{
+  DamageLists dl(db, 100);
+  dl.AddEntry (1, 2);
+  dl.AddEntry (3, 2);
+  EXPECT_EQ (changes.characters, std::set<Database::IdT> ({1, 3}));
+
+  DamageLists (db, 101).AddEntry (4, 5);
+  changes = StateChanges ();
+  DamageLists (db, 105).RemoveOld (5);
+  EXPECT_EQ (changes.characters, std::set<Database::IdT> ({1, 3}));
+
+  changes = StateChanges ();
+  dl.RemoveCharacter (5);
+  EXPECT_EQ (changes.characters, std::set<Database::IdT> ({4, 5}));
+}
+
+TEST_F (StateChangesTests, ClearAllEffects)
+{
+  accounts.CreateNew ("domob");
+  const auto c1 = characters.CreateNew ("domob", Faction::RED)->GetId ();
+  auto c = characters.CreateNew ("domob", Faction::RED);
+  const auto c2 = c->GetId ();
+  c->MutableEffects ().mutable_speed ()->set_percent (10);
+  c.reset ();
+  auto b = buildings.CreateNew ("checkmark", "domob", Faction::RED);
+  const auto b1 = b->GetId ();
+  b->MutableEffects ().mutable_speed ()->set_percent (10);
+  b.reset ();
+  buildings.CreateNew ("checkmark", "domob", Faction::RED);
+
+  changes = StateChanges ();
+  FighterTable (buildings, characters).ClearAllEffects ();
+  EXPECT_EQ (changes.characters, std::set<Database::IdT> ({c2}));
+  EXPECT_EQ (changes.buildings, std::set<Database::IdT> ({b1}));
+  EXPECT_NE (c1, c2);
+}
+
+} // anonymous namespace
+} // namespace pxd
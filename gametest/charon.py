@@ -89,6 +89,7 @@ class CharonClient ():
     args.extend (["--charon_server_jid", testAccountJid (TEST_ACCOUNTS[0])])
     args.extend (["--charon_client_jid", testAccountJid (TEST_ACCOUNTS[1])])
     args.extend (["--charon_password", TEST_ACCOUNTS[1][1]])
+    args.append ("--charon_state_deltas")
 
     envVars = dict (os.environ)
     envVars["GLOG_log_dir"] = self.datadir
@@ -149,6 +150,7 @@ class CharonTest (PXTest):
     args.extend (["--charon_server_jid", testAccountJid (TEST_ACCOUNTS[0])])
     args.extend (["--charon_password", TEST_ACCOUNTS[0][1]])
     args.extend (["--rest_port", str (REST_PORT)])
+    args.append ("--charon_state_deltas")
     self.startGameDaemon (extraArgs=args)
 
     self.mainLogger.info ("Starting tauriond as Charon client...")
@@ -202,6 +204,27 @@ class CharonTest (PXTest):
         "accounts": [],
       })
 
+      self.mainLogger.info ("Testing waitforstatedelta...")
+      last = client.rpc.waitforstatedelta ("")
+      w = Waiter (client.rpc.waitforstatedelta, last["blockhash"])
+      w.assertRunning ()
+      self.generate (1)
+      delta = w.wait ()
+      self.assertEqual (delta["blockhash"], self.rpc.xaya.getbestblockhash ())
+      self.assertEqual (delta["previous"], last["blockhash"])
+      self.assertEqual (delta["delta"]["characters"]["updated"],
+                        self.rpc.game.getcharacters ()["data"])
+
+      self.mainLogger.info ("Testing local state in the client...")
+      expected = self.rpc.game.getcharacters ()
+      for _ in range (100):
+        res = client.rpc.getcharacters ()
+        if res["blockhash"] == expected["blockhash"]:
+          break
+        time.sleep (0.1)
+      self.assertEqual (res["blockhash"], expected["blockhash"])
+      self.assertEqual (res["data"], expected["data"])
+
 
 if __name__ == "__main__":
   CharonTest ().main ()
@@ -82,11 +82,40 @@ class SplitStateRpcsTest (PXTest):
     self.assertEqual (moneySupply, state["moneysupply"])
     self.assertEqual (prizes, state["prizes"])
 
+    # Test the area and per-owner filtered RPCs against the full state.
+    centre = {"x": 0, "y": 0}
+    self.assertEqual (
+        self.getRpc ("getcharactersinrange", centre=centre, l1range=10),
+        [c for c in characters
+           if "position" in c and self.inRange (c["position"], 10)])
+    self.assertEqual (
+        self.getRpc ("getgroundlootinrange", centre=centre, l1range=10),
+        [l for l in loot if self.inRange (l["position"], 10)])
+    self.assertEqual (
+        self.getRpc ("getbuildingsinrange",
+                     centre={"x": -100, "y": 200}, l1range=1),
+        [b for b in buildings if b["centre"] == {"x": -100, "y": 200}])
+    owners = ["prospector", "killed", "prospector"]
+    self.assertEqual (
+        self.getRpc ("getcharactersbyowner", owners=owners),
+        sorted ([c for c in characters if c["owner"] in owners],
+                key=lambda c: (c["owner"], c["id"])))
+
     # Test the bootstrap data.
     self.assertEqual (self.getRpc ("getbootstrapdata"), {
       "regions": regions,
     })
 
 
+  def inRange (self, pos, l1range):
+    """
+    Returns true if the given coordinate is within the L1 range
+    of the origin.
+    """
+
+    return abs (pos["x"]) + abs (pos["y"]) + abs (pos["x"] + pos["y"]) \
+              <= 2 * l1range
+
+
 if __name__ == "__main__":
   SplitStateRpcsTest ().main ()
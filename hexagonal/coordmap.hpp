@@ -0,0 +1,177 @@
+/*
+    GSP for the Taurion blockchain game
+    Copyright (C) 2021  Autonomous Worlds Ltd
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef HEXAGONAL_COORDMAP_HPP
+#define HEXAGONAL_COORDMAP_HPP
+
+#include "coord.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace pxd
+{
+
+/**
+ * Hash map from HexCoord to values of some type.  This uses open addressing
+ * with linear probing in a flat array, keyed by the coordinate packed into
+ * 32 bits.  It is much more cache friendly than std::unordered_map, which
+ * allocates a node for each entry.  Entries are erased with backward-shift
+ * deletion, so that no tombstones build up even if elements are inserted
+ * and erased frequently (e.g. for moving vehicles).
+ */
+template <typename T>
+  class HexCoordMap
+{
+
+private:
+
+  /**
+   * One slot in the table.
+   */
+  struct Slot
+  {
+
+    /** The key stored here (if used).  */
+    HexCoord key;
+
+    /** Whether or not this slot is in use.  */
+    bool used = false;
+
+    /** The value stored (if used).  */
+    T value;
+
+  };
+
+  /** Number of slots allocated when the first element is inserted.  */
+  static constexpr size_t MIN_SLOTS = 16;
+
+  /**
+   * The table of slots.  Its size is always zero (if nothing has ever been
+   * inserted) or a power of two.
+   */
+  std::vector<Slot> slots;
+
+  /** Number of elements in the map.  */
+  size_t numElements = 0;
+
+  /**
+   * Returns the packed 32-bit key for a coordinate.
+   */
+  static inline uint32_t PackKey (const HexCoord& c);
+
+  /**
+   * Returns the "home" slot for a given coordinate, i.e. the slot where
+   * linear probing for it starts.  The table must not be empty.
+   */
+  inline size_t HomeSlot (const HexCoord& c) const;
+
+  /**
+   * Returns the index of the slot holding the given coordinate, or the
+   * index of the empty slot where it should be inserted if it is not
+   * in the map.  The table must not be empty.
+   */
+  inline size_t FindSlot (const HexCoord& c) const;
+
+  /**
+   * Resizes the table to the given number of slots (a power of two),
+   * re-inserting all existing elements.
+   */
+  void Rehash (size_t newSlots);
+
+public:
+
+  HexCoordMap () = default;
+
+  HexCoordMap (HexCoordMap&&) = default;
+  HexCoordMap& operator= (HexCoordMap&&) = default;
+
+  HexCoordMap (const HexCoordMap&) = default;
+  HexCoordMap& operator= (const HexCoordMap&) = default;
+
+  /**
+   * Returns the number of elements in the map.
+   */
+  size_t
+  Size () const
+  {
+    return numElements;
+  }
+
+  bool
+  Empty () const
+  {
+    return numElements == 0;
+  }
+
+  /**
+   * Removes all elements from the map.  This keeps the allocated table,
+   * and thus takes time linear in the table's size (rather than the number
+   * of elements) unless the map is empty already.  For clearing a map
+   * with few elements in a large table, erasing them one by one is cheaper.
+   */
+  void Clear ();
+
+  /**
+   * Returns a pointer to the value for the given coordinate, or null
+   * if there is no entry for it.
+   */
+  const T* Find (const HexCoord& c) const;
+  T* Find (const HexCoord& c);
+
+  /**
+   * Returns the value for the given coordinate, which must exist.
+   */
+  const T& At (const HexCoord& c) const;
+
+  /**
+   * Returns a reference to the value for the given coordinate,
+   * inserting a default-constructed value if there is none yet.
+   */
+  T& Access (const HexCoord& c);
+
+  /**
+   * Inserts a new element.  Returns false (and does not change the map)
+   * if there is already an entry for the coordinate.
+   */
+  bool Insert (const HexCoord& c, const T& val);
+
+  /**
+   * Erases the element for the given coordinate.  Returns true if there
+   * was an entry, and false if the map did not contain the coordinate.
+   */
+  bool Erase (const HexCoord& c);
+
+  /**
+   * Returns the number of bytes allocated for the table.
+   */
+  size_t
+  GetMemoryBytes () const
+  {
+    return slots.capacity () * sizeof (Slot);
+  }
+
+};
+
+} // namespace pxd
+
+#include "coordmap.tpp"
+
+#endif // HEXAGONAL_COORDMAP_HPP
@@ -0,0 +1,195 @@
+/*
+    GSP for the Taurion blockchain game
+    Copyright (C) 2021  Autonomous Worlds Ltd
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+/* Template implementation code for coordmap.hpp.  */
+
+#include <glog/logging.h>
+
+#include <utility>
+
+namespace pxd
+{
+
+template <typename T>
+  constexpr size_t HexCoordMap<T>::MIN_SLOTS;
+
+template <typename T>
+  inline uint32_t
+  HexCoordMap<T>::PackKey (const HexCoord& c)
+{
+  static_assert (sizeof (HexCoord::IntT) == 2,
+                 "packed key assumes 16-bit coordinates");
+
+  const uint16_t x = static_cast<uint16_t> (c.GetX ());
+  const uint16_t y = static_cast<uint16_t> (c.GetY ());
+  return (static_cast<uint32_t> (x) << 16) | y;
+}
+
+template <typename T>
+  inline size_t
+  HexCoordMap<T>::HomeSlot (const HexCoord& c) const
+{
+  /* The packed keys of nearby coordinates differ only in a few bits, so we
+     need a good mixer before taking the lower bits as slot index.  This is
+     the 64-bit finaliser (fmix64) of MurmurHash3.  Its first shift is a no-op
+     for our 32-bit keys, but we keep the full function so that it is exactly
+     the well-known mixer.  */
+  uint64_t h = PackKey (c);
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdull;
+  h ^= h >> 33;
+  h *= 0xc4ceb9fe1a85ec53ull;
+  h ^= h >> 33;
+
+  return h & (slots.size () - 1);
+}
+
+template <typename T>
+  inline size_t
+  HexCoordMap<T>::FindSlot (const HexCoord& c) const
+{
+  const size_t mask = slots.size () - 1;
+
+  /* Since the load factor is always below one, there is always an empty
+     slot and the loop terminates.  */
+  size_t i = HomeSlot (c);
+  while (slots[i].used && slots[i].key != c)
+    i = (i + 1) & mask;
+
+  return i;
+}
+
+template <typename T>
+  void
+  HexCoordMap<T>::Rehash (const size_t newSlots)
+{
+  CHECK_EQ (newSlots & (newSlots - 1), 0)
+      << "Number of slots must be a power of two";
+  CHECK_GT (newSlots, numElements);
+
+  std::vector<Slot> old(newSlots);
+  std::swap (old, slots);
+
+  for (auto& s : old)
+    if (s.used)
+      slots[FindSlot (s.key)] = std::move (s);
+}
+
+template <typename T>
+  void
+  HexCoordMap<T>::Clear ()
+{
+  if (numElements == 0)
+    return;
+
+  for (auto& s : slots)
+    s = Slot ();
+  numElements = 0;
+}
+
+template <typename T>
+  const T*
+  HexCoordMap<T>::Find (const HexCoord& c) const
+{
+  if (numElements == 0)
+    return nullptr;
+
+  const auto& s = slots[FindSlot (c)];
+  return s.used ? &s.value : nullptr;
+}
+
+template <typename T>
+  T*
+  HexCoordMap<T>::Find (const HexCoord& c)
+{
+  const auto* res = static_cast<const HexCoordMap<T>&> (*this).Find (c);
+  return const_cast<T*> (res);
+}
+
+template <typename T>
+  const T&
+  HexCoordMap<T>::At (const HexCoord& c) const
+{
+  const T* res = Find (c);
+  CHECK (res != nullptr) << "No entry for " << c;
+  return *res;
+}
+
+template <typename T>
+  T&
+  HexCoordMap<T>::Access (const HexCoord& c)
+{
+  /* Keep the load factor at most 3/4, so that probe sequences stay short.  */
+  if (4 * (numElements + 1) > 3 * slots.size ())
+    Rehash (slots.empty () ? MIN_SLOTS : 2 * slots.size ());
+
+  auto& s = slots[FindSlot (c)];
+  if (!s.used)
+    {
+      s.key = c;
+      s.used = true;
+      ++numElements;
+    }
+
+  return s.value;
+}
+
+template <typename T>
+  bool
+  HexCoordMap<T>::Insert (const HexCoord& c, const T& val)
+{
+  if (Find (c) != nullptr)
+    return false;
+
+  Access (c) = val;
+  return true;
+}
+
+template <typename T>
+  bool
+  HexCoordMap<T>::Erase (const HexCoord& c)
+{
+  if (numElements == 0)
+    return false;
+
+  size_t hole = FindSlot (c);
+  if (!slots[hole].used)
+    return false;
+
+  /* Backward-shift deletion:  We move elements after the erased one back
+     into the hole as long as that does not move them before their home
+     slot.  This keeps all probe sequences intact without tombstones.  */
+  const size_t mask = slots.size () - 1;
+  for (size_t j = (hole + 1) & mask; slots[j].used; j = (j + 1) & mask)
+    {
+      const size_t home = HomeSlot (slots[j].key);
+      if (((j - home) & mask) >= ((j - hole) & mask))
+        {
+          slots[hole] = std::move (slots[j]);
+          hole = j;
+        }
+    }
+
+  slots[hole] = Slot ();
+  --numElements;
+
+  return true;
+}
+
+} // namespace pxd
@@ -0,0 +1,164 @@
+/*
+    GSP for the Taurion blockchain game
+    Copyright (C) 2021  Autonomous Worlds Ltd
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#include "coordmap.hpp"
+
+#include "coord.hpp"
+
+#include <benchmark/benchmark.h>
+
+#include <glog/logging.h>
+
+#include <cstdlib>
+#include <unordered_map>
+#include <vector>
+
+namespace pxd
+{
+namespace
+{
+
+/** Node-based map used as baseline.  */
+using UnorderedCountMap = std::unordered_map<HexCoord, unsigned>;
+/** Our flat map.  */
+using FlatCountMap = HexCoordMap<unsigned>;
+
+/**
+ * Operations of the vehicle-count maps used in the benchmark, like
+ * those SparseTileMap does when vehicles are moved in DynObstacles.
+ */
+template <typename Map>
+  struct CountOps;
+
+template <>
+  struct CountOps<UnorderedCountMap>
+{
+
+  static void
+  Add (UnorderedCountMap& m, const HexCoord& c)
+  {
+    ++m[c];
+  }
+
+  static void
+  Remove (UnorderedCountMap& m, const HexCoord& c)
+  {
+    auto mit = m.find (c);
+    CHECK (mit != m.end ());
+    if (--mit->second == 0)
+      m.erase (mit);
+  }
+
+  static bool
+  Has (const UnorderedCountMap& m, const HexCoord& c)
+  {
+    return m.count (c) > 0;
+  }
+
+};
+
+template <>
+  struct CountOps<FlatCountMap>
+{
+
+  static void
+  Add (FlatCountMap& m, const HexCoord& c)
+  {
+    ++m.Access (c);
+  }
+
+  static void
+  Remove (FlatCountMap& m, const HexCoord& c)
+  {
+    auto* val = m.Find (c);
+    CHECK (val != nullptr);
+    if (--*val == 0)
+      m.Erase (c);
+  }
+
+  static bool
+  Has (const FlatCountMap& m, const HexCoord& c)
+  {
+    return m.Find (c) != nullptr;
+  }
+
+};
+
+/**
+ * Benchmarks the pattern of moving vehicles around:  In each iteration,
+ * every vehicle is removed from its tile, moved to a random neighbour and
+ * added there again, and then all neighbours of the new tile are checked
+ * for other vehicles (as path finding does).  The argument is the number
+ * of vehicles.
+ */
+template <typename Map>
+  void
+  VehicleMovement (benchmark::State& state)
+{
+  using Ops = CountOps<Map>;
+  const size_t n = state.range (0);
+
+  std::srand (42);
+  std::vector<HexCoord> vehicles;
+  Map map;
+  for (size_t i = 0; i < n; ++i)
+    {
+      const HexCoord c(std::rand () % 1'000, std::rand () % 1'000);
+      vehicles.push_back (c);
+      Ops::Add (map, c);
+    }
+
+  unsigned found = 0;
+  for (auto _ : state)
+    for (auto& v : vehicles)
+      {
+        Ops::Remove (map, v);
+
+        const int dir = std::rand () % 6;
+        int i = 0;
+        for (const auto& nb : v.Neighbours ())
+          if (i++ == dir)
+            {
+              v = nb;
+              break;
+            }
+
+        Ops::Add (map, v);
+
+        for (const auto& nb : v.Neighbours ())
+          if (Ops::Has (map, nb))
+            ++found;
+      }
+
+  benchmark::DoNotOptimize (found);
+  state.SetItemsProcessed (state.iterations () * n);
+}
+BENCHMARK_TEMPLATE (VehicleMovement, UnorderedCountMap)
+  ->Unit (benchmark::kMicrosecond)
+  ->Arg (100)
+  ->Arg (10'000)
+  ->Arg (1'000'000);
+BENCHMARK_TEMPLATE (VehicleMovement, FlatCountMap)
+  ->Unit (benchmark::kMicrosecond)
+  ->Arg (100)
+  ->Arg (10'000)
+  ->Arg (1'000'000);
+
+} // anonymous namespace
+} // namespace pxd
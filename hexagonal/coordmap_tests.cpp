@@ -0,0 +1,164 @@
+/*
+    GSP for the Taurion blockchain game
+    Copyright (C) 2021  Autonomous Worlds Ltd
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#include "coordmap.hpp"
+
+#include "coord.hpp"
+
+#include <gtest/gtest.h>
+
+#include <cstdlib>
+#include <limits>
+#include <unordered_map>
+
+namespace pxd
+{
+namespace
+{
+
+using HexCoordMapTests = testing::Test;
+
+TEST_F (HexCoordMapTests, BasicAccess)
+{
+  const HexCoord a(-5, 2);
+  const HexCoord b(5, -2);
+
+  HexCoordMap<int> map;
+  EXPECT_TRUE (map.Empty ());
+  EXPECT_EQ (map.Find (a), nullptr);
+  EXPECT_FALSE (map.Erase (a));
+
+  EXPECT_TRUE (map.Insert (a, 42));
+  EXPECT_FALSE (map.Insert (a, 10));
+  EXPECT_EQ (map.Size (), 1);
+  EXPECT_EQ (map.At (a), 42);
+  EXPECT_EQ (map.Find (b), nullptr);
+
+  map.Access (b) = 5;
+  ++map.Access (b);
+  EXPECT_EQ (map.Size (), 2);
+  EXPECT_EQ (map.At (b), 6);
+
+  *map.Find (a) = 1;
+  EXPECT_EQ (map.At (a), 1);
+
+  EXPECT_TRUE (map.Erase (a));
+  EXPECT_EQ (map.Find (a), nullptr);
+  EXPECT_EQ (map.At (b), 6);
+  EXPECT_EQ (map.Size (), 1);
+
+  map.Clear ();
+  EXPECT_TRUE (map.Empty ());
+  EXPECT_EQ (map.Find (b), nullptr);
+  EXPECT_GT (map.GetMemoryBytes (), 0);
+}
+
+TEST_F (HexCoordMapTests, AccessDefaultValue)
+{
+  HexCoordMap<unsigned> map;
+  EXPECT_EQ (map.Access (HexCoord (1, 2)), 0);
+  map.Erase (HexCoord (1, 2));
+  EXPECT_EQ (map.Access (HexCoord (1, 2)), 0);
+}
+
+TEST_F (HexCoordMapTests, ExtremeCoordinates)
+{
+  HexCoordMap<int> map;
+  const HexCoord::IntT lo = std::numeric_limits<HexCoord::IntT>::min ();
+  const HexCoord::IntT hi = std::numeric_limits<HexCoord::IntT>::max ();
+
+  map.Access (HexCoord (lo, lo)) = 1;
+  map.Access (HexCoord (hi, hi)) = 2;
+  map.Access (HexCoord (-1, -1)) = 3;
+  map.Access (HexCoord (0, 0)) = 4;
+
+  EXPECT_EQ (map.Size (), 4);
+  EXPECT_EQ (map.At (HexCoord (lo, lo)), 1);
+  EXPECT_EQ (map.At (HexCoord (hi, hi)), 2);
+  EXPECT_EQ (map.At (HexCoord (-1, -1)), 3);
+  EXPECT_EQ (map.At (HexCoord (0, 0)), 4);
+  EXPECT_EQ (map.Find (HexCoord (lo, hi)), nullptr);
+}
+
+/**
+ * Performs many random operations (with coordinates from a small area, so
+ * that we get lots of collisions and removals within probe sequences)
+ * and compares the result to std::unordered_map.
+ */
+TEST_F (HexCoordMapTests, MatchesUnorderedMap)
+{
+  HexCoordMap<int> map;
+  std::unordered_map<HexCoord, int> expected;
+
+  std::srand (42);
+  for (int i = 0; i < 100'000; ++i)
+    {
+      const HexCoord c(std::rand () % 30, std::rand () % 30);
+      switch (std::rand () % 3)
+        {
+        case 0:
+          ASSERT_EQ (map.Insert (c, i), expected.emplace (c, i).second);
+          break;
+        case 1:
+          ASSERT_EQ (map.Erase (c), expected.erase (c) > 0);
+          break;
+        default:
+          map.Access (c) += i;
+          expected[c] += i;
+          break;
+        }
+
+      ASSERT_EQ (map.Size (), expected.size ());
+    }
+
+  for (int x = 0; x < 30; ++x)
+    for (int y = 0; y < 30; ++y)
+      {
+        const HexCoord c(x, y);
+        const auto mit = expected.find (c);
+        const int* val = map.Find (c);
+        if (mit == expected.end ())
+          {
+            ASSERT_EQ (val, nullptr);
+          }
+        else
+          {
+            ASSERT_NE (val, nullptr);
+            ASSERT_EQ (*val, mit->second);
+          }
+      }
+}
+
+TEST_F (HexCoordMapTests, Copy)
+{
+  HexCoordMap<int> map;
+  map.Access (HexCoord (1, 2)) = 3;
+
+  HexCoordMap<int> copy(map);
+  copy.Access (HexCoord (1, 2)) = 4;
+  copy.Access (HexCoord (5, 6)) = 7;
+
+  EXPECT_EQ (map.Size (), 1);
+  EXPECT_EQ (map.At (HexCoord (1, 2)), 3);
+  EXPECT_EQ (copy.Size (), 2);
+  EXPECT_EQ (copy.At (HexCoord (1, 2)), 4);
+}
+
+} // anonymous namespace
+} // namespace pxd
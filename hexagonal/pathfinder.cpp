@@ -18,11 +18,67 @@
 
 #include "pathfinder.hpp"
 
+#include <atomic>
+
 namespace pxd
 {
 
 constexpr PathFinder::DistanceT PathFinder::NO_CONNECTION;
 
+namespace
+{
+
+/** Number of currently allocated distance maps.  */
+std::atomic<uint64_t> numMaps(0);
+
+/** Number of bytes currently allocated for distance maps.  */
+std::atomic<uint64_t> numBytes(0);
+
+/** Peak number of bytes allocated for distance maps.  */
+std::atomic<uint64_t> peakBytes(0);
+
+} // anonymous namespace
+
+PathFinder::~PathFinder ()
+{
+  if (distances != nullptr)
+    AccountWorkspace (workspaceBytes, false);
+}
+
+void
+PathFinder::AccountWorkspace (const size_t bytes, const bool allocated)
+{
+  if (!allocated)
+    {
+      --numMaps;
+      numBytes -= bytes;
+      return;
+    }
+
+  ++numMaps;
+  const uint64_t now = (numBytes += bytes);
+
+  uint64_t peak = peakBytes;
+  while (now > peak && !peakBytes.compare_exchange_weak (peak, now))
+    ;
+}
+
+PathFinder::WorkspaceUsage
+PathFinder::GetWorkspaceUsage ()
+{
+  WorkspaceUsage res;
+  res.maps = numMaps;
+  res.bytes = numBytes;
+  res.peakBytes = peakBytes;
+  return res;
+}
+
+void
+PathFinder::ResetPeakWorkspaceBytes ()
+{
+  peakBytes = numBytes.load ();
+}
+
 PathFinder::Stepper
 PathFinder::StepPath (const HexCoord& source) const
 {
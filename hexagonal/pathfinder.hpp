@@ -85,16 +85,45 @@ private:
    */
   size_t computedTiles = 0;
 
+  /** Bytes allocated for the distance map (for memory accounting).  */
+  size_t workspaceBytes = 0;
+
+  /**
+   * Updates the process-wide workspace usage for a distance map of the
+   * given size being allocated or freed.
+   */
+  static void AccountWorkspace (size_t bytes, bool allocated);
+
   friend class PathFinderTests;
 
 public:
 
   class Stepper;
 
+  /**
+   * Memory used by the distance maps of all PathFinder instances
+   * in the process together.
+   */
+  struct WorkspaceUsage
+  {
+
+    /** Number of distance maps currently allocated.  */
+    uint64_t maps;
+
+    /** Bytes currently allocated for distance maps.  */
+    uint64_t bytes;
+
+    /** Maximum of bytes since the last ResetPeakWorkspaceBytes call.  */
+    uint64_t peakBytes;
+
+  };
+
   explicit PathFinder (const HexCoord& t)
     : target(t)
   {}
 
+  ~PathFinder ();
+
   PathFinder () = delete;
   PathFinder (const PathFinder&) = delete;
   void operator= (const PathFinder&) = delete;
@@ -126,6 +155,16 @@ public:
    */
   Stepper StepPath (const HexCoord& source) const;
 
+  /**
+   * Returns the current workspace memory usage.
+   */
+  static WorkspaceUsage GetWorkspaceUsage ();
+
+  /**
+   * Resets the peak value of workspace bytes to the current usage.
+   */
+  static void ResetPeakWorkspaceBytes ();
+
 };
 
 /**
@@ -107,6 +107,8 @@ template <typename Fcn>
   /* Initialise the distance map after some quick returns above.  */
   distances = std::make_unique<RangeMap<DistanceT>> (target, l1Range,
                                                      NO_CONNECTION);
+  workspaceBytes = distances->GetMemoryBytes ();
+  AccountWorkspace (workspaceBytes, true);
 
   /* Run Dijkstra's algorithm with a std::priority_queue.  Since we cannot
      lower tentative distances of elements, we simply insert another copy
@@ -158,6 +158,29 @@ TEST_F (PathFinderTests, FullRange)
               });
 }
 
+TEST_F (PathFinderTests, WorkspaceUsage)
+{
+  const auto before = PathFinder::GetWorkspaceUsage ();
+  PathFinder::ResetPeakWorkspaceBytes ();
+
+  uint64_t bytes;
+  {
+    PathFinder finder(HexCoord (-1, 2));
+    EXPECT_EQ (PathFinder::GetWorkspaceUsage ().maps, before.maps);
+
+    ASSERT_EQ (finder.Compute (&EdgeWeight, HexCoord (0, 0), 10), 8);
+    const auto during = PathFinder::GetWorkspaceUsage ();
+    EXPECT_EQ (during.maps, before.maps + 1);
+    bytes = during.bytes - before.bytes;
+    EXPECT_GT (bytes, 0);
+  }
+
+  const auto after = PathFinder::GetWorkspaceUsage ();
+  EXPECT_EQ (after.maps, before.maps);
+  EXPECT_EQ (after.bytes, before.bytes);
+  EXPECT_EQ (after.peakBytes, before.bytes + bytes);
+}
+
 TEST_F (PathFinderTests, ThroughX)
 {
   PathFinder finder(HexCoord (-1, 2));
@@ -84,6 +84,15 @@ public:
    */
   typename std::vector<T>::const_reference Get (const HexCoord& c) const;
 
+  /**
+   * Returns the (approximate) number of bytes allocated for the data.
+   */
+  size_t
+  GetMemoryBytes () const
+  {
+    return data.capacity () * sizeof (T);
+  }
+
 };
 
 /**
@@ -18,13 +18,17 @@
 
 #include "basemap.hpp"
 
+#include "datafile.hpp"
+
 namespace pxd
 {
 
 BaseMap::BaseMap (const xaya::Chain c)
-  : cfg(c), sz(cfg)
+  : sz(SafeZones::ForChain (c)),
+    obstacles(tiledata::GetRawData ().obstacles),
+    attr(TileAttributes::ForChain (c))
 {
-  CHECK_EQ (&blob_obstacles_end - &blob_obstacles_start,
+  CHECK_EQ (tiledata::GetRawData ().obstacleBytes,
             tiledata::obstacles::bitDataSize);
 }
 
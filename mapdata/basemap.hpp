@@ -21,6 +21,7 @@
 
 #include "regionmap.hpp"
 #include "safezones.hpp"
+#include "tileattributes.hpp"
 
 #include "hexagonal/coord.hpp"
 #include "hexagonal/pathfinder.hpp"
@@ -39,14 +40,17 @@ class BaseMap
 
 private:
 
-  /** RoConfig data.  */
-  const RoConfig cfg;
-
   /** RegionMap instance that is exposed as part of the BaseMap.  */
   const RegionMap rm;
 
-  /** SafeZones instance used.  */
-  const pxd::SafeZones sz;
+  /** SafeZones instance used (shared for all maps of the chain).  */
+  const pxd::SafeZones& sz;
+
+  /** The raw obstacle bit vectors.  */
+  const unsigned char* const obstacles;
+
+  /** The packed attributes of all tiles (shared for all maps of the chain).  */
+  const TileAttributes& attr;
 
 public:
 
@@ -79,6 +83,12 @@ public:
     return sz;
   }
 
+  const TileAttributes&
+  Attributes () const
+  {
+    return attr;
+  }
+
   /**
    * Returns the edge-weight for the basemap, to be used with path
    * finding on it.
@@ -86,6 +96,12 @@ public:
   PathFinder::DistanceT GetEdgeWeight (const HexCoord& from,
                                        const HexCoord& to) const;
 
+  /**
+   * Returns the edge-weight for the basemap for moving onto a tile
+   * with the given attributes.
+   */
+  static PathFinder::DistanceT GetEdgeWeight (TileAttributes::Tile to);
+
 };
 
 } // namespace pxd
@@ -66,7 +66,7 @@ BaseMap::IsPassable (const HexCoord& c) const
 
   const int yInd = basemap::YArrayIndex (c.GetY ());
   const unsigned char* bits
-      = &blob_obstacles_start + tiledata::obstacles::bitDataOffsetForY[yInd];
+      = obstacles + tiledata::obstacles::bitDataOffsetForY[yInd];
 
   const int xInd = c.GetX () - tiledata::minX[yInd];
   return (bits[xInd / basemap::BITS] & (1 << xInd % basemap::BITS));
@@ -75,7 +75,13 @@ BaseMap::IsPassable (const HexCoord& c) const
 inline PathFinder::DistanceT
 BaseMap::GetEdgeWeight (const HexCoord& from, const HexCoord& to) const
 {
-  if (IsPassable (to))
+  return GetEdgeWeight (attr.Get (to));
+}
+
+inline PathFinder::DistanceT
+BaseMap::GetEdgeWeight (const TileAttributes::Tile to)
+{
+  if (to.IsPassable ())
     return 1'000;
 
   return PathFinder::NO_CONNECTION;
@@ -20,3 +20,15 @@ blob_region_xcoord_end:
 .align 1
 blob_region_ids_start: .incbin "regionids.bin"
 blob_region_ids_end:
+
+.global blob_region_spans_start
+.global blob_region_spans_end
+.align 2
+blob_region_spans_start: .incbin "regionspans.bin"
+blob_region_spans_end:
+
+.global blob_region_span_offsets_start
+.global blob_region_span_offsets_end
+.align 4
+blob_region_span_offsets_start: .incbin "regionspanoffsets.bin"
+blob_region_span_offsets_end:
@@ -0,0 +1,337 @@
+/*
+    GSP for the Taurion blockchain game
+    Copyright (C) 2021  Autonomous Worlds Ltd
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#include "config.h"
+
+#include "datafile.hpp"
+
+#include <glog/logging.h>
+
+#ifdef HAVE_SYS_MMAN_H
+# include <fcntl.h>
+# include <sys/mman.h>
+# include <sys/stat.h>
+# include <unistd.h>
+#endif // HAVE_SYS_MMAN_H
+
+#include <cstring>
+#include <vector>
+
+namespace pxd
+{
+
+namespace
+{
+
+/** Magic bytes at the start of a data file.  */
+constexpr char MAGIC[8] = {'T', 'N', 'M', 'A', 'P', 'D', 'A', 'T'};
+
+/** Current version of the data file format.  */
+constexpr uint32_t FORMAT_VERSION = 2;
+
+/**
+ * Alignment of the data sections in the file.  We align them to pages,
+ * so that the mapped data is aligned in memory as well.
+ */
+constexpr size_t ALIGNMENT = 4'096;
+
+/** Number of bytes per region ID in the compact data.  */
+constexpr size_t BYTES_PER_ID = 3;
+
+/** Number of coordinate values per region span.  */
+constexpr size_t VALUES_PER_SPAN = 3;
+
+/**
+ * Header of a data file.  The file is written and read on the same
+ * platform (like the embedded blobs), so we just use the native layout.
+ */
+struct FileHeader
+{
+  char magic[sizeof (MAGIC)];
+  uint32_t version;
+  uint32_t reserved;
+  uint64_t obstacleBytes;
+  uint64_t regionEntries;
+  uint64_t regionIdBound;
+  uint64_t checksum;
+};
+
+static_assert (sizeof (FileHeader) <= ALIGNMENT, "file header is too large");
+
+/**
+ * Offsets of the sections within a data file.
+ */
+struct FileLayout
+{
+
+  size_t obstacles;
+  size_t regionXCoord;
+  size_t regionIds;
+  size_t regionSpans;
+  size_t regionSpanOffsets;
+  size_t total;
+
+  explicit FileLayout (const uint64_t obstacleBytes,
+                       const uint64_t regionEntries,
+                       const uint64_t regionIdBound)
+  {
+    const auto align = [] (const size_t offs)
+      {
+        return (offs + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+      };
+
+    obstacles = ALIGNMENT;
+    regionXCoord = align (obstacles + obstacleBytes);
+    regionIds = align (regionXCoord + sizeof (int16_t) * regionEntries);
+    regionSpans = align (regionIds + BYTES_PER_ID * regionEntries);
+    regionSpanOffsets = align (regionSpans + SpanBytes (regionEntries));
+    total = regionSpanOffsets + OffsetBytes (regionIdBound);
+  }
+
+  /**
+   * Returns the size of the region spans in bytes.
+   */
+  static size_t
+  SpanBytes (const uint64_t regionEntries)
+  {
+    return sizeof (int16_t) * VALUES_PER_SPAN * regionEntries;
+  }
+
+  /**
+   * Returns the size of the region span offsets in bytes.
+   */
+  static size_t
+  OffsetBytes (const uint64_t regionIdBound)
+  {
+    return sizeof (uint32_t) * (regionIdBound + 1);
+  }
+
+};
+
+/**
+ * Updates a 64-bit FNV-1a hash with the given bytes.
+ */
+uint64_t
+UpdateFnv (uint64_t hash, const void* data, const size_t len)
+{
+  constexpr uint64_t PRIME = 1'099'511'628'211ull;
+
+  const auto* bytes = static_cast<const unsigned char*> (data);
+  for (size_t i = 0; i < len; ++i)
+    {
+      hash ^= bytes[i];
+      hash *= PRIME;
+    }
+
+  return hash;
+}
+
+/**
+ * Writes the given number of zero bytes for padding.
+ */
+void
+WritePadding (std::ostream& out, const size_t len)
+{
+  const std::vector<char> zeros(len, 0);
+  out.write (zeros.data (), zeros.size ());
+}
+
+} // anonymous namespace
+
+uint64_t
+RawMapData::ComputeChecksum () const
+{
+  uint64_t hash = 14'695'981'039'346'656'037ull;
+  hash = UpdateFnv (hash, obstacles, obstacleBytes);
+  hash = UpdateFnv (hash, regionXCoord, sizeof (int16_t) * regionEntries);
+  hash = UpdateFnv (hash, regionIds, BYTES_PER_ID * regionEntries);
+  hash = UpdateFnv (hash, regionSpans, FileLayout::SpanBytes (regionEntries));
+  hash = UpdateFnv (hash, regionSpanOffsets,
+                    FileLayout::OffsetBytes (regionIdBound));
+
+  return hash;
+}
+
+uint64_t
+WriteMapDataFile (const RawMapData& data, std::ostream& out)
+{
+  FileHeader header;
+  std::memset (&header, 0, sizeof (header));
+  std::memcpy (header.magic, MAGIC, sizeof (MAGIC));
+  header.version = FORMAT_VERSION;
+  header.obstacleBytes = data.obstacleBytes;
+  header.regionEntries = data.regionEntries;
+  header.regionIdBound = data.regionIdBound;
+  header.checksum = data.ComputeChecksum ();
+
+  const FileLayout layout(data.obstacleBytes, data.regionEntries,
+                          data.regionIdBound);
+
+  out.write (reinterpret_cast<const char*> (&header), sizeof (header));
+  WritePadding (out, layout.obstacles - sizeof (header));
+
+  out.write (reinterpret_cast<const char*> (data.obstacles),
+             data.obstacleBytes);
+  WritePadding (out,
+                layout.regionXCoord - layout.obstacles - data.obstacleBytes);
+
+  const size_t xcoordBytes = sizeof (int16_t) * data.regionEntries;
+  out.write (reinterpret_cast<const char*> (data.regionXCoord), xcoordBytes);
+  WritePadding (out, layout.regionIds - layout.regionXCoord - xcoordBytes);
+
+  const size_t idsBytes = BYTES_PER_ID * data.regionEntries;
+  out.write (reinterpret_cast<const char*> (data.regionIds), idsBytes);
+  WritePadding (out, layout.regionSpans - layout.regionIds - idsBytes);
+
+  const size_t spanBytes = FileLayout::SpanBytes (data.regionEntries);
+  out.write (reinterpret_cast<const char*> (data.regionSpans), spanBytes);
+  WritePadding (out,
+                layout.regionSpanOffsets - layout.regionSpans - spanBytes);
+
+  out.write (reinterpret_cast<const char*> (data.regionSpanOffsets),
+             FileLayout::OffsetBytes (data.regionIdBound));
+
+  CHECK (out) << "Failed to write map data file";
+  return header.checksum;
+}
+
+MappedDataFile::~MappedDataFile ()
+{
+#ifdef HAVE_SYS_MMAN_H
+  if (mapped != nullptr)
+    munmap (mapped, mappedSize);
+#endif // HAVE_SYS_MMAN_H
+}
+
+bool
+MappedDataFile::ParseHeader (const std::string& file)
+{
+  FileHeader header;
+  if (mappedSize < sizeof (header))
+    {
+      LOG (ERROR) << "Map data file " << file << " is too small";
+      return false;
+    }
+  std::memcpy (&header, mapped, sizeof (header));
+
+  if (std::memcmp (header.magic, MAGIC, sizeof (MAGIC)) != 0)
+    {
+      LOG (ERROR) << file << " is not a map data file";
+      return false;
+    }
+  if (header.version != FORMAT_VERSION)
+    {
+      LOG (ERROR)
+          << "Map data file " << file << " has unsupported version "
+          << header.version;
+      return false;
+    }
+
+  const FileLayout layout(header.obstacleBytes, header.regionEntries,
+                          header.regionIdBound);
+  if (layout.total != mappedSize)
+    {
+      LOG (ERROR)
+          << "Map data file " << file << " has size " << mappedSize
+          << ", expected " << layout.total;
+      return false;
+    }
+
+  const auto* base = static_cast<const unsigned char*> (mapped);
+  data.obstacles = base + layout.obstacles;
+  data.obstacleBytes = header.obstacleBytes;
+  data.regionXCoord
+      = reinterpret_cast<const int16_t*> (base + layout.regionXCoord);
+  data.regionIds = base + layout.regionIds;
+  data.regionEntries = header.regionEntries;
+  data.regionSpans
+      = reinterpret_cast<const int16_t*> (base + layout.regionSpans);
+  data.regionSpanOffsets
+      = reinterpret_cast<const uint32_t*> (base + layout.regionSpanOffsets);
+  data.regionIdBound = header.regionIdBound;
+  checksum = header.checksum;
+
+  return true;
+}
+
+bool
+MappedDataFile::Open (const std::string& file, const bool verify)
+{
+  CHECK (mapped == nullptr) << "Data file is already open";
+
+#ifdef HAVE_SYS_MMAN_H
+  const int fd = open (file.c_str (), O_RDONLY);
+  if (fd < 0)
+    {
+      LOG (ERROR) << "Failed to open map data file " << file;
+      return false;
+    }
+
+  struct stat st;
+  if (fstat (fd, &st) != 0 || st.st_size == 0)
+    {
+      LOG (ERROR) << "Failed to get size of map data file " << file;
+      close (fd);
+      return false;
+    }
+  mappedSize = st.st_size;
+
+  /* The mapping is read-only and shared, so that all processes using the
+     same file share the pages in the page cache.  We populate the mapping
+     right away, as the data will be needed anyway, and it avoids page
+     faults later on during block processing.  */
+  int flags = MAP_SHARED;
+#ifdef MAP_POPULATE
+  flags |= MAP_POPULATE;
+#endif // MAP_POPULATE
+  mapped = mmap (nullptr, mappedSize, PROT_READ, flags, fd, 0);
+  close (fd);
+
+  if (mapped == MAP_FAILED)
+    {
+      LOG (ERROR) << "Failed to map data file " << file;
+      mapped = nullptr;
+      return false;
+    }
+
+#ifdef MADV_HUGEPAGE
+  /* This is just a hint, so we do not care if it fails (e.g. because
+     huge pages for file mappings are not supported).  */
+  madvise (mapped, mappedSize, MADV_HUGEPAGE);
+#endif // MADV_HUGEPAGE
+#else // HAVE_SYS_MMAN_H
+  LOG (ERROR) << "Memory-mapped map data files are not supported";
+  return false;
+#endif // HAVE_SYS_MMAN_H
+
+  if (!ParseHeader (file))
+    return false;
+
+  if (verify && data.ComputeChecksum () != checksum)
+    {
+      LOG (ERROR) << "Checksum mismatch in map data file " << file;
+      return false;
+    }
+
+  LOG (INFO)
+      << "Mapped " << mappedSize << " bytes of map data from " << file;
+  return true;
+}
+
+} // namespace pxd
@@ -0,0 +1,165 @@
+/*
+    GSP for the Taurion blockchain game
+    Copyright (C) 2021  Autonomous Worlds Ltd
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef MAPDATA_DATAFILE_HPP
+#define MAPDATA_DATAFILE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <string>
+
+namespace pxd
+{
+
+/**
+ * The raw (large) data of the base map, i.e. the obstacle bit vectors,
+ * the compact region map and the spans of each region.  The small metadata (like coordinate ranges
+ * and offsets per row) is always compiled in as part of tiledata.cpp, but
+ * the raw data itself may come either from blobs embedded into the binary
+ * or from a memory-mapped data file.
+ */
+struct RawMapData
+{
+
+  /** The obstacle bit vectors of all rows.  */
+  const unsigned char* obstacles = nullptr;
+  /** Size of the obstacle data in bytes.  */
+  size_t obstacleBytes = 0;
+
+  /** The x coordinates of the compact region data.  */
+  const int16_t* regionXCoord = nullptr;
+  /** The 24-bit region IDs of the compact region data.  */
+  const unsigned char* regionIds = nullptr;
+  /** Number of entries in the compact region data.  */
+  size_t regionEntries = 0;
+
+  /**
+   * The spans of all regions, grouped by region ID.  Each span is given
+   * by three values (y, x begin, x end) with inclusive x range.  There is
+   * one span per entry of the compact region data.
+   */
+  const int16_t* regionSpans = nullptr;
+  /**
+   * For each region ID, the index of its first span.  This has
+   * regionIdBound + 1 entries, so that the spans for some ID end where
+   * those of the next ID start.
+   */
+  const uint32_t* regionSpanOffsets = nullptr;
+  /** One larger than the maximum region ID.  */
+  size_t regionIdBound = 0;
+
+  /**
+   * Computes the checksum of the data.  This is a 64-bit FNV-1a hash,
+   * which is not secure but good enough to detect corrupted data files
+   * and mismatches with the compiled-in metadata.
+   */
+  uint64_t ComputeChecksum () const;
+
+};
+
+/**
+ * Writes the given map data into a data file, which can then be used
+ * with MappedDataFile.  The file has a header with a magic string, format
+ * version, the data sizes and a checksum, followed by the page-aligned
+ * raw data.  Returns the checksum of the data.
+ */
+uint64_t WriteMapDataFile (const RawMapData& data, std::ostream& out);
+
+/**
+ * A map data file (as written by WriteMapDataFile) that is mapped into
+ * memory read-only.  This way, the data is loaded lazily and can be shared
+ * between multiple processes on the same host through the page cache.
+ */
+class MappedDataFile
+{
+
+private:
+
+  /** The mapped memory region.  */
+  void* mapped = nullptr;
+
+  /** Size of the mapped region.  */
+  size_t mappedSize = 0;
+
+  /** The data (pointing into the mapped memory).  */
+  RawMapData data;
+
+  /** The checksum stored in the file header.  */
+  uint64_t checksum = 0;
+
+  /**
+   * Validates the file header and sets up the data pointers.  Returns
+   * false if the file is invalid.
+   */
+  bool ParseHeader (const std::string& file);
+
+public:
+
+  MappedDataFile () = default;
+  ~MappedDataFile ();
+
+  MappedDataFile (const MappedDataFile&) = delete;
+  void operator= (const MappedDataFile&) = delete;
+
+  /**
+   * Maps the given file.  Returns false (and logs an error) if the file
+   * cannot be mapped or is invalid.  If verify is true, the checksum of the
+   * data is verified as well, which reads in all of the data.
+   */
+  bool Open (const std::string& file, bool verify);
+
+  const RawMapData&
+  GetData () const
+  {
+    return data;
+  }
+
+  uint64_t
+  GetChecksum () const
+  {
+    return checksum;
+  }
+
+};
+
+namespace tiledata
+{
+
+/**
+ * Returns the raw map data that should be used.  This is the data from
+ * the file set with UseDataFile, if any, or otherwise the data embedded
+ * into the binary.  If the TAURION_MAPDATA environment variable is set
+ * and no file has been set explicitly, the file it names is used.
+ */
+const RawMapData& GetRawData ();
+
+/**
+ * Sets the map data to be memory-mapped from the given file.  This must
+ * be called before any map data is accessed (i.e. before BaseMap or
+ * RegionMap instances are created), typically right at startup.  Returns
+ * false if the file is invalid or does not match the compiled-in map.
+ */
+bool UseDataFile (const std::string& file);
+
+} // namespace tiledata
+
+} // namespace pxd
+
+#endif // MAPDATA_DATAFILE_HPP
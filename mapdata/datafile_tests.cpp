@@ -0,0 +1,179 @@
+/*
+    GSP for the Taurion blockchain game
+    Copyright (C) 2021  Autonomous Worlds Ltd
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#include "datafile.hpp"
+
+#include "tiledata.hpp"
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace pxd
+{
+namespace
+{
+
+class MappedDataFileTests : public testing::Test
+{
+
+protected:
+
+  /** Obstacle data for the test file.  */
+  const std::vector<unsigned char> obstacles = {1, 2, 3, 4, 5};
+  /** Region x coordinates for the test file.  */
+  const std::vector<int16_t> xcoords = {-10, 0, 42};
+  /** Region IDs for the test file.  */
+  const std::vector<unsigned char> ids = {1, 0, 0, 2, 0, 0, 3, 0, 1};
+  /** Region spans for the test file.  */
+  const std::vector<int16_t> spans = {5, -10, -1, 5, 0, 41, 5, 42, 50};
+  /** Region span offsets for the test file.  */
+  const std::vector<uint32_t> spanOffsets = {0, 0, 1, 2, 3};
+
+  /** Raw data pointing to the test arrays.  */
+  RawMapData data;
+
+  /** Name of the data file used in the test.  */
+  const std::string file;
+
+  MappedDataFileTests ()
+    : file(testing::TempDir () + "/mapdata_test.bin")
+  {
+    data.obstacles = obstacles.data ();
+    data.obstacleBytes = obstacles.size ();
+    data.regionXCoord = xcoords.data ();
+    data.regionIds = ids.data ();
+    data.regionEntries = xcoords.size ();
+    data.regionSpans = spans.data ();
+    data.regionSpanOffsets = spanOffsets.data ();
+    data.regionIdBound = spanOffsets.size () - 1;
+  }
+
+  ~MappedDataFileTests ()
+  {
+    std::remove (file.c_str ());
+  }
+
+  /**
+   * Writes the test data to the file and returns the checksum.
+   */
+  uint64_t
+  WriteFile ()
+  {
+    std::ofstream out(file, std::ios_base::binary);
+    return WriteMapDataFile (data, out);
+  }
+
+  /**
+   * Modifies the byte at the given offset in the file.
+   */
+  void
+  CorruptFile (const long offset)
+  {
+    std::fstream f(file, std::ios_base::binary | std::ios_base::in
+                            | std::ios_base::out);
+    f.seekg (offset);
+    const char c = f.get () ^ 0x01;
+    f.seekp (offset);
+    f.put (c);
+  }
+
+};
+
+TEST_F (MappedDataFileTests, RoundTrip)
+{
+  const uint64_t checksum = WriteFile ();
+  EXPECT_EQ (checksum, data.ComputeChecksum ());
+
+  MappedDataFile mapped;
+  ASSERT_TRUE (mapped.Open (file, true));
+  EXPECT_EQ (mapped.GetChecksum (), checksum);
+
+  const auto& read = mapped.GetData ();
+  EXPECT_EQ (std::vector<unsigned char> (read.obstacles,
+                                         read.obstacles + read.obstacleBytes),
+             obstacles);
+  EXPECT_EQ (std::vector<int16_t> (read.regionXCoord,
+                                   read.regionXCoord + read.regionEntries),
+             xcoords);
+  EXPECT_EQ (std::vector<unsigned char> (read.regionIds,
+                                         read.regionIds
+                                            + 3 * read.regionEntries),
+             ids);
+  EXPECT_EQ (std::vector<int16_t> (read.regionSpans,
+                                   read.regionSpans + 3 * read.regionEntries),
+             spans);
+  EXPECT_EQ (read.regionIdBound, spanOffsets.size () - 1);
+  EXPECT_EQ (std::vector<uint32_t> (read.regionSpanOffsets,
+                                    read.regionSpanOffsets
+                                        + read.regionIdBound + 1),
+             spanOffsets);
+}
+
+TEST_F (MappedDataFileTests, ChecksumMismatch)
+{
+  WriteFile ();
+  /* The obstacle data starts at the first page.  */
+  CorruptFile (4'096);
+
+  MappedDataFile unverified;
+  EXPECT_TRUE (unverified.Open (file, false));
+
+  MappedDataFile verified;
+  EXPECT_FALSE (verified.Open (file, true));
+}
+
+TEST_F (MappedDataFileTests, InvalidHeader)
+{
+  WriteFile ();
+  CorruptFile (0);
+
+  MappedDataFile mapped;
+  EXPECT_FALSE (mapped.Open (file, false));
+}
+
+TEST_F (MappedDataFileTests, SizeMismatch)
+{
+  WriteFile ();
+  {
+    std::ofstream out(file, std::ios_base::binary | std::ios_base::app);
+    out.put (0);
+  }
+
+  MappedDataFile mapped;
+  EXPECT_FALSE (mapped.Open (file, false));
+}
+
+TEST_F (MappedDataFileTests, MissingFile)
+{
+  MappedDataFile mapped;
+  EXPECT_FALSE (mapped.Open (file, false));
+}
+
+TEST (RawMapDataTests, MatchesCompiledChecksum)
+{
+  EXPECT_EQ (tiledata::GetRawData ().ComputeChecksum (),
+             tiledata::dataChecksum);
+}
+
+} // anonymous namespace
+} // namespace pxd
@@ -0,0 +1,101 @@
+/*
+    GSP for the Taurion blockchain game
+    Copyright (C) 2021  Autonomous Worlds Ltd
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#include "dyntiles.hpp"
+
+#include <atomic>
+
+namespace pxd
+{
+namespace dyntiles
+{
+
+namespace
+{
+
+/** Number of currently allocated buckets.  */
+std::atomic<uint64_t> numBuckets(0);
+
+/** Number of currently allocated bytes.  */
+std::atomic<uint64_t> numBytes(0);
+
+/** Peak number of allocated bytes.  */
+std::atomic<uint64_t> peakBytes(0);
+
+/** Number of buckets held in pools.  */
+std::atomic<uint64_t> numPooled(0);
+
+/** Number of bytes held in pools.  */
+std::atomic<uint64_t> numPooledBytes(0);
+
+} // anonymous namespace
+
+BucketUsage
+GetBucketUsage ()
+{
+  BucketUsage res;
+  res.buckets = numBuckets;
+  res.bytes = numBytes;
+  res.peakBytes = peakBytes;
+  res.pooled = numPooled;
+  res.pooledBytes = numPooledBytes;
+  return res;
+}
+
+void
+ResetPeakBucketBytes ()
+{
+  peakBytes = numBytes.load ();
+}
+
+void
+AccountBucket (const size_t bytes, const bool allocated)
+{
+  if (!allocated)
+    {
+      --numBuckets;
+      numBytes -= bytes;
+      return;
+    }
+
+  ++numBuckets;
+  const uint64_t now = (numBytes += bytes);
+
+  uint64_t peak = peakBytes;
+  while (now > peak && !peakBytes.compare_exchange_weak (peak, now))
+    ;
+}
+
+void
+AccountPooled (const size_t bytes, const bool added)
+{
+  if (added)
+    {
+      ++numPooled;
+      numPooledBytes += bytes;
+    }
+  else
+    {
+      --numPooled;
+      numPooledBytes -= bytes;
+    }
+}
+
+} // namespace dyntiles
+} // namespace pxd
@@ -24,6 +24,9 @@
 #include "hexagonal/coord.hpp"
 
 #include <array>
+#include <bitset>
+#include <cstdint>
+#include <vector>
 
 namespace pxd
 {
@@ -53,10 +56,24 @@ static_assert (BUCKET_SIZE * NUM_BUCKETS >= tiledata::numTiles,
                "number of buckets is too small to cover all tiles");
 
 /**
- * Custom implementation of an "optional object" of the given type.
- * We use that internally to represent bucket arrays in DynTiles.
+ * Maximum number of bytes (per bucket type) that we keep in the pool
+ * of free buckets for reuse.  Buckets freed beyond that are deallocated.
  */
-template <typename T> class Optional;
+constexpr size_t MAX_POOLED_BYTES = (64 << 20);
+
+/**
+ * A reference-counted bucket array.  Buckets can be shared between
+ * DynTiles instances (through snapshots), and are copied on write
+ * if they are.
+ */
+template <typename A> class Bucket;
+
+/**
+ * Process-wide pool of free buckets of a given array type.  Freed buckets
+ * are put here and reused rather than deallocated, since DynTiles
+ * instances are created and destroyed frequently (e.g. per block).
+ */
+template <typename A> class BucketPool;
 
 /**
  * Fixed array of N entries of type T like std::array, but this class
@@ -64,6 +81,52 @@ template <typename T> class Optional;
  */
 template <typename T, size_t N> class BucketArray;
 
+/**
+ * Memory usage of the buckets allocated by all DynTiles instances in
+ * the process together (e.g. by DynObstacles).
+ */
+struct BucketUsage
+{
+
+  /** Number of buckets currently allocated.  */
+  uint64_t buckets;
+
+  /** Bytes currently allocated for buckets.  */
+  uint64_t bytes;
+
+  /** Maximum of bytes since the last call to ResetPeakBucketBytes.  */
+  uint64_t peakBytes;
+
+  /** Number of free buckets held in the pools for reuse.  */
+  uint64_t pooled;
+
+  /** Bytes held by free buckets in the pools.  */
+  uint64_t pooledBytes;
+
+};
+
+/**
+ * Returns the current bucket memory usage.
+ */
+BucketUsage GetBucketUsage ();
+
+/**
+ * Resets the peak value of bucket bytes to the current usage.
+ */
+void ResetPeakBucketBytes ();
+
+/**
+ * Updates the bucket usage for a bucket of the given size being
+ * allocated or freed.  This is called internally by DynTiles.
+ */
+void AccountBucket (size_t bytes, bool allocated);
+
+/**
+ * Updates the pool statistics for a bucket of the given size being
+ * added to or taken out of a pool.
+ */
+void AccountPooled (size_t bytes, bool added);
+
 } // namespace dyntiles
 
 /**
@@ -73,6 +136,15 @@ template <typename T, size_t N> class BucketArray;
  *
  * For boolean type, this is memory efficient and stores them as individual
  * bits rather than bytes (using std::bitset under the hood).
+ *
+ * Buckets are taken from and returned to a process-wide pool, and the
+ * instance keeps track of the buckets it has touched.  Thus Clear() and
+ * destruction only cost time proportional to the touched buckets, and
+ * Snapshot() creates a copy that shares all buckets until one side
+ * modifies them.
+ *
+ * An instance itself is not thread-safe, but snapshots of it can be
+ * used (and modified) in other threads independently.
  */
 template <typename T>
   class DynTiles
@@ -83,15 +155,47 @@ private:
   /** The type of array for our buckets.  */
   using Array = dyntiles::BucketArray<T, dyntiles::BUCKET_SIZE>;
 
+  /** The reference-counted bucket type.  */
+  using Bucket = dyntiles::Bucket<Array>;
+
+  /** The pool to use for our buckets.  */
+  using Pool = dyntiles::BucketPool<Array>;
+
   /** The default value.  */
   const T defaultValue;
 
   /**
-   * The underlying data, as a vector of vectors.  Each entry here corresponds
-   * to BUCKET_SIZE tiles; it may be empty instead, in which case we assume
+   * The underlying data, as an array of buckets.  Each entry here corresponds
+   * to BUCKET_SIZE tiles; it may be null instead, in which case we assume
    * that all of those tiles are still at the default value.
    */
-  std::array<dyntiles::Optional<Array>, dyntiles::NUM_BUCKETS> data;
+  std::array<Bucket*, dyntiles::NUM_BUCKETS> data;
+
+  /**
+   * Indices of all buckets that have been touched, i.e. that are not null
+   * in data.  This allows us to clear the instance quickly.
+   */
+  std::vector<unsigned> dirty;
+
+  /**
+   * Buckets that may be shared with a snapshot.  Only for them do we need
+   * to check the reference count (and copy them if they are still shared)
+   * before writing.  This keeps the refcount out of the normal access path.
+   */
+  std::bitset<dyntiles::NUM_BUCKETS> maybeShared;
+
+  /**
+   * Copies the instance, sharing all buckets.  This is what Snapshot()
+   * uses; it is private so that copies are always explicit.
+   */
+  DynTiles (const DynTiles& o);
+
+  /**
+   * Makes sure the given bucket is allocated and not shared with any
+   * other instance, so that it can be written to.  This is the slow path
+   * of Access, which we keep out of line.
+   */
+  void PrepareWrite (size_t bucket);
 
 public:
 
@@ -100,9 +204,13 @@ public:
    */
   explicit DynTiles (const T& val);
 
+  DynTiles (DynTiles&& o);
+
+  ~DynTiles ();
+
   DynTiles () = delete;
-  DynTiles (const DynTiles&) = delete;
   void operator= (const DynTiles&) = delete;
+  void operator= (DynTiles&&) = delete;
 
   /**
    * Accesses and potentially modifies the element.  c must be on the map.
@@ -114,6 +222,22 @@ public:
    */
   typename Array::const_reference Get (const HexCoord& c) const;
 
+  /**
+   * Resets all elements back to the default value.  The buckets are
+   * returned to the pool, so that a later reuse of the instance does
+   * not need fresh allocations.
+   */
+  void Clear ();
+
+  /**
+   * Returns a copy of the current state.  The copy shares all buckets
+   * with this instance, and buckets are only duplicated when either of
+   * them modifies one.  This is cheap and can be used to pass the data
+   * on to readers (e.g. in another thread) while continuing to update
+   * the original.
+   */
+  DynTiles Snapshot ();
+
 };
 
 } // namespace pxd
@@ -20,7 +20,10 @@
 
 #include <glog/logging.h>
 
+#include <atomic>
 #include <bitset>
+#include <mutex>
+#include <utility>
 
 namespace pxd
 {
@@ -61,61 +64,122 @@ GetBuckets (const size_t fullIndex, size_t& bucket, size_t& within)
 #endif // ENABLE_SLOW_ASSERTS
 }
 
-template <typename T>
-  class Optional
+template <typename A>
+  class Bucket
 {
 
-private:
+public:
 
-  /** The value if present.  */
-  T* value = nullptr;
+  /** The actual data array.  */
+  A data;
 
-public:
+  /** Number of DynTiles instances referencing this bucket.  */
+  std::atomic<unsigned> refs;
 
-  Optional () = default;
+  Bucket () = default;
 
-  ~Optional ()
+  Bucket (const Bucket<A>&) = delete;
+  void operator= (const Bucket<A>&) = delete;
+
+  /**
+   * Returns true if the bucket is referenced by more than one instance,
+   * so that it has to be copied before modifying it.
+   */
+  bool
+  IsShared () const
   {
-    /* For some reason, it makes a huge performance difference (e.g. in the
-       DynTilesBoolConstruction benchmark) to explicitly check for the
-       pointer being null before the delete.  */
-    if (value != nullptr)
-      delete value;
+    return refs.load (std::memory_order_acquire) > 1;
   }
 
-  Optional (const Optional<T>&) = delete;
-  void operator= (const Optional<T>&) = delete;
+};
+
+template <typename A>
+  class BucketPool
+{
+
+private:
+
+  /** Maximum number of buckets we keep.  */
+  static constexpr size_t MAX_FREE = MAX_POOLED_BYTES / sizeof (A);
+
+  /** The free buckets.  */
+  std::vector<Bucket<A>*> free;
+
+  /** Lock for this instance.  */
+  std::mutex mut;
+
+  BucketPool () = default;
 
   /**
-   * Extracts the value if it is present, returning nullptr if not.
+   * Returns the process-wide instance.  It is never destructed, so that
+   * buckets can be released safely also during static destruction.
    */
-  T*
-  Get ()
+  static BucketPool&
+  Instance ()
   {
-    return value;
+    static auto* instance = new BucketPool ();
+    return *instance;
   }
 
+public:
+
+  BucketPool (const BucketPool&) = delete;
+  void operator= (const BucketPool&) = delete;
+
   /**
-   * Extracts the value if it is present, returning nullptr if not.
+   * Returns a bucket with a reference count of one, either taken from the
+   * pool or freshly allocated.  The content of the data array is undefined.
    */
-  const T*
-  Get () const
+  static Bucket<A>*
+  Acquire ()
   {
-    return value;
+    auto& pool = Instance ();
+
+    Bucket<A>* res = nullptr;
+    {
+      std::lock_guard<std::mutex> lock(pool.mut);
+      if (!pool.free.empty ())
+        {
+          res = pool.free.back ();
+          pool.free.pop_back ();
+        }
+    }
+
+    if (res == nullptr)
+      res = new Bucket<A> ();
+    else
+      AccountPooled (sizeof (A), false);
+
+    res->refs.store (1, std::memory_order_relaxed);
+    AccountBucket (sizeof (A), true);
+
+    return res;
   }
 
   /**
-   * Ensures that there is a value.  If there is not, it is
-   * default-constructed.  Returns true if the value was constructed.
+   * Drops one reference to the given bucket.  If this was the last one,
+   * the bucket is returned to the pool (or freed if the pool is full).
    */
-  bool
-  MaybeConstruct ()
+  static void
+  Unref (Bucket<A>* b)
   {
-    if (value != nullptr)
-      return false;
-
-    value = new T ();
-    return true;
+    if (b->refs.fetch_sub (1, std::memory_order_acq_rel) > 1)
+      return;
+
+    AccountBucket (sizeof (A), false);
+
+    auto& pool = Instance ();
+    {
+      std::lock_guard<std::mutex> lock(pool.mut);
+      if (pool.free.size () < MAX_FREE)
+        {
+          pool.free.push_back (b);
+          AccountPooled (sizeof (A), true);
+          return;
+        }
+    }
+
+    delete b;
   }
 
 };
@@ -153,7 +217,59 @@ public:
 template <typename T>
   DynTiles<T>::DynTiles (const T& val)
   : defaultValue(val)
-{}
+{
+  data.fill (nullptr);
+}
+
+template <typename T>
+  DynTiles<T>::DynTiles (const DynTiles& o)
+  : defaultValue(o.defaultValue), data(o.data), dirty(o.dirty),
+    maybeShared(o.maybeShared)
+{
+  for (const auto b : dirty)
+    data[b]->refs.fetch_add (1, std::memory_order_relaxed);
+}
+
+template <typename T>
+  DynTiles<T>::DynTiles (DynTiles&& o)
+  : defaultValue(o.defaultValue), data(o.data), dirty(std::move (o.dirty)),
+    maybeShared(o.maybeShared)
+{
+  for (const auto b : dirty)
+    o.data[b] = nullptr;
+  o.dirty.clear ();
+  o.maybeShared.reset ();
+}
+
+template <typename T>
+  DynTiles<T>::~DynTiles ()
+{
+  Clear ();
+}
+
+template <typename T>
+  void
+  DynTiles<T>::PrepareWrite (const size_t bucket)
+{
+  auto& part = data[bucket];
+
+  if (part == nullptr)
+    {
+      part = Pool::Acquire ();
+      part->data.fill (defaultValue);
+      dirty.push_back (bucket);
+      return;
+    }
+
+  if (part->IsShared ())
+    {
+      auto* copy = Pool::Acquire ();
+      copy->data = part->data;
+      Pool::Unref (part);
+      part = copy;
+    }
+  maybeShared[bucket] = false;
+}
 
 template <typename T>
   inline typename DynTiles<T>::Array::reference
@@ -162,11 +278,11 @@ template <typename T>
   size_t bucket, within;
   dyntiles::GetBuckets (dyntiles::GetIndex (c), bucket, within);
 
-  auto& part = data[bucket];
-  if (part.MaybeConstruct ())
-    part.Get ()->fill (defaultValue);
+  auto*& part = data[bucket];
+  if (part == nullptr || maybeShared[bucket])
+    PrepareWrite (bucket);
 
-  return (*part.Get ())[within];
+  return part->data[within];
 }
 
 template <typename T>
@@ -176,11 +292,35 @@ template <typename T>
   size_t bucket, within;
   dyntiles::GetBuckets (dyntiles::GetIndex (c), bucket, within);
 
-  const auto& part = data[bucket];
-  if (part.Get () == nullptr)
+  const auto* part = data[bucket];
+  if (part == nullptr)
     return defaultValue;
 
-  return (*part.Get ())[within];
+  return part->data[within];
+}
+
+template <typename T>
+  void
+  DynTiles<T>::Clear ()
+{
+  for (const auto b : dirty)
+    {
+      Pool::Unref (data[b]);
+      data[b] = nullptr;
+    }
+  dirty.clear ();
+  maybeShared.reset ();
+}
+
+template <typename T>
+  DynTiles<T>
+  DynTiles<T>::Snapshot ()
+{
+  for (const auto b : dirty)
+    maybeShared[b] = true;
+
+  DynTiles<T> res(*this);
+  return res;
 }
 
 } // namespace pxd
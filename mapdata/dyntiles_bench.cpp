@@ -143,5 +143,74 @@ BENCHMARK (DynTilesBoolReadInitialised)
   ->Args ({10000, 100})
   ->Args ({10000, 1000});
 
+/**
+ * Benchmarks repeated use of DynTiles<bool> for a sparse set of updates,
+ * as done e.g. for DynObstacles once per block.  The first argument is the
+ * number of random coordinates to set, and the second argument is whether
+ * we construct a fresh instance each time (0) or clear and reuse an
+ * existing one (1).
+ */
+void
+DynTilesBoolReuse (benchmark::State& state)
+{
+  const unsigned n = state.range (0);
+  const bool reuse = state.range (1);
+
+  std::srand (42);
+  const auto coords = RandomCoords (n);
+
+  DynTiles<bool> existing(false);
+  for (auto _ : state)
+    {
+      if (reuse)
+        {
+          existing.Clear ();
+          for (const auto& c : coords)
+            existing.Access (c) = true;
+        }
+      else
+        {
+          DynTiles<bool> dyn(false);
+          for (const auto& c : coords)
+            dyn.Access (c) = true;
+        }
+    }
+}
+BENCHMARK (DynTilesBoolReuse)
+  ->Unit (benchmark::kMicrosecond)
+  ->Args ({100, 0})
+  ->Args ({100, 1})
+  ->Args ({10000, 0})
+  ->Args ({10000, 1});
+
+/**
+ * Benchmarks taking a snapshot of a DynTiles<bool> instance and then
+ * modifying the original.  The argument is the number of random coordinates
+ * that are set initially and then changed after the snapshot.
+ */
+void
+DynTilesBoolSnapshot (benchmark::State& state)
+{
+  const unsigned n = state.range (0);
+
+  std::srand (42);
+  const auto coords = RandomCoords (n);
+
+  DynTiles<bool> dyn(false);
+  for (const auto& c : coords)
+    dyn.Access (c) = true;
+
+  for (auto _ : state)
+    {
+      auto snapshot = dyn.Snapshot ();
+      for (const auto& c : coords)
+        dyn.Access (c) = !dyn.Get (c);
+    }
+}
+BENCHMARK (DynTilesBoolSnapshot)
+  ->Unit (benchmark::kMicrosecond)
+  ->Arg (100)
+  ->Arg (10000);
+
 } // anonymous namespace
 } // namespace pxd
@@ -25,6 +25,8 @@
 #include <gtest/gtest.h>
 
 #include <functional>
+#include <memory>
+#include <utility>
 
 namespace pxd
 {
@@ -65,5 +67,147 @@ TEST_F (DynTilesTests, FullMap)
     });
 }
 
+TEST_F (DynTilesTests, BucketUsage)
+{
+  const auto before = dyntiles::GetBucketUsage ();
+  dyntiles::ResetPeakBucketBytes ();
+
+  {
+    DynTiles<int> m(0);
+    m.Get (HexCoord (0, 0));
+    EXPECT_EQ (dyntiles::GetBucketUsage ().buckets, before.buckets);
+
+    m.Access (HexCoord (0, 0)) = 42;
+    m.Access (HexCoord (1, 0)) = 42;
+    const auto during = dyntiles::GetBucketUsage ();
+    EXPECT_EQ (during.buckets, before.buckets + 1);
+    EXPECT_EQ (during.bytes,
+               before.bytes + dyntiles::BUCKET_SIZE * sizeof (int));
+  }
+
+  const auto after = dyntiles::GetBucketUsage ();
+  EXPECT_EQ (after.buckets, before.buckets);
+  EXPECT_EQ (after.bytes, before.bytes);
+  EXPECT_EQ (after.peakBytes,
+             before.bytes + dyntiles::BUCKET_SIZE * sizeof (int));
+
+  dyntiles::ResetPeakBucketBytes ();
+  EXPECT_EQ (dyntiles::GetBucketUsage ().peakBytes, before.bytes);
+}
+
+TEST_F (DynTilesTests, Clear)
+{
+  const auto base = dyntiles::GetBucketUsage ().buckets;
+  const HexCoord a(0, 0);
+  const HexCoord b(-2000, 1000);
+
+  DynTiles<int> m(5);
+  m.Access (a) = 10;
+  m.Access (b) = 20;
+  EXPECT_EQ (dyntiles::GetBucketUsage ().buckets, base + 2);
+
+  m.Clear ();
+  EXPECT_EQ (dyntiles::GetBucketUsage ().buckets, base);
+  EXPECT_EQ (m.Get (a), 5);
+  EXPECT_EQ (m.Get (b), 5);
+
+  m.Access (b) = 30;
+  EXPECT_EQ (m.Get (a), 5);
+  EXPECT_EQ (m.Get (b), 30);
+  EXPECT_EQ (dyntiles::GetBucketUsage ().buckets, base + 1);
+}
+
+TEST_F (DynTilesTests, BucketsArePooled)
+{
+  const HexCoord c(10, -10);
+
+  {
+    DynTiles<int> m(0);
+    m.Access (c) = 42;
+  }
+
+  const auto before = dyntiles::GetBucketUsage ();
+  ASSERT_GT (before.pooled, 0);
+
+  DynTiles<int> m(0);
+  EXPECT_EQ (m.Get (c), 0);
+  m.Access (c) = 1;
+  EXPECT_EQ (m.Get (c), 1);
+  EXPECT_EQ (m.Get (HexCoord (11, -10)), 0);
+
+  const auto after = dyntiles::GetBucketUsage ();
+  EXPECT_EQ (after.pooled, before.pooled - 1);
+  EXPECT_EQ (after.pooledBytes,
+             before.pooledBytes - dyntiles::BUCKET_SIZE * sizeof (int));
+  EXPECT_EQ (after.buckets, before.buckets + 1);
+}
+
+TEST_F (DynTilesTests, Snapshot)
+{
+  const auto base = dyntiles::GetBucketUsage ().buckets;
+  const HexCoord a(0, 0);
+  const HexCoord b(1, 0);
+  const HexCoord c(-2000, 1000);
+
+  DynTiles<int> m(0);
+  m.Access (a) = 1;
+  m.Access (c) = 2;
+
+  auto snapshot = m.Snapshot ();
+  EXPECT_EQ (snapshot.Get (a), 1);
+  EXPECT_EQ (snapshot.Get (b), 0);
+  EXPECT_EQ (snapshot.Get (c), 2);
+  EXPECT_EQ (dyntiles::GetBucketUsage ().buckets, base + 2);
+
+  m.Access (a) = 10;
+  m.Access (b) = 20;
+  snapshot.Access (c) = 30;
+  EXPECT_EQ (dyntiles::GetBucketUsage ().buckets, base + 4);
+
+  EXPECT_EQ (m.Get (a), 10);
+  EXPECT_EQ (m.Get (b), 20);
+  EXPECT_EQ (m.Get (c), 2);
+  EXPECT_EQ (snapshot.Get (a), 1);
+  EXPECT_EQ (snapshot.Get (b), 0);
+  EXPECT_EQ (snapshot.Get (c), 30);
+
+  m.Clear ();
+  EXPECT_EQ (m.Get (a), 0);
+  EXPECT_EQ (snapshot.Get (a), 1);
+  EXPECT_EQ (dyntiles::GetBucketUsage ().buckets, base + 2);
+}
+
+TEST_F (DynTilesTests, SnapshotOutlivesOriginal)
+{
+  const auto base = dyntiles::GetBucketUsage ().buckets;
+  const HexCoord c(5, 5);
+
+  auto m = std::make_unique<DynTiles<bool>> (false);
+  m->Access (c) = true;
+  auto snapshot = m->Snapshot ();
+  m.reset ();
+
+  EXPECT_TRUE (snapshot.Get (c));
+  EXPECT_EQ (dyntiles::GetBucketUsage ().buckets, base + 1);
+
+  /* The bucket is no longer shared, so this must not copy it.  */
+  snapshot.Access (c) = false;
+  EXPECT_FALSE (snapshot.Get (c));
+  EXPECT_EQ (dyntiles::GetBucketUsage ().buckets, base + 1);
+}
+
+TEST_F (DynTilesTests, Move)
+{
+  const auto base = dyntiles::GetBucketUsage ().buckets;
+  const HexCoord c(5, 5);
+
+  DynTiles<bool> m(false);
+  m.Access (c) = true;
+
+  DynTiles<bool> moved(std::move (m));
+  EXPECT_TRUE (moved.Get (c));
+  EXPECT_EQ (dyntiles::GetBucketUsage ().buckets, base + 1);
+}
+
 } // anonymous namespace
 } // namespace pxd
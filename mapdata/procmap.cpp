@@ -22,6 +22,7 @@
 
 #include "config.h"
 
+#include "datafile.hpp"
 #include "dataio.hpp"
 #include "tiledata.hpp"
 
@@ -31,12 +32,17 @@
 #include <gflags/gflags.h>
 #include <glog/logging.h>
 
+#include <algorithm>
+#include <array>
 #include <cstdint>
 #include <cstdlib>
 #include <fstream>
 #include <iostream>
 #include <set>
+#include <sstream>
+#include <string>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
 DEFINE_string (obstacle_input, "",
@@ -51,6 +57,13 @@ DEFINE_string (region_xcoord_output, "",
                "The output file for x coordinates in compact region data");
 DEFINE_string (region_ids_output, "",
                "The output file for IDs in the compact region data");
+DEFINE_string (region_spans_output, "",
+               "The output file for the spans of all regions");
+DEFINE_string (region_span_offsets_output, "",
+               "The output file for the offsets of each region's spans");
+DEFINE_string (data_file_output, "",
+               "If set, write all raw data as map data file for"
+               " memory-mapping at runtime here");
 
 namespace pxd
 {
@@ -521,6 +534,13 @@ public:
  * and x coordinate between x (inclusive) and the next x (exclusive) have the
  * given region ID.  This compacts data massively, and still allows efficient
  * lookup using binary search over x.
+ *
+ * In addition, we output the same runs grouped by region:  For each region
+ * ID, the list of its spans as (y, x begin, x end) triplets with inclusive
+ * x range, ordered by row.  An array of offsets (indexed by region ID) gives
+ * the start of each region's spans, so that the shape of a region can be
+ * read directly without having to flood-fill it.  This requires that each
+ * region is connected, which is verified when writing the spans.
  */
 class RegionData : public PerTileData
 {
@@ -551,6 +571,62 @@ protected:
     ++numTiles;
   }
 
+  /** A span of a region, as region ID and (y, x begin, x end).  */
+  using CoordT = int16_t;
+  using Span = std::pair<int32_t, std::array<CoordT, 3>>;
+
+  /**
+   * Checks that the spans of a single region (ordered by row) form
+   * a connected shape.  This is what the former flood-fill implementation
+   * of RegionMap::GetRegionShape returned, so that using the spans instead
+   * is only equivalent if it holds.
+   */
+  static void
+  CheckConnected (const std::vector<Span>::const_iterator begin,
+                  const std::vector<Span>::const_iterator end)
+  {
+    const size_t n = end - begin;
+    std::vector<size_t> parent(n);
+    for (size_t i = 0; i < n; ++i)
+      parent[i] = i;
+
+    const auto find = [&parent] (size_t i)
+      {
+        while (parent[i] != i)
+          {
+            parent[i] = parent[parent[i]];
+            i = parent[i];
+          }
+        return i;
+      };
+
+    /* Spans in the same row are never adjacent (they would have been
+       merged), so we only have to check spans in the next row.  The tile
+       (x, y) is adjacent to (x, y + 1) and (x - 1, y + 1).  */
+    size_t components = n;
+    for (size_t i = 0; i < n; ++i)
+      {
+        const auto& a = begin[i].second;
+        for (size_t j = i + 1; j < n && begin[j].second[0] <= a[0] + 1; ++j)
+          {
+            const auto& b = begin[j].second;
+            if (b[0] != a[0] + 1 || b[1] > a[2] || b[2] < a[1] - 1)
+              continue;
+
+            const size_t ri = find (i);
+            const size_t rj = find (j);
+            if (ri != rj)
+              {
+                parent[ri] = rj;
+                --components;
+              }
+          }
+      }
+
+    CHECK_EQ (components, 1)
+        << "Region " << begin->first << " is not connected";
+  }
+
 public:
 
   RegionData ()
@@ -604,11 +680,16 @@ public:
    */
   void
   Write (std::ostream& codeOut,
-         std::ostream& xcoordOut, std::ostream& idsOut) const
+         std::ostream& xcoordOut, std::ostream& idsOut,
+         std::ostream& spansOut, std::ostream& spanOffsetsOut) const
   {
     LOG (INFO) << "Writing region map data...";
     codeOut << "namespace regions {" << std::endl;
 
+    /* The spans of all regions.  They are collected in row order here,
+       and then sorted (stably) by region ID when writing them.  */
+    std::vector<Span> spans;
+
     int entries = 0;
     codeOut << "const size_t compactOffsetForY[] = {" << std::endl;
     for (int y = GetRanges ().GetRowRange ().minVal;
@@ -616,7 +697,6 @@ public:
       {
         codeOut << "  " << entries << "," << std::endl;
 
-        using CoordT = int16_t;
         std::vector<CoordT> xCoords;
 
         const auto& colRange = GetRanges ().GetColumnRange (y);
@@ -633,7 +713,15 @@ public:
                 WriteInt24 (idsOut, val);
                 ++entries;
                 lastVal = val;
+
+                std::array<CoordT, 3> span;
+                span[0] = y;
+                span[1] = x;
+                span[2] = x;
+                spans.emplace_back (val, span);
               }
+            else
+              spans.back ().second[2] = x;
           }
 
         xcoordOut.write (reinterpret_cast<const char*> (xCoords.data ()),
@@ -644,11 +732,91 @@ public:
 
     codeOut << "const size_t compactEntries = " << entries << ";" << std::endl;
 
+    LOG (INFO) << "Writing region spans...";
+    std::stable_sort (spans.begin (), spans.end (),
+                      [] (const Span& a, const Span& b)
+                        {
+                          return a.first < b.first;
+                        });
+
+    const int32_t idBound = idRange.maxVal + 1;
+    auto spanIt = spans.cbegin ();
+    for (int32_t id = 0; id <= idBound; ++id)
+      {
+        const uint32_t offset = spanIt - spans.cbegin ();
+        spanOffsetsOut.write (reinterpret_cast<const char*> (&offset),
+                              sizeof (offset));
+
+        const auto regionBegin = spanIt;
+        for (; spanIt != spans.cend () && spanIt->first == id; ++spanIt)
+          spansOut.write (reinterpret_cast<const char*> (
+                              spanIt->second.data ()),
+                          sizeof (CoordT) * spanIt->second.size ());
+        if (spanIt != regionBegin)
+          CheckConnected (regionBegin, spanIt);
+      }
+    CHECK (spanIt == spans.cend ());
+
+    codeOut << "const size_t idBound = " << idBound << ";" << std::endl;
+
     codeOut << "} // namespace regions" << std::endl;
   }
 
 };
 
+/**
+ * Reads the full content of a binary file as string.
+ */
+std::string
+ReadFile (const std::string& file)
+{
+  std::ifstream in(file, std::ios_base::binary);
+  CHECK (in) << "Failed to open " << file;
+
+  std::ostringstream data;
+  data << in.rdbuf ();
+  return data.str ();
+}
+
+/**
+ * Reads back the raw data from the binary blob files, and writes the
+ * checksum over it as C++ code.  If a data file output is set, also
+ * writes the raw data to it.
+ */
+void
+WriteChecksumAndDataFile (std::ostream& codeOut)
+{
+  const std::string obstacles = ReadFile (FLAGS_obstacle_output);
+  const std::string xcoords = ReadFile (FLAGS_region_xcoord_output);
+  const std::string ids = ReadFile (FLAGS_region_ids_output);
+  const std::string spans = ReadFile (FLAGS_region_spans_output);
+  const std::string spanOffsets = ReadFile (FLAGS_region_span_offsets_output);
+
+  RawMapData data;
+  data.obstacles = reinterpret_cast<const unsigned char*> (obstacles.data ());
+  data.obstacleBytes = obstacles.size ();
+  data.regionXCoord = reinterpret_cast<const int16_t*> (xcoords.data ());
+  data.regionIds = reinterpret_cast<const unsigned char*> (ids.data ());
+  data.regionEntries = xcoords.size () / sizeof (int16_t);
+  data.regionSpans = reinterpret_cast<const int16_t*> (spans.data ());
+  data.regionSpanOffsets
+      = reinterpret_cast<const uint32_t*> (spanOffsets.data ());
+  data.regionIdBound = spanOffsets.size () / sizeof (uint32_t) - 1;
+
+  uint64_t checksum;
+  if (FLAGS_data_file_output.empty ())
+    checksum = data.ComputeChecksum ();
+  else
+    {
+      LOG (INFO) << "Writing map data file...";
+      std::ofstream out(FLAGS_data_file_output, std::ios_base::binary);
+      checksum = WriteMapDataFile (data, out);
+    }
+
+  codeOut << "const uint64_t dataChecksum = " << checksum << "ull;"
+          << std::endl;
+}
+
 } // anonymous namespace
 } // namespace pxd
 
@@ -669,6 +837,10 @@ main (int argc, char** argv)
       << "--region_xcoord_output must be set";
   CHECK (!FLAGS_region_ids_output.empty ())
       << "--region_ids_output must be set";
+  CHECK (!FLAGS_region_spans_output.empty ())
+      << "--region_spans_output must be set";
+  CHECK (!FLAGS_region_span_offsets_output.empty ())
+      << "--region_span_offsets_output must be set";
 
   std::ofstream codeOut(FLAGS_code_output);
   CHECK (codeOut);
@@ -710,9 +882,14 @@ main (int argc, char** argv)
 
     std::ofstream xcoordOut(FLAGS_region_xcoord_output, std::ios_base::binary);
     std::ofstream idsOut(FLAGS_region_ids_output, std::ios_base::binary);
-    regions.Write (codeOut, xcoordOut, idsOut);
+    std::ofstream spansOut(FLAGS_region_spans_output, std::ios_base::binary);
+    std::ofstream spanOffsetsOut(FLAGS_region_span_offsets_output,
+                                 std::ios_base::binary);
+    regions.Write (codeOut, xcoordOut, idsOut, spansOut, spanOffsetsOut);
   }
 
+  pxd::WriteChecksumAndDataFile (codeOut);
+
   codeOut << "} // namespace tiledata" << std::endl;
   codeOut << "} // namespace pxd" << std::endl;
 
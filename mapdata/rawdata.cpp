@@ -0,0 +1,140 @@
+/*
+    GSP for the Taurion blockchain game
+    Copyright (C) 2021  Autonomous Worlds Ltd
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#include "datafile.hpp"
+
+#include "tiledata.hpp"
+
+#include <glog/logging.h>
+
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+
+namespace pxd
+{
+namespace tiledata
+{
+
+namespace
+{
+
+/** Lock for the global state below.  */
+std::mutex mut;
+
+/** The memory-mapped data file, if one is used.  */
+std::unique_ptr<MappedDataFile> dataFile;
+
+/** The raw data in use, once it has been determined.  */
+const RawMapData* rawData = nullptr;
+
+/** Name of the environment variable that can specify a data file.  */
+constexpr const char* ENV_DATA_FILE = "TAURION_MAPDATA";
+
+/**
+ * Returns the embedded blobs as RawMapData.
+ */
+const RawMapData&
+GetEmbeddedData ()
+{
+#ifdef PXD_NO_EMBEDDED_MAPDATA
+  LOG (FATAL)
+      << "Map data is not embedded into this binary, a data file must be"
+      << " specified (e.g. with the " << ENV_DATA_FILE
+      << " environment variable)";
+#else // PXD_NO_EMBEDDED_MAPDATA
+  static const RawMapData embedded = [] ()
+    {
+      RawMapData res;
+      res.obstacles = &blob_obstacles_start;
+      res.obstacleBytes = &blob_obstacles_end - &blob_obstacles_start;
+      res.regionXCoord = &blob_region_xcoord_start;
+      res.regionIds = &blob_region_ids_start;
+      res.regionEntries = &blob_region_xcoord_end - &blob_region_xcoord_start;
+      res.regionSpans = &blob_region_spans_start;
+      res.regionSpanOffsets = &blob_region_span_offsets_start;
+      res.regionIdBound = &blob_region_span_offsets_end
+                            - &blob_region_span_offsets_start - 1;
+      return res;
+    } ();
+
+  return embedded;
+#endif // PXD_NO_EMBEDDED_MAPDATA
+}
+
+/**
+ * Maps the given data file and checks it against the compiled-in
+ * metadata.  Must be called with the lock held.
+ */
+bool
+MapDataFile (const std::string& file)
+{
+  auto mappedFile = std::make_unique<MappedDataFile> ();
+  if (!mappedFile->Open (file, true))
+    return false;
+
+  const auto& data = mappedFile->GetData ();
+  if (mappedFile->GetChecksum () != dataChecksum
+        || data.obstacleBytes != obstacles::bitDataSize
+        || data.regionEntries != regions::compactEntries
+        || data.regionIdBound != regions::idBound)
+    {
+      LOG (ERROR)
+          << "Map data file " << file << " does not match the map data"
+          << " this binary was built with";
+      return false;
+    }
+
+  dataFile = std::move (mappedFile);
+  rawData = &dataFile->GetData ();
+  return true;
+}
+
+} // anonymous namespace
+
+const RawMapData&
+GetRawData ()
+{
+  std::lock_guard<std::mutex> lock(mut);
+
+  if (rawData == nullptr)
+    {
+      const char* envFile = std::getenv (ENV_DATA_FILE);
+      if (envFile != nullptr && envFile[0] != '\0')
+        CHECK (MapDataFile (envFile))
+            << "Failed to use map data file " << envFile
+            << " from " << ENV_DATA_FILE;
+      else
+        rawData = &GetEmbeddedData ();
+    }
+
+  return *rawData;
+}
+
+bool
+UseDataFile (const std::string& file)
+{
+  std::lock_guard<std::mutex> lock(mut);
+  CHECK (rawData == nullptr) << "Map data has already been accessed";
+
+  return MapDataFile (file);
+}
+
+} // namespace tiledata
+} // namespace pxd
@@ -18,49 +18,99 @@
 
 #include "regionmap.hpp"
 
+#include "datafile.hpp"
 #include "tiledata.hpp"
 
-#include "hexagonal/rangemap.hpp"
-
 #include <glog/logging.h>
 
 #include <algorithm>
-#include <queue>
+#include <limits>
 
 namespace pxd
 {
 
 constexpr RegionMap::IdT RegionMap::OUT_OF_MAP;
+constexpr int RegionMap::BUCKET_WIDTH;
 
-RegionMap::RegionMap ()
+namespace
 {
-  using tiledata::regions::compactEntries;
-  CHECK_EQ (&blob_region_xcoord_end - &blob_region_xcoord_start,
-            compactEntries);
-  CHECK_EQ (&blob_region_ids_end - &blob_region_ids_start,
-            tiledata::regions::BYTES_PER_ID * compactEntries);
+
+/**
+ * Returns the index into the compact data where the entries for the
+ * row with the given index end.
+ */
+size_t
+RowEnd (const int yInd)
+{
+  if (yInd < tiledata::maxY - tiledata::minY)
+    return tiledata::regions::compactOffsetForY[yInd + 1];
+  return tiledata::regions::compactEntries;
 }
 
-RegionMap::IdT
-RegionMap::GetRegionId (const HexCoord& c) const
+} // anonymous namespace
+
+RegionMap::RegionMap (const bool useIndex)
+  : xCoords(tiledata::GetRawData ().regionXCoord),
+    ids(tiledata::GetRawData ().regionIds),
+    spans(tiledata::GetRawData ().regionSpans),
+    spanOffsets(tiledata::GetRawData ().regionSpanOffsets)
 {
-  const auto x = c.GetX ();
-  const auto y = c.GetY ();
+  CHECK_EQ (tiledata::GetRawData ().regionEntries,
+            tiledata::regions::compactEntries);
+  CHECK_EQ (tiledata::GetRawData ().regionIdBound,
+            tiledata::regions::idBound);
 
-  if (y < tiledata::minY || y > tiledata::maxY)
-    return OUT_OF_MAP;
-  const int yInd = y - tiledata::minY;
+  if (useIndex)
+    BuildIndex ();
+}
 
-  if (x < tiledata::minX[yInd] || x > tiledata::maxX[yInd])
-    return OUT_OF_MAP;
+void
+RegionMap::BuildIndex ()
+{
+  const int numRows = tiledata::maxY - tiledata::minY + 1;
+  bucketOffsetForY.reserve (numRows);
+
+  for (int yInd = 0; yInd < numRows; ++yInd)
+    {
+      bucketOffsetForY.push_back (bucketEntries.size ());
+
+      const size_t end = RowEnd (yInd);
+      size_t entry = tiledata::regions::compactOffsetForY[yInd];
+      CHECK_EQ (xCoords[entry], tiledata::minX[yInd]);
+
+      for (int x = tiledata::minX[yInd]; x <= tiledata::maxX[yInd];
+           x += BUCKET_WIDTH)
+        {
+          while (entry + 1 < end && xCoords[entry + 1] <= x)
+            ++entry;
+          bucketEntries.push_back (entry);
+        }
+    }
+
+  CHECK_LE (tiledata::regions::compactEntries,
+            std::numeric_limits<uint32_t>::max ());
+  VLOG (1)
+      << "Built region lookup index with " << bucketEntries.size ()
+      << " buckets";
+}
 
-  using tiledata::regions::compactOffsetForY;
-  const int16_t* xBegin = &blob_region_xcoord_start + compactOffsetForY[yInd];
-  const int16_t* xEnd;
-  if (y < tiledata::maxY)
-    xEnd = &blob_region_xcoord_start + compactOffsetForY[yInd + 1];
-  else
-    xEnd = &blob_region_xcoord_end;
+size_t
+RegionMap::FindEntry (const int x, const int yInd) const
+{
+  const size_t end = RowEnd (yInd);
+
+  if (!bucketEntries.empty ())
+    {
+      const int bucket = (x - tiledata::minX[yInd]) / BUCKET_WIDTH;
+      size_t entry = bucketEntries[bucketOffsetForY[yInd] + bucket];
+      while (entry + 1 < end && xCoords[entry + 1] <= x)
+        ++entry;
+
+      return entry;
+    }
+
+  const int16_t* xBegin = xCoords + tiledata::regions::compactOffsetForY[yInd];
+  const int16_t* xEnd = xCoords + end;
 
   /* Calling std::upper_bound on the sorted row of x coordinates gives us
      the first element that is larger than our x.  This means that the
@@ -73,9 +123,24 @@ RegionMap::GetRegionId (const HexCoord& c) const
   --xFound;
   CHECK_LE (*xFound, x);
 
+  return xFound - xCoords;
+}
+
+RegionMap::IdT
+RegionMap::GetRegionId (const HexCoord& c) const
+{
+  const auto x = c.GetX ();
+  const auto y = c.GetY ();
+
+  if (y < tiledata::minY || y > tiledata::maxY)
+    return OUT_OF_MAP;
+  const int yInd = y - tiledata::minY;
+
+  if (x < tiledata::minX[yInd] || x > tiledata::maxX[yInd])
+    return OUT_OF_MAP;
+
   using tiledata::regions::BYTES_PER_ID;
-  const size_t offs = xFound - &blob_region_xcoord_start;
-  const unsigned char* data = &blob_region_ids_start + BYTES_PER_ID * offs;
+  const unsigned char* data = ids + BYTES_PER_ID * FindEntry (x, yInd);
 
   IdT res = 0;
   for (int i = 0; i < BYTES_PER_ID; ++i)
@@ -85,100 +150,49 @@ RegionMap::GetRegionId (const HexCoord& c) const
   return res;
 }
 
-namespace
+size_t
+RegionMap::GetIndexBytes () const
 {
+  return sizeof (uint32_t) * (bucketEntries.capacity ()
+                                + bucketOffsetForY.capacity ());
+}
 
-/**
- * Simple helper class for the state while we do a flood fill of some region.
- */
-class RegionFiller
+std::vector<RegionMap::Span>
+RegionMap::GetRegionSpans (const IdT id) const
 {
+  std::vector<Span> res;
+  if (id >= tiledata::regions::idBound)
+    return res;
+
+  const uint32_t begin = spanOffsets[id];
+  const uint32_t end = spanOffsets[id + 1];
+  res.reserve (end - begin);
+
+  for (const int16_t* data = spans + 3 * begin; data != spans + 3 * end;
+       data += 3)
+    {
+      Span s;
+      s.y = data[0];
+      s.xBegin = data[1];
+      s.xEnd = data[2];
+      res.push_back (s);
+    }
 
-private:
-
-  /** The result set being built up.  */
-  std::set<HexCoord> regionTiles;
-
-  /** Stores whether or not a tile has already been processed.  */
-  RangeMap<bool> processed;
-
-  /**
-   * The queue of tiles to still process.  Each tile on here is known to be
-   * in the region and already in the result set, but we still need to
-   * iterate over and process its neighbours.
-   */
-  std::queue<HexCoord> todo;
-
-public:
-
-  /**
-   * Constructs the object with basic initialisation.  The initial tile
-   * ("seed") for the flood fill has not yet been added here.  The l1range
-   * of the processed map is chosen such that all regions on the actual
-   * map fit inside.
-   */
-  explicit RegionFiller (const HexCoord& c)
-    : processed(c, 100, false)
-  {}
-
-  /**
-   * Moves out the result set.
-   */
-  std::set<HexCoord>
-  MoveResult ()
-  {
-    return std::move (regionTiles);
-  }
-
-  /**
-   * Adds a tile to the result set and queues it for processing.  This is
-   * called whenever we determine that some coordinate is in the region.
-   */
-  void
-  AddRegionTile (const HexCoord& c)
-  {
-    /* Since the RangeMap has an underlying data storage of std::vector<bool>,
-       its Access method does not return bool& but the bit-reference wrapper.
-       Hence we cannot say "auto&" here, but in effect p acts still as a
-       reference to the value.  */
-    auto p = processed.Access (c);
-    if (p)
-      return;
-    p = true;
-
-    const auto insertRes = regionTiles.insert (c);
-    CHECK (insertRes.second);
-
-    todo.push (c);
-  }
-
-  /**
-   * Extracts the next tile for which we need to process its neighbours.
-   * Returns false if there is none (i.e. we are done).
-   */
-  bool
-  NextTodo (HexCoord& c)
-  {
-    if (todo.empty ())
-      return false;
-
-    c = todo.front ();
-    todo.pop ();
-    return true;
-  }
-
-  /**
-   * Checks whether or not the given tile has already been processed.
-   */
-  bool
-  AlreadyProcessed (const HexCoord& c) const
-  {
-    return processed.Get (c);
-  }
-
-};
+  return res;
+}
 
-} // anonymous namespace
+size_t
+RegionMap::GetRegionArea (const IdT id) const
+{
+  if (id >= tiledata::regions::idBound)
+    return 0;
+
+  size_t res = 0;
+  for (uint32_t i = spanOffsets[id]; i < spanOffsets[id + 1]; ++i)
+    res += spans[3 * i + 2] - spans[3 * i + 1] + 1;
+
+  return res;
+}
 
 std::set<HexCoord>
 RegionMap::GetRegionShape (const HexCoord& c, IdT& id) const
@@ -186,23 +200,14 @@ RegionMap::GetRegionShape (const HexCoord& c, IdT& id) const
   id = GetRegionId (c);
   CHECK_NE (id, OUT_OF_MAP) << "Coordinate is out of the map: " << c;
 
-  RegionFiller filler(c);
-  filler.AddRegionTile (c);
+  std::set<HexCoord> res;
+  for (const auto& s : GetRegionSpans (id))
+    for (int x = s.xBegin; x <= s.xEnd; ++x)
+      res.emplace (x, s.y);
 
-  HexCoord todo;
-  while (filler.NextTodo (todo))
-    for (const auto& n : todo.Neighbours ())
-      {
-        /* AddRegionTile ignores already processed tiles as well, but by doing
-           so here we save a somewhat expensive call to GetRegionInternal.  */
-        if (filler.AlreadyProcessed (n))
-          continue;
-
-        if (GetRegionId (n) == id)
-          filler.AddRegionTile (n);
-      }
-
-  return filler.MoveResult ();
+  CHECK (res.count (c) > 0)
+      << "Region spans of " << id << " do not contain " << c;
+  return res;
 }
 
 } // namespace pxd
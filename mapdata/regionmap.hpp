@@ -21,8 +21,10 @@
 
 #include "hexagonal/coord.hpp"
 
+#include <cstddef>
 #include <cstdint>
 #include <set>
+#include <vector>
 
 namespace pxd
 {
@@ -31,20 +33,86 @@ namespace pxd
  * Utility class for working with the region data of our basemap.  This can
  * mainly map coordinates to region IDs based on the embedded, compacted
  * data.  It can also find more geometrical data about a region, though,
- * like all other tiles in it.
+ * like all other tiles in it (based on the precomputed spans of each region).
  */
 class RegionMap
 {
 
+private:
+
+  /** The x coordinates of the compact region data.  */
+  const int16_t* const xCoords;
+
+  /** The encoded IDs of the compact region data.  */
+  const unsigned char* const ids;
+
+  /** The spans of all regions (as y, x begin and x end).  */
+  const int16_t* const spans;
+
+  /** For each region ID, the index of its first span.  */
+  const uint32_t* const spanOffsets;
+
+  /**
+   * Width (in tiles) of the buckets for the lookup index.  For each bucket,
+   * the index stores the entry in the compact data that contains its first
+   * tile, so that a lookup only has to scan over the few entries starting
+   * within the bucket.
+   */
+  static constexpr int BUCKET_WIDTH = 32;
+
+  /**
+   * For each bucket (with the buckets of all rows after each other), the
+   * index into the compact data of the entry for the bucket's first tile.
+   * This is empty if the index is not used.
+   */
+  std::vector<uint32_t> bucketEntries;
+
+  /** For each row, the offset into bucketEntries where its buckets start.  */
+  std::vector<uint32_t> bucketOffsetForY;
+
+  /**
+   * Builds up the lookup index.
+   */
+  void BuildIndex ();
+
+  /**
+   * Finds the index into the compact data of the entry that holds the
+   * given on-map coordinate.
+   */
+  size_t FindEntry (int x, int yInd) const;
+
 public:
 
   /** Type for the ID of regions.  */
   using IdT = uint32_t;
 
+  /**
+   * A contiguous span of tiles within one row, which all belong to the
+   * same region.
+   */
+  struct Span
+  {
+
+    /** The y coordinate of the row.  */
+    int y;
+
+    /** The first x coordinate of the span.  */
+    int xBegin;
+
+    /** The last x coordinate of the span (inclusive).  */
+    int xEnd;
+
+  };
+
   /** Region ID value returned for out-of-map coordinates.  */
   static constexpr IdT OUT_OF_MAP = static_cast<IdT> (-1);
 
-  RegionMap ();
+  /**
+   * Constructs the region map.  If useIndex is true, a lookup index is
+   * built, which makes GetRegionId constant time instead of a binary search
+   * over the compact data of a row, at the cost of some memory.
+   */
+  explicit RegionMap (bool useIndex = true);
 
   RegionMap (const RegionMap&) = delete;
   void operator= (const RegionMap&) = delete;
@@ -61,6 +129,23 @@ public:
    */
   std::set<HexCoord> GetRegionShape (const HexCoord& c, IdT& id) const;
 
+  /**
+   * Returns the spans making up the region with the given ID, ordered by
+   * row and x coordinate.  Returns an empty list for IDs that do not
+   * exist on the map.
+   */
+  std::vector<Span> GetRegionSpans (IdT id) const;
+
+  /**
+   * Returns the number of tiles in the region with the given ID.
+   */
+  size_t GetRegionArea (IdT id) const;
+
+  /**
+   * Returns the memory used by the lookup index in bytes.
+   */
+  size_t GetIndexBytes () const;
+
 };
 
 } // namespace pwd
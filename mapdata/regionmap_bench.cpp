@@ -34,14 +34,16 @@ namespace
 {
 
 /**
- * Benchmarks the lookup of the region ID from a coordinate.  Accepts one
- * argument, the number of (random) tiles to look up.
+ * Benchmarks the lookup of the region ID from a coordinate.  Accepts two
+ * arguments, the number of (random) tiles to look up and whether or not
+ * the lookup index should be used.
  */
 void
 GetRegionId (benchmark::State& state)
 {
-  RegionMap rm;
   const unsigned n = state.range (0);
+  const bool useIndex = state.range (1);
+  RegionMap rm(useIndex);
 
   std::srand (42);
   for (auto _ : state)
@@ -55,8 +57,10 @@ GetRegionId (benchmark::State& state)
 }
 BENCHMARK (GetRegionId)
   ->Unit (benchmark::kMillisecond)
-  ->Arg (1000)
-  ->Arg (1000000);
+  ->Args ({1000, 0})
+  ->Args ({1000, 1})
+  ->Args ({1000000, 0})
+  ->Args ({1000000, 1});
 
 /**
  * Benchmarks computing the shape of a region (finding all tiles in it).
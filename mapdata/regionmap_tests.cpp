@@ -74,6 +74,31 @@ TEST_F (RegionMapTests, MatchesOriginalData)
     }
 }
 
+TEST_F (RegionMapTests, IndexMatchesBinarySearch)
+{
+  const RegionMap withoutIndex(false);
+  EXPECT_EQ (withoutIndex.GetIndexBytes (), 0);
+  EXPECT_GT (rm.GetIndexBytes (), 0);
+
+  /* Checking every tile would take quite long (and MatchesOriginalData
+     already verifies all tiles with the index), so we just check a subset
+     of all rows, including the first and last one.  */
+  for (int y = tiledata::minY; y <= tiledata::maxY; y += 13)
+    {
+      const int yInd = y - tiledata::minY;
+      for (int x = tiledata::minX[yInd] - 1; x <= tiledata::maxX[yInd] + 1;
+           ++x)
+        {
+          const HexCoord c(x, y);
+          ASSERT_EQ (rm.GetRegionId (c), withoutIndex.GetRegionId (c))
+              << "Mismatch for tile " << c;
+        }
+    }
+
+  const HexCoord lastRow(0, tiledata::maxY);
+  EXPECT_EQ (rm.GetRegionId (lastRow), withoutIndex.GetRegionId (lastRow));
+}
+
 TEST_F (RegionMapTests, GetRegionShape)
 {
   const HexCoord coords[] =
@@ -105,6 +130,60 @@ TEST_F (RegionMapTests, GetRegionShape)
     }
 }
 
+TEST_F (RegionMapTests, RegionSpans)
+{
+  const HexCoord coords[] =
+    {
+      HexCoord (0, -4064),
+      HexCoord (-4064, 0),
+      HexCoord (0, 0),
+      HexCoord (100, -200),
+    };
+
+  for (const auto& c : coords)
+    {
+      RegionMap::IdT id;
+      const std::set<HexCoord> tiles = rm.GetRegionShape (c, id);
+      EXPECT_EQ (rm.GetRegionArea (id), tiles.size ());
+
+      const auto spans = rm.GetRegionSpans (id);
+      ASSERT_FALSE (spans.empty ());
+      for (size_t i = 0; i < spans.size (); ++i)
+        {
+          const auto& s = spans[i];
+          ASSERT_LE (s.xBegin, s.xEnd);
+          if (i > 0)
+            {
+              EXPECT_TRUE (spans[i - 1].y < s.y
+                            || spans[i - 1].xEnd < s.xBegin);
+            }
+
+          /* Each span should be maximal within the row.  */
+          EXPECT_NE (rm.GetRegionId (HexCoord (s.xBegin - 1, s.y)), id);
+          EXPECT_NE (rm.GetRegionId (HexCoord (s.xEnd + 1, s.y)), id);
+          for (int x = s.xBegin; x <= s.xEnd; ++x)
+            EXPECT_EQ (tiles.count (HexCoord (x, s.y)), 1);
+        }
+    }
+}
+
+TEST_F (RegionMapTests, RegionAreasCoverMap)
+{
+  size_t total = 0;
+  for (RegionMap::IdT id = 0; id < tiledata::regions::idBound; ++id)
+    total += rm.GetRegionArea (id);
+
+  EXPECT_EQ (total, tiledata::numTiles);
+}
+
+TEST_F (RegionMapTests, InvalidRegionId)
+{
+  const RegionMap::IdT id = tiledata::regions::idBound;
+  EXPECT_TRUE (rm.GetRegionSpans (id).empty ());
+  EXPECT_EQ (rm.GetRegionArea (id), 0);
+  EXPECT_EQ (rm.GetRegionArea (RegionMap::OUT_OF_MAP), 0);
+}
+
 /**
  * Tests GetRegionShape exhaustively, which means that the method is invoked
  * for each region on the full map and we verify that it works as well as
@@ -18,22 +18,36 @@
 
 #include "safezones.hpp"
 
-#include "hexagonal/ring.hpp"
+#include "tiledata.hpp"
+
+#include <algorithm>
+#include <map>
+#include <mutex>
 
 namespace pxd
 {
 
-SafeZones::SafeZones (const RoConfig& cfg)
-  : data(new uint8_t[ARRAY_SIZE])
+constexpr int SafeZones::CELL_SIZE;
+
+namespace
 {
-  uint8_t* mutData = const_cast<uint8_t*> (data);
-  std::fill (mutData, mutData + ARRAY_SIZE, 0);
 
+/** Lock for the per-chain instances.  */
+std::mutex mutInstances;
+
+} // anonymous namespace
+
+SafeZones::SafeZones (const RoConfig& cfg)
+{
   for (const auto& sz : cfg->safe_zones ())
     {
-      const HexCoord centre(sz.centre ().x (), sz.centre ().y ());
+      Zone z;
+      z.centre = HexCoord (sz.centre ().x (), sz.centre ().y ());
+      CHECK_LE (sz.radius (),
+                static_cast<unsigned> (tiledata::maxY - tiledata::minY))
+          << "Safe zone at " << z.centre << " is too large";
+      z.radius = sz.radius ();
 
-      Entry e;
       if (sz.has_faction ())
         {
           const auto f = FactionFromString (sz.faction ());
@@ -42,7 +56,7 @@ SafeZones::SafeZones (const RoConfig& cfg)
             case Faction::RED:
             case Faction::GREEN:
             case Faction::BLUE:
-              e = static_cast<Entry> (f);
+              z.type = static_cast<Entry> (f);
               break;
             default:
               LOG (FATAL)
@@ -52,31 +66,84 @@ SafeZones::SafeZones (const RoConfig& cfg)
             }
         }
       else
-        e = Entry::NEUTRAL;
+        z.type = Entry::NEUTRAL;
+
+      /* Two zones overlap if and only if some tile is within both radii,
+         which is the case exactly if the distance between the centres
+         is at most the sum of the radii.  */
+      for (const auto& other : zones)
+        CHECK_GT (HexCoord::DistanceL1 (z.centre, other.centre),
+                  z.radius + other.radius)
+            << "Overlapping safe zones at " << z.centre
+            << " and " << other.centre;
+
+      zones.push_back (z);
+    }
+
+  int gridMaxX = tiledata::maxX[0];
+  gridMinX = tiledata::minX[0];
+  for (int yInd = 1; yInd <= tiledata::maxY - tiledata::minY; ++yInd)
+    {
+      gridMinX = std::min (gridMinX, tiledata::minX[yInd]);
+      gridMaxX = std::max (gridMaxX, tiledata::maxX[yInd]);
+    }
+  gridMinY = tiledata::minY;
+  const int gridMaxY = tiledata::maxY;
 
-      const uint8_t val = static_cast<uint8_t> (e);
-      CHECK_LE (val, 0x0F);
+  cellsX = (gridMaxX - gridMinX) / CELL_SIZE + 1;
+  cellsY = (gridMaxY - gridMinY) / CELL_SIZE + 1;
 
-      for (unsigned r = 0; r <= sz.radius (); ++r)
-        for (const auto& c : L1Ring (centre, r))
-          {
-            const auto old = GetEntry (c);
-            CHECK (old == Entry::NONE)
-                << "Overlapping safe zones at " << c
-                << ", previous value " << static_cast<int> (old);
+  /* Each zone is added to all cells intersecting its bounding box in
+     axial coordinates.  This is slightly more than the cells intersecting
+     the zone itself, but that does not matter for correctness.  */
+  std::vector<std::vector<uint32_t>> zonesPerCell(cellsX * cellsY);
+  for (size_t i = 0; i < zones.size (); ++i)
+    {
+      const auto& z = zones[i];
+      const int loX = std::max (z.centre.GetX () - z.radius, gridMinX);
+      const int hiX = std::min (z.centre.GetX () + z.radius, gridMaxX);
+      const int loY = std::max (z.centre.GetY () - z.radius, gridMinY);
+      const int hiY = std::min (z.centre.GetY () + z.radius, gridMaxY);
+      if (loX > hiX || loY > hiY)
+        continue;
 
-            size_t ind;
-            unsigned shift;
-            GetPosition (c, ind, shift);
+      for (int cy = (loY - gridMinY) / CELL_SIZE;
+           cy <= (hiY - gridMinY) / CELL_SIZE; ++cy)
+        for (int cx = (loX - gridMinX) / CELL_SIZE;
+             cx <= (hiX - gridMinX) / CELL_SIZE; ++cx)
+          zonesPerCell[cy * cellsX + cx].push_back (i);
+    }
 
-            mutData[ind] |= (val << shift);
-          }
+  cellOffsets.reserve (zonesPerCell.size () + 1);
+  for (const auto& cell : zonesPerCell)
+    {
+      cellOffsets.push_back (cellZones.size ());
+      cellZones.insert (cellZones.end (), cell.begin (), cell.end ());
     }
+  cellOffsets.push_back (cellZones.size ());
+}
+
+const SafeZones&
+SafeZones::ForChain (const xaya::Chain chain)
+{
+  std::lock_guard<std::mutex> lock(mutInstances);
+
+  /* The instances are never destructed, like the RoConfig singletons.  */
+  static std::map<xaya::Chain, const SafeZones*> instances;
+
+  auto& ptr = instances[chain];
+  if (ptr == nullptr)
+    ptr = new SafeZones (RoConfig (chain));
+
+  return *ptr;
 }
 
-SafeZones::~SafeZones ()
+size_t
+SafeZones::GetMemoryBytes () const
 {
-  delete[] data;
+  return sizeof (Zone) * zones.capacity ()
+            + sizeof (uint32_t) * (cellOffsets.capacity ()
+                                    + cellZones.capacity ());
 }
 
 } // namespace pwd
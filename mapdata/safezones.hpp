@@ -19,21 +19,27 @@
 #ifndef MAPDATA_SAFEZONES_HPP
 #define MAPDATA_SAFEZONES_HPP
 
-#include "tiledata.hpp"
-
 #include "database/faction.hpp"
 #include "hexagonal/coord.hpp"
 #include "proto/roconfig.hpp"
 
+#include <xayagame/gamelogic.hpp>
+
 #include <cstddef>
 #include <cstdint>
+#include <vector>
 
 namespace pxd
 {
 
 /**
- * Class that holds a pre-computed map of which tiles are safe zones or
- * starting areas to allow quick access during path finding and combat.
+ * Class that holds the safe zones and starting areas in a form that allows
+ * quick access during path finding and combat.
+ *
+ * The zones are just a few dozen hexagonal discs, so we store them as a list
+ * together with a coarse grid over the map.  For each grid cell, we record
+ * the zones intersecting it.  Looking up a tile then only needs to check the
+ * (typically zero or one) zones of its cell.
  */
 class SafeZones
 {
@@ -41,9 +47,7 @@ class SafeZones
 private:
 
   /**
-   * The entries stored in our map for each coordinate.  This encodes
-   * all data we need for safe and starter zones, and fits into 4 bits
-   * so that we can store two of each into a single byte in memory.
+   * The kind of zone a tile is in.
    */
   enum class Entry : uint8_t
   {
@@ -54,42 +58,77 @@ private:
     NEUTRAL = 4,
   };
 
-  /** Size of the total data array we need in bytes.  */
-  static constexpr size_t ARRAY_SIZE = (tiledata::numTiles + 1) / 2;
+  /**
+   * Data for one of the zones.
+   */
+  struct Zone
+  {
+
+    /** The centre of the zone.  */
+    HexCoord centre;
+
+    /** The zone's radius.  */
+    HexCoord::IntT radius;
+
+    /** The kind of zone this is.  */
+    Entry type;
+
+  };
+
+  /** Size of the grid cells (in each axial coordinate).  */
+  static constexpr int CELL_SIZE = 64;
+
+  /** All zones we have.  */
+  std::vector<Zone> zones;
+
+  /** Minimum x coordinate covered by the grid.  */
+  int gridMinX;
+  /** Minimum y coordinate covered by the grid.  */
+  int gridMinY;
+
+  /** Number of grid cells along the x axis.  */
+  int cellsX;
+  /** Number of grid cells along the y axis.  */
+  int cellsY;
 
   /**
-   * The array of entries.  Each byte here holds two entries, and in total
-   * they are organised in a row-by-row fashion like DynTiles.  We allocate
-   * it dynamically to avoid issues with stack overflow.
+   * For each grid cell (row-by-row along y), the index into cellZones where
+   * the list of zones intersecting it starts.  This has one extra entry at
+   * the end, so that the list for a cell ends where that for the next starts.
    */
-  const uint8_t* const data;
+  std::vector<uint32_t> cellOffsets;
+
+  /** The indices into zones of the zones for each cell.  */
+  std::vector<uint32_t> cellZones;
 
   /**
-   * Reads out the entry for the given coordinate.
+   * Returns the index of the grid cell containing the given coordinate,
+   * or -1 if it is outside of the grid.
    */
-  inline Entry GetEntry (const HexCoord& c) const;
+  inline int GetCell (int x, int y) const;
 
   /**
-   * For a given coordinate, returns the byte-based index into the data array
-   * and the bit shift to apply to get to this coordinate's entry.
+   * Reads out the entry for the given coordinate.
    */
-  static inline void GetPosition (const HexCoord& c,
-                                  size_t& ind, unsigned& shift);
+  inline Entry GetEntry (const HexCoord& c) const;
 
 public:
 
   /**
    * Constructs an instance based on the zone data from the given RoConfig.
-   * This fills in all the data caches.
    */
   explicit SafeZones (const RoConfig& cfg);
 
-  ~SafeZones ();
-
   SafeZones () = delete;
   SafeZones (const SafeZones&) = delete;
   void operator= (const SafeZones&) = delete;
 
+  /**
+   * Returns the process-wide instance for the given chain.  It is constructed
+   * on first use and never destructed.
+   */
+  static const SafeZones& ForChain (xaya::Chain chain);
+
   /**
    * Returns true if the given coordinate is a no-combat zone.  This is the
    * case for all factions' starter zones as well as the neutral safe zones.
@@ -102,6 +141,11 @@ public:
    */
   inline Faction StarterFor (const HexCoord& c) const;
 
+  /**
+   * Returns the number of bytes allocated for the zone data.
+   */
+  size_t GetMemoryBytes () const;
+
 };
 
 } // namespace pwd
@@ -18,29 +18,38 @@
 
 /* Inline code for safezones.hpp.  */
 
-#include "dyntiles.hpp"
-
 #include <glog/logging.h>
 
 namespace pxd
 {
 
-void
-SafeZones::GetPosition (const HexCoord& c, size_t& ind, unsigned& shift)
+int
+SafeZones::GetCell (const int x, const int y) const
 {
-  const size_t fullIndex = dyntiles::GetIndex (c);
-  ind = fullIndex / 2;
-  shift = (fullIndex % 2 == 0 ? 0 : 4);
+  const int cellX = (x - gridMinX) / CELL_SIZE;
+  const int cellY = (y - gridMinY) / CELL_SIZE;
+
+  if (x < gridMinX || y < gridMinY || cellX >= cellsX || cellY >= cellsY)
+    return -1;
+
+  return cellY * cellsX + cellX;
 }
 
 SafeZones::Entry
 SafeZones::GetEntry (const HexCoord& c) const
 {
-  size_t ind;
-  unsigned shift;
-  GetPosition (c, ind, shift);
+  const int cell = GetCell (c.GetX (), c.GetY ());
+  if (cell < 0)
+    return Entry::NONE;
+
+  for (uint32_t i = cellOffsets[cell]; i < cellOffsets[cell + 1]; ++i)
+    {
+      const auto& z = zones[cellZones[i]];
+      if (HexCoord::DistanceL1 (c, z.centre) <= z.radius)
+        return z.type;
+    }
 
-  return static_cast<Entry> ((data[ind] >> shift) & 0x0F);
+  return Entry::NONE;
 }
 
 bool
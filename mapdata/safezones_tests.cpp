@@ -69,6 +69,28 @@ TEST_F (SafeZonesTests, StarterFor)
   EXPECT_EQ (sz.StarterFor (RED_START), Faction::RED);
 }
 
+TEST_F (SafeZonesTests, OutOfMap)
+{
+  EXPECT_FALSE (sz.IsNoCombat (HexCoord (0, tiledata::maxY + 1'000)));
+  EXPECT_EQ (sz.StarterFor (HexCoord (-10'000, 0)), Faction::INVALID);
+}
+
+TEST_F (SafeZonesTests, ForChain)
+{
+  const auto& regtest = SafeZones::ForChain (xaya::Chain::REGTEST);
+  EXPECT_EQ (&regtest, &SafeZones::ForChain (xaya::Chain::REGTEST));
+  EXPECT_NE (&regtest, &SafeZones::ForChain (xaya::Chain::MAIN));
+
+  EXPECT_TRUE (regtest.IsNoCombat (NEUTRAL));
+  EXPECT_EQ (regtest.StarterFor (RED_START), Faction::RED);
+}
+
+TEST_F (SafeZonesTests, MemoryBytes)
+{
+  EXPECT_GT (sz.GetMemoryBytes (), 0);
+  EXPECT_LT (sz.GetMemoryBytes (), 1 << 20);
+}
+
 /**
  * Exhaustively check each coordinate against the StarterZones and the
  * direct roconfig proto data.
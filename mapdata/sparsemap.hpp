@@ -22,8 +22,7 @@
 #include "dyntiles.hpp"
 
 #include "hexagonal/coord.hpp"
-
-#include <unordered_map>
+#include "hexagonal/coordmap.hpp"
 
 namespace pxd
 {
@@ -47,7 +46,7 @@ private:
   DynTiles<bool> density;
 
   /** The actual map from existing tiles to values.  */
-  std::unordered_map<HexCoord, T> values;
+  HexCoordMap<T> values;
 
   friend class SparseMapTests;
 
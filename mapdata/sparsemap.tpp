@@ -33,7 +33,7 @@ template <typename T>
   if (!density.Get (c))
     return defaultValue;
 
-  return values.at (c);
+  return values.At (c);
 }
 
 template <typename T>
@@ -42,13 +42,13 @@ template <typename T>
 {
   if (val == defaultValue)
     {
-      values.erase (c);
+      values.Erase (c);
       density.Access (c) = false;
       return;
     }
 
   density.Access (c) = true;
-  values[c] = val;
+  values.Access (c) = val;
 }
 
 } // namespace pxd
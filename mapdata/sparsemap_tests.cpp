@@ -42,7 +42,7 @@ protected:
   size_t
   GetNumEntries () const
   {
-    return map.values.size ();
+    return map.values.Size ();
   }
 
 };
@@ -0,0 +1,115 @@
+/*
+    GSP for the Taurion blockchain game
+    Copyright (C) 2021  Autonomous Worlds Ltd
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#include "tileattributes.hpp"
+
+#include "datafile.hpp"
+#include "tiledata.hpp"
+
+#include <glog/logging.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <mutex>
+
+namespace pxd
+{
+
+constexpr int TileAttributes::BLOCK_BITS_X;
+constexpr int TileAttributes::BLOCK_BITS_Y;
+constexpr size_t TileAttributes::BLOCK_TILES;
+
+namespace
+{
+
+/** Size of a cache line, to which we align the data and blocks.  */
+constexpr size_t CACHE_LINE = 64;
+
+/** Lock for the per-chain instances.  */
+std::mutex mutInstances;
+
+} // anonymous namespace
+
+TileAttributes::TileAttributes (const SafeZones& sz)
+{
+  static_assert (BLOCK_TILES / 2 == CACHE_LINE,
+                 "blocks should fill exactly one cache line");
+
+  const int numRows = tiledata::maxY - tiledata::minY + 1;
+  size_t maxWidth = 0;
+  for (int yInd = 0; yInd < numRows; ++yInd)
+    maxWidth = std::max<size_t> (maxWidth, tiledata::maxX[yInd]
+                                              - tiledata::minX[yInd] + 1);
+
+  blocksPerRow = (maxWidth + (1 << BLOCK_BITS_X) - 1) >> BLOCK_BITS_X;
+  const size_t blockRows = (numRows + (1 << BLOCK_BITS_Y) - 1) >> BLOCK_BITS_Y;
+  dataBytes = blockRows * blocksPerRow * BLOCK_TILES / 2;
+
+  allocated.reset (new uint8_t[dataBytes + CACHE_LINE]);
+  const auto addr = reinterpret_cast<uintptr_t> (allocated.get ());
+  data = allocated.get () + (CACHE_LINE - addr % CACHE_LINE) % CACHE_LINE;
+  std::fill (data, data + dataBytes, 0);
+
+  const unsigned char* obstacles = tiledata::GetRawData ().obstacles;
+  for (int yInd = 0; yInd < numRows; ++yInd)
+    for (int x = tiledata::minX[yInd]; x <= tiledata::maxX[yInd]; ++x)
+      {
+        const HexCoord c(x, tiledata::minY + yInd);
+        const size_t xInd = x - tiledata::minX[yInd];
+
+        /* We read the obstacle bits directly rather than through
+           BaseMap::IsPassable, which is quite a bit faster for
+           iterating over all tiles (and does not need a BaseMap).  */
+        const unsigned char* bits
+            = obstacles + tiledata::obstacles::bitDataOffsetForY[yInd];
+        uint8_t val = 0;
+        if (bits[xInd / 8] & (1 << (xInd % 8)))
+          val |= tileattributes::PASSABLE;
+
+        const Faction starter = sz.StarterFor (c);
+        if (starter != Faction::INVALID)
+          val |= static_cast<uint8_t> (starter);
+        else if (sz.IsNoCombat (c))
+          val |= tileattributes::ZONE_NEUTRAL;
+
+        const size_t ind = GetIndex (xInd, yInd);
+        data[ind / 2] |= (val << (4 * (ind % 2)));
+      }
+
+  VLOG (1)
+      << "Built tile attribute layer with " << dataBytes << " bytes";
+}
+
+const TileAttributes&
+TileAttributes::ForChain (const xaya::Chain chain)
+{
+  std::lock_guard<std::mutex> lock(mutInstances);
+
+  /* The instances are never destructed, like the SafeZones ones.  */
+  static std::map<xaya::Chain, const TileAttributes*> instances;
+
+  auto& ptr = instances[chain];
+  if (ptr == nullptr)
+    ptr = new TileAttributes (SafeZones::ForChain (chain));
+
+  return *ptr;
+}
+
+} // namespace pxd
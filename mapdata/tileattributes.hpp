@@ -0,0 +1,164 @@
+/*
+    GSP for the Taurion blockchain game
+    Copyright (C) 2021  Autonomous Worlds Ltd
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef MAPDATA_TILEATTRIBUTES_HPP
+#define MAPDATA_TILEATTRIBUTES_HPP
+
+#include "safezones.hpp"
+
+#include "database/faction.hpp"
+#include "hexagonal/coord.hpp"
+
+#include <xayagame/gamelogic.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace pxd
+{
+
+/**
+ * Packed layer of all static per-tile attributes that are needed for
+ * movement, i.e. whether a tile is passable and what kind of safe zone
+ * it is in.  Each tile uses one nibble, and the tiles are grouped into
+ * blocks of 16 * 8 (which fit a single cache line), so that the tiles
+ * visited from one step of path finding are (almost always) in the same
+ * cache line.
+ *
+ * The layer takes up tens of megabytes, so there is just one instance per
+ * chain (see ForChain) that is shared between all BaseMap's.
+ */
+class TileAttributes
+{
+
+public:
+
+  /**
+   * The attributes of a single tile.  This is a cheap value type that just
+   * wraps the packed data of the tile.
+   */
+  class Tile
+  {
+
+  private:
+
+    /** The packed data of the tile.  */
+    uint8_t bits;
+
+    explicit Tile (const uint8_t b)
+      : bits(b)
+    {}
+
+    friend class TileAttributes;
+
+  public:
+
+    /**
+     * Returns whether or not the tile is passable.  This is false for
+     * tiles that are not on the map.
+     */
+    inline bool IsPassable () const;
+
+    /**
+     * Returns true if the tile is a no-combat zone (either a starter zone
+     * or a neutral safe zone).
+     */
+    inline bool IsNoCombat () const;
+
+    /**
+     * Returns the faction for which this is a starter zone, or INVALID if
+     * it is no starter zone.
+     */
+    inline Faction StarterFor () const;
+
+  };
+
+private:
+
+  /** Number of bits for the x coordinate within a block.  */
+  static constexpr int BLOCK_BITS_X = 4;
+  /** Number of bits for the y coordinate within a block.  */
+  static constexpr int BLOCK_BITS_Y = 3;
+
+  /** Number of tiles in a block.  */
+  static constexpr size_t BLOCK_TILES = 1 << (BLOCK_BITS_X + BLOCK_BITS_Y);
+
+  /** Number of blocks in each row of blocks.  */
+  size_t blocksPerRow;
+
+  /** Size of the data array in bytes.  */
+  size_t dataBytes;
+
+  /**
+   * The allocated memory for the data.  This has some extra space so that
+   * we can align the data itself to a cache line.
+   */
+  std::unique_ptr<uint8_t[]> allocated;
+
+  /** The data itself, aligned to a cache line.  */
+  uint8_t* data;
+
+  /**
+   * Returns the index of a tile's nibble into the data array, given
+   * by its row index and its x offset within the row.
+   */
+  inline size_t GetIndex (size_t xInd, size_t yInd) const;
+
+public:
+
+  /**
+   * Builds up the attributes from the obstacle data and the given
+   * safe zones.
+   */
+  explicit TileAttributes (const SafeZones& sz);
+
+  TileAttributes () = delete;
+  TileAttributes (const TileAttributes&) = delete;
+  void operator= (const TileAttributes&) = delete;
+
+  /**
+   * Returns the process-wide instance for the given chain.  It is constructed
+   * on first use and never destructed.
+   */
+  static const TileAttributes& ForChain (xaya::Chain chain);
+
+  /**
+   * Returns the attributes of the given tile.  For tiles that are not
+   * on the map, this returns attributes that say it is not passable and
+   * in no safe zone.
+   */
+  inline Tile Get (const HexCoord& c) const;
+
+  /**
+   * Returns the number of bytes allocated for the data.
+   */
+  size_t
+  GetMemoryBytes () const
+  {
+    return dataBytes;
+  }
+
+};
+
+} // namespace pxd
+
+#include "tileattributes.tpp"
+
+#endif // MAPDATA_TILEATTRIBUTES_HPP
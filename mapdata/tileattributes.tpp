@@ -0,0 +1,93 @@
+/*
+    GSP for the Taurion blockchain game
+    Copyright (C) 2021  Autonomous Worlds Ltd
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+/* Inline code for tileattributes.hpp.  */
+
+#include "tiledata.hpp"
+
+namespace pxd
+{
+
+namespace tileattributes
+{
+
+/** Bits of a tile's data that hold the safe-zone kind.  */
+constexpr uint8_t ZONE_MASK = 0x07;
+
+/** Zone value for neutral safe zones (factions use their own value).  */
+constexpr uint8_t ZONE_NEUTRAL = 4;
+
+/** Bit that is set for passable tiles.  */
+constexpr uint8_t PASSABLE = 0x08;
+
+} // namespace tileattributes
+
+bool
+TileAttributes::Tile::IsPassable () const
+{
+  return bits & tileattributes::PASSABLE;
+}
+
+bool
+TileAttributes::Tile::IsNoCombat () const
+{
+  return (bits & tileattributes::ZONE_MASK) != 0;
+}
+
+Faction
+TileAttributes::Tile::StarterFor () const
+{
+  const uint8_t zone = bits & tileattributes::ZONE_MASK;
+  if (zone == 0 || zone == tileattributes::ZONE_NEUTRAL)
+    return Faction::INVALID;
+
+  return static_cast<Faction> (zone);
+}
+
+size_t
+TileAttributes::GetIndex (const size_t xInd, const size_t yInd) const
+{
+  constexpr size_t maskX = (1 << BLOCK_BITS_X) - 1;
+  constexpr size_t maskY = (1 << BLOCK_BITS_Y) - 1;
+
+  const size_t block = (yInd >> BLOCK_BITS_Y) * blocksPerRow
+                          + (xInd >> BLOCK_BITS_X);
+  const size_t inBlock = ((yInd & maskY) << BLOCK_BITS_X) | (xInd & maskX);
+
+  return block * BLOCK_TILES + inBlock;
+}
+
+TileAttributes::Tile
+TileAttributes::Get (const HexCoord& c) const
+{
+  const auto x = c.GetX ();
+  const auto y = c.GetY ();
+
+  if (y < tiledata::minY || y > tiledata::maxY)
+    return Tile (0);
+  const int yInd = y - tiledata::minY;
+
+  if (x < tiledata::minX[yInd] || x > tiledata::maxX[yInd])
+    return Tile (0);
+
+  const size_t ind = GetIndex (x - tiledata::minX[yInd], yInd);
+  return Tile ((data[ind / 2] >> (4 * (ind % 2))) & 0x0F);
+}
+
+} // namespace pxd
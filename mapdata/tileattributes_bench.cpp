@@ -0,0 +1,82 @@
+/*
+    GSP for the Taurion blockchain game
+    Copyright (C) 2021  Autonomous Worlds Ltd
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#include "basemap.hpp"
+
+#include "benchutils.hpp"
+
+#include "hexagonal/coord.hpp"
+
+#include <xayagame/gamelogic.hpp>
+
+#include <benchmark/benchmark.h>
+
+#include <cstdlib>
+
+namespace pxd
+{
+namespace
+{
+
+/**
+ * Benchmarks the lookup of the static data needed for movement onto all
+ * neighbours of random tiles, as done for each step of path finding.
+ * Accepts two arguments, the number of random tiles whose neighbours
+ * we check, and whether the packed attributes (1) or the separate obstacle
+ * and safe-zone data (0) should be used.
+ */
+void
+NeighbourAttributes (benchmark::State& state)
+{
+  const BaseMap map(xaya::Chain::MAIN);
+  const size_t n = state.range (0);
+  const bool packed = state.range (1);
+
+  std::srand (42);
+  for (auto _ : state)
+    {
+      state.PauseTiming ();
+      const auto coords = RandomCoords (n);
+      state.ResumeTiming ();
+
+      unsigned passable = 0;
+      for (const auto& c : coords)
+        for (const auto& nb : c.Neighbours ())
+          {
+            if (packed)
+              {
+                const auto t = map.Attributes ().Get (nb);
+                if (t.IsPassable () && t.StarterFor () == Faction::INVALID)
+                  ++passable;
+              }
+            else if (map.IsPassable (nb)
+                      && map.SafeZones ().StarterFor (nb) == Faction::INVALID)
+              ++passable;
+          }
+
+      benchmark::DoNotOptimize (passable);
+    }
+}
+BENCHMARK (NeighbourAttributes)
+  ->Unit (benchmark::kMillisecond)
+  ->Args ({100'000, 0})
+  ->Args ({100'000, 1});
+
+} // anonymous namespace
+} // namespace pxd
@@ -0,0 +1,117 @@
+/*
+    GSP for the Taurion blockchain game
+    Copyright (C) 2021  Autonomous Worlds Ltd
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#include "tileattributes.hpp"
+
+#include "basemap.hpp"
+#include "tiledata.hpp"
+
+#include "hexagonal/coord.hpp"
+
+#include <xayagame/gamelogic.hpp>
+
+#include <gtest/gtest.h>
+
+namespace pxd
+{
+namespace
+{
+
+class TileAttributesTests : public testing::Test
+{
+
+protected:
+
+  const BaseMap map;
+  const TileAttributes& attr;
+
+  TileAttributesTests ()
+    : map(xaya::Chain::REGTEST), attr(map.Attributes ())
+  {}
+
+};
+
+TEST_F (TileAttributesTests, BasicValues)
+{
+  const auto neutral = attr.Get (HexCoord (2'042, 10));
+  EXPECT_TRUE (neutral.IsNoCombat ());
+  EXPECT_EQ (neutral.StarterFor (), Faction::INVALID);
+
+  const auto red = attr.Get (HexCoord (-2'042, 100));
+  EXPECT_TRUE (red.IsNoCombat ());
+  EXPECT_EQ (red.StarterFor (), Faction::RED);
+
+  const auto normal = attr.Get (HexCoord (2'042, 11));
+  EXPECT_FALSE (normal.IsNoCombat ());
+  EXPECT_EQ (normal.StarterFor (), Faction::INVALID);
+
+  EXPECT_TRUE (attr.Get (HexCoord (0, 0)).IsPassable ());
+}
+
+TEST_F (TileAttributesTests, OutOfMap)
+{
+  for (const auto& c : {HexCoord (0, tiledata::maxY + 1),
+                        HexCoord (0, tiledata::minY - 1),
+                        HexCoord (tiledata::maxX[0] + 1, tiledata::minY),
+                        HexCoord (-10'000, 0)})
+    {
+      ASSERT_FALSE (map.IsOnMap (c));
+      const auto t = attr.Get (c);
+      EXPECT_FALSE (t.IsPassable ());
+      EXPECT_FALSE (t.IsNoCombat ());
+      EXPECT_EQ (t.StarterFor (), Faction::INVALID);
+    }
+}
+
+TEST_F (TileAttributesTests, SharedPerChain)
+{
+  const BaseMap other(xaya::Chain::REGTEST);
+  EXPECT_EQ (&attr, &other.Attributes ());
+  EXPECT_EQ (&attr, &TileAttributes::ForChain (xaya::Chain::REGTEST));
+  EXPECT_NE (&attr, &TileAttributes::ForChain (xaya::Chain::MAIN));
+}
+
+TEST_F (TileAttributesTests, MemoryBytes)
+{
+  EXPECT_GE (attr.GetMemoryBytes (), tiledata::numTiles / 2);
+}
+
+/**
+ * Checks the attributes of all tiles against the underlying obstacle
+ * and safe-zone data.
+ */
+TEST_F (TileAttributesTests, Exhaustive)
+{
+  for (int y = tiledata::minY; y <= tiledata::maxY; ++y)
+    {
+      const int yInd = y - tiledata::minY;
+      for (int x = tiledata::minX[yInd]; x <= tiledata::maxX[yInd]; ++x)
+        {
+          const HexCoord c(x, y);
+          const auto t = attr.Get (c);
+
+          ASSERT_EQ (t.IsPassable (), map.IsPassable (c)) << c;
+          ASSERT_EQ (t.IsNoCombat (), map.SafeZones ().IsNoCombat (c)) << c;
+          ASSERT_EQ (t.StarterFor (), map.SafeZones ().StarterFor (c)) << c;
+        }
+    }
+}
+
+} // anonymous namespace
+} // namespace pxd
@@ -55,6 +55,12 @@ extern const size_t offsetForY[];
  */
 constexpr size_t numTiles = 66'080'641;
 
+/**
+ * Checksum of the raw map data (see RawMapData::ComputeChecksum).  This is
+ * used to verify that a map data file matches the compiled-in metadata.
+ */
+extern const uint64_t dataChecksum;
+
 namespace obstacles
 {
 
@@ -82,11 +88,19 @@ extern const size_t compactOffsetForY[];
 /** Number of entries for the compact region data arrays.  */
 extern const size_t compactEntries;
 
+/**
+ * One larger than the maximum region ID.  The region span offsets have
+ * one more entry than this, so that the spans of each ID can be found
+ * from the offsets for it and the next ID.
+ */
+extern const size_t idBound;
+
 } // namespace regions
 
 } // namespace tiledata
 } // namespace pxd
 
+#ifndef PXD_NO_EMBEDDED_MAPDATA
 extern "C"
 {
 
@@ -109,6 +123,17 @@ extern const int16_t blob_region_xcoord_end;
 extern const unsigned char blob_region_ids_start;
 extern const unsigned char blob_region_ids_end;
 
+/* The spans of each region, grouped by region ID and ordered by row.  Each
+   span consists of three int16_t's, the y coordinate and the first and last
+   x coordinate of the span.  */
+extern const int16_t blob_region_spans_start;
+extern const int16_t blob_region_spans_end;
+
+/* For each region ID, the index of its first span as uint32_t.  */
+extern const uint32_t blob_region_span_offsets_start;
+extern const uint32_t blob_region_span_offsets_end;
+
 } // extern C
+#endif // PXD_NO_EMBEDDED_MAPDATA
 
 #endif // MAPDATA_TILEDATA_HPP
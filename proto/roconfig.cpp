@@ -409,6 +409,24 @@ RoConfig::Item (const std::string& item) const
   return *ptr;
 }
 
+RoConfig::CacheUsage
+RoConfig::GetCacheUsage () const
+{
+  std::lock_guard<std::recursive_mutex> lock(data->mut);
+
+  CacheUsage res;
+  res.items = data->constructedItems.size ();
+  res.buildings = data->constructedBuildings.size ();
+
+  res.bytes = data->proto.SpaceUsedLong ();
+  for (const auto& entry : data->constructedItems)
+    res.bytes += entry.first.size () + entry.second->SpaceUsedLong ();
+  for (const auto& entry : data->constructedBuildings)
+    res.bytes += entry.first.size () + entry.second->SpaceUsedLong ();
+
+  return res;
+}
+
 /* ************************************************************************** */
 
 } // namespace pxd
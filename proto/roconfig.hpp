@@ -59,6 +59,24 @@ private:
 
 public:
 
+  /**
+   * Memory used by the underlying singleton instance, including the
+   * caches of constructed item and building data.
+   */
+  struct CacheUsage
+  {
+
+    /** Number of constructed items cached.  */
+    size_t items;
+
+    /** Number of constructed buildings cached.  */
+    size_t buildings;
+
+    /** Approximate bytes used by the proto and the cached data.  */
+    uint64_t bytes;
+
+  };
+
   /**
    * Constructs a fresh instance of the wrapper class, which will give
    * access to the underlying data.
@@ -106,6 +124,11 @@ public:
    */
   const proto::BuildingData& Building (const std::string& type) const;
 
+  /**
+   * Returns the memory used by the singleton instance and its caches.
+   */
+  CacheUsage GetCacheUsage () const;
+
 };
 
 } // namespace pxd
@@ -107,6 +107,24 @@ TEST (RoConfigTests, Building)
   EXPECT_GT (cfg.Building ("ancient1").enter_radius (), 0);
 }
 
+TEST (RoConfigTests, CacheUsage)
+{
+  const RoConfig cfg(xaya::Chain::REGTEST);
+  const auto before = cfg.GetCacheUsage ();
+  EXPECT_GT (before.bytes, 0);
+
+  cfg.Item ("bow bpc");
+  cfg.Item ("bow bpc");
+  cfg.Building ("ancient1");
+
+  const auto after = cfg.GetCacheUsage ();
+  EXPECT_LE (after.items, before.items + 1);
+  EXPECT_LE (after.buildings, before.buildings + 1);
+  EXPECT_GT (after.items, 0);
+  EXPECT_GT (after.buildings, 0);
+  EXPECT_GE (after.bytes, before.bytes);
+}
+
 /* ************************************************************************** */
 
 class RoItemsTests : public testing::Test
@@ -0,0 +1,260 @@
+/*
+    GSP for the Taurion blockchain game
+    Copyright (C) 2021  Autonomous Worlds Ltd
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#include "blockstats.hpp"
+
+#include "trace.hpp"
+
+#include <glog/logging.h>
+
+#include <algorithm>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+
+namespace pxd
+{
+
+const std::vector<double> BlockStats::BUCKETS = {
+  0.0005, 0.001, 0.0025, 0.005, 0.01, 0.025, 0.05,
+  0.1, 0.25, 0.5, 1.0, 2.5, 5.0, 10.0,
+};
+
+BlockStats::BlockStats (const size_t w)
+  : windowSize(w)
+{
+  CHECK_GT (windowSize, 0);
+}
+
+void
+BlockStats::Record (BlockData&& blk)
+{
+  std::lock_guard<std::mutex> lock(mut);
+
+  ++numBlocks;
+  for (const auto& phase : blk.phases)
+    {
+      auto& t = totals[phase.name];
+      if (t.buckets.empty ())
+        t.buckets.resize (BUCKETS.size (), 0);
+
+      for (size_t i = 0; i < BUCKETS.size (); ++i)
+        if (phase.seconds <= BUCKETS[i])
+          ++t.buckets[i];
+
+      ++t.count;
+      t.sum += phase.seconds;
+      t.statements += phase.statements;
+      t.entities += phase.entities;
+    }
+
+  window.push_back (std::move (blk));
+  while (window.size () > windowSize)
+    window.pop_front ();
+}
+
+namespace
+{
+
+/**
+ * Converts the data of one phase to JSON.
+ */
+Json::Value
+PhaseToJson (const BlockStats::PhaseData& phase)
+{
+  Json::Value res(Json::objectValue);
+  res["name"] = phase.name;
+  res["ms"] = phase.seconds * 1'000.0;
+  res["statements"] = static_cast<Json::UInt64> (phase.statements);
+  res["entities"] = static_cast<Json::UInt64> (phase.entities);
+  return res;
+}
+
+/**
+ * Returns the given quantile (between 0 and 1) of a sorted, non-empty
+ * list of values.
+ */
+double
+Quantile (const std::vector<double>& sorted, const double q)
+{
+  CHECK (!sorted.empty ());
+  const size_t ind = q * (sorted.size () - 1) + 0.5;
+  return sorted[std::min (ind, sorted.size () - 1)];
+}
+
+} // anonymous namespace
+
+Json::Value
+BlockStats::ToJson () const
+{
+  std::lock_guard<std::mutex> lock(mut);
+
+  /* Collect the times by phase, keeping the phases in the order in which
+     they first appear in the window.  */
+  std::vector<std::string> order;
+  std::map<std::string, std::vector<double>> times;
+  for (const auto& blk : window)
+    for (const auto& phase : blk.phases)
+      {
+        auto& lst = times[phase.name];
+        if (lst.empty ())
+          order.push_back (phase.name);
+        lst.push_back (phase.seconds * 1'000.0);
+      }
+
+  Json::Value phases(Json::arrayValue);
+  for (const auto& name : order)
+    {
+      auto& lst = times[name];
+      std::sort (lst.begin (), lst.end ());
+
+      double sum = 0.0;
+      for (const double t : lst)
+        sum += t;
+
+      Json::Value cur(Json::objectValue);
+      cur["name"] = name;
+      cur["count"] = static_cast<Json::UInt64> (lst.size ());
+      cur["mean"] = sum / lst.size ();
+      cur["median"] = Quantile (lst, 0.5);
+      cur["p90"] = Quantile (lst, 0.9);
+      cur["max"] = lst.back ();
+      phases.append (cur);
+    }
+
+  Json::Value res(Json::objectValue);
+  res["blocks"] = static_cast<Json::UInt64> (numBlocks);
+  res["window"] = static_cast<Json::UInt64> (window.size ());
+  res["phases"] = phases;
+
+  if (!window.empty ())
+    {
+      const auto& last = window.back ();
+      Json::Value lastJson(Json::objectValue);
+      lastJson["height"] = last.height;
+      Json::Value lastPhases(Json::arrayValue);
+      for (const auto& phase : last.phases)
+        lastPhases.append (PhaseToJson (phase));
+      lastJson["phases"] = lastPhases;
+      res["last"] = lastJson;
+    }
+
+  return res;
+}
+
+std::string
+BlockStats::ToPrometheus () const
+{
+  std::lock_guard<std::mutex> lock(mut);
+
+  std::ostringstream out;
+
+  out << "# HELP taurion_blocks_total Number of processed blocks.\n"
+      << "# TYPE taurion_blocks_total counter\n"
+      << "taurion_blocks_total " << numBlocks << "\n";
+
+  out << "# HELP taurion_block_phase_seconds"
+         " Wall time of block processing phases.\n"
+      << "# TYPE taurion_block_phase_seconds histogram\n";
+  for (const auto& entry : totals)
+    {
+      const std::string label = "phase=\"" + entry.first + "\"";
+      const auto& t = entry.second;
+      for (size_t i = 0; i < BUCKETS.size (); ++i)
+        out << "taurion_block_phase_seconds_bucket{" << label
+            << ",le=\"" << BUCKETS[i] << "\"} " << t.buckets[i] << "\n";
+      out << "taurion_block_phase_seconds_bucket{" << label
+          << ",le=\"+Inf\"} " << t.count << "\n";
+      out << "taurion_block_phase_seconds_sum{" << label << "} "
+          << std::setprecision (std::numeric_limits<double>::max_digits10)
+          << t.sum << std::setprecision (6) << "\n";
+      out << "taurion_block_phase_seconds_count{" << label << "} "
+          << t.count << "\n";
+    }
+
+  out << "# HELP taurion_block_phase_statements_total"
+         " Database statements executed in block processing phases.\n"
+      << "# TYPE taurion_block_phase_statements_total counter\n";
+  for (const auto& entry : totals)
+    out << "taurion_block_phase_statements_total{phase=\"" << entry.first
+        << "\"} " << entry.second.statements << "\n";
+
+  out << "# HELP taurion_block_phase_entities_total"
+         " Entities read from the database in block processing phases.\n"
+      << "# TYPE taurion_block_phase_entities_total counter\n";
+  for (const auto& entry : totals)
+    out << "taurion_block_phase_entities_total{phase=\"" << entry.first
+        << "\"} " << entry.second.entities << "\n";
+
+  return out.str ();
+}
+
+/* ************************************************************************** */
+
+BlockStats::Recorder::Recorder (BlockStats* s, Database& d,
+                                const unsigned height)
+  : stats(s), db(d)
+{
+  data.height = height;
+}
+
+BlockStats::Recorder::~Recorder ()
+{
+  if (stats == nullptr)
+    return;
+
+  EndPhase ();
+  stats->Record (std::move (data));
+}
+
+void
+BlockStats::Recorder::EndPhase ()
+{
+  if (!inPhase)
+    return;
+
+  auto& phase = data.phases.back ();
+  const auto end = Clock::now ();
+  phase.seconds = std::chrono::duration<double> (end - start).count ();
+  phase.statements = db.GetNumExecuted () - startStatements;
+  phase.entities = db.GetNumRowsRead () - startRows;
+  inPhase = false;
+
+  TraceLog::Get ().Record ("phase", phase.name, start, end);
+}
+
+void
+BlockStats::Recorder::StartPhase (const std::string& name)
+{
+  if (stats == nullptr)
+    return;
+
+  EndPhase ();
+
+  PhaseData phase;
+  phase.name = name;
+  data.phases.push_back (std::move (phase));
+
+  inPhase = true;
+  startStatements = db.GetNumExecuted ();
+  startRows = db.GetNumRowsRead ();
+  start = Clock::now ();
+}
+
+} // namespace pxd
@@ -0,0 +1,214 @@
+/*
+    GSP for the Taurion blockchain game
+    Copyright (C) 2021  Autonomous Worlds Ltd
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef PXD_BLOCKSTATS_HPP
+#define PXD_BLOCKSTATS_HPP
+
+#include "database/database.hpp"
+
+#include <json/json.h>
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace pxd
+{
+
+/**
+ * Statistics about the processing of blocks, split into the phases of
+ * PXLogic::UpdateState.  For each phase and block, the wall time, number of
+ * executed database statements and number of entities (result rows) read
+ * from the database are recorded.  The data of the last few blocks is kept in
+ * a rolling window, and cumulative histograms of the phase times are kept
+ * for export to Prometheus.
+ *
+ * This class is thread-safe, so that stats can be read from RPC or REST
+ * while blocks are being processed.
+ */
+class BlockStats
+{
+
+public:
+
+  /** Measurements of one phase in one block.  */
+  struct PhaseData
+  {
+
+    /** The name of the phase.  */
+    std::string name;
+
+    /** Wall time taken by the phase in seconds.  */
+    double seconds = 0.0;
+
+    /** Number of database statements executed during the phase.  */
+    uint64_t statements = 0;
+
+    /** Number of entities (result rows) read during the phase.  */
+    uint64_t entities = 0;
+
+  };
+
+  /** Measurements of one block.  */
+  struct BlockData
+  {
+
+    /** The block height.  */
+    unsigned height;
+
+    /** The phases in order.  */
+    std::vector<PhaseData> phases;
+
+  };
+
+  class Recorder;
+
+private:
+
+  /** Cumulative data about one phase over all blocks.  */
+  struct PhaseTotals
+  {
+
+    /**
+     * Number of measurements with a time of at most the corresponding
+     * entry in BUCKETS.  The counts are cumulative as in Prometheus.
+     */
+    std::vector<uint64_t> buckets;
+
+    /** Total number of measurements.  */
+    uint64_t count = 0;
+
+    /** Sum of all times in seconds.  */
+    double sum = 0.0;
+
+    /** Total number of statements.  */
+    uint64_t statements = 0;
+
+    /** Total number of entities.  */
+    uint64_t entities = 0;
+
+  };
+
+  /** Upper bounds (in seconds) of the histogram buckets.  */
+  static const std::vector<double> BUCKETS;
+
+  /** Number of blocks to keep in the rolling window.  */
+  const size_t windowSize;
+
+  /** Lock for the data members.  */
+  mutable std::mutex mut;
+
+  /** Data of the most recent blocks, oldest first.  */
+  std::deque<BlockData> window;
+
+  /** Cumulative data by phase name.  */
+  std::map<std::string, PhaseTotals> totals;
+
+  /** Total number of recorded blocks.  */
+  uint64_t numBlocks = 0;
+
+public:
+
+  explicit BlockStats (size_t w);
+
+  BlockStats () = delete;
+  BlockStats (const BlockStats&) = delete;
+  void operator= (const BlockStats&) = delete;
+
+  /**
+   * Records the data of a processed block.
+   */
+  void Record (BlockData&& blk);
+
+  /**
+   * Returns a JSON summary of the rolling window, with count, mean, median,
+   * 90th percentile and maximum time per phase as well as the full data
+   * of the last block.
+   */
+  Json::Value ToJson () const;
+
+  /**
+   * Returns the cumulative statistics in the Prometheus text format.
+   */
+  std::string ToPrometheus () const;
+
+};
+
+/**
+ * Helper that measures the phases of processing a single block.  A phase
+ * is started with StartPhase, and lasts until the next phase is started or
+ * the block is finished when the instance is destructed.  If the stats
+ * instance is null, then nothing is recorded.
+ */
+class BlockStats::Recorder
+{
+
+private:
+
+  using Clock = std::chrono::steady_clock;
+
+  /** The stats to record to (may be null).  */
+  BlockStats* stats;
+
+  /** The database, used to count the statements and rows.  */
+  Database& db;
+
+  /** Data of the block so far.  */
+  BlockData data;
+
+  /** Whether or not a phase is currently running.  */
+  bool inPhase = false;
+
+  /** Start time of the current phase.  */
+  Clock::time_point start;
+
+  /** Statement count at the start of the current phase.  */
+  uint64_t startStatements;
+
+  /** Row count at the start of the current phase.  */
+  uint64_t startRows;
+
+  /**
+   * Finishes the current phase, if any.
+   */
+  void EndPhase ();
+
+public:
+
+  explicit Recorder (BlockStats* s, Database& d, unsigned height);
+  ~Recorder ();
+
+  Recorder () = delete;
+  Recorder (const Recorder&) = delete;
+  void operator= (const Recorder&) = delete;
+
+  /**
+   * Starts a new phase with the given name, ending the previous one.
+   */
+  void StartPhase (const std::string& name);
+
+};
+
+} // namespace pxd
+
+#endif // PXD_BLOCKSTATS_HPP
@@ -0,0 +1,163 @@
+/*
+    GSP for the Taurion blockchain game
+    Copyright (C) 2021  Autonomous Worlds Ltd
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#include "blockstats.hpp"
+
+#include "database/dbtest.hpp"
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <string>
+
+namespace pxd
+{
+namespace
+{
+
+struct CountResult : public Database::ResultType
+{
+  RESULT_COLUMN (int64_t, n, 1);
+};
+
+class BlockStatsTests : public DBTestWithSchema
+{
+
+protected:
+
+  BlockStats stats;
+
+  BlockStatsTests ()
+    : stats(2)
+  {}
+
+  /**
+   * Runs a query that returns the given number of rows, and steps
+   * through all of them.
+   */
+  void
+  QueryRows (const unsigned rows)
+  {
+    auto stmt = db.Prepare (R"(
+      WITH RECURSIVE `cnt` (`n`) AS
+        (SELECT 1 UNION ALL SELECT `n` + 1 FROM `cnt` WHERE `n` < ?1)
+      SELECT `n` FROM `cnt` WHERE `n` <= ?1
+    )");
+    stmt.Bind (1, rows);
+
+    auto res = stmt.Query<CountResult> ();
+    unsigned cnt = 0;
+    while (res.Step ())
+      ++cnt;
+    CHECK_EQ (cnt, rows);
+  }
+
+  /**
+   * Records a block with two phases, where the first one executes the given
+   * number of statements (at least one) and reads the given number of rows.
+   */
+  void
+  RecordBlock (const unsigned height, const unsigned statements,
+               const unsigned entities)
+  {
+    CHECK_GT (statements, 0);
+    BlockStats::Recorder rec(&stats, db, height);
+
+    rec.StartPhase ("foo");
+    QueryRows (entities);
+    for (unsigned i = 1; i < statements; ++i)
+      QueryRows (0);
+
+    rec.StartPhase ("bar");
+  }
+
+};
+
+TEST_F (BlockStatsTests, Empty)
+{
+  const Json::Value res = stats.ToJson ();
+  EXPECT_EQ (res["blocks"].asInt (), 0);
+  EXPECT_EQ (res["phases"].size (), 0);
+  EXPECT_FALSE (res.isMember ("last"));
+}
+
+TEST_F (BlockStatsTests, PhasesRecorded)
+{
+  RecordBlock (10, 3, 5);
+
+  const Json::Value res = stats.ToJson ();
+  EXPECT_EQ (res["blocks"].asInt (), 1);
+
+  ASSERT_EQ (res["phases"].size (), 2);
+  EXPECT_EQ (res["phases"][0]["name"], "foo");
+  EXPECT_EQ (res["phases"][0]["count"].asInt (), 1);
+  EXPECT_EQ (res["phases"][1]["name"], "bar");
+
+  const auto& last = res["last"];
+  EXPECT_EQ (last["height"].asInt (), 10);
+  ASSERT_EQ (last["phases"].size (), 2);
+  EXPECT_EQ (last["phases"][0]["statements"].asInt (), 3);
+  EXPECT_EQ (last["phases"][0]["entities"].asInt (), 5);
+  EXPECT_EQ (last["phases"][1]["statements"].asInt (), 0);
+  EXPECT_EQ (last["phases"][1]["entities"].asInt (), 0);
+  EXPECT_GE (last["phases"][0]["ms"].asDouble (), 0.0);
+}
+
+TEST_F (BlockStatsTests, RollingWindow)
+{
+  RecordBlock (10, 1, 1);
+  RecordBlock (11, 1, 1);
+  RecordBlock (12, 1, 1);
+
+  const Json::Value res = stats.ToJson ();
+  EXPECT_EQ (res["blocks"].asInt (), 3);
+  EXPECT_EQ (res["window"].asInt (), 2);
+  EXPECT_EQ (res["phases"][0]["count"].asInt (), 2);
+  EXPECT_EQ (res["last"]["height"].asInt (), 12);
+}
+
+TEST_F (BlockStatsTests, Prometheus)
+{
+  RecordBlock (10, 2, 1);
+  RecordBlock (11, 3, 4);
+
+  const std::string res = stats.ToPrometheus ();
+  EXPECT_NE (res.find ("taurion_blocks_total 2\n"), std::string::npos);
+  EXPECT_NE (res.find ("taurion_block_phase_seconds_count{phase=\"foo\"} 2\n"),
+             std::string::npos);
+  EXPECT_NE (res.find ("taurion_block_phase_seconds_bucket{phase=\"foo\","
+                       "le=\"+Inf\"} 2\n"),
+             std::string::npos);
+  EXPECT_NE (res.find ("taurion_block_phase_statements_total{phase=\"foo\"}"
+                       " 5\n"),
+             std::string::npos);
+  EXPECT_NE (res.find ("taurion_block_phase_entities_total{phase=\"foo\"}"
+                       " 5\n"),
+             std::string::npos);
+}
+
+TEST_F (BlockStatsTests, NoStats)
+{
+  BlockStats::Recorder rec(nullptr, db, 10);
+  rec.StartPhase ("foo");
+  QueryRows (10);
+}
+
+} // anonymous namespace
+} // namespace pxd
@@ -0,0 +1,98 @@
+/*
+    GSP for the Taurion blockchain game
+    Copyright (C) 2021  Autonomous Worlds Ltd
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#include "bootstrapcache.hpp"
+
+#include <glog/logging.h>
+
+namespace pxd
+{
+
+void
+BootstrapRegionsCache::Reset ()
+{
+  regions.clear ();
+  initialised = false;
+}
+
+size_t
+BootstrapRegionsCache::GetDataBytes () const
+{
+  size_t res = 0;
+  for (const auto& entry : regions)
+    res += entry.second.size ();
+  return res;
+}
+
+unsigned
+BootstrapRegionsCache::Update (GameStateJson& gsj, const xaya::uint256& hash,
+                               const unsigned h)
+{
+  if (initialised && hash == blockHash)
+    {
+      CHECK_EQ (h, height);
+      return 0;
+    }
+
+  /* If we are at a different block whose height is not beyond the last one,
+     blocks have been detached and regions may have been reverted to a state
+     with an older modification height.  We cannot detect those, so just
+     reload.  */
+  if (initialised && h <= height)
+    {
+      VLOG (1) << "Block " << hash.ToHex () << " at height " << h
+               << " is not after cached " << height
+               << ", reloading all regions";
+      Reset ();
+    }
+
+  /* QueryModifiedSince returns regions with a modification height of
+     at least the given one, so we start after the last cached height.  */
+  const unsigned since = initialised ? height + 1 : 0;
+
+  unsigned cnt = 0;
+  gsj.ForEachRegion (since, [this, &cnt] (const Json::Value& r)
+    {
+      regions[r["id"].asUInt ()] = SerialiseJson (r);
+      ++cnt;
+    });
+
+  initialised = true;
+  blockHash = hash;
+  height = h;
+
+  VLOG (1) << "Updated " << cnt << " regions in bootstrap cache";
+  return cnt;
+}
+
+void
+BootstrapRegionsCache::Write (JsonStreamWriter& out) const
+{
+  CHECK (initialised);
+
+  out.BeginObject ();
+  out.Key ("regions");
+  out.BeginArray ();
+  for (const auto& entry : regions)
+    out.RawValue (entry.second);
+  out.EndArray ();
+  out.EndObject ();
+}
+
+} // namespace pxd
@@ -0,0 +1,99 @@
+/*
+    GSP for the Taurion blockchain game
+    Copyright (C) 2021  Autonomous Worlds Ltd
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef PXD_BOOTSTRAPCACHE_HPP
+#define PXD_BOOTSTRAPCACHE_HPP
+
+#include "gamestatejson.hpp"
+#include "jsonstream.hpp"
+
+#include "mapdata/regionmap.hpp"
+
+#include <xayautil/uint256.hpp>
+
+#include <map>
+#include <string>
+
+namespace pxd
+{
+
+/**
+ * In-memory cache of the serialised region data that makes up the
+ * bootstrap data.  It is updated incrementally on each new block, so that
+ * only the regions that actually changed are converted and serialised again,
+ * and the full bootstrap JSON can then be produced by just concatenating
+ * the cached strings.
+ *
+ * This class is not thread-safe; callers have to synchronise access.
+ */
+class BootstrapRegionsCache
+{
+
+private:
+
+  /** Serialised JSON of each region, keyed (and ordered) by region ID.  */
+  std::map<RegionMap::IdT, std::string> regions;
+
+  /** Whether or not the cache has been filled already.  */
+  bool initialised = false;
+
+  /** The block hash the cache corresponds to (if initialised).  */
+  xaya::uint256 blockHash;
+
+  /** The block height the cache corresponds to (if initialised).  */
+  unsigned height;
+
+public:
+
+  BootstrapRegionsCache () = default;
+
+  BootstrapRegionsCache (const BootstrapRegionsCache&) = delete;
+  void operator= (const BootstrapRegionsCache&) = delete;
+
+  /**
+   * Clears the cache, so that the next update reloads all regions.
+   */
+  void Reset ();
+
+  /**
+   * Brings the cache up-to-date with the state of the given GameStateJson,
+   * which corresponds to the given block.  If it is the block of the last
+   * update, nothing needs to be done.  If it is a different block whose
+   * height is not larger than the last one (i.e. blocks have been detached),
+   * all regions are reloaded.  Returns the number of regions that have been
+   * (re-)serialised.
+   */
+  unsigned Update (GameStateJson& gsj, const xaya::uint256& hash, unsigned h);
+
+  /**
+   * Writes the bootstrap data from the cache.  The result is exactly what
+   * GameStateJson::WriteBootstrapData would produce.
+   */
+  void Write (JsonStreamWriter& out) const;
+
+  /**
+   * Returns the total size of the cached serialised data in bytes.
+   */
+  size_t GetDataBytes () const;
+
+};
+
+} // namespace pxd
+
+#endif // PXD_BOOTSTRAPCACHE_HPP
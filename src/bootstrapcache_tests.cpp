@@ -0,0 +1,174 @@
+/*
+    GSP for the Taurion blockchain game
+    Copyright (C) 2021  Autonomous Worlds Ltd
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#include "bootstrapcache.hpp"
+
+#include "testutils.hpp"
+
+#include "database/dbtest.hpp"
+#include "database/region.hpp"
+
+#include <gtest/gtest.h>
+
+#include <xayautil/hash.hpp>
+
+#include <sstream>
+#include <string>
+
+namespace pxd
+{
+namespace
+{
+
+class BootstrapRegionsCacheTests : public DBTestWithSchema
+{
+
+protected:
+
+  ContextForTesting ctx;
+  GameStateJson gsj;
+
+  BootstrapRegionsCache cache;
+
+  BootstrapRegionsCacheTests ()
+    : gsj(db, ctx)
+  {}
+
+  /**
+   * Sets the prospecting character of the given region, marking it
+   * as modified at the given height.
+   */
+  void
+  Prospect (const RegionMap::IdT id, const unsigned h,
+            const Database::IdT character)
+  {
+    RegionsTable tbl(db, h);
+    tbl.GetById (id)->MutableProto ().set_prospecting_character (character);
+  }
+
+  /**
+   * Updates the cache for the given block, and expects that the output
+   * then matches the freshly computed bootstrap data.  Returns the number
+   * of regions that were updated.  The block hash is derived from the
+   * height and the given branch name.
+   */
+  unsigned
+  UpdateAndVerify (const unsigned h, const std::string& branch = "main")
+  {
+    const auto hash = xaya::SHA256::Hash (branch + std::to_string (h));
+    const unsigned res = cache.Update (gsj, hash, h);
+
+    std::ostringstream cached;
+    {
+      JsonStreamWriter writer(cached);
+      cache.Write (writer);
+    }
+
+    std::ostringstream expected;
+    {
+      JsonStreamWriter writer(expected);
+      gsj.WriteBootstrapData (writer);
+    }
+
+    EXPECT_EQ (cached.str (), expected.str ());
+    return res;
+  }
+
+};
+
+TEST_F (BootstrapRegionsCacheTests, Empty)
+{
+  EXPECT_EQ (UpdateAndVerify (10), 0);
+  EXPECT_EQ (cache.GetDataBytes (), 0);
+}
+
+TEST_F (BootstrapRegionsCacheTests, IncrementalUpdates)
+{
+  Prospect (20, 10, 1);
+  Prospect (30, 10, 2);
+  EXPECT_EQ (UpdateAndVerify (10), 2);
+
+  EXPECT_EQ (UpdateAndVerify (11), 0);
+
+  Prospect (10, 12, 3);
+  Prospect (30, 12, 4);
+  EXPECT_EQ (UpdateAndVerify (12), 2);
+
+  Prospect (20, 14, 5);
+  EXPECT_EQ (UpdateAndVerify (14), 1);
+}
+
+TEST_F (BootstrapRegionsCacheTests, ReloadOnDetach)
+{
+  Prospect (20, 10, 1);
+  Prospect (30, 11, 2);
+  EXPECT_EQ (UpdateAndVerify (11), 2);
+
+  /* Simulate undoing block 11, which reverts region 30 to its previous
+     modification height (and thus it is not returned from a query for
+     changes since then).  */
+  {
+    RegionsTable tbl(db, 9);
+    tbl.GetById (30)->MutableProto ().clear_prospecting_character ();
+  }
+  EXPECT_EQ (UpdateAndVerify (10), 2);
+}
+
+TEST_F (BootstrapRegionsCacheTests, SameBlock)
+{
+  Prospect (20, 10, 1);
+  Prospect (30, 10, 2);
+  EXPECT_EQ (UpdateAndVerify (10), 2);
+  EXPECT_EQ (UpdateAndVerify (10), 0);
+}
+
+TEST_F (BootstrapRegionsCacheTests, ReorgToSameHeight)
+{
+  Prospect (20, 10, 1);
+  Prospect (30, 11, 2);
+  EXPECT_EQ (UpdateAndVerify (11), 2);
+
+  /* Block 11 is replaced by a different one, which modifies another
+     region instead.  */
+  {
+    RegionsTable tbl(db, 9);
+    tbl.GetById (30)->MutableProto ().clear_prospecting_character ();
+  }
+  Prospect (40, 11, 3);
+
+  /* All regions in the database are reloaded.  */
+  EXPECT_EQ (UpdateAndVerify (11, "fork"), 3);
+}
+
+TEST_F (BootstrapRegionsCacheTests, Reset)
+{
+  Prospect (20, 10, 1);
+  EXPECT_EQ (UpdateAndVerify (10), 1);
+
+  EXPECT_GT (cache.GetDataBytes (), 0);
+
+  cache.Reset ();
+  EXPECT_EQ (cache.GetDataBytes (), 0);
+
+  Prospect (30, 11, 2);
+  EXPECT_EQ (UpdateAndVerify (11), 2);
+}
+
+} // anonymous namespace
+} // namespace pxd
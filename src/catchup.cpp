@@ -0,0 +1,64 @@
+/*
+    GSP for the Taurion blockchain game
+    Copyright (C) 2021  Autonomous Worlds Ltd
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#include "catchup.hpp"
+
+#include "database/schema.hpp"
+
+#include <glog/logging.h>
+
+namespace pxd
+{
+
+void
+CatchUpMode::SetThreshold (const int64_t seconds)
+{
+  CHECK_GE (seconds, 0);
+  threshold = seconds;
+}
+
+bool
+CatchUpMode::Update (xaya::SQLiteDatabase& db, const int64_t blockTime,
+                     const int64_t now)
+{
+  if (threshold == 0)
+    return false;
+
+  const int64_t behind = now - blockTime;
+
+  if (!active && behind > threshold)
+    {
+      LOG (INFO)
+          << "Block is " << behind << " seconds old, entering catch-up mode";
+      DropRpcIndices (db);
+      active = true;
+    }
+  else if (active && 2 * behind <= threshold)
+    {
+      LOG (INFO)
+          << "Block is " << behind << " seconds old, leaving catch-up mode"
+          << " and rebuilding RPC indices";
+      SetupDatabaseSchema (db);
+      active = false;
+    }
+
+  return active;
+}
+
+} // namespace pxd
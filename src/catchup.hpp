@@ -0,0 +1,102 @@
+/*
+    GSP for the Taurion blockchain game
+    Copyright (C) 2021  Autonomous Worlds Ltd
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef PXD_CATCHUP_HPP
+#define PXD_CATCHUP_HPP
+
+#include <xayagame/sqlitestorage.hpp>
+
+#include <atomic>
+#include <cstdint>
+
+namespace pxd
+{
+
+/**
+ * Tracks whether the GSP is in "catch-up mode", i.e. syncing blocks that
+ * are far behind the current wall-clock time (like during the initial sync).
+ * In that mode, work that is only needed for serving up-to-date data
+ * to clients (but not for the consensus state) can be skipped.
+ *
+ * The mode is determined from the timestamps of attached blocks.  It is
+ * entered when a block is older than the threshold, and left again when
+ * blocks are within half the threshold of the current time.  That way
+ * we do not switch back and forth for blocks with timestamps right at the
+ * threshold.
+ *
+ * While in catch-up mode, the database indices only needed for RPC
+ * queries are dropped, and they are rebuilt when catch-up mode ends.
+ * The rebuild happens as part of attaching the block that ends catch-up
+ * mode, and thus inside the game's transaction and lock.  On a large
+ * database, this stalls block processing and RPC calls for as long as
+ * the indices take to build.  Since the indices are needed for serving
+ * clients at the tip anyway, this is a one-time cost per catch-up.
+ */
+class CatchUpMode
+{
+
+private:
+
+  /** The threshold in seconds, or zero if catch-up mode is disabled.  */
+  int64_t threshold = 0;
+
+  /**
+   * Whether or not we are currently catching up.  This is updated while
+   * blocks are attached, but may be read from other threads (e.g. the
+   * REST API).
+   */
+  std::atomic<bool> active;
+
+public:
+
+  CatchUpMode ()
+    : active(false)
+  {}
+
+  CatchUpMode (const CatchUpMode&) = delete;
+  void operator= (const CatchUpMode&) = delete;
+
+  /**
+   * Enables catch-up mode with the given threshold in seconds.  Zero
+   * disables it.
+   */
+  void SetThreshold (int64_t seconds);
+
+  /**
+   * Updates the mode for a block with the given timestamp that is being
+   * attached, based on the current time.  If the mode changes, the RPC
+   * indices are dropped or rebuilt in the database.  Returns true if we
+   * are catching up.
+   */
+  bool Update (xaya::SQLiteDatabase& db, int64_t blockTime, int64_t now);
+
+  /**
+   * Returns true if we are currently catching up.
+   */
+  bool
+  IsActive () const
+  {
+    return active;
+  }
+
+};
+
+} // namespace pxd
+
+#endif // PXD_CATCHUP_HPP
@@ -0,0 +1,112 @@
+/*
+    GSP for the Taurion blockchain game
+    Copyright (C) 2021  Autonomous Worlds Ltd
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#include "catchup.hpp"
+
+#include "database/dbtest.hpp"
+
+#include <gtest/gtest.h>
+
+#include <glog/logging.h>
+
+namespace pxd
+{
+namespace
+{
+
+class CatchUpModeTests : public DBTestWithSchema
+{
+
+protected:
+
+  /** Fake current time used in the tests.  */
+  static constexpr int64_t NOW = 1'000'000;
+
+  CatchUpMode mode;
+
+  CatchUpModeTests ()
+  {
+    mode.SetThreshold (100);
+  }
+
+  /**
+   * Updates the mode for a block that is the given number of seconds old.
+   */
+  bool
+  Update (const int64_t age)
+  {
+    return mode.Update (*db, NOW - age, NOW);
+  }
+
+  /**
+   * Returns true if the given index exists in the database.
+   */
+  bool
+  HasIndex (const std::string& name)
+  {
+    auto stmt = (*db).Prepare (R"(
+      SELECT COUNT(*) FROM `sqlite_master`
+        WHERE `type` = 'index' AND `name` = ?1
+    )");
+    stmt.Bind (1, name);
+    CHECK (stmt.Step ());
+    return stmt.Get<int> (0) > 0;
+  }
+
+};
+
+constexpr int64_t CatchUpModeTests::NOW;
+
+TEST_F (CatchUpModeTests, Disabled)
+{
+  mode.SetThreshold (0);
+  EXPECT_FALSE (Update (1'000));
+  EXPECT_FALSE (mode.IsActive ());
+  EXPECT_TRUE (HasIndex ("dex_trade_history_by_item_building"));
+}
+
+TEST_F (CatchUpModeTests, EnterAndLeave)
+{
+  EXPECT_FALSE (Update (100));
+  EXPECT_TRUE (HasIndex ("dex_trade_history_by_item_building"));
+
+  EXPECT_TRUE (Update (101));
+  EXPECT_TRUE (mode.IsActive ());
+  EXPECT_FALSE (HasIndex ("dex_trade_history_by_item_building"));
+  EXPECT_TRUE (HasIndex ("characters_owner"));
+
+  EXPECT_FALSE (Update (50));
+  EXPECT_FALSE (mode.IsActive ());
+  EXPECT_TRUE (HasIndex ("dex_trade_history_by_item_building"));
+}
+
+TEST_F (CatchUpModeTests, Hysteresis)
+{
+  EXPECT_TRUE (Update (1'000));
+  EXPECT_TRUE (Update (100));
+  EXPECT_TRUE (Update (51));
+  EXPECT_FALSE (HasIndex ("regions_by_modifiedheight"));
+
+  EXPECT_FALSE (Update (0));
+  EXPECT_FALSE (Update (99));
+  EXPECT_TRUE (HasIndex ("regions_by_modifiedheight"));
+}
+
+} // anonymous namespace
+} // namespace pxd
@@ -20,8 +20,11 @@
 
 #include "config.h"
 
+#include "gamestatejson.hpp"
 #include "pxrpcserver.hpp"
 #include "rest.hpp"
+#include "rpccache.hpp"
+#include "statedelta.hpp"
 
 #include <charon/notifications.hpp>
 #include <charon/rpcserver.hpp>
@@ -39,8 +42,13 @@
 #include <chrono>
 #include <condition_variable>
 #include <map>
+#include <memory>
 #include <mutex>
+#include <set>
+#include <sstream>
+#include <stdexcept>
 #include <string>
+#include <thread>
 
 namespace pxd
 {
@@ -59,10 +67,26 @@ DEFINE_int32 (charon_priority, 0, "Priority for the XMPP connection");
 
 DEFINE_string (charon_pubsub_service, "",
                "The pubsub service to use on the Charon server");
+DEFINE_bool (charon_state_deltas, false,
+             "If true, the Charon server computes and pushes per-block"
+             " deltas of the game state, and the Charon client keeps"
+             " a local copy of the state updated with them");
+DEFINE_int32 (charon_state_delta_max_entries, 10'000,
+              "Maximum number of changed entries the Charon server sends"
+              " in a state delta; with more, clients refetch the full state");
 DEFINE_int32 (charon_timeout_ms, 3000,
               "Timeout in ms that the Charon client will wait"
               " for a server response");
 
+DEFINE_bool (charon_client_cache, true,
+             "If true, the Charon client caches state results per block"
+             " and coalesces identical concurrent requests");
+DEFINE_int32 (charon_client_cache_entries, 1'000,
+              "Maximum number of results cached in the Charon client");
+DEFINE_int32 (charon_client_cache_mib, 64,
+              "Maximum total size (in MiB) of the results cached"
+              " in the Charon client");
+
 DEFINE_string (rest_endpoint, "https://rest.taurion.io",
                "URL for the REST API that is used in the Charon client");
 DEFINE_string (cafile, "",
@@ -72,6 +96,24 @@ DEFINE_string (cafile, "",
 /** Interval for Charon server reconnects.  */
 const auto RECONNECT_INTERVAL = std::chrono::seconds (5);
 
+/**
+ * Number of recent blocks for which the Charon server keeps track of the
+ * modified state entries.  Deltas can be computed as long as the previous
+ * one was sent for one of those blocks.
+ */
+constexpr unsigned STATE_CHANGE_LOG_BLOCKS = 32;
+
+/**
+ * Number of times the Charon client tries to fetch the full state through
+ * REST for the block of the current delta, before giving up (and trying
+ * again with the next delta).  The REST endpoint may lag slightly behind
+ * the deltas pushed through Charon.
+ */
+constexpr unsigned STATE_FETCH_ATTEMPTS = 5;
+
+/** Delay between retries of fetching the full state (times the attempt).  */
+const auto STATE_FETCH_RETRY = std::chrono::milliseconds (500);
+
 /**
  * Returns the version string to use for this build in Charon (i.e. advertise
  * in the server and require in the client).
@@ -115,6 +157,12 @@ const std::map<std::string, PXRpcMethod> CHARON_METHODS = {
   {"getcharacters", &PXRpcServer::getcharactersI},
   {"getgroundloot", &PXRpcServer::getgroundlootI},
   {"getongoings", &PXRpcServer::getongoingsI},
+  {"getbuildingsinrange", &PXRpcServer::getbuildingsinrangeI},
+  {"getcharactersinrange", &PXRpcServer::getcharactersinrangeI},
+  {"getgroundlootinrange", &PXRpcServer::getgroundlootinrangeI},
+  {"getcharactersbyowner", &PXRpcServer::getcharactersbyownerI},
+  {"getbuildinginventoriesbyowner",
+   &PXRpcServer::getbuildinginventoriesbyownerI},
   {"getregions", &PXRpcServer::getregionsI},
   {"getmoneysupply", &PXRpcServer::getmoneysupplyI},
   {"getprizestats", &PXRpcServer::getprizestatsI},
@@ -125,6 +173,15 @@ const std::map<std::string, PXRpcMethod> CHARON_METHODS = {
   {"getversion", &PXRpcServer::getversionI},
 };
 
+/**
+ * Methods from CHARON_METHODS whose results may change without a new block,
+ * and which are thus never cached in the Charon client.
+ */
+const std::set<std::string> UNCACHEABLE_METHODS = {
+  "getpendingstate",
+  "getversion",
+};
+
 /**
  * UpdateWaiter implementation that forwards wait calls to a given call
  * on a PXRpcServer instance.
@@ -161,6 +218,96 @@ public:
 
 };
 
+/**
+ * Charon notification for the per-block state deltas computed with
+ * StateDeltaTracker.  The state ID is the block hash the delta leads to.
+ */
+class StateDeltaNotification : public charon::NotificationType
+{
+
+public:
+
+  StateDeltaNotification ()
+    : charon::NotificationType("statedelta")
+  {}
+
+  Json::Value
+  ExtractStateId (const Json::Value& fullState) const override
+  {
+    return fullState["blockhash"];
+  }
+
+  Json::Value
+  AlwaysBlockId () const override
+  {
+    return "";
+  }
+
+};
+
+/**
+ * UpdateWaiter that waits for a new block and then computes the delta
+ * of the game state relative to the previous one.  The delta is computed
+ * just once here (from the entries modified in the blocks in between),
+ * and then pushed to all subscribed clients.
+ */
+class StateDeltaWaiter : public charon::UpdateWaiter
+{
+
+private:
+
+  /** PXRpcServer instance used for waiting on changes.  */
+  PXRpcServer& rpc;
+
+  /** The Game instance to extract state data from.  */
+  xaya::Game& game;
+
+  /** The game logic, used to extract state data.  */
+  PXLogic& logic;
+
+  /** Tracker for computing the deltas.  */
+  StateDeltaTracker tracker;
+
+  /** The argument list for the waitforchange call.  */
+  Json::Value params;
+
+public:
+
+  explicit StateDeltaWaiter (PXRpcServer& r, xaya::Game& g, PXLogic& l,
+                             const Json::Value& alwaysBlock)
+    : rpc(r), game(g), logic(l),
+      tracker(*l.GetStateChangeLog (), FLAGS_charon_state_delta_max_entries),
+      params(Json::arrayValue)
+  {
+    params.append (alwaysBlock);
+  }
+
+  bool
+  WaitForUpdate (Json::Value& newState) override
+  {
+    Json::Value block;
+    rpc.waitforchangeI (params, block);
+
+    /* The block returned from waitforchange may be outdated already when
+       we read the state.  Thus the delta is keyed on the block hash that
+       is passed to the callback together with the state.  If there has
+       been no new block, the tracker returns the previous delta again.  */
+    const Json::Value state = logic.GetCustomStateData (game,
+      [this] (GameStateJson& gsj, const xaya::uint256& hash,
+              const unsigned height)
+        {
+          return tracker.Update (gsj, hash, height);
+        });
+
+    if (!state.isMember ("data"))
+      return false;
+
+    newState = state["data"];
+    return true;
+  }
+
+};
+
 /**
  * Charon backend implementation that answers method calls directly through
  * a Game instance (without going through some JSON-RPC loop).
@@ -215,6 +362,18 @@ public:
                      &PXRpcServer::waitforchangeI);
     AddNotification (std::make_unique<charon::PendingChangeNotification> (),
                      &PXRpcServer::waitforpendingchangeI);
+
+    if (FLAGS_charon_state_deltas)
+      {
+        LOG (INFO) << "Pushing per-block state deltas through Charon";
+        rules.EnableStateChangeLog (STATE_CHANGE_LOG_BLOCKS);
+        auto n = std::make_unique<StateDeltaNotification> ();
+        auto w = std::make_unique<StateDeltaWaiter> (rpc, game, rules,
+                                                     n->AlwaysBlockId ());
+        auto t = std::make_unique<charon::WaiterThread> (std::move (n),
+                                                         std::move (w));
+        srv.AddNotification (std::move (t));
+      }
   }
 
   void
@@ -292,6 +451,12 @@ private:
     /** Methods to forward to the nonstate RPC server.  */
     static const std::map<std::string, NonStateMethod> NONSTATE_METHODS;
 
+    /**
+     * Methods that can be answered from the local copy of the state
+     * (if enabled), mapped to the section of the state they return.
+     */
+    static const std::map<std::string, std::string> LOCAL_STATE_METHODS;
+
     /**
      * Notification methods enabled on the client.  The value of each entry
      * is the type string we use on the Charon client.
@@ -385,6 +550,54 @@ private:
   /** The RPC server, if one has been started / set up.  */
   std::unique_ptr<RpcServer> rpc;
 
+  /** Cache for results forwarded through Charon.  */
+  RpcResultCache cache;
+
+  /**
+   * Thread that waits for state-change notifications and updates the
+   * current block in the cache accordingly.
+   */
+  std::unique_ptr<std::thread> cacheUpdater;
+
+  /**
+   * Runs the loop for cacheUpdater until we should stop.
+   */
+  void UpdateCacheBlock ();
+
+  /**
+   * Local copy of the tracked sections of the game state (as custom-state
+   * result with "blockhash" and "data"), which is kept up-to-date with
+   * the state deltas pushed by the server.  It is null while we have
+   * no state yet.
+   */
+  Json::Value localState;
+
+  /** Mutex protecting localState.  */
+  std::mutex stateMut;
+
+  /**
+   * Thread that waits for state deltas and applies them to localState.
+   */
+  std::unique_ptr<std::thread> stateUpdater;
+
+  /**
+   * Runs the loop for stateUpdater until we should stop.
+   */
+  void UpdateLocalState ();
+
+  /**
+   * Fetches the full state through REST, and returns it with only the
+   * sections we track in the local state.  Throws std::runtime_error
+   * if the REST request fails or returns something invalid.
+   */
+  Json::Value FetchTrackedState ();
+
+  /**
+   * Fills in the result for a method returning one section of the local
+   * state.  Returns false if we have no local state.
+   */
+  bool GetLocalState (const std::string& section, Json::Value& result);
+
   /** Mutex for stopping.  */
   std::mutex mut;
 
@@ -400,7 +613,9 @@ public:
                              const std::string& clientJid,
                              const std::string& password)
     : client(serverJid, GetBackendVersion (), clientJid, password),
-      rest(FLAGS_rest_endpoint)
+      rest(FLAGS_rest_endpoint),
+      cache(FLAGS_charon_client_cache_entries,
+            static_cast<size_t> (FLAGS_charon_client_cache_mib) << 20)
   {
     LOG (INFO)
         << "Using " << serverJid << " as Charon server,"
@@ -435,6 +650,15 @@ const std::map<std::string, RealCharonClient::RpcServer::NonStateMethod>
     {"getbuildingshape", &NonStateRpcServer::getbuildingshapeI},
   };
 
+const std::map<std::string, std::string>
+    RealCharonClient::RpcServer::LOCAL_STATE_METHODS =
+  {
+    {"getaccounts", "accounts"},
+    {"getbuildings", "buildings"},
+    {"getcharacters", "characters"},
+    {"getgroundloot", "groundloot"},
+  };
+
 RealCharonClient::RpcServer::RpcServer (RealCharonClient& p,
                                         jsonrpc::AbstractServerConnector& conn)
   : jsonrpc::AbstractServer<RpcServer> (conn, jsonrpc::JSONRPC_SERVER_V2),
@@ -453,6 +677,7 @@ RealCharonClient::RpcServer::RpcServer (RealCharonClient& p,
 
   AddNotification<charon::StateChangeNotification> ("waitforchange");
   AddNotification<charon::PendingChangeNotification> ("waitforpendingchange");
+  AddNotification<StateDeltaNotification> ("waitforstatedelta");
 }
 
 void
@@ -477,10 +702,27 @@ RealCharonClient::RpcServer::HandleMethodCall (jsonrpc::Procedure& proc,
         }
     }
 
+  const auto mitLocal = LOCAL_STATE_METHODS.find (method);
+  if (FLAGS_charon_state_deltas && mitLocal != LOCAL_STATE_METHODS.end ()
+        && parent.GetLocalState (mitLocal->second, result))
+    {
+      VLOG (1) << "Answering method " << method << " from the local state";
+      return;
+    }
+
   if (CHARON_METHODS.find (method) != CHARON_METHODS.end ())
     {
-      VLOG (1) << "Forwarding method " << method << " through Charon";
-      result = parent.client.ForwardMethod (method, params);
+      const auto forward = [this, &method, &params] ()
+        {
+          VLOG (1) << "Forwarding method " << method << " through Charon";
+          return parent.client.ForwardMethod (method, params);
+        };
+
+      if (FLAGS_charon_client_cache
+            && UNCACHEABLE_METHODS.count (method) == 0)
+        result = parent.cache.Get (method, params, forward);
+      else
+        result = forward ();
 
       /* getversion is a special case, where we want to return both the
          result of the server and the local one from nonstate.  */
@@ -541,6 +783,18 @@ RealCharonClient::Run ()
     LOG (INFO) << "Using server resource: " << srvResource;
 
   shouldStop = false;
+  if (FLAGS_charon_client_cache)
+    cacheUpdater = std::make_unique<std::thread> ([this] ()
+      {
+        UpdateCacheBlock ();
+      });
+  /* The state delta notification is only registered with the client
+     together with the local RPC server.  */
+  if (FLAGS_charon_state_deltas && rpc != nullptr)
+    stateUpdater = std::make_unique<std::thread> ([this] ()
+      {
+        UpdateLocalState ();
+      });
   if (rpc != nullptr)
     rpc->StartListening ();
 
@@ -552,9 +806,179 @@ RealCharonClient::Run ()
 
   if (rpc != nullptr)
     rpc->StopListening ();
+  if (cacheUpdater != nullptr)
+    {
+      cacheUpdater->join ();
+      cacheUpdater.reset ();
+    }
+  if (stateUpdater != nullptr)
+    {
+      stateUpdater->join ();
+      stateUpdater.reset ();
+    }
   client.Disconnect ();
 }
 
+void
+RealCharonClient::UpdateCacheBlock ()
+{
+  const std::string type = charon::StateChangeNotification ().GetType ();
+
+  /* The state for state-change notifications is the current block hash.
+     WaitForChange returns after a timeout even without a change, so that
+     we can check regularly if we should stop.  */
+  Json::Value known = "";
+  while (true)
+    {
+      {
+        std::lock_guard<std::mutex> lock(mut);
+        if (shouldStop)
+          return;
+      }
+
+      try
+        {
+          known = client.WaitForChange (type, known);
+        }
+      catch (const std::exception& exc)
+        {
+          /* If we do not know about changes, we must not cache results.  */
+          LOG (WARNING) << "Waiting for state change failed: " << exc.what ();
+          cache.SetBlock ("");
+          known = "";
+          std::this_thread::sleep_for (std::chrono::seconds (1));
+          continue;
+        }
+
+      if (known.isString ())
+        cache.SetBlock (known.asString ());
+      else
+        known = "";
+    }
+}
+
+Json::Value
+RealCharonClient::FetchTrackedState ()
+{
+  Json::Value full = rest.GetState ();
+  if (!full.isObject () || !full["blockhash"].isString ()
+        || !full["data"].isObject ())
+    throw std::runtime_error ("invalid state returned from REST endpoint");
+
+  Json::Value data(Json::objectValue);
+  for (const auto& sec : StateDeltaTracker::Sections ())
+    data[sec.first].swap (full["data"][sec.first]);
+  full["data"].swap (data);
+
+  return full;
+}
+
+void
+RealCharonClient::UpdateLocalState ()
+{
+  const std::string type = StateDeltaNotification ().GetType ();
+
+  /* The state ID for the notification is the block hash of the delta.  */
+  Json::Value known = "";
+  while (true)
+    {
+      {
+        std::lock_guard<std::mutex> lock(mut);
+        if (shouldStop)
+          return;
+      }
+
+      Json::Value delta;
+      try
+        {
+          delta = client.WaitForChange (type, known);
+        }
+      catch (const std::exception& exc)
+        {
+          LOG (WARNING) << "Waiting for state delta failed: " << exc.what ();
+          known = "";
+          std::this_thread::sleep_for (std::chrono::seconds (1));
+          continue;
+        }
+
+      if (!delta.isObject ())
+        {
+          known = "";
+          continue;
+        }
+      known = delta["blockhash"];
+
+      {
+        std::lock_guard<std::mutex> lock(stateMut);
+        if (localState.isObject () && localState["blockhash"] == known)
+          continue;
+        if (ApplyStateDelta (delta, localState))
+          {
+            VLOG (1) << "Applied state delta for block " << known;
+            continue;
+          }
+      }
+
+      /* The delta is not relative to our state (or there is no delta data,
+         e.g. after a reorg), so we need to fetch the full state again.
+         This is done without holding the lock, so that requests can still
+         be answered from the previous state in the mean time.  */
+      LOG (INFO) << "Fetching full state through REST for block " << known;
+      Json::Value fresh;
+      try
+        {
+          /* The state must be for exactly the block of the delta, as
+             otherwise no further deltas would apply to it.  */
+          for (unsigned attempt = 1; ; ++attempt)
+            {
+              fresh = FetchTrackedState ();
+              if (fresh["blockhash"] == known)
+                break;
+
+              std::ostringstream msg;
+              msg << "REST state is for block " << fresh["blockhash"].asString ()
+                  << " instead of " << known;
+              if (attempt >= STATE_FETCH_ATTEMPTS)
+                throw std::runtime_error (msg.str ());
+
+              VLOG (1) << msg.str () << ", retrying";
+              std::this_thread::sleep_for (attempt * STATE_FETCH_RETRY);
+            }
+        }
+      catch (const std::runtime_error& exc)
+        {
+          LOG (WARNING) << "Failed to fetch the full state: " << exc.what ();
+          {
+            std::lock_guard<std::mutex> lock(stateMut);
+            localState = Json::Value ();
+          }
+          known = "";
+          std::this_thread::sleep_for (std::chrono::seconds (1));
+          continue;
+        }
+
+      std::lock_guard<std::mutex> lock(stateMut);
+      localState = std::move (fresh);
+    }
+}
+
+bool
+RealCharonClient::GetLocalState (const std::string& section,
+                                 Json::Value& result)
+{
+  std::lock_guard<std::mutex> lock(stateMut);
+  if (!localState.isObject ())
+    return false;
+
+  result = Json::Value (Json::objectValue);
+  for (const auto& key : localState.getMemberNames ())
+    if (key != "data")
+      result[key] = localState[key];
+  result["data"] = localState["data"][section];
+
+  return true;
+}
+
 /* ************************************************************************** */
 
 } // anonymous namespace
@@ -0,0 +1,659 @@
+/*
+    GSP for the Taurion blockchain game
+    Copyright (C) 2021  Autonomous Worlds Ltd
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#include "dbdump.hpp"
+
+#include "proto/dbdump.pb.h"
+
+#include <xayautil/compression.hpp>
+#include <xayautil/hash.hpp>
+
+#include <google/protobuf/io/coded_stream.h>
+#include <google/protobuf/io/zero_copy_stream_impl.h>
+
+#include <glog/logging.h>
+
+#include <sqlite3.h>
+
+#include <vector>
+
+namespace pxd
+{
+
+namespace
+{
+
+/** Version of the dump format that we write and accept.  */
+constexpr uint32_t DUMP_VERSION = 1;
+
+/** Number of rows per chunk.  */
+constexpr int CHUNK_ROWS = 1'000;
+
+/** Maximum size of a single entry or uncompressed chunk we accept.  */
+constexpr size_t MAX_ENTRY_SIZE = 256 << 20;
+
+/**
+ * Returns the raw bytes of a uint256 value as string.
+ */
+std::string
+BinaryHash (const xaya::uint256& hash)
+{
+  return std::string (reinterpret_cast<const char*> (hash.GetBlobData ()),
+                      xaya::uint256::NUM_BYTES);
+}
+
+/**
+ * Returns true if the given string starts with the prefix.
+ */
+bool
+HasPrefix (const std::string& str, const std::string& prefix)
+{
+  return str.compare (0, prefix.size (), prefix) == 0;
+}
+
+/**
+ * Executes a single SQL statement from a dump.  Unlike
+ * SQLiteDatabase::Execute, this fails (returns false) if the string
+ * contains more than one statement, so that nothing can be smuggled in
+ * after an expected prefix.  Errors from SQLite are reported by
+ * returning false as well.
+ */
+bool
+ExecuteSingleStatement (xaya::SQLiteDatabase& db, const std::string& sql)
+{
+  sqlite3_stmt* stmt = nullptr;
+  const char* tail = nullptr;
+  int rc = sqlite3_prepare_v2 (*db, sql.c_str (), sql.size () + 1,
+                               &stmt, &tail);
+  if (rc != SQLITE_OK)
+    {
+      LOG (ERROR)
+          << "Failed to prepare statement from dump: "
+          << sqlite3_errmsg (*db) << "\n" << sql;
+      sqlite3_finalize (stmt);
+      return false;
+    }
+
+  if (stmt == nullptr
+        || std::string (tail).find_first_not_of (" \t\r\n")
+              != std::string::npos)
+    {
+      LOG (ERROR) << "Expected a single statement in dump:\n" << sql;
+      sqlite3_finalize (stmt);
+      return false;
+    }
+
+  rc = sqlite3_step (stmt);
+  sqlite3_finalize (stmt);
+  if (rc != SQLITE_DONE)
+    {
+      LOG (ERROR)
+          << "Failed to execute statement from dump: "
+          << sqlite3_errmsg (*db) << "\n" << sql;
+      return false;
+    }
+
+  return true;
+}
+
+/**
+ * Returns the given SQL identifier quoted for use in a statement.
+ */
+std::string
+QuoteIdentifier (const std::string& name)
+{
+  std::string res = "`";
+  for (const char c : name)
+    {
+      if (c == '`')
+        res.push_back ('`');
+      res.push_back (c);
+    }
+  res.push_back ('`');
+  return res;
+}
+
+/**
+ * Helper class that writes the entries of a dump to a stream, and computes
+ * the checksum over them.
+ */
+class DumpWriter
+{
+
+private:
+
+  /** The underlying output stream.  */
+  google::protobuf::io::OstreamOutputStream out;
+
+  /** Hasher for the checksum.  */
+  xaya::SHA256 hasher;
+
+public:
+
+  explicit DumpWriter (std::ostream& o)
+    : out(&o)
+  {}
+
+  DumpWriter () = delete;
+  DumpWriter (const DumpWriter&) = delete;
+  void operator= (const DumpWriter&) = delete;
+
+  /**
+   * Writes an entry, and includes it in the checksum.
+   */
+  void
+  Write (const proto::DumpEntry& entry)
+  {
+    std::string data;
+    CHECK (entry.SerializeToString (&data));
+    hasher << data;
+
+    google::protobuf::io::CodedOutputStream coded(&out);
+    coded.WriteVarint32 (data.size ());
+    coded.WriteString (data);
+  }
+
+  /**
+   * Writes the trailer with the checksum over all previous entries.
+   */
+  void
+  Finish (const uint64_t rows)
+  {
+    proto::DumpEntry entry;
+    auto& trailer = *entry.mutable_trailer ();
+    trailer.set_rows (rows);
+    trailer.set_checksum (BinaryHash (hasher.Finalise ()));
+
+    std::string data;
+    CHECK (entry.SerializeToString (&data));
+
+    google::protobuf::io::CodedOutputStream coded(&out);
+    coded.WriteVarint32 (data.size ());
+    coded.WriteString (data);
+  }
+
+};
+
+/**
+ * Writes a chunk with the given rows (if there are any) and clears them.
+ */
+void
+FlushChunk (proto::DumpRows& rows, DumpWriter& writer)
+{
+  if (rows.rows_size () == 0)
+    return;
+
+  std::string serialised;
+  CHECK (rows.SerializeToString (&serialised));
+  rows.Clear ();
+
+  proto::DumpEntry entry;
+  entry.mutable_chunk ()->set_compressed (xaya::CompressData (serialised));
+  writer.Write (entry);
+}
+
+/**
+ * Reads out the value of a column in the current row of a statement.
+ */
+void
+ReadColumn (sqlite3_stmt* stmt, const int col, proto::DumpValue& val)
+{
+  switch (sqlite3_column_type (stmt, col))
+    {
+    case SQLITE_NULL:
+      val.set_null (true);
+      break;
+
+    case SQLITE_INTEGER:
+      val.set_integer (sqlite3_column_int64 (stmt, col));
+      break;
+
+    case SQLITE_FLOAT:
+      val.set_real (sqlite3_column_double (stmt, col));
+      break;
+
+    case SQLITE_TEXT:
+      {
+        const auto* text = sqlite3_column_text (stmt, col);
+        const int len = sqlite3_column_bytes (stmt, col);
+        val.set_text (reinterpret_cast<const char*> (text), len);
+        break;
+      }
+
+    case SQLITE_BLOB:
+      {
+        const auto* blob = sqlite3_column_blob (stmt, col);
+        const int len = sqlite3_column_bytes (stmt, col);
+        val.set_blob (static_cast<const char*> (blob), len);
+        break;
+      }
+
+    default:
+      LOG (FATAL)
+          << "Unexpected column type: " << sqlite3_column_type (stmt, col);
+    }
+}
+
+/**
+ * Binds a dumped value to a parameter of a statement.
+ */
+void
+BindValue (sqlite3_stmt* stmt, const int ind, const proto::DumpValue& val)
+{
+  int rc;
+  switch (val.value_case ())
+    {
+    case proto::DumpValue::kInteger:
+      rc = sqlite3_bind_int64 (stmt, ind, val.integer ());
+      break;
+    case proto::DumpValue::kReal:
+      rc = sqlite3_bind_double (stmt, ind, val.real ());
+      break;
+    case proto::DumpValue::kText:
+      rc = sqlite3_bind_text (stmt, ind, val.text ().data (),
+                              val.text ().size (), SQLITE_TRANSIENT);
+      break;
+    case proto::DumpValue::kBlob:
+      rc = sqlite3_bind_blob (stmt, ind, val.blob ().data (),
+                              val.blob ().size (), SQLITE_TRANSIENT);
+      break;
+    default:
+      rc = sqlite3_bind_null (stmt, ind);
+      break;
+    }
+  CHECK_EQ (rc, SQLITE_OK);
+}
+
+/**
+ * Dumps the rows of a single table, returning their number.
+ */
+uint64_t
+DumpRows (xaya::SQLiteDatabase& db, const std::string& table,
+          DumpWriter& writer)
+{
+  auto stmt = db.Prepare ("SELECT * FROM " + QuoteIdentifier (table));
+  const int numColumns = sqlite3_column_count (*stmt);
+
+  uint64_t num = 0;
+  proto::DumpRows rows;
+  while (stmt.Step ())
+    {
+      auto& row = *rows.add_rows ();
+      for (int i = 0; i < numColumns; ++i)
+        ReadColumn (*stmt, i, *row.add_values ());
+      ++num;
+
+      if (rows.rows_size () >= CHUNK_ROWS)
+        FlushChunk (rows, writer);
+    }
+  FlushChunk (rows, writer);
+
+  return num;
+}
+
+/**
+ * Reads the next entry from the input stream.  Returns false if there
+ * is none or it is invalid.
+ */
+bool
+ReadEntry (google::protobuf::io::ZeroCopyInputStream& in,
+           proto::DumpEntry& entry, std::string& data)
+{
+  google::protobuf::io::CodedInputStream coded(&in);
+
+  uint32_t size;
+  if (!coded.ReadVarint32 (&size) || size > MAX_ENTRY_SIZE)
+    return false;
+  if (!coded.ReadString (&data, size))
+    return false;
+
+  return entry.ParseFromString (data);
+}
+
+/**
+ * Reads and validates the header entry from the input stream, and fills
+ * in the header fields of info from it.  The serialised entry is returned
+ * in data, so that it can be included in the checksum.
+ */
+bool
+ReadHeader (google::protobuf::io::ZeroCopyInputStream& in, DumpInfo& info,
+            std::string& data)
+{
+  proto::DumpEntry entry;
+  if (!ReadEntry (in, entry, data) || !entry.has_header ())
+    {
+      LOG (ERROR) << "Dump does not start with a valid header";
+      return false;
+    }
+
+  const auto& header = entry.header ();
+  if (header.version () != DUMP_VERSION)
+    {
+      LOG (ERROR) << "Unsupported dump version: " << header.version ();
+      return false;
+    }
+  if (header.block_hash ().size () != xaya::uint256::NUM_BYTES)
+    {
+      LOG (ERROR) << "Invalid block hash in dump header";
+      return false;
+    }
+
+  info.chain = header.chain ();
+  info.hash.FromBlob (
+      reinterpret_cast<const unsigned char*> (header.block_hash ().data ()));
+  info.height = header.height ();
+
+  return true;
+}
+
+/**
+ * Helper class that holds the state while importing a dump.
+ */
+class DumpImporter
+{
+
+private:
+
+  /** The database to import into.  */
+  xaya::SQLiteDatabase& db;
+
+  /** Info about the dump that is filled in.  */
+  DumpInfo& info;
+
+  /** The INSERT statement for the current table (if any).  */
+  xaya::SQLiteDatabase::Statement insert;
+
+  /** Number of columns of the current table.  */
+  int numColumns = 0;
+
+  /** Index statements that should be run after all rows are inserted.  */
+  std::vector<std::string> indices;
+
+  /**
+   * Starts a new table.
+   */
+  bool ProcessTable (const proto::DumpTable& table);
+
+  /**
+   * Inserts the rows of a chunk into the current table.
+   */
+  bool ProcessChunk (const proto::DumpChunk& chunk);
+
+public:
+
+  explicit DumpImporter (xaya::SQLiteDatabase& d, DumpInfo& i)
+    : db(d), info(i)
+  {}
+
+  DumpImporter () = delete;
+  DumpImporter (const DumpImporter&) = delete;
+  void operator= (const DumpImporter&) = delete;
+
+  /**
+   * Processes the full dump from the given stream.
+   */
+  bool Process (std::istream& in);
+
+};
+
+bool
+DumpImporter::ProcessTable (const proto::DumpTable& table)
+{
+  /* The dump is only checked for integrity, not authenticated.  As a basic
+     sanity check, make sure at least that the schema statements we execute
+     from it are of the expected kind.  Dumps should still only be imported
+     from trusted sources.  */
+  bool ok = !table.name ().empty () && HasPrefix (table.sql (), "CREATE TABLE");
+  for (const auto& idx : table.indices ())
+    ok = ok && (HasPrefix (idx, "CREATE INDEX")
+                  || HasPrefix (idx, "CREATE UNIQUE INDEX"));
+
+  if (!ok)
+    {
+      LOG (ERROR) << "Invalid table in dump:\n" << table.DebugString ();
+      return false;
+    }
+
+  VLOG (1) << "Importing table " << table.name ();
+  if (!ExecuteSingleStatement (db, table.sql ()))
+    return false;
+  for (const auto& idx : table.indices ())
+    indices.push_back (idx);
+
+  /* Determine the number of columns by preparing a query on the
+     freshly created table.  */
+  {
+    const std::string sql = "SELECT * FROM " + QuoteIdentifier (table.name ());
+    auto stmt = db.Prepare (sql);
+    numColumns = sqlite3_column_count (*stmt);
+  }
+
+  std::string sql = "INSERT INTO " + QuoteIdentifier (table.name ())
+                      + " VALUES (";
+  for (int i = 0; i < numColumns; ++i)
+    {
+      if (i > 0)
+        sql += ", ";
+      sql += "?" + std::to_string (i + 1);
+    }
+  sql += ")";
+  insert = db.Prepare (sql);
+
+  ++info.tables;
+  return true;
+}
+
+bool
+DumpImporter::ProcessChunk (const proto::DumpChunk& chunk)
+{
+  if (numColumns == 0)
+    {
+      LOG (ERROR) << "Chunk of rows before any table in dump";
+      return false;
+    }
+
+  std::string serialised;
+  proto::DumpRows rows;
+  if (!xaya::UncompressData (chunk.compressed (), MAX_ENTRY_SIZE, serialised)
+        || !rows.ParseFromString (serialised))
+    {
+      LOG (ERROR) << "Invalid chunk of rows in dump";
+      return false;
+    }
+
+  for (const auto& row : rows.rows ())
+    {
+      if (row.values_size () != numColumns)
+        {
+          LOG (ERROR)
+              << "Row has " << row.values_size () << " values, but the table"
+              << " has " << numColumns << " columns";
+          return false;
+        }
+
+      insert.Reset ();
+      for (int i = 0; i < numColumns; ++i)
+        BindValue (*insert, i + 1, row.values (i));
+      insert.Execute ();
+
+      ++info.rows;
+    }
+
+  return true;
+}
+
+bool
+DumpImporter::Process (std::istream& in)
+{
+  google::protobuf::io::IstreamInputStream zcIn(&in);
+  xaya::SHA256 hasher;
+
+  proto::DumpEntry entry;
+  std::string data;
+
+  if (!ReadHeader (zcIn, info, data))
+    return false;
+  hasher << data;
+
+  while (true)
+    {
+      if (!ReadEntry (zcIn, entry, data))
+        {
+          LOG (ERROR) << "Dump is truncated or has an invalid entry";
+          return false;
+        }
+
+      switch (entry.entry_case ())
+        {
+        case proto::DumpEntry::kTable:
+          if (!ProcessTable (entry.table ()))
+            return false;
+          break;
+
+        case proto::DumpEntry::kChunk:
+          if (!ProcessChunk (entry.chunk ()))
+            return false;
+          break;
+
+        case proto::DumpEntry::kTrailer:
+          {
+            const auto& trailer = entry.trailer ();
+            if (trailer.checksum () != BinaryHash (hasher.Finalise ()))
+              {
+                LOG (ERROR) << "Checksum mismatch in dump";
+                return false;
+              }
+            if (trailer.rows () != info.rows)
+              {
+                LOG (ERROR)
+                    << "Dump should have " << trailer.rows () << " rows,"
+                    << " but has " << info.rows;
+                return false;
+              }
+
+            for (const auto& idx : indices)
+              if (!ExecuteSingleStatement (db, idx))
+                return false;
+
+            return true;
+          }
+
+        default:
+          LOG (ERROR) << "Unexpected entry in dump:\n" << entry.DebugString ();
+          return false;
+        }
+
+      hasher << data;
+    }
+}
+
+} // anonymous namespace
+
+Json::Value
+DumpInfo::ToJson () const
+{
+  Json::Value res(Json::objectValue);
+  res["chain"] = chain;
+  res["blockhash"] = hash.ToHex ();
+  res["height"] = height;
+  res["tables"] = tables;
+  res["rows"] = static_cast<Json::UInt64> (rows);
+
+  return res;
+}
+
+void
+WriteDatabaseDump (xaya::SQLiteDatabase& db, DumpInfo& info,
+                   std::ostream& out)
+{
+  DumpWriter writer(out);
+
+  {
+    proto::DumpEntry entry;
+    auto& header = *entry.mutable_header ();
+    header.set_version (DUMP_VERSION);
+    header.set_chain (info.chain);
+    header.set_block_hash (BinaryHash (info.hash));
+    header.set_height (info.height);
+    writer.Write (entry);
+  }
+
+  info.tables = 0;
+  info.rows = 0;
+
+  auto tables = db.Prepare (R"(
+    SELECT `name`, `sql`
+      FROM `sqlite_master`
+      WHERE `type` = 'table' AND `name` NOT LIKE 'sqlite!_%' ESCAPE '!'
+      ORDER BY `name`
+  )");
+  while (tables.Step ())
+    {
+      proto::DumpEntry entry;
+      auto& table = *entry.mutable_table ();
+      table.set_name (tables.Get<std::string> (0));
+      table.set_sql (tables.Get<std::string> (1));
+
+      auto indices = db.Prepare (R"(
+        SELECT `sql`
+          FROM `sqlite_master`
+          WHERE `type` = 'index' AND `tbl_name` = ?1 AND `sql` IS NOT NULL
+          ORDER BY `name`
+      )");
+      indices.Bind (1, table.name ());
+      while (indices.Step ())
+        table.add_indices (indices.Get<std::string> (0));
+
+      VLOG (1) << "Dumping table " << table.name ();
+      writer.Write (entry);
+      info.rows += DumpRows (db, table.name (), writer);
+      ++info.tables;
+    }
+
+  writer.Finish (info.rows);
+}
+
+bool
+ReadDumpHeader (std::istream& in, DumpInfo& info)
+{
+  google::protobuf::io::IstreamInputStream zcIn(&in);
+  std::string data;
+  return ReadHeader (zcIn, info, data);
+}
+
+bool
+ReadDatabaseDump (std::istream& in, xaya::SQLiteDatabase& db, DumpInfo& info)
+{
+  info.tables = 0;
+  info.rows = 0;
+
+  db.Execute ("BEGIN");
+
+  DumpImporter importer(db, info);
+  if (!importer.Process (in))
+    {
+      db.Execute ("ROLLBACK");
+      return false;
+    }
+
+  db.Execute ("COMMIT");
+  return true;
+}
+
+} // namespace pxd
@@ -0,0 +1,97 @@
+/*
+    GSP for the Taurion blockchain game
+    Copyright (C) 2021  Autonomous Worlds Ltd
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef PXD_DBDUMP_HPP
+#define PXD_DBDUMP_HPP
+
+#include <xayagame/sqlitestorage.hpp>
+#include <xayautil/uint256.hpp>
+
+#include <json/json.h>
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+
+namespace pxd
+{
+
+/**
+ * Data about a binary dump of the game-state database.
+ */
+struct DumpInfo
+{
+
+  /** The chain as string (e.g. "main").  */
+  std::string chain;
+
+  /** The block hash at which the state was dumped.  */
+  xaya::uint256 hash;
+
+  /** The block height at which the state was dumped.  */
+  unsigned height = 0;
+
+  /** Number of tables in the dump.  */
+  unsigned tables = 0;
+
+  /** Total number of rows in the dump.  */
+  uint64_t rows = 0;
+
+  /**
+   * Returns the data as JSON.
+   */
+  Json::Value ToJson () const;
+
+};
+
+/**
+ * Writes a binary dump of all tables in the given database to the stream.
+ * All tables (including the ones of libxayagame that hold e.g. the current
+ * block hash and the undo data) are dumped, except for SQLite's internal
+ * tables.  The undo data is needed so that a node bootstrapped from the dump
+ * can detach its starting block (and earlier ones) on a reorg.  With pruning
+ * enabled, it only covers the most recent blocks.
+ *
+ * The database must be in a consistent state for the entire time, e.g. by
+ * being a read snapshot.  The chain, hash and height must be set in info,
+ * and the number of tables and rows are filled in.
+ */
+void WriteDatabaseDump (xaya::SQLiteDatabase& db, DumpInfo& info,
+                        std::ostream& out);
+
+/**
+ * Reads just the header of a binary dump, filling in the chain, hash and
+ * height of info.  Returns false if the header is invalid.  This does
+ * not verify the rest of the dump.
+ */
+bool ReadDumpHeader (std::istream& in, DumpInfo& info);
+
+/**
+ * Reads a binary dump from the stream and imports it into the given
+ * database, which should be empty.  The import is done in a single
+ * transaction, which is only committed if the dump is complete and its
+ * checksum matches.  Returns false (and logs an error) if the dump is
+ * invalid.  Otherwise, info is filled in from the dump.
+ */
+bool ReadDatabaseDump (std::istream& in, xaya::SQLiteDatabase& db,
+                       DumpInfo& info);
+
+} // namespace pxd
+
+#endif // PXD_DBDUMP_HPP
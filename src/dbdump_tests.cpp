@@ -0,0 +1,243 @@
+/*
+    GSP for the Taurion blockchain game
+    Copyright (C) 2021  Autonomous Worlds Ltd
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#include "dbdump.hpp"
+
+#include "database/dbtest.hpp"
+
+#include <xayautil/hash.hpp>
+
+#include <gtest/gtest.h>
+
+#include <glog/logging.h>
+
+#include <sqlite3.h>
+
+#include <sstream>
+#include <string>
+
+namespace pxd
+{
+namespace
+{
+
+class DatabaseDumpTests : public DBTestWithSchema
+{
+
+protected:
+
+  /** Database into which we import dumps.  */
+  xaya::SQLiteDatabase target;
+
+  DatabaseDumpTests ()
+    : target("target", SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE
+                         | SQLITE_OPEN_MEMORY)
+  {
+    auto& raw = *db;
+    raw.Execute (R"(
+      CREATE TABLE `xayagame_undo` (`hash` BLOB PRIMARY KEY, `data` BLOB);
+      INSERT INTO `xayagame_undo` (`hash`, `data`) VALUES (x'00', x'01');
+
+      CREATE TABLE `values test` (
+        `id` INTEGER PRIMARY KEY,
+        `int` INTEGER NULL,
+        `real` REAL NULL,
+        `text` TEXT NULL,
+        `blob` BLOB NULL
+      );
+      CREATE INDEX `values by text` ON `values test` (`text`);
+      INSERT INTO `values test`
+        (`id`, `int`, `real`, `text`, `blob`)
+        VALUES (1, -42, 1.5, 'foo', x'00ff00'),
+               (2, NULL, NULL, NULL, NULL);
+    )");
+  }
+
+  /**
+   * Writes a dump of the test database and returns it as string.
+   */
+  std::string
+  WriteDump (DumpInfo& info)
+  {
+    info.chain = "regtest";
+    info.hash = xaya::SHA256::Hash ("block");
+    info.height = 10;
+
+    std::ostringstream out;
+    WriteDatabaseDump (*db, info, out);
+    return out.str ();
+  }
+
+  /**
+   * Imports the given dump into the target database.
+   */
+  bool
+  ReadDump (const std::string& data, DumpInfo& info)
+  {
+    std::istringstream in(data);
+    return ReadDatabaseDump (in, target, info);
+  }
+
+  /**
+   * Returns the number of rows in a table of the target database, or -1
+   * if the table does not exist.
+   */
+  int
+  CountRows (const std::string& table)
+  {
+    auto stmt = target.Prepare (R"(
+      SELECT COUNT(*) FROM `sqlite_master`
+        WHERE `type` = 'table' AND `name` = ?1
+    )");
+    stmt.Bind (1, table);
+    CHECK (stmt.Step ());
+    if (stmt.Get<int> (0) == 0)
+      return -1;
+
+    stmt = target.Prepare ("SELECT COUNT(*) FROM `" + table + "`");
+    CHECK (stmt.Step ());
+    return stmt.Get<int> (0);
+  }
+
+};
+
+TEST_F (DatabaseDumpTests, RoundTrip)
+{
+  DumpInfo written;
+  const std::string data = WriteDump (written);
+
+  DumpInfo read;
+  ASSERT_TRUE (ReadDump (data, read));
+  EXPECT_EQ (read.chain, "regtest");
+  EXPECT_EQ (read.hash, xaya::SHA256::Hash ("block"));
+  EXPECT_EQ (read.height, 10);
+  EXPECT_EQ (read.tables, written.tables);
+  EXPECT_EQ (read.rows, written.rows);
+
+  auto stmt = target.Prepare (R"(
+    SELECT `int`, `real`, `text`, `blob`, `blob` IS NULL
+      FROM `values test`
+      ORDER BY `id`
+  )");
+  ASSERT_TRUE (stmt.Step ());
+  EXPECT_EQ (stmt.Get<int> (0), -42);
+  EXPECT_EQ (sqlite3_column_double (*stmt, 1), 1.5);
+  EXPECT_EQ (stmt.Get<std::string> (2), "foo");
+  EXPECT_EQ (stmt.GetBlob (3), std::string ("\0\xff\0", 3));
+  ASSERT_TRUE (stmt.Step ());
+  for (int i = 0; i < 4; ++i)
+    EXPECT_EQ (sqlite3_column_type (*stmt, i), SQLITE_NULL);
+  EXPECT_FALSE (stmt.Step ());
+
+  stmt = target.Prepare (R"(
+    SELECT COUNT(*) FROM `sqlite_master`
+      WHERE `type` = 'index' AND `name` = 'values by text'
+  )");
+  ASSERT_TRUE (stmt.Step ());
+  EXPECT_EQ (stmt.Get<int> (0), 1);
+}
+
+TEST_F (DatabaseDumpTests, ManyRows)
+{
+  auto& raw = *db;
+  auto stmt = raw.Prepare (R"(
+    INSERT INTO `values test` (`id`, `int`) VALUES (?1, ?1)
+  )");
+  for (int i = 100; i < 2'600; ++i)
+    {
+      stmt.Reset ();
+      stmt.Bind (1, i);
+      stmt.Execute ();
+    }
+
+  DumpInfo written;
+  const std::string data = WriteDump (written);
+
+  DumpInfo read;
+  ASSERT_TRUE (ReadDump (data, read));
+  EXPECT_EQ (read.rows, written.rows);
+  EXPECT_EQ (CountRows ("values test"), 2'502);
+}
+
+TEST_F (DatabaseDumpTests, UndoDataIncluded)
+{
+  DumpInfo info;
+  ASSERT_TRUE (ReadDump (WriteDump (info), info));
+  EXPECT_EQ (CountRows ("xayagame_undo"), 1);
+  EXPECT_EQ (CountRows ("accounts"), 0);
+}
+
+TEST_F (DatabaseDumpTests, Corrupted)
+{
+  DumpInfo info;
+  std::string data = WriteDump (info);
+  data[data.size () / 2] ^= 0x01;
+
+  EXPECT_FALSE (ReadDump (data, info));
+  EXPECT_EQ (CountRows ("values test"), -1);
+}
+
+TEST_F (DatabaseDumpTests, Truncated)
+{
+  DumpInfo info;
+  const std::string data = WriteDump (info);
+
+  EXPECT_FALSE (ReadDump (data.substr (0, data.size () - 10), info));
+  EXPECT_EQ (CountRows ("values test"), -1);
+}
+
+TEST_F (DatabaseDumpTests, MultipleStatementsRejected)
+{
+  /* Tamper with the schema of the source database, so that the dump
+     (with valid checksums) contains an extra statement after the
+     expected CREATE INDEX.  */
+  auto& raw = *db;
+  raw.Execute (R"(
+    PRAGMA writable_schema = ON;
+    UPDATE `sqlite_master`
+      SET `sql` = `sql` || '; DROP TABLE `victim`'
+      WHERE `name` = 'values by text';
+    PRAGMA writable_schema = OFF;
+  )");
+
+  target.Execute ("CREATE TABLE `victim` (`id` INTEGER PRIMARY KEY)");
+
+  DumpInfo info;
+  EXPECT_FALSE (ReadDump (WriteDump (info), info));
+  EXPECT_EQ (CountRows ("victim"), 0);
+  EXPECT_EQ (CountRows ("values test"), -1);
+}
+
+TEST_F (DatabaseDumpTests, HeaderOnly)
+{
+  DumpInfo info;
+  std::istringstream in(WriteDump (info));
+
+  DumpInfo header;
+  ASSERT_TRUE (ReadDumpHeader (in, header));
+  EXPECT_EQ (header.chain, "regtest");
+  EXPECT_EQ (header.hash, xaya::SHA256::Hash ("block"));
+  EXPECT_EQ (header.height, 10);
+
+  std::istringstream garbage("foobar");
+  EXPECT_FALSE (ReadDumpHeader (garbage, header));
+}
+
+} // anonymous namespace
+} // namespace pxd
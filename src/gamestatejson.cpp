@@ -36,6 +36,11 @@
 #include "proto/character.pb.h"
 
 #include <algorithm>
+#include <future>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
 
 namespace pxd
 {
@@ -478,6 +483,18 @@ template <>
   return res;
 }
 
+template <>
+  Json::Value
+  GameStateJson::Convert<BuildingInventory> (const BuildingInventory& inv) const
+{
+  Json::Value res(Json::objectValue);
+  res["building"] = IntToJson (inv.GetBuildingId ());
+  res["account"] = inv.GetAccount ();
+  res["inventory"] = Convert (inv.GetInventory ());
+
+  return res;
+}
+
 template <>
   Json::Value
   GameStateJson::Convert<pxd::OngoingOperation> (
@@ -640,6 +657,22 @@ template <typename T, typename R>
   return arr;
 }
 
+template <typename T, typename R>
+  void
+  GameStateJson::WriteResults (T& tbl, Database::Result<R> res,
+                               JsonStreamWriter& out) const
+{
+  out.BeginArray ();
+
+  while (res.Step ())
+    {
+      const auto h = tbl.GetFromResult (res);
+      out.Value (Convert (*h));
+    }
+
+  out.EndArray ();
+}
+
 Json::Value
 GameStateJson::MoneySupply ()
 {
@@ -713,6 +746,35 @@ GameStateJson::PrizeStats ()
   return res;
 }
 
+namespace
+{
+
+/**
+ * Adds the reserved and total Cubit balances to the JSON of an account,
+ * given the map of all reserved balances.
+ */
+void
+AddReservedBalance (const std::map<std::string, Amount>& reserved,
+                    Json::Value& entry)
+{
+  const auto& nmVal = entry["name"];
+  CHECK (nmVal.isString ());
+  const auto mit = reserved.find (nmVal.asString ());
+
+  Amount cur;
+  if (mit == reserved.end ())
+    cur = 0;
+  else
+    cur = mit->second;
+
+  auto& bal = entry["balance"];
+  CHECK (bal.isObject ());
+  bal["reserved"] = IntToJson (cur);
+  bal["total"] = IntToJson (cur + bal["available"].asInt64 ());
+}
+
+} // anonymous namespace
+
 Json::Value
 GameStateJson::Accounts ()
 {
@@ -722,22 +784,7 @@ GameStateJson::Accounts ()
   /* Add in also the Cubit balances reserved in open bids.  */
   const auto reserved = orders.GetReservedCoins ();
   for (auto& entry : res)
-    {
-      const auto& nmVal = entry["name"];
-      CHECK (nmVal.isString ());
-      const auto mit = reserved.find (nmVal.asString ());
-
-      Amount cur;
-      if (mit == reserved.end ())
-        cur = 0;
-      else
-        cur = mit->second;
-
-      auto& bal = entry["balance"];
-      CHECK (bal.isObject ());
-      bal["reserved"] = IntToJson (cur);
-      bal["total"] = IntToJson (cur + bal["available"].asInt64 ());
-    }
+    AddReservedBalance (reserved, entry);
 
   return res;
 }
@@ -763,6 +810,124 @@ GameStateJson::GroundLoot ()
   return ResultsAsArray (tbl, tbl.QueryNonEmpty ());
 }
 
+Json::Value
+GameStateJson::BuildingsInRange (const HexCoord& centre,
+                                 const HexCoord::IntT l1range)
+{
+  BuildingsTable tbl(db);
+  return ResultsAsArray (tbl, tbl.QueryInRange (centre, l1range));
+}
+
+Json::Value
+GameStateJson::CharactersInRange (const HexCoord& centre,
+                                  const HexCoord::IntT l1range)
+{
+  CharacterTable tbl(db);
+  return ResultsAsArray (tbl, tbl.QueryInRange (centre, l1range));
+}
+
+Json::Value
+GameStateJson::GroundLootInRange (const HexCoord& centre,
+                                  const HexCoord::IntT l1range)
+{
+  GroundLootTable tbl(db);
+  return ResultsAsArray (tbl, tbl.QueryInRange (centre, l1range));
+}
+
+Json::Value
+GameStateJson::CharactersOfOwners (const std::set<std::string>& owners)
+{
+  CharacterTable tbl(db);
+
+  Json::Value res(Json::arrayValue);
+  for (const auto& o : owners)
+    for (const auto& entry : ResultsAsArray (tbl, tbl.QueryForOwner (o)))
+      res.append (entry);
+
+  return res;
+}
+
+Json::Value
+GameStateJson::BuildingInventoriesOfOwners (
+    const std::set<std::string>& owners)
+{
+  Json::Value res(Json::arrayValue);
+  for (const auto& o : owners)
+    {
+      const auto arr = ResultsAsArray (buildingInventories,
+                                       buildingInventories.QueryForAccount (o));
+      for (const auto& entry : arr)
+        res.append (entry);
+    }
+
+  return res;
+}
+
+Json::Value
+GameStateJson::StateEntries (const StateChanges& keys)
+{
+  Json::Value accounts(Json::arrayValue);
+  if (!keys.accounts.empty ())
+    {
+      const auto reserved = orders.GetReservedCoins ();
+      AccountsTable tbl(db);
+      for (const auto& name : keys.accounts)
+        {
+          const auto h = tbl.GetByName (name);
+          if (h == nullptr)
+            continue;
+
+          Json::Value entry = Convert (*h);
+          AddReservedBalance (reserved, entry);
+          accounts.append (entry);
+        }
+    }
+
+  Json::Value buildings(Json::arrayValue);
+  BuildingsTable buildingsTbl(db);
+  for (const auto id : keys.buildings)
+    {
+      const auto h = buildingsTbl.GetById (id);
+      if (h != nullptr)
+        buildings.append (Convert (*h));
+    }
+
+  Json::Value characters(Json::arrayValue);
+  CharacterTable charactersTbl(db);
+  for (const auto id : keys.characters)
+    {
+      const auto h = charactersTbl.GetById (id);
+      if (h != nullptr)
+        characters.append (Convert (*h));
+    }
+
+  /* Ground loot is removed from the database when it becomes empty,
+     and GetByCoord returns an empty handle in that case.  */
+  Json::Value loot(Json::arrayValue);
+  GroundLootTable lootTbl(db);
+  for (const auto& pos : keys.groundLoot)
+    {
+      const auto h = lootTbl.GetByCoord (pos);
+      if (!h->GetInventory ().IsEmpty ())
+        loot.append (Convert (*h));
+    }
+
+  /* Regions are never removed from the database.  */
+  Json::Value regions(Json::arrayValue);
+  RegionsTable regionsTbl(db, RegionsTable::HEIGHT_READONLY);
+  for (const auto id : keys.regions)
+    regions.append (Convert (*regionsTbl.GetById (id)));
+
+  Json::Value res(Json::objectValue);
+  res["accounts"] = accounts;
+  res["buildings"] = buildings;
+  res["characters"] = characters;
+  res["groundloot"] = loot;
+  res["regions"] = regions;
+
+  return res;
+}
+
 Json::Value
 GameStateJson::OngoingOperations ()
 {
@@ -777,6 +942,16 @@ GameStateJson::Regions (const unsigned h)
   return ResultsAsArray (tbl, tbl.QueryModifiedSince (h));
 }
 
+void
+GameStateJson::ForEachRegion (
+    const unsigned h, const std::function<void (const Json::Value&)>& cb)
+{
+  RegionsTable tbl(db, RegionsTable::HEIGHT_READONLY);
+  auto res = tbl.QueryModifiedSince (h);
+  while (res.Step ())
+    cb (Convert (*tbl.GetFromResult (res)));
+}
+
 Json::Value
 GameStateJson::TradeHistory (const std::string& item,
                              const Database::IdT building)
@@ -789,19 +964,52 @@ Json::Value
 GameStateJson::FullState ()
 {
   Json::Value res(Json::objectValue);
-
-  res["accounts"] = Accounts ();
-  res["buildings"] = Buildings ();
-  res["characters"] = Characters ();
-  res["groundloot"] = GroundLoot ();
-  res["ongoings"] = OngoingOperations ();
-  res["moneysupply"] = MoneySupply ();
-  res["regions"] = Regions (0);
-  res["prizes"] = PrizeStats ();
+  for (const auto& name : FullStateSections ())
+    res[name] = FullStateSection (name);
 
   return res;
 }
 
+const std::vector<std::string>&
+GameStateJson::FullStateSections ()
+{
+  static const std::vector<std::string> sections = {
+    "accounts",
+    "buildings",
+    "characters",
+    "groundloot",
+    "moneysupply",
+    "ongoings",
+    "prizes",
+    "regions",
+  };
+
+  return sections;
+}
+
+Json::Value
+GameStateJson::FullStateSection (const std::string& name)
+{
+  if (name == "accounts")
+    return Accounts ();
+  if (name == "buildings")
+    return Buildings ();
+  if (name == "characters")
+    return Characters ();
+  if (name == "groundloot")
+    return GroundLoot ();
+  if (name == "moneysupply")
+    return MoneySupply ();
+  if (name == "ongoings")
+    return OngoingOperations ();
+  if (name == "prizes")
+    return PrizeStats ();
+  if (name == "regions")
+    return Regions (0);
+
+  LOG (FATAL) << "Unknown full-state section: " << name;
+}
+
 Json::Value
 GameStateJson::BootstrapData ()
 {
@@ -811,4 +1019,138 @@ GameStateJson::BootstrapData ()
   return res;
 }
 
+void
+GameStateJson::WriteAccounts (JsonStreamWriter& out)
+{
+  const auto reserved = orders.GetReservedCoins ();
+
+  AccountsTable tbl(db);
+  auto res = tbl.QueryAll ();
+
+  out.BeginArray ();
+  while (res.Step ())
+    {
+      Json::Value entry = Convert (*tbl.GetFromResult (res));
+      AddReservedBalance (reserved, entry);
+      out.Value (entry);
+    }
+  out.EndArray ();
+}
+
+void
+GameStateJson::WriteBuildings (JsonStreamWriter& out)
+{
+  BuildingsTable tbl(db);
+  WriteResults (tbl, tbl.QueryAll (), out);
+}
+
+void
+GameStateJson::WriteCharacters (JsonStreamWriter& out)
+{
+  CharacterTable tbl(db);
+  WriteResults (tbl, tbl.QueryAll (), out);
+}
+
+void
+GameStateJson::WriteGroundLoot (JsonStreamWriter& out)
+{
+  GroundLootTable tbl(db);
+  WriteResults (tbl, tbl.QueryNonEmpty (), out);
+}
+
+void
+GameStateJson::WriteOngoingOperations (JsonStreamWriter& out)
+{
+  OngoingsTable tbl(db);
+  WriteResults (tbl, tbl.QueryAll (), out);
+}
+
+void
+GameStateJson::WriteRegions (const unsigned h, JsonStreamWriter& out)
+{
+  RegionsTable tbl(db, RegionsTable::HEIGHT_READONLY);
+  WriteResults (tbl, tbl.QueryModifiedSince (h), out);
+}
+
+void
+GameStateJson::WriteFullState (JsonStreamWriter& out)
+{
+  /* The keys have to be written in the order in which jsoncpp sorts them,
+     so that the result matches FullState exactly.  */
+
+  out.BeginObject ();
+
+  out.Key ("accounts");
+  WriteAccounts (out);
+  out.Key ("buildings");
+  WriteBuildings (out);
+  out.Key ("characters");
+  WriteCharacters (out);
+  out.Key ("groundloot");
+  WriteGroundLoot (out);
+  out.Key ("moneysupply");
+  out.Value (MoneySupply ());
+  out.Key ("ongoings");
+  WriteOngoingOperations (out);
+  out.Key ("prizes");
+  out.Value (PrizeStats ());
+  out.Key ("regions");
+  WriteRegions (0, out);
+
+  out.EndObject ();
+}
+
+void
+GameStateJson::WriteBootstrapData (JsonStreamWriter& out)
+{
+  out.BeginObject ();
+  out.Key ("regions");
+  WriteRegions (0, out);
+  out.EndObject ();
+}
+
+FullStateSnapshots
+AcquireFullStateSnapshots (SnapshotPool& pool)
+{
+  const size_t num = std::min<size_t> (
+      std::max (pool.GetMaxIdle (), 1u),
+      GameStateJson::FullStateSections ().size ());
+
+  FullStateSnapshots res;
+  for (size_t i = 0; i < num; ++i)
+    res.push_back (pool.Acquire ());
+
+  return res;
+}
+
+Json::Value
+ParallelFullState (FullStateSnapshots& snapshots, const Context& ctx)
+{
+  CHECK (!snapshots.empty ());
+
+  const auto& names = GameStateJson::FullStateSections ();
+  std::vector<Json::Value> sections(names.size ());
+
+  /* Worker i computes the sections i, i + n, i + 2n and so on, where n
+     is the number of snapshots (and threads).  */
+  const size_t n = snapshots.size ();
+  std::vector<std::future<void>> workers;
+  for (size_t i = 0; i < n; ++i)
+    workers.push_back (std::async (std::launch::async,
+      [&snapshots, &ctx, &names, &sections, i, n] ()
+        {
+          GameStateJson gsj(*snapshots[i], ctx);
+          for (size_t j = i; j < names.size (); j += n)
+            sections[j] = gsj.FullStateSection (names[j]);
+        }));
+  for (auto& w : workers)
+    w.get ();
+
+  Json::Value res(Json::objectValue);
+  for (size_t j = 0; j < names.size (); ++j)
+    res[names[j]] = std::move (sections[j]);
+
+  return res;
+}
+
 } // namespace pxd
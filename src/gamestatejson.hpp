@@ -20,19 +20,35 @@
 #define PXD_GAMESTATEJSON_HPP
 
 #include "context.hpp"
+#include "jsonstream.hpp"
+#include "snapshotpool.hpp"
 
 #include "database/damagelists.hpp"
 #include "database/database.hpp"
 #include "database/dex.hpp"
 #include "database/inventory.hpp"
+#include "database/statechanges.hpp"
+#include "hexagonal/coord.hpp"
 #include "mapdata/basemap.hpp"
 #include "proto/building.pb.h"
 
 #include <json/json.h>
 
+#include <functional>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
 namespace pxd
 {
 
+/**
+ * Maximum number of blocks before the current one from which the regions
+ * modified since can be queried (with getregions or through REST).
+ */
+constexpr int MAX_REGIONS_HEIGHT_DIFFERENCE = 2 * 60 * 24 * 3;
+
 /**
  * Utility class that handles construction of game-state JSON.
  */
@@ -70,6 +86,15 @@ private:
   template <typename T, typename R>
     Json::Value ResultsAsArray (T& tbl, Database::Result<R> res) const;
 
+  /**
+   * Extracts all results from the Database::Result instance, converts them
+   * to JSON and writes them as array directly to the given stream.  Only
+   * the JSON value of a single row is kept in memory at any time.
+   */
+  template <typename T, typename R>
+    void WriteResults (T& tbl, Database::Result<R> res,
+                       JsonStreamWriter& out) const;
+
 public:
 
   explicit GameStateJson (Database& d, const Context& c)
@@ -114,6 +139,49 @@ public:
    */
   Json::Value GroundLoot ();
 
+  /**
+   * Returns the JSON data for all buildings whose centre is within
+   * the given L1 range of a coordinate.
+   */
+  Json::Value BuildingsInRange (const HexCoord& centre,
+                                HexCoord::IntT l1range);
+
+  /**
+   * Returns the JSON data for all characters on the map within the
+   * given L1 range of a coordinate.
+   */
+  Json::Value CharactersInRange (const HexCoord& centre,
+                                 HexCoord::IntT l1range);
+
+  /**
+   * Returns the JSON data for all ground loot within the given L1 range
+   * of a coordinate.
+   */
+  Json::Value GroundLootInRange (const HexCoord& centre,
+                                 HexCoord::IntT l1range);
+
+  /**
+   * Returns the JSON data for all characters owned by one of the given
+   * accounts.  They are ordered by owner first and then by ID.
+   */
+  Json::Value CharactersOfOwners (const std::set<std::string>& owners);
+
+  /**
+   * Returns the building inventories of all the given accounts, ordered
+   * by account and then building.
+   */
+  Json::Value BuildingInventoriesOfOwners (
+      const std::set<std::string>& owners);
+
+  /**
+   * Returns the JSON data of just the given entries in the accounts,
+   * buildings, characters, ground loot and regions sections.  The result
+   * is an object with those sections (in the same form as in FullState),
+   * each holding the requested entries that exist.  Keys that do not
+   * (any more) exist in the game state are skipped.
+   */
+  Json::Value StateEntries (const StateChanges& keys);
+
   /**
    * Returns the JSON data about all ongoing operations.
    */
@@ -125,6 +193,15 @@ public:
    */
   Json::Value Regions (unsigned h);
 
+  /**
+   * Invokes the callback with the JSON data of each region modified after
+   * the given block height, in order of region ID.  This allows callers to
+   * process (e.g. cache) the regions one by one, without building up the
+   * full array.
+   */
+  void ForEachRegion (unsigned h,
+                      const std::function<void (const Json::Value&)>& cb);
+
   /**
    * Returns the JSON data about money supply and burnsale stats.
    */
@@ -148,6 +225,17 @@ public:
    */
   Json::Value FullState ();
 
+  /**
+   * Returns the names of all sections (top-level keys) of FullState.
+   * They can be computed independently of each other.
+   */
+  static const std::vector<std::string>& FullStateSections ();
+
+  /**
+   * Returns the data for one of the sections of FullState.
+   */
+  Json::Value FullStateSection (const std::string& name);
+
   /**
    * Returns the bootstrap data that the frontend needs on startup (e.g.
    * including all regions, not just recently-modified ones).  This is
@@ -155,8 +243,43 @@ public:
    */
   Json::Value BootstrapData ();
 
+  /* The methods below write the same data as the corresponding methods
+     returning Json::Value, but stream it row-by-row to a JsonStreamWriter
+     instead of building up the full DOM.  The produced bytes are the same
+     as serialising the DOM result with SerialiseJson.  */
+
+  void WriteAccounts (JsonStreamWriter& out);
+  void WriteBuildings (JsonStreamWriter& out);
+  void WriteCharacters (JsonStreamWriter& out);
+  void WriteGroundLoot (JsonStreamWriter& out);
+  void WriteOngoingOperations (JsonStreamWriter& out);
+  void WriteRegions (unsigned h, JsonStreamWriter& out);
+  void WriteFullState (JsonStreamWriter& out);
+  void WriteBootstrapData (JsonStreamWriter& out);
+
 };
 
+/** Snapshots used to compute the full state in parallel.  */
+using FullStateSnapshots = std::vector<std::unique_ptr<SnapshotPool::Snapshot>>;
+
+/**
+ * Acquires the snapshots for ParallelFullState, one per worker thread.
+ * There are at most as many workers as the pool keeps idle connections,
+ * so that no extra connections have to be opened.  This must be called
+ * while no writes to the database can happen (e.g. with the game lock
+ * held), so that all snapshots see the same state.
+ */
+FullStateSnapshots AcquireFullStateSnapshots (SnapshotPool& pool);
+
+/**
+ * Computes the same result as GameStateJson::FullState, but builds the
+ * sections concurrently.  Each snapshot is used by one thread for its
+ * share of the sections.  The snapshots must have been acquired with
+ * AcquireFullStateSnapshots; after that, no lock needs to be held.
+ */
+Json::Value ParallelFullState (FullStateSnapshots& snapshots,
+                               const Context& ctx);
+
 } // namespace pxd
 
 #endif // PXD_GAMESTATEJSON_HPP
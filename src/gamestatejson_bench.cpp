@@ -0,0 +1,191 @@
+/*
+    GSP for the Taurion blockchain game
+    Copyright (C) 2021  Autonomous Worlds Ltd
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+/* Benchmarks comparing the construction of the game-state JSON as full
+   DOM (with serialisation afterwards) to streaming it directly to the
+   output with JsonStreamWriter.
+
+   Besides the time, each benchmark reports the process' peak RSS as
+   counter.  Since that is a process-wide maximum, the streaming variant is
+   registered first.  For exact numbers, run a single benchmark in isolation,
+   e.g. with --benchmark_filter=GameStateJsonCharactersDom/100000.
+
+   For comparison, GameStateProtoCharacters builds and serialises the same
+   data as binary StateSnapshot (as returned by /state.pb.gz).  */
+
+#include "gamestatejson.hpp"
+
+#include "gamestateproto.hpp"
+#include "jsonstream.hpp"
+#include "testutils.hpp"
+
+#include "database/character.hpp"
+#include "database/dbtest.hpp"
+#include "database/faction.hpp"
+#include "database/schema.hpp"
+#include "hexagonal/coord.hpp"
+#include "proto/snapshot.pb.h"
+
+#include <benchmark/benchmark.h>
+
+#include <google/protobuf/arena.h>
+
+#include <sys/resource.h>
+
+#include <sstream>
+#include <string>
+
+namespace pxd
+{
+namespace
+{
+
+/**
+ * Fills the database with the given number of characters.  They have some
+ * non-trivial data (position, inventory, HP) to make the JSON realistic.
+ */
+void
+InsertCharacters (Database& db, const unsigned num)
+{
+  CharacterTable tbl(db);
+  for (unsigned i = 0; i < num; ++i)
+    {
+      auto c = tbl.CreateNew ("domob " + std::to_string (i % 1'000),
+                              Faction::RED);
+      c->SetPosition (HexCoord (i % 1'000, i / 1'000));
+      c->MutableProto ().set_speed (1'000);
+      c->MutableHP ().set_armour (100);
+      c->MutableHP ().set_shield (30);
+      c->GetInventory ().SetFungibleCount ("foo", 10 + i % 7);
+      c->GetInventory ().SetFungibleCount ("bar", 1);
+    }
+}
+
+/**
+ * Sets the peak RSS (in kB) of the process as counter on the benchmark.
+ */
+void
+ReportPeakRss (benchmark::State& state)
+{
+  struct rusage usage;
+  CHECK_EQ (getrusage (RUSAGE_SELF, &usage), 0);
+  state.counters["peak_rss_kb"] = usage.ru_maxrss;
+}
+
+/**
+ * Streams the characters JSON directly to an output buffer.
+ */
+void
+GameStateJsonCharactersStreamed (benchmark::State& state)
+{
+  TestDatabase db;
+  SetupDatabaseSchema (*db);
+  InsertCharacters (db, state.range (0));
+
+  ContextForTesting ctx;
+  GameStateJson gsj(db, ctx);
+
+  size_t bytes = 0;
+  for (auto _ : state)
+    {
+      std::ostringstream out;
+      {
+        JsonStreamWriter writer(out);
+        gsj.WriteCharacters (writer);
+      }
+      bytes = out.tellp ();
+    }
+
+  state.counters["bytes"] = bytes;
+  ReportPeakRss (state);
+}
+BENCHMARK (GameStateJsonCharactersStreamed)
+  ->Unit (benchmark::kMillisecond)
+  ->Arg (1'000)
+  ->Arg (100'000);
+
+/**
+ * Builds the characters JSON as DOM and serialises it afterwards (which is
+ * what happens for the existing RPC methods).
+ *
+ * The number of characters in the database is passed as argument.
+ */
+void
+GameStateJsonCharactersDom (benchmark::State& state)
+{
+  TestDatabase db;
+  SetupDatabaseSchema (*db);
+  InsertCharacters (db, state.range (0));
+
+  ContextForTesting ctx;
+  GameStateJson gsj(db, ctx);
+
+  size_t bytes = 0;
+  for (auto _ : state)
+    {
+      const std::string out = SerialiseJson (gsj.Characters ());
+      bytes = out.size ();
+    }
+
+  state.counters["bytes"] = bytes;
+  ReportPeakRss (state);
+}
+BENCHMARK (GameStateJsonCharactersDom)
+  ->Unit (benchmark::kMillisecond)
+  ->Arg (1'000)
+  ->Arg (100'000);
+
+/**
+ * Builds the characters as binary StateSnapshot on an arena and serialises
+ * it.  The number of characters is passed as argument.
+ */
+void
+GameStateProtoCharacters (benchmark::State& state)
+{
+  TestDatabase db;
+  SetupDatabaseSchema (*db);
+  InsertCharacters (db, state.range (0));
+
+  ContextForTesting ctx;
+  GameStateProto gsp(db, ctx);
+
+  size_t bytes = 0;
+  for (auto _ : state)
+    {
+      google::protobuf::Arena arena;
+      auto* snapshot
+          = google::protobuf::Arena::CreateMessage<proto::StateSnapshot> (
+              &arena);
+      gsp.AddCharacters (*snapshot);
+
+      std::string out;
+      CHECK (snapshot->SerializeToString (&out));
+      bytes = out.size ();
+    }
+
+  state.counters["bytes"] = bytes;
+  ReportPeakRss (state);
+}
+BENCHMARK (GameStateProtoCharacters)
+  ->Unit (benchmark::kMillisecond)
+  ->Arg (1'000)
+  ->Arg (100'000);
+
+} // anonymous namespace
+} // namespace pxd
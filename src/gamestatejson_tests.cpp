@@ -32,6 +32,7 @@
 #include "database/moneysupply.hpp"
 #include "database/ongoing.hpp"
 #include "database/region.hpp"
+#include "database/schema.hpp"
 #include "proto/character.pb.h"
 #include "proto/region.pb.h"
 
@@ -39,6 +40,9 @@
 
 #include <json/json.h>
 
+#include <cstdio>
+#include <memory>
+#include <sstream>
 #include <string>
 
 namespace pxd
@@ -76,6 +80,15 @@ protected:
     const Json::Value actual = converter.FullState ();
     VLOG (1) << "Actual JSON for the game state:\n" << actual;
     ASSERT_TRUE (PartialJsonEqual (actual, ParseJson (expectedStr)));
+
+    /* Every state we test should also be produced byte-for-byte the same
+       by the streaming writer.  */
+    std::ostringstream streamed;
+    {
+      JsonStreamWriter writer(streamed);
+      converter.WriteFullState (writer);
+    }
+    ASSERT_EQ (streamed.str (), SerialiseJson (actual));
   }
 
 };
@@ -122,6 +135,29 @@ TEST_F (CharacterJsonTests, Basic)
   })");
 }
 
+TEST_F (CharacterJsonTests, InRangeAndOfOwners)
+{
+  tbl.CreateNew ("domob", Faction::RED)->SetPosition (HexCoord (1, 1));
+  tbl.CreateNew ("andy", Faction::GREEN)->SetPosition (HexCoord (-2, 0));
+  tbl.CreateNew ("domob", Faction::RED)->SetPosition (HexCoord (10, 0));
+  tbl.CreateNew ("bob", Faction::BLUE)->SetBuildingId (100);
+
+  EXPECT_TRUE (PartialJsonEqual (
+      converter.CharactersInRange (HexCoord (0, 0), 2),
+      ParseJson (R"([
+        {"id": 1, "owner": "domob"},
+        {"id": 2, "owner": "andy"}
+      ])")));
+
+  EXPECT_TRUE (PartialJsonEqual (
+      converter.CharactersOfOwners ({"domob", "bob", "unknown"}),
+      ParseJson (R"([
+        {"id": 4, "owner": "bob"},
+        {"id": 1, "owner": "domob"},
+        {"id": 3, "owner": "domob"}
+      ])")));
+}
+
 TEST_F (CharacterJsonTests, EnterBuilding)
 {
   tbl.CreateNew ("domob", Faction::RED);
@@ -771,6 +807,46 @@ TEST_F (BuildingJsonTests, Inventories)
   })");
 }
 
+TEST_F (BuildingJsonTests, InRangeAndInventoriesOfOwners)
+{
+  auto h = tbl.CreateNew ("checkmark", "", Faction::ANCIENT);
+  h->SetCentre (HexCoord (5, 5));
+  h.reset ();
+  tbl.CreateNew ("checkmark", "", Faction::ANCIENT)
+      ->SetCentre (HexCoord (0, 0));
+
+  inv.Get (2, "domob")->GetInventory ().SetFungibleCount ("foo", 2);
+  inv.Get (1, "domob")->GetInventory ().SetFungibleCount ("foo", 100);
+  inv.Get (1, "andy")->GetInventory ().SetFungibleCount ("bar", 1);
+  inv.Get (1, "bob")->GetInventory ().SetFungibleCount ("bar", 5);
+
+  EXPECT_TRUE (PartialJsonEqual (
+      converter.BuildingsInRange (HexCoord (1, 1), 2),
+      ParseJson (R"([
+        {"id": 2}
+      ])")));
+
+  EXPECT_TRUE (PartialJsonEqual (
+      converter.BuildingInventoriesOfOwners ({"domob", "andy"}),
+      ParseJson (R"([
+        {
+          "building": 1,
+          "account": "andy",
+          "inventory": {"fungible": {"bar": 1}}
+        },
+        {
+          "building": 1,
+          "account": "domob",
+          "inventory": {"fungible": {"foo": 100}}
+        },
+        {
+          "building": 2,
+          "account": "domob",
+          "inventory": {"fungible": {"foo": 2}}
+        }
+      ])")));
+}
+
 TEST_F (BuildingJsonTests, Orderbook)
 {
   ASSERT_EQ (tbl.CreateNew ("checkmark", "", Faction::ANCIENT)->GetId (), 1);
@@ -1381,6 +1457,22 @@ TEST_F (RegionJsonTests, MiningResource)
   })");
 }
 
+TEST_F (RegionJsonTests, StreamedBootstrapData)
+{
+  tbl.GetById (20)->MutableProto ().set_prospecting_character (42);
+  tbl.GetById (10)->MutableProto ().mutable_prospection ()->set_name ("foo");
+
+  std::ostringstream streamed;
+  {
+    JsonStreamWriter writer(streamed);
+    converter.WriteBootstrapData (writer);
+  }
+
+  const Json::Value expected = converter.BootstrapData ();
+  ASSERT_EQ (expected["regions"].size (), 2);
+  EXPECT_EQ (streamed.str (), SerialiseJson (expected));
+}
+
 /* ************************************************************************** */
 
 class MoneySupplyJsonTests : public GameStateJsonTests
@@ -1590,5 +1682,113 @@ TEST_F (TradeHistoryJsonTests, ForItemAndBuilding)
 
 /* ************************************************************************** */
 
+/**
+ * Database instance backed by a temporary file in WAL mode, so that
+ * snapshots of it can be taken.
+ */
+class FileDatabase : public Database
+{
+
+private:
+
+  /** The database file.  */
+  const std::string file;
+
+  /** The main read-write connection.  */
+  std::unique_ptr<xaya::SQLiteDatabase> db;
+
+  /** Next ID to give out.  */
+  IdT nextId = 1;
+
+public:
+
+  explicit FileDatabase (const std::string& f)
+    : file(f)
+  {
+    std::remove (file.c_str ());
+    db = std::make_unique<xaya::SQLiteDatabase> (
+        file, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE);
+    SetDatabase (*db);
+    db->Execute ("PRAGMA `journal_mode` = WAL");
+    SetupDatabaseSchema (*db);
+  }
+
+  ~FileDatabase ()
+  {
+    db.reset ();
+    for (const std::string suffix : {"", "-wal", "-shm"})
+      std::remove ((file + suffix).c_str ());
+  }
+
+  IdT
+  GetNextId () override
+  {
+    return nextId++;
+  }
+
+  IdT
+  GetLogId () override
+  {
+    return GetNextId ();
+  }
+
+};
+
+class ParallelFullStateTests : public testing::Test
+{
+
+protected:
+
+  const std::string file;
+
+  FileDatabase db;
+  SnapshotPool pool;
+
+  ContextForTesting ctx;
+
+  ParallelFullStateTests ()
+    : file(testing::TempDir () + "parallelfullstate_tests.sqlite"),
+      db(file), pool(file, 2)
+  {
+    MoneySupply ms(db);
+    ms.InitialiseDatabase ();
+  }
+
+};
+
+TEST_F (ParallelFullStateTests, MatchesSequential)
+{
+  AccountsTable accounts(db);
+  accounts.CreateNew ("domob")->SetFaction (Faction::RED);
+
+  CharacterTable characters(db);
+  characters.CreateNew ("domob", Faction::RED)->SetPosition (HexCoord (1, 2));
+  characters.CreateNew ("domob", Faction::RED)->SetBuildingId (100);
+
+  BuildingsTable buildings(db);
+  buildings.CreateNew ("checkmark", "", Faction::ANCIENT);
+
+  GroundLootTable loot(db);
+  loot.GetByCoord (HexCoord (5, 5))->GetInventory ()
+      .SetFungibleCount ("foo", 10);
+
+  RegionsTable regions(db, 10);
+  regions.GetById (42)->MutableProto ().set_prospecting_character (1);
+
+  GameStateJson gsj(db, ctx);
+  const Json::Value expected = gsj.FullState ();
+  ASSERT_EQ (expected["characters"].size (), 2);
+  ASSERT_EQ (expected["regions"].size (), 1);
+
+  auto snapshots = AcquireFullStateSnapshots (pool);
+  ASSERT_EQ (snapshots.size (), 2);
+  EXPECT_EQ (ParallelFullState (snapshots, ctx), expected);
+
+  snapshots.clear ();
+  EXPECT_EQ (pool.GetNumIdle (), 2);
+}
+
+/* ************************************************************************** */
+
 } // anonymous namespace
 } // namespace pxd
@@ -0,0 +1,287 @@
+/*
+    GSP for the Taurion blockchain game
+    Copyright (C) 2021  Autonomous Worlds Ltd
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#include "gamestateproto.hpp"
+
+#include "protoutils.hpp"
+
+#include "database/faction.hpp"
+#include "database/itemcounts.hpp"
+#include "database/moneysupply.hpp"
+
+#include <glog/logging.h>
+
+#include <algorithm>
+
+namespace pxd
+{
+
+namespace
+{
+
+/**
+ * Copies the combat-related fields shared between characters and buildings
+ * to the snapshot entry.
+ */
+template <typename T>
+  void
+  CopyCombatData (const CombatEntity& e, T& out)
+{
+  *out.mutable_hp () = e.GetHP ();
+  *out.mutable_regen_data () = e.GetRegenData ();
+  if (e.HasTarget ())
+    *out.mutable_target () = e.GetTarget ();
+  if (e.HasFriendlyTargets ())
+    out.set_friendly_targets (true);
+  *out.mutable_effects () = e.GetEffects ();
+}
+
+} // anonymous namespace
+
+void
+GameStateProto::Convert (const Character& c,
+                         proto::SnapshotCharacter& out) const
+{
+  out.set_id (c.GetId ());
+  out.set_owner (c.GetOwner ());
+  out.set_faction (static_cast<uint32_t> (c.GetFaction ()));
+
+  if (c.IsInBuilding ())
+    out.set_in_building (c.GetBuildingId ());
+  else
+    *out.mutable_position () = CoordToProto (c.GetPosition ());
+  if (c.GetEnterBuilding () != Database::EMPTY_ID)
+    out.set_enter_building (c.GetEnterBuilding ());
+
+  *out.mutable_volatile_mv () = c.GetVolatileMv ();
+  CopyCombatData (c, out);
+  *out.mutable_inventory () = c.GetInventory ().GetProtoForBinding ().Get ();
+
+  for (const auto id : dl.GetAttackers (c.GetId ()))
+    out.add_attackers (id);
+
+  *out.mutable_data () = c.GetProto ();
+}
+
+void
+GameStateProto::Convert (const Building& b, proto::SnapshotBuilding& out) const
+{
+  out.set_id (b.GetId ());
+  out.set_type (b.GetType ());
+  out.set_faction (static_cast<uint32_t> (b.GetFaction ()));
+  if (b.GetFaction () != Faction::ANCIENT)
+    out.set_owner (b.GetOwner ());
+  *out.mutable_centre () = CoordToProto (b.GetCentre ());
+
+  CopyCombatData (b, out);
+
+  auto res = buildingInventories.QueryForBuilding (b.GetId ());
+  while (res.Step ())
+    {
+      auto h = buildingInventories.GetFromResult (res);
+      auto* inv = out.add_inventories ();
+      inv->set_account (h->GetAccount ());
+      *inv->mutable_inventory ()
+          = h->GetInventory ().GetProtoForBinding ().Get ();
+    }
+
+  *out.mutable_data () = b.GetProto ();
+}
+
+void
+GameStateProto::Convert (const GroundLoot& loot,
+                         proto::SnapshotGroundLoot& out) const
+{
+  *out.mutable_position () = CoordToProto (loot.GetPosition ());
+  *out.mutable_inventory () = loot.GetInventory ().GetProtoForBinding ().Get ();
+}
+
+void
+GameStateProto::Convert (const Region& r, proto::SnapshotRegion& out) const
+{
+  out.set_id (r.GetId ());
+  if (r.GetProto ().has_prospection ())
+    out.set_resource_left (r.GetResourceLeft ());
+  *out.mutable_data () = r.GetProto ();
+}
+
+void
+GameStateProto::Convert (const OngoingOperation& op,
+                         proto::SnapshotOngoing& out) const
+{
+  out.set_id (op.GetId ());
+  out.set_height (op.GetHeight ());
+  if (op.GetCharacterId () != Database::EMPTY_ID)
+    out.set_character_id (op.GetCharacterId ());
+  if (op.GetBuildingId () != Database::EMPTY_ID)
+    out.set_building_id (op.GetBuildingId ());
+  *out.mutable_data () = op.GetProto ();
+}
+
+void
+GameStateProto::AddAccounts (proto::StateSnapshot& out)
+{
+  const auto reserved = orders.GetReservedCoins ();
+
+  AccountsTable tbl(db);
+  auto res = tbl.QueryAll ();
+  while (res.Step ())
+    {
+      const auto a = tbl.GetFromResult (res);
+      auto* entry = out.add_accounts ();
+
+      entry->set_name (a->GetName ());
+      if (a->IsInitialised ())
+        entry->set_faction (static_cast<uint32_t> (a->GetFaction ()));
+
+      const auto mit = reserved.find (a->GetName ());
+      if (mit != reserved.end ())
+        entry->set_reserved_balance (mit->second);
+
+      *entry->mutable_data () = a->GetProto ();
+    }
+}
+
+void
+GameStateProto::AddBuildings (proto::StateSnapshot& out)
+{
+  BuildingsTable tbl(db);
+  auto res = tbl.QueryAll ();
+  while (res.Step ())
+    Convert (*tbl.GetFromResult (res), *out.add_buildings ());
+}
+
+void
+GameStateProto::AddCharacters (proto::StateSnapshot& out)
+{
+  CharacterTable tbl(db);
+  auto res = tbl.QueryAll ();
+  while (res.Step ())
+    Convert (*tbl.GetFromResult (res), *out.add_characters ());
+}
+
+void
+GameStateProto::AddGroundLoot (proto::StateSnapshot& out)
+{
+  GroundLootTable tbl(db);
+  auto res = tbl.QueryNonEmpty ();
+  while (res.Step ())
+    Convert (*tbl.GetFromResult (res), *out.add_ground_loot ());
+}
+
+void
+GameStateProto::AddRegions (const unsigned h, proto::StateSnapshot& out)
+{
+  RegionsTable tbl(db, RegionsTable::HEIGHT_READONLY);
+  auto res = tbl.QueryModifiedSince (h);
+  while (res.Step ())
+    Convert (*tbl.GetFromResult (res), *out.add_regions ());
+}
+
+void
+GameStateProto::SetMoneySupply (proto::StateSnapshot& out)
+{
+  const auto& params = ctx.RoConfig ()->params ();
+  pxd::MoneySupply ms(db);
+  auto& supply = *out.mutable_money_supply ();
+
+  /* This matches GameStateJson::MoneySupply.  */
+
+  Amount total = 0;
+  for (const auto& key : ms.GetValidKeys ())
+    {
+      const Amount value = ms.Get (key);
+      if (key == "gifted" && !params.god_mode ())
+        {
+          CHECK_EQ (value, 0);
+          continue;
+        }
+
+      auto* entry = supply.add_entries ();
+      entry->set_key (key);
+      entry->set_amount (value);
+      total += value;
+    }
+  supply.set_total (total);
+
+  Amount burnsaleAmount = ms.Get ("burnsale");
+  for (int i = 0; i < params.burnsale_stages_size (); ++i)
+    {
+      const auto& data = params.burnsale_stages (i);
+      const Amount alreadySold = std::min<Amount> (burnsaleAmount,
+                                                   data.amount_sold ());
+      burnsaleAmount -= alreadySold;
+
+      auto* stage = supply.add_burnsale ();
+      stage->set_stage (i + 1);
+      stage->set_price_sat (data.price_sat ());
+      stage->set_total (data.amount_sold ());
+      stage->set_sold (alreadySold);
+      stage->set_available (data.amount_sold () - alreadySold);
+    }
+  CHECK_EQ (burnsaleAmount, 0);
+}
+
+void
+GameStateProto::AddOngoingOperations (proto::StateSnapshot& out)
+{
+  OngoingsTable tbl(db);
+  auto res = tbl.QueryAll ();
+  while (res.Step ())
+    Convert (*tbl.GetFromResult (res), *out.add_ongoings ());
+}
+
+void
+GameStateProto::AddPrizeStats (proto::StateSnapshot& out)
+{
+  ItemCounts cnt(db);
+  for (const auto& p : ctx.RoConfig ()->params ().prizes ())
+    {
+      const unsigned found = cnt.GetFound (p.name () + " prize");
+      CHECK_LE (found, p.number ());
+
+      auto* entry = out.add_prizes ();
+      entry->set_name (p.name ());
+      entry->set_number (p.number ());
+      entry->set_probability (p.probability ());
+      entry->set_found (found);
+      entry->set_available (p.number () - found);
+    }
+}
+
+void
+GameStateProto::FullState (proto::StateSnapshot& out)
+{
+  AddAccounts (out);
+  AddBuildings (out);
+  AddCharacters (out);
+  AddGroundLoot (out);
+  SetMoneySupply (out);
+  AddOngoingOperations (out);
+  AddPrizeStats (out);
+  AddRegions (0, out);
+}
+
+void
+GameStateProto::BootstrapData (proto::StateSnapshot& out)
+{
+  AddRegions (0, out);
+}
+
+} // namespace pxd
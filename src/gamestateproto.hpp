@@ -0,0 +1,141 @@
+/*
+    GSP for the Taurion blockchain game
+    Copyright (C) 2021  Autonomous Worlds Ltd
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef PXD_GAMESTATEPROTO_HPP
+#define PXD_GAMESTATEPROTO_HPP
+
+#include "context.hpp"
+
+#include "database/account.hpp"
+#include "database/building.hpp"
+#include "database/character.hpp"
+#include "database/damagelists.hpp"
+#include "database/database.hpp"
+#include "database/dex.hpp"
+#include "database/inventory.hpp"
+#include "database/ongoing.hpp"
+#include "database/region.hpp"
+#include "proto/snapshot.pb.h"
+
+namespace pxd
+{
+
+/**
+ * Utility class that constructs the binary (protobuf) form of the game
+ * state, as a more compact alternative to GameStateJson for consumers
+ * that are programs anyway.  The protos stored in the database are copied
+ * over as they are, together with the data from the other columns.
+ */
+class GameStateProto
+{
+
+private:
+
+  /** Database to read from.  */
+  Database& db;
+
+  /** Context for the roconfig (needed for money supply and prizes).  */
+  const Context& ctx;
+
+  /** Database table to access building inventories.  */
+  mutable BuildingInventoriesTable buildingInventories;
+
+  /** Damage lists accessor (for adding the attackers to a character).  */
+  const DamageLists dl;
+
+  /** Database table for DEX orders (for the reserved balances).  */
+  const DexOrderTable orders;
+
+public:
+
+  explicit GameStateProto (Database& d, const Context& c)
+    : db(d), ctx(c), buildingInventories(db), dl(db), orders(db)
+  {}
+
+  GameStateProto () = delete;
+  GameStateProto (const GameStateProto&) = delete;
+  void operator= (const GameStateProto&) = delete;
+
+  /**
+   * Converts a state instance (like a Character or Region) to the
+   * corresponding entry of a StateSnapshot.
+   */
+  void Convert (const Character& c, proto::SnapshotCharacter& out) const;
+  void Convert (const Building& b, proto::SnapshotBuilding& out) const;
+  void Convert (const GroundLoot& loot, proto::SnapshotGroundLoot& out) const;
+  void Convert (const Region& r, proto::SnapshotRegion& out) const;
+  void Convert (const OngoingOperation& op,
+                proto::SnapshotOngoing& out) const;
+
+  /**
+   * Adds all accounts to the snapshot.
+   */
+  void AddAccounts (proto::StateSnapshot& out);
+
+  /**
+   * Adds all buildings to the snapshot.
+   */
+  void AddBuildings (proto::StateSnapshot& out);
+
+  /**
+   * Adds all characters to the snapshot.
+   */
+  void AddCharacters (proto::StateSnapshot& out);
+
+  /**
+   * Adds all (non-empty) ground loot to the snapshot.
+   */
+  void AddGroundLoot (proto::StateSnapshot& out);
+
+  /**
+   * Adds all regions modified after the given height to the snapshot.
+   */
+  void AddRegions (unsigned h, proto::StateSnapshot& out);
+
+  /**
+   * Sets the money supply of the snapshot.
+   */
+  void SetMoneySupply (proto::StateSnapshot& out);
+
+  /**
+   * Adds all ongoing operations to the snapshot.
+   */
+  void AddOngoingOperations (proto::StateSnapshot& out);
+
+  /**
+   * Adds the prospecting prize statistics to the snapshot.
+   */
+  void AddPrizeStats (proto::StateSnapshot& out);
+
+  /**
+   * Fills in the binary equivalent of GameStateJson::FullState, i.e.
+   * all sections that the JSON full state has as well.
+   */
+  void FullState (proto::StateSnapshot& out);
+
+  /**
+   * Fills in the binary equivalent of GameStateJson::BootstrapData.
+   */
+  void BootstrapData (proto::StateSnapshot& out);
+
+};
+
+} // namespace pxd
+
+#endif // PXD_GAMESTATEPROTO_HPP
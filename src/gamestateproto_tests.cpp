@@ -0,0 +1,235 @@
+/*
+    GSP for the Taurion blockchain game
+    Copyright (C) 2021  Autonomous Worlds Ltd
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#include "gamestateproto.hpp"
+
+#include "testutils.hpp"
+
+#include "database/account.hpp"
+#include "database/building.hpp"
+#include "database/character.hpp"
+#include "database/damagelists.hpp"
+#include "database/dbtest.hpp"
+#include "database/dex.hpp"
+#include "database/faction.hpp"
+#include "database/inventory.hpp"
+#include "database/itemcounts.hpp"
+#include "database/moneysupply.hpp"
+#include "database/ongoing.hpp"
+#include "database/region.hpp"
+
+#include <gtest/gtest.h>
+
+namespace pxd
+{
+namespace
+{
+
+class GameStateProtoTests : public DBTestWithSchema
+{
+
+protected:
+
+  ContextForTesting ctx;
+
+  /** GameStateProto instance used in testing.  */
+  GameStateProto converter;
+
+  /** Snapshot that we fill in.  */
+  proto::StateSnapshot snapshot;
+
+  GameStateProtoTests ()
+    : converter(db, ctx)
+  {}
+
+};
+
+TEST_F (GameStateProtoTests, Characters)
+{
+  CharacterTable tbl(db);
+
+  auto c = tbl.CreateNew ("domob", Faction::RED);
+  c->SetPosition (HexCoord (-5, 2));
+  c->MutableProto ().set_speed (750);
+  c->GetInventory ().SetFungibleCount ("foo", 10);
+  c->MutableHP ().set_armour (42);
+  const auto id1 = c->GetId ();
+  c.reset ();
+
+  c = tbl.CreateNew ("andy", Faction::GREEN);
+  c->SetBuildingId (100);
+  c->SetEnterBuilding (101);
+  const auto id2 = c->GetId ();
+  c.reset ();
+
+  DamageLists dl(db, 10);
+  dl.AddEntry (id1, id2);
+
+  converter.FullState (snapshot);
+  ASSERT_EQ (snapshot.characters_size (), 2);
+
+  const auto& first = snapshot.characters (0);
+  EXPECT_EQ (first.id (), id1);
+  EXPECT_EQ (first.owner (), "domob");
+  EXPECT_EQ (first.faction (), static_cast<uint32_t> (Faction::RED));
+  EXPECT_EQ (first.position ().x (), -5);
+  EXPECT_EQ (first.position ().y (), 2);
+  EXPECT_FALSE (first.has_in_building ());
+  EXPECT_FALSE (first.has_enter_building ());
+  EXPECT_EQ (first.data ().speed (), 750);
+  EXPECT_EQ (first.inventory ().fungible ().at ("foo"), 10);
+  EXPECT_EQ (first.hp ().armour (), 42);
+  ASSERT_EQ (first.attackers_size (), 1);
+  EXPECT_EQ (first.attackers (0), id2);
+
+  const auto& second = snapshot.characters (1);
+  EXPECT_EQ (second.id (), id2);
+  EXPECT_FALSE (second.has_position ());
+  EXPECT_EQ (second.in_building (), 100);
+  EXPECT_EQ (second.enter_building (), 101);
+  EXPECT_EQ (second.attackers_size (), 0);
+}
+
+TEST_F (GameStateProtoTests, BuildingsAndAccounts)
+{
+  AccountsTable accounts(db);
+  accounts.CreateNew ("domob")->SetFaction (Faction::RED);
+  accounts.CreateNew ("andy")->AddBalance (100);
+
+  BuildingsTable buildings(db);
+  buildings.CreateNew ("checkmark", "", Faction::ANCIENT);
+  auto b = buildings.CreateNew ("checkmark", "domob", Faction::RED);
+  b->SetCentre (HexCoord (1, 2));
+  const auto bId = b->GetId ();
+  b.reset ();
+
+  BuildingInventoriesTable inv(db);
+  inv.Get (bId, "andy")->GetInventory ().SetFungibleCount ("foo", 3);
+
+  DexOrderTable orders(db);
+  orders.CreateNew (bId, "andy", DexOrder::Type::BID, "foo", 2, 10);
+
+  converter.FullState (snapshot);
+
+  ASSERT_EQ (snapshot.accounts_size (), 2);
+  EXPECT_EQ (snapshot.accounts (0).name (), "andy");
+  EXPECT_FALSE (snapshot.accounts (0).has_faction ());
+  EXPECT_EQ (snapshot.accounts (0).data ().balance (), 100);
+  EXPECT_EQ (snapshot.accounts (0).reserved_balance (), 20);
+  EXPECT_EQ (snapshot.accounts (1).name (), "domob");
+  EXPECT_EQ (snapshot.accounts (1).faction (),
+             static_cast<uint32_t> (Faction::RED));
+  EXPECT_FALSE (snapshot.accounts (1).has_reserved_balance ());
+
+  ASSERT_EQ (snapshot.buildings_size (), 2);
+  EXPECT_FALSE (snapshot.buildings (0).has_owner ());
+  EXPECT_EQ (snapshot.buildings (0).faction (),
+             static_cast<uint32_t> (Faction::ANCIENT));
+  const auto& second = snapshot.buildings (1);
+  EXPECT_EQ (second.id (), bId);
+  EXPECT_EQ (second.type (), "checkmark");
+  EXPECT_EQ (second.owner (), "domob");
+  EXPECT_EQ (second.centre ().x (), 1);
+  EXPECT_EQ (second.centre ().y (), 2);
+  ASSERT_EQ (second.inventories_size (), 1);
+  EXPECT_EQ (second.inventories (0).account (), "andy");
+  EXPECT_EQ (second.inventories (0).inventory ().fungible ().at ("foo"), 3);
+}
+
+TEST_F (GameStateProtoTests, MoneySupply)
+{
+  MoneySupply ms(db);
+  ms.Increment ("burnsale", 25'000'000'000);
+
+  converter.FullState (snapshot);
+  const auto& supply = snapshot.money_supply ();
+  EXPECT_EQ (supply.total (), 25'000'000'000);
+
+  ASSERT_EQ (supply.entries_size (), 2);
+  EXPECT_EQ (supply.entries (0).key (), "burnsale");
+  EXPECT_EQ (supply.entries (0).amount (), 25'000'000'000);
+  EXPECT_EQ (supply.entries (1).key (), "gifted");
+  EXPECT_EQ (supply.entries (1).amount (), 0);
+
+  ASSERT_EQ (supply.burnsale_size (), 4);
+  EXPECT_EQ (supply.burnsale (1).stage (), 2);
+  EXPECT_EQ (supply.burnsale (1).price_sat (), 20'000);
+  EXPECT_EQ (supply.burnsale (1).available (), 0);
+  EXPECT_EQ (supply.burnsale (2).sold (), 5'000'000'000);
+  EXPECT_EQ (supply.burnsale (2).available (), 5'000'000'000);
+  EXPECT_EQ (supply.burnsale (3).sold (), 0);
+}
+
+TEST_F (GameStateProtoTests, OngoingsAndPrizes)
+{
+  OngoingsTable ongoings(db);
+  auto op = ongoings.CreateNew (10);
+  op->SetHeight (15);
+  op->SetCharacterId (42);
+  op->MutableProto ().mutable_prospection ();
+  const auto opId = op->GetId ();
+  op.reset ();
+
+  ItemCounts cnt(db);
+  cnt.IncrementFound ("gold prize");
+
+  converter.FullState (snapshot);
+
+  ASSERT_EQ (snapshot.ongoings_size (), 1);
+  const auto& ongoing = snapshot.ongoings (0);
+  EXPECT_EQ (ongoing.id (), opId);
+  EXPECT_EQ (ongoing.height (), 15);
+  EXPECT_EQ (ongoing.character_id (), 42);
+  EXPECT_FALSE (ongoing.has_building_id ());
+  EXPECT_EQ (ongoing.data ().start_height (), 10);
+  EXPECT_TRUE (ongoing.data ().has_prospection ());
+
+  ASSERT_EQ (snapshot.prizes_size (), 3);
+  EXPECT_EQ (snapshot.prizes (0).name (), "gold");
+  EXPECT_EQ (snapshot.prizes (0).number (), 3);
+  EXPECT_EQ (snapshot.prizes (0).probability (), 100);
+  EXPECT_EQ (snapshot.prizes (0).found (), 1);
+  EXPECT_EQ (snapshot.prizes (0).available (), 2);
+}
+
+TEST_F (GameStateProtoTests, BootstrapData)
+{
+  RegionsTable tbl(db, 1'042);
+  tbl.GetById (20)->MutableProto ().set_prospecting_character (42);
+  auto r = tbl.GetById (10);
+  r->MutableProto ().mutable_prospection ()->set_resource ("sand");
+  r->SetResourceLeft (150);
+  r.reset ();
+
+  CharacterTable characters(db);
+  characters.CreateNew ("domob", Faction::RED);
+
+  converter.BootstrapData (snapshot);
+  EXPECT_EQ (snapshot.characters_size (), 0);
+  ASSERT_EQ (snapshot.regions_size (), 2);
+  EXPECT_EQ (snapshot.regions (0).id (), 10);
+  EXPECT_EQ (snapshot.regions (0).resource_left (), 150);
+  EXPECT_EQ (snapshot.regions (0).data ().prospection ().resource (), "sand");
+  EXPECT_EQ (snapshot.regions (1).id (), 20);
+  EXPECT_FALSE (snapshot.regions (1).has_resource_left ());
+  EXPECT_EQ (snapshot.regions (1).data ().prospecting_character (), 42);
+}
+
+} // anonymous namespace
+} // namespace pxd
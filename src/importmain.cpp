@@ -0,0 +1,187 @@
+/*
+    GSP for the Taurion blockchain game
+    Copyright (C) 2021  Autonomous Worlds Ltd
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+/* Utility program that imports a binary game-state dump (as written by
+   the exportsnapshot RPC method of tauriond) into a fresh data directory.
+   tauriond can then be started on that data directory, and continues
+   syncing from the block at which the dump was made instead of processing
+   the entire chain from the start.  The dump is verified before it is
+   committed to the database.  */
+
+#include "config.h"
+
+#include "dbdump.hpp"
+
+#include <xayagame/sqlitestorage.hpp>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+
+#include <google/protobuf/stubs/common.h>
+
+#include <sqlite3.h>
+
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+DEFINE_string (snapshot, "",
+               "the binary state dump to import");
+DEFINE_string (datadir, "",
+               "base data directory of tauriond into which to import");
+DEFINE_string (output, "",
+               "if set, import into this SQLite file instead of the"
+               " game-state database in --datadir");
+
+namespace pxd
+{
+namespace
+{
+
+/** The game ID of Taurion, which determines the data directory.  */
+const std::string GAME_ID = "tn";
+
+/**
+ * Creates the given directory if it does not exist yet.  Returns false
+ * if that fails.
+ */
+bool
+EnsureDirectory (const std::string& dir)
+{
+  if (mkdir (dir.c_str (), 0777) == 0 || errno == EEXIST)
+    return true;
+
+  LOG (ERROR) << "Failed to create directory " << dir;
+  return false;
+}
+
+/**
+ * Returns the path of the game-state database inside the data directory
+ * for the given chain, creating the directories as needed.  Returns an
+ * empty string if that fails.
+ */
+std::string
+GetDatabaseFile (const std::string& datadir, const std::string& chain)
+{
+  std::string dir = datadir;
+  for (const auto& sub : {GAME_ID, chain})
+    {
+      if (!EnsureDirectory (dir))
+        return "";
+      dir += "/" + sub;
+    }
+  if (!EnsureDirectory (dir))
+    return "";
+
+  return dir + "/storage.sqlite";
+}
+
+/**
+ * Returns true if a file with the given name exists.
+ */
+bool
+FileExists (const std::string& file)
+{
+  struct stat st;
+  return stat (file.c_str (), &st) == 0;
+}
+
+} // anonymous namespace
+} // namespace pxd
+
+int
+main (int argc, char** argv)
+{
+  google::InitGoogleLogging (argv[0]);
+  GOOGLE_PROTOBUF_VERIFY_VERSION;
+
+  gflags::SetUsageMessage ("Import a binary game-state dump");
+  gflags::SetVersionString (PACKAGE_VERSION);
+  gflags::ParseCommandLineFlags (&argc, &argv, true);
+
+  if (FLAGS_snapshot.empty ())
+    {
+      std::cerr << "Error: --snapshot must be set" << std::endl;
+      return EXIT_FAILURE;
+    }
+  if (FLAGS_datadir.empty () == FLAGS_output.empty ())
+    {
+      std::cerr << "Error: exactly one of --datadir and --output must be set"
+                << std::endl;
+      return EXIT_FAILURE;
+    }
+
+  std::ifstream in(FLAGS_snapshot, std::ios::binary);
+  if (!in)
+    {
+      std::cerr << "Error: failed to open " << FLAGS_snapshot << std::endl;
+      return EXIT_FAILURE;
+    }
+
+  pxd::DumpInfo info;
+  if (!pxd::ReadDumpHeader (in, info))
+    {
+      std::cerr << "Error: " << FLAGS_snapshot << " is not a valid dump"
+                << std::endl;
+      return EXIT_FAILURE;
+    }
+  in.clear ();
+  in.seekg (0);
+
+  std::string file = FLAGS_output;
+  if (file.empty ())
+    file = pxd::GetDatabaseFile (FLAGS_datadir, info.chain);
+  if (file.empty ())
+    return EXIT_FAILURE;
+
+  if (pxd::FileExists (file))
+    {
+      std::cerr << "Error: " << file << " exists already" << std::endl;
+      return EXIT_FAILURE;
+    }
+
+  LOG (INFO)
+      << "Importing state at height " << info.height
+      << " (" << info.hash.ToHex () << ") into " << file << "...";
+
+  bool ok;
+  {
+    xaya::SQLiteDatabase db(file, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE);
+    ok = pxd::ReadDatabaseDump (in, db, info);
+  }
+
+  if (!ok)
+    {
+      std::cerr << "Error: importing " << FLAGS_snapshot << " failed"
+                << std::endl;
+      std::remove (file.c_str ());
+      return EXIT_FAILURE;
+    }
+
+  std::cout << info.ToJson () << std::endl;
+
+  google::protobuf::ShutdownProtobufLibrary ();
+  return EXIT_SUCCESS;
+}
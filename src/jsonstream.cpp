@@ -0,0 +1,166 @@
+/*
+    GSP for the Taurion blockchain game
+    Copyright (C) 2021  Autonomous Worlds Ltd
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#include "jsonstream.hpp"
+
+#include <glog/logging.h>
+
+namespace pxd
+{
+
+namespace
+{
+
+/**
+ * Returns the jsoncpp builder with the settings that we use for compact
+ * serialisation.  These match what libxayagame uses for its REST results.
+ */
+Json::StreamWriterBuilder
+CompactBuilder ()
+{
+  Json::StreamWriterBuilder wbuilder;
+  wbuilder["commentStyle"] = "None";
+  wbuilder["indentation"] = "";
+  wbuilder["enableYAMLCompatibility"] = false;
+  return wbuilder;
+}
+
+} // anonymous namespace
+
+JsonStreamWriter::JsonStreamWriter (std::ostream& o)
+  : out(o), writer(CompactBuilder ().newStreamWriter ())
+{}
+
+JsonStreamWriter::~JsonStreamWriter ()
+{
+  CHECK (hasElements.empty ()) << "JSON stream has unclosed arrays or objects";
+  CHECK (!afterKey) << "JSON stream has a key without value";
+}
+
+void
+JsonStreamWriter::BeforeValue ()
+{
+  if (afterKey)
+    {
+      afterKey = false;
+      return;
+    }
+
+  if (hasElements.empty ())
+    return;
+
+  if (hasElements.back ())
+    out << ',';
+  hasElements.back () = true;
+}
+
+void
+JsonStreamWriter::Open (const char c)
+{
+  BeforeValue ();
+  out << c;
+  hasElements.push_back (false);
+}
+
+void
+JsonStreamWriter::Close (const char c)
+{
+  CHECK (!hasElements.empty ()) << "No open JSON array or object";
+  CHECK (!afterKey) << "JSON object key without value";
+  hasElements.pop_back ();
+  out << c;
+}
+
+void
+JsonStreamWriter::BeginArray ()
+{
+  Open ('[');
+}
+
+void
+JsonStreamWriter::EndArray ()
+{
+  Close (']');
+}
+
+void
+JsonStreamWriter::BeginObject ()
+{
+  Open ('{');
+}
+
+void
+JsonStreamWriter::EndObject ()
+{
+  Close ('}');
+}
+
+void
+JsonStreamWriter::Key (const std::string& key)
+{
+  CHECK (!afterKey) << "JSON object key without value";
+  BeforeValue ();
+  writer->write (key, &out);
+  out << ':';
+  afterKey = true;
+}
+
+void
+JsonStreamWriter::Value (const Json::Value& val)
+{
+  BeforeValue ();
+  writer->write (val, &out);
+}
+
+void
+JsonStreamWriter::RawValue (const std::string& serialised)
+{
+  BeforeValue ();
+  out << serialised;
+}
+
+StringAppendBuffer::int_type
+StringAppendBuffer::overflow (const int_type c)
+{
+  if (!traits_type::eq_int_type (c, traits_type::eof ()))
+    target.push_back (traits_type::to_char_type (c));
+  return traits_type::not_eof (c);
+}
+
+std::streamsize
+StringAppendBuffer::xsputn (const char* s, const std::streamsize n)
+{
+  target.append (s, n);
+  return n;
+}
+
+std::string
+SerialiseJson (const Json::Value& val)
+{
+  std::string res;
+  StringAppendBuffer buf(res);
+  std::ostream out(&buf);
+  {
+    JsonStreamWriter writer(out);
+    writer.Value (val);
+  }
+  return res;
+}
+
+} // namespace pxd
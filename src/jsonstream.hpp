@@ -0,0 +1,158 @@
+/*
+    GSP for the Taurion blockchain game
+    Copyright (C) 2021  Autonomous Worlds Ltd
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef PXD_JSONSTREAM_HPP
+#define PXD_JSONSTREAM_HPP
+
+#include <json/json.h>
+
+#include <memory>
+#include <ostream>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+namespace pxd
+{
+
+/**
+ * Incremental writer for compact JSON output.  This allows large arrays
+ * (like all characters in the game state) to be written to a stream element
+ * by element, without ever having to build up the full Json::Value DOM
+ * in memory.  The individual elements are serialised through jsoncpp with
+ * the same settings as SerialiseJson, so that the produced bytes are exactly
+ * the same as if the full value had been serialised at once.
+ *
+ * Object members must be written in the order in which jsoncpp would
+ * serialise them (i.e. sorted by key), which is the responsibility of
+ * the caller.
+ */
+class JsonStreamWriter
+{
+
+private:
+
+  /** The stream we write to.  */
+  std::ostream& out;
+
+  /** jsoncpp writer used for all "leaf" values.  */
+  std::unique_ptr<Json::StreamWriter> writer;
+
+  /**
+   * For each currently open array or object, whether or not we have
+   * already written an element to it (and thus need a separator before
+   * the next one).
+   */
+  std::vector<bool> hasElements;
+
+  /**
+   * Set to true if we have just written an object key and expect the
+   * corresponding value next.
+   */
+  bool afterKey = false;
+
+  /**
+   * Writes the separator needed before the next value (if any) and
+   * updates the state accordingly.
+   */
+  void BeforeValue ();
+
+  /**
+   * Opens a new array or object with the given start character.
+   */
+  void Open (char c);
+
+  /**
+   * Closes the currently open array or object with the given character.
+   */
+  void Close (char c);
+
+public:
+
+  explicit JsonStreamWriter (std::ostream& o);
+  ~JsonStreamWriter ();
+
+  JsonStreamWriter () = delete;
+  JsonStreamWriter (const JsonStreamWriter&) = delete;
+  void operator= (const JsonStreamWriter&) = delete;
+
+  void BeginArray ();
+  void EndArray ();
+
+  void BeginObject ();
+  void EndObject ();
+
+  /**
+   * Writes the key for the next member of the currently open object.
+   */
+  void Key (const std::string& key);
+
+  /**
+   * Writes a complete value (as array element or object member value).
+   */
+  void Value (const Json::Value& val);
+
+  /**
+   * Writes a value that has already been serialised to JSON (e.g. from
+   * a cache).  The string is copied verbatim to the output.
+   */
+  void RawValue (const std::string& serialised);
+
+};
+
+/**
+ * Stream buffer that appends everything written to it directly to a given
+ * string.  With this, JSON can be streamed into a result buffer without
+ * the extra copy that std::ostringstream::str() would make.  There is
+ * no internal buffering, so the string is up-to-date after each write.
+ */
+class StringAppendBuffer : public std::streambuf
+{
+
+private:
+
+  /** The string we append to.  */
+  std::string& target;
+
+protected:
+
+  int_type overflow (int_type c) override;
+  std::streamsize xsputn (const char* s, std::streamsize n) override;
+
+public:
+
+  explicit StringAppendBuffer (std::string& t)
+    : target(t)
+  {}
+
+  StringAppendBuffer () = delete;
+  StringAppendBuffer (const StringAppendBuffer&) = delete;
+  void operator= (const StringAppendBuffer&) = delete;
+
+};
+
+/**
+ * Serialises a JSON value in the compact format that JsonStreamWriter
+ * produces as well.  This is the reference format for streamed output.
+ */
+std::string SerialiseJson (const Json::Value& val);
+
+} // namespace pxd
+
+#endif // PXD_JSONSTREAM_HPP
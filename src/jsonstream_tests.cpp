@@ -0,0 +1,134 @@
+/*
+    GSP for the Taurion blockchain game
+    Copyright (C) 2021  Autonomous Worlds Ltd
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#include "jsonstream.hpp"
+
+#include "testutils.hpp"
+
+#include <gtest/gtest.h>
+
+#include <sstream>
+
+namespace pxd
+{
+namespace
+{
+
+class JsonStreamWriterTests : public testing::Test
+{
+
+protected:
+
+  std::ostringstream out;
+
+};
+
+TEST_F (JsonStreamWriterTests, SingleValues)
+{
+  for (const std::string str : {"null", "true", "42", "-1.5", R"("foo")",
+                                "[]", "{}", R"("ä\n\"")"})
+    {
+      std::ostringstream cur;
+      {
+        JsonStreamWriter writer(cur);
+        writer.Value (ParseJson (str));
+      }
+      EXPECT_EQ (cur.str (), SerialiseJson (ParseJson (str)));
+    }
+
+  EXPECT_EQ (SerialiseJson (ParseJson ("[1, 2, {\"a\": null}]")),
+             R"([1,2,{"a":null}])");
+}
+
+TEST_F (JsonStreamWriterTests, NestedStructure)
+{
+  const Json::Value expected = ParseJson (R"({
+    "a": {},
+    "b": [1, [], {"x": "y"}, [true, false]],
+    "c": [],
+    "d": {"foo": 0.1, "z": "raw"}
+  })");
+
+  {
+    JsonStreamWriter writer(out);
+    writer.BeginObject ();
+
+    writer.Key ("a");
+    writer.BeginObject ();
+    writer.EndObject ();
+
+    writer.Key ("b");
+    writer.BeginArray ();
+    writer.Value (1);
+    writer.BeginArray ();
+    writer.EndArray ();
+    writer.Value (expected["b"][2]);
+    writer.BeginArray ();
+    writer.Value (true);
+    writer.Value (false);
+    writer.EndArray ();
+    writer.EndArray ();
+
+    writer.Key ("c");
+    writer.BeginArray ();
+    writer.EndArray ();
+
+    writer.Key ("d");
+    writer.BeginObject ();
+    writer.Key ("foo");
+    writer.Value (0.1);
+    writer.Key ("z");
+    writer.RawValue (R"("raw")");
+    writer.EndObject ();
+
+    writer.EndObject ();
+  }
+
+  EXPECT_EQ (out.str (), SerialiseJson (expected));
+}
+
+TEST_F (JsonStreamWriterTests, UnclosedContainer)
+{
+  EXPECT_DEATH (
+    {
+      JsonStreamWriter writer(out);
+      writer.BeginArray ();
+    }, "unclosed");
+}
+
+TEST (StringAppendBufferTests, AppendsToString)
+{
+  std::string target = "prefix:";
+  StringAppendBuffer buf(target);
+  std::ostream str(&buf);
+
+  {
+    JsonStreamWriter writer(str);
+    writer.BeginArray ();
+    writer.Value (ParseJson (R"({"foo": [1, 2]})"));
+    writer.Value ("x");
+    writer.EndArray ();
+  }
+  str << '!';
+
+  EXPECT_EQ (target, R"(prefix:[{"foo":[1,2]},"x"]!)");
+}
+
+} // anonymous namespace
+} // namespace pxd
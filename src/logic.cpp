@@ -25,18 +25,33 @@
 #include "movement.hpp"
 #include "moveprocessor.hpp"
 #include "ongoings.hpp"
+#include "trace.hpp"
 
 #include "database/account.hpp"
 #include "database/building.hpp"
 #include "database/dex.hpp"
 #include "database/moneysupply.hpp"
 #include "database/schema.hpp"
+#include "mapdata/safezones.hpp"
+#include "proto/roconfig.hpp"
 
 #include <glog/logging.h>
 
+#include <ctime>
+#include <ostream>
+#include <utility>
+
 namespace pxd
 {
 
+namespace
+{
+
+/** Number of recent blocks for which to keep processing stats.  */
+constexpr size_t BLOCK_STATS_WINDOW = 100;
+
+} // anonymous namespace
+
 SQLiteGameDatabase::SQLiteGameDatabase (xaya::SQLiteDatabase& d, PXLogic& g)
   : game(g)
 {
@@ -55,6 +70,10 @@ SQLiteGameDatabase::GetLogId ()
   return game.Ids ("log").GetNext ();
 }
 
+PXLogic::PXLogic ()
+  : blockStats(BLOCK_STATS_WINDOW)
+{}
+
 const BaseMap&
 PXLogic::GetBaseMap ()
 {
@@ -65,6 +84,37 @@ PXLogic::GetBaseMap ()
           << "Constructing BaseMap instance for chain "
           << static_cast<int> (chain);
       map = std::make_unique<BaseMap> (chain);
+
+      memoryStats.Register ("safezones", [this] ()
+        {
+          Json::Value res(Json::objectValue);
+          const uint64_t bytes = map->SafeZones ().GetMemoryBytes ();
+          res["bytes"] = static_cast<Json::UInt64> (bytes);
+          return res;
+        });
+      memoryStats.Register ("tileattributes", [this] ()
+        {
+          Json::Value res(Json::objectValue);
+          const uint64_t bytes = map->Attributes ().GetMemoryBytes ();
+          res["bytes"] = static_cast<Json::UInt64> (bytes);
+          return res;
+        });
+      memoryStats.Register ("regionindex", [this] ()
+        {
+          Json::Value res(Json::objectValue);
+          const uint64_t bytes = map->Regions ().GetIndexBytes ();
+          res["bytes"] = static_cast<Json::UInt64> (bytes);
+          return res;
+        });
+      memoryStats.Register ("roconfig", [chain] ()
+        {
+          const auto usage = RoConfig (chain).GetCacheUsage ();
+          Json::Value res(Json::objectValue);
+          res["items"] = static_cast<Json::UInt64> (usage.items);
+          res["buildings"] = static_cast<Json::UInt64> (usage.buildings);
+          res["bytes"] = static_cast<Json::UInt64> (usage.bytes);
+          return res;
+        });
     }
 
   CHECK (map != nullptr);
@@ -74,7 +124,7 @@ PXLogic::GetBaseMap ()
 void
 PXLogic::UpdateState (Database& db, xaya::Random& rnd,
                       const xaya::Chain chain, const BaseMap& map,
-                      const Json::Value& blockData)
+                      const Json::Value& blockData, BlockStats* stats)
 {
   const auto& blockMeta = blockData["block"];
   CHECK (blockMeta.isObject ());
@@ -88,36 +138,49 @@ PXLogic::UpdateState (Database& db, xaya::Random& rnd,
   Context ctx(chain, map, height, timestamp);
 
   FameUpdater fame(db, ctx);
-  UpdateState (db, fame, rnd, ctx, blockData);
+  UpdateState (db, fame, rnd, ctx, blockData, stats);
 }
 
 void
 PXLogic::UpdateState (Database& db, FameUpdater& fame, xaya::Random& rnd,
-                      const Context& ctx, const Json::Value& blockData)
+                      const Context& ctx, const Json::Value& blockData,
+                      BlockStats* stats)
 {
+  BlockStats::Recorder rec(stats, db, ctx.Height ());
+
+  rec.StartPhase ("damagelists");
   fame.GetDamageLists ().RemoveOld (
       ctx.RoConfig ()->params ().damage_list_blocks ());
 
+  rec.StartPhase ("hp");
   AllHpUpdates (db, fame, rnd, ctx);
+  rec.StartPhase ("ongoings");
   ProcessAllOngoings (db, rnd, ctx);
 
+  rec.StartPhase ("dynobstacles");
   DynObstacles dyn(db, ctx);
   MoveProcessor mvProc(db, dyn, rnd, ctx);
+  rec.StartPhase ("moves");
   mvProc.ProcessAdmin (blockData["admin"]);
   mvProc.ProcessAll (blockData["moves"]);
 
+  rec.StartPhase ("mining");
   ProcessAllMining (db, rnd, ctx);
+  rec.StartPhase ("movement");
   ProcessAllMovement (db, dyn, ctx);
 
   /* Entering buildings should be after moves and movement, so that players
      enter as soon as possible (perhaps in the same instant the move for it
      gets confirmed).  It should be before combat targets, so that players
      entering a building won't be attacked any more.  */
+  rec.StartPhase ("enterbuildings");
   ProcessEnterBuildings (db, dyn, ctx);
 
+  rec.StartPhase ("targets");
   FindCombatTargets (db, rnd, ctx);
 
 #ifdef ENABLE_SLOW_ASSERTS
+  rec.StartPhase ("validation");
   ValidateStateSlow (db, ctx);
 #endif // ENABLE_SLOW_ASSERTS
 }
@@ -178,9 +241,45 @@ PXLogic::InitialiseState (xaya::SQLiteDatabase& db)
 void
 PXLogic::UpdateState (xaya::SQLiteDatabase& db, const Json::Value& blockData)
 {
+  if (blockRecorder != nullptr)
+    {
+      *blockRecorder << SerialiseJson (blockData) << std::endl;
+      CHECK (*blockRecorder) << "Failed to record block data";
+    }
+
+  TraceSqliteStatements (*db, TraceLog::Get ().IsEnabled ());
+  const TraceSpan trace("block", "UpdateState");
+
+  const int64_t timestamp = blockData["block"]["timestamp"].asInt64 ();
+  catchUp.Update (db, timestamp, std::time (nullptr));
+
+  memoryStats.StartBlock ();
+
   SQLiteGameDatabase dbObj(db, *this);
+  StateChanges changes;
+  if (changeLog != nullptr)
+    dbObj.TrackChanges (&changes);
+
   UpdateState (dbObj, GetContext ().GetRandom (),
-               GetChain (), GetBaseMap (), blockData);
+               GetChain (), GetBaseMap (), blockData, &blockStats);
+
+  if (changeLog != nullptr)
+    {
+      dbObj.TrackChanges (nullptr);
+
+      const auto& blockMeta = blockData["block"];
+      xaya::uint256 hash, parent;
+      CHECK (hash.FromHex (blockMeta["hash"].asString ()));
+      CHECK (parent.FromHex (blockMeta["parent"].asString ()));
+      changeLog->Record (hash, parent, std::move (changes));
+    }
+
+  const unsigned height = blockData["block"]["height"].asUInt ();
+  memoryStats.FinishBlock (height, dbObj.GetArenaBytes ());
+  if (memoryLogInterval > 0 && height % memoryLogInterval == 0)
+    LOG (INFO)
+        << "Memory usage at height " << height << ":\n"
+        << memoryStats.ToJson ();
 }
 
 Json::Value
@@ -194,17 +293,152 @@ PXLogic::GetStateAsJson (const xaya::SQLiteDatabase& db)
   return gsj.FullState ();
 }
 
+void
+PXLogic::EnableSnapshotReads (const unsigned maxIdle)
+{
+  CHECK (!snapshotsInitialised);
+  snapshotConnections = maxIdle;
+}
+
+void
+PXLogic::LogMemoryStats (const unsigned interval)
+{
+  memoryLogInterval = interval;
+}
+
+void
+PXLogic::EnableCatchUpMode (const unsigned threshold)
+{
+  catchUp.SetThreshold (threshold);
+}
+
+void
+PXLogic::EnableStateChangeLog (const unsigned blocks)
+{
+  CHECK_GT (blocks, 0);
+  changeLog = std::make_unique<StateChangeLog> (blocks);
+}
+
+void
+PXLogic::RecordBlocks (const std::string& file)
+{
+  LOG (INFO) << "Recording block data to " << file;
+  blockRecorder = std::make_unique<std::ofstream> (file, std::ios::app);
+  CHECK (*blockRecorder) << "Failed to open " << file << " for recording";
+}
+
+namespace
+{
+
+/**
+ * Database result for a PRAGMA query returning a single string.
+ */
+struct PragmaResult : public Database::ResultType
+{
+  RESULT_COLUMN (std::string, value, 1);
+};
+
+} // anonymous namespace
+
+void
+PXLogic::InitialiseSnapshots (xaya::SQLiteDatabase& db)
+{
+  CHECK (!snapshotsInitialised);
+  snapshotsInitialised = true;
+
+  if (snapshotConnections == 0)
+    return;
+
+  const char* file = sqlite3_db_filename (*db, "main");
+  if (file == nullptr || file[0] == '\0')
+    {
+      LOG (WARNING) << "Database is in memory, not using snapshots";
+      return;
+    }
+
+  SQLiteGameDatabase dbObj(db, *this);
+  auto stmt = dbObj.Prepare ("PRAGMA `journal_mode`");
+  auto res = stmt.Query<PragmaResult> ();
+  CHECK (res.Step ());
+  const std::string mode = res.Get<PragmaResult::value> ();
+  CHECK (!res.Step ());
+  if (mode != "wal")
+    {
+      LOG (WARNING)
+          << "Database journal mode is " << mode << ", not using snapshots";
+      return;
+    }
+
+  snapshots = std::make_unique<SnapshotPool> (file, snapshotConnections);
+}
+
+Json::Value
+PXLogic::GetFullState (xaya::Game& game)
+{
+  /* With snapshots, we only acquire them while holding the game lock.
+     The sections are then built in parallel after the lock has been
+     released again.  */
+  FullStateSnapshots parts;
+
+  Json::Value res = SQLiteGame::GetCustomStateData (game, "gamestate",
+      [&] (const xaya::SQLiteDatabase& db, const xaya::uint256& hash,
+           const unsigned height)
+        {
+          auto& mutableDb = const_cast<xaya::SQLiteDatabase&> (db);
+          if (!snapshotsInitialised)
+            InitialiseSnapshots (mutableDb);
+
+          if (snapshots == nullptr)
+            return GetStateAsJson (db);
+
+          parts = AcquireFullStateSnapshots (*snapshots);
+          return Json::Value ();
+        });
+
+  if (!parts.empty ())
+    {
+      const Context ctx(GetChain (), GetBaseMap (),
+                        Context::NO_HEIGHT, Context::NO_TIMESTAMP);
+      res["gamestate"] = ParallelFullState (parts, ctx);
+    }
+
+  return res;
+}
+
 Json::Value
 PXLogic::GetCustomStateData (xaya::Game& game, const JsonStateFromRawDb& cb)
 {
-  return SQLiteGame::GetCustomStateData (game, "data",
-      [this, &cb] (const xaya::SQLiteDatabase& db, const xaya::uint256& hash,
-                   const unsigned height)
+  /* If we can, we only take a snapshot while holding the game lock, and
+     then run the (potentially expensive) callback on the snapshot after
+     the lock has been released again.  */
+  std::unique_ptr<SnapshotPool::Snapshot> snapshot;
+  xaya::uint256 snapshotHash;
+  unsigned snapshotHeight;
+
+  Json::Value res = SQLiteGame::GetCustomStateData (game, "data",
+      [&] (const xaya::SQLiteDatabase& db, const xaya::uint256& hash,
+           const unsigned height)
         {
-          SQLiteGameDatabase dbObj(const_cast<xaya::SQLiteDatabase&> (db),
-                                   *this);
-          return cb (dbObj, hash, height);
+          auto& mutableDb = const_cast<xaya::SQLiteDatabase&> (db);
+          if (!snapshotsInitialised)
+            InitialiseSnapshots (mutableDb);
+
+          if (snapshots == nullptr)
+            {
+              SQLiteGameDatabase dbObj(mutableDb, *this);
+              return cb (dbObj, hash, height);
+            }
+
+          snapshot = snapshots->Acquire ();
+          snapshotHash = hash;
+          snapshotHeight = height;
+          return Json::Value ();
         });
+
+  if (snapshot != nullptr)
+    res["data"] = cb (*snapshot, snapshotHash, snapshotHeight);
+
+  return res;
 }
 
 Json::Value
@@ -231,6 +465,104 @@ PXLogic::GetCustomStateData (xaya::Game& game, const JsonStateFromDatabase& cb)
     });
 }
 
+Json::Value
+PXLogic::WriteCustomStateData (xaya::Game& game,
+                               const JsonStateWriterWithBlock& cb,
+                               std::string& serialised)
+{
+  /* The data is streamed directly into the result string.  The envelope
+     is only known afterwards, so we serialise it separately (it is small)
+     and splice the data into it in place.  */
+  serialised.clear ();
+  Json::Value res = GetCustomStateData (game,
+    [&serialised, &cb] (GameStateJson& gsj, const xaya::uint256& hash,
+                        const unsigned height)
+    {
+      StringAppendBuffer buf(serialised);
+      std::ostream data(&buf);
+      JsonStreamWriter writer(data);
+      cb (gsj, hash, height, writer);
+      return Json::Value ();
+    });
+
+  /* getMemberNames returns the keys in the same order in which jsoncpp
+     serialises them.  dataPos is the position in the envelope at which
+     the "data" value belongs.  */
+  std::string envelope;
+  size_t dataPos = std::string::npos;
+  {
+    StringAppendBuffer buf(envelope);
+    std::ostream out(&buf);
+    JsonStreamWriter writer(out);
+    writer.BeginObject ();
+    for (const auto& key : res.getMemberNames ())
+      {
+        writer.Key (key);
+        if (key == "data")
+          {
+            dataPos = envelope.size ();
+            writer.RawValue ("");
+          }
+        else
+          writer.Value (res[key]);
+      }
+    writer.EndObject ();
+  }
+
+  /* If there is no current state yet (e.g. on a fresh node before the
+     initial state), libxayagame returns the envelope without "data" and
+     the callback is never invoked.  */
+  if (dataPos == std::string::npos)
+    {
+      serialised = std::move (envelope);
+      return res;
+    }
+
+  serialised.reserve (serialised.size () + envelope.size ());
+  serialised.insert (0, envelope, 0, dataPos);
+  serialised.append (envelope, dataPos, std::string::npos);
+
+  res.removeMember ("data");
+  return res;
+}
+
+Json::Value
+PXLogic::WriteCustomStateData (xaya::Game& game, const JsonStateWriter& cb,
+                               std::string& serialised)
+{
+  return WriteCustomStateData (game,
+    [&cb] (GameStateJson& gsj, const xaya::uint256& hash,
+           const unsigned height, JsonStreamWriter& out)
+    {
+      cb (gsj, out);
+    },
+    serialised);
+}
+
+std::string
+PXLogic::GetStateSnapshot (xaya::Game& game, const ProtoStateFromDatabase& cb,
+                           proto::StateSnapshot& out)
+{
+  const Json::Value res = GetCustomStateData (game,
+    [this, &cb, &out] (Database& db, const xaya::uint256& hash,
+                       const unsigned height)
+      {
+        out.set_block_hash (hash.ToHex ());
+        out.set_height (height);
+
+        const Context ctx(GetChain (), GetBaseMap (),
+                          Context::NO_HEIGHT, Context::NO_TIMESTAMP);
+        GameStateProto gsp(db, ctx);
+        cb (gsp);
+
+        return Json::Value ();
+      });
+
+  const auto& state = res["state"];
+  CHECK (state.isString ());
+  return state.asString ();
+}
+
 namespace
 {
 
@@ -19,14 +19,22 @@
 #ifndef PXD_LOGIC_HPP
 #define PXD_LOGIC_HPP
 
+#include "blockstats.hpp"
+#include "catchup.hpp"
 #include "context.hpp"
 #include "fame.hpp"
 #include "gamestatejson.hpp"
+#include "gamestateproto.hpp"
+#include "jsonstream.hpp"
+#include "memorystats.hpp"
 #include "params.hpp"
+#include "snapshotpool.hpp"
+#include "statedelta.hpp"
 
 #include "database/database.hpp"
 #include "mapdata/basemap.hpp"
 #include "proto/character.pb.h"
+#include "proto/snapshot.pb.h"
 
 #include <xayagame/sqlitegame.hpp>
 #include <xayagame/sqlitestorage.hpp>
@@ -36,6 +44,7 @@
 
 #include <sqlite3.h>
 
+#include <fstream>
 #include <functional>
 #include <memory>
 #include <string>
@@ -86,21 +95,74 @@ private:
    */
   std::unique_ptr<const BaseMap> map;
 
+  /**
+   * Number of idle read-only connections to keep for reading custom state
+   * data from database snapshots.  If zero, snapshots are not used.
+   */
+  unsigned snapshotConnections = 0;
+
+  /**
+   * Pool of read-only snapshot connections.  This is set up on the first
+   * custom-state read (as we need the database for it), and stays null if
+   * snapshots are disabled or not possible (e.g. not in WAL mode).
+   */
+  std::unique_ptr<SnapshotPool> snapshots;
+
+  /** Whether or not we already tried to set up the snapshot pool.  */
+  bool snapshotsInitialised = false;
+
+  /** Timing statistics of the block processing.  */
+  BlockStats blockStats;
+
+  /** Memory accounting of caches and block processing.  */
+  MemoryStats memoryStats;
+
+  /**
+   * If non-zero, the memory stats are logged whenever the block height
+   * is a multiple of this.
+   */
+  unsigned memoryLogInterval = 0;
+
+  /** Tracks whether we are syncing blocks far behind the tip.  */
+  CatchUpMode catchUp;
+
+  /**
+   * If not null, the block data of all attached blocks is written here
+   * (one JSON value per line) so that it can be replayed later.
+   */
+  std::unique_ptr<std::ofstream> blockRecorder;
+
+  /**
+   * If not null, the entries modified by each attached block are
+   * recorded here (for computing state deltas).
+   */
+  std::unique_ptr<StateChangeLog> changeLog;
+
+  /**
+   * Sets up the snapshot pool, if enabled and possible with the given
+   * main database connection.  This must be called with the game lock
+   * held (i.e. from a GetCustomStateData callback).
+   */
+  void InitialiseSnapshots (xaya::SQLiteDatabase& db);
+
   /**
    * Handles the actual logic for the game-state update.  This is extracted
    * here out of UpdateState, so that it can be accessed from unit tests
-   * independently of SQLiteGame.
+   * independently of SQLiteGame.  If stats is not null, the time taken
+   * by the individual phases is recorded there.
    */
   static void UpdateState (Database& db, xaya::Random& rnd,
                            xaya::Chain chain, const BaseMap& map,
-                           const Json::Value& blockData);
+                           const Json::Value& blockData,
+                           BlockStats* stats = nullptr);
 
   /**
    * Updates the state with a custom FameUpdater.  This is used for mocking
    * the instance in tests.
    */
   static void UpdateState (Database& db, FameUpdater& fame, xaya::Random& rnd,
-                           const Context& ctx, const Json::Value& blockData);
+                           const Context& ctx, const Json::Value& blockData,
+                           BlockStats* stats = nullptr);
 
   /**
    * Performs (potentially slow) validations on the current database state.
@@ -111,6 +173,8 @@ private:
    */
   static void ValidateStateSlow (Database& db, const Context& ctx);
 
+  friend class BlockReplayer;
+  friend class PXLogicBenchmark;
   friend class PXLogicTests;
   friend class PXRpcServer;
   friend class SQLiteGameDatabase;
@@ -146,7 +210,22 @@ public:
     = std::function<Json::Value (GameStateJson& gsj,
                                  const xaya::uint256& hash, unsigned height)>;
 
-  PXLogic () = default;
+  /**
+   * Type for a callback that writes JSON data from the database directly
+   * to a stream, instead of returning it as Json::Value.
+   */
+  using JsonStateWriter
+      = std::function<void (GameStateJson& gsj, JsonStreamWriter& out)>;
+
+  /** Extended state writer that also receives block hash and height.  */
+  using JsonStateWriterWithBlock
+      = std::function<void (GameStateJson& gsj, const xaya::uint256& hash,
+                            unsigned height, JsonStreamWriter& out)>;
+
+  /** Type for a callback that fills in a binary state snapshot.  */
+  using ProtoStateFromDatabase = std::function<void (GameStateProto& gsp)>;
+
+  PXLogic ();
 
   PXLogic (const PXLogic&) = delete;
   void operator= (const PXLogic&) = delete;
@@ -157,6 +236,91 @@ public:
    */
   const BaseMap& GetBaseMap ();
 
+  /**
+   * Returns the statistics about block processing.
+   */
+  const BlockStats&
+  GetBlockStats () const
+  {
+    return blockStats;
+  }
+
+  /**
+   * Returns the memory accounting instance, to which other components
+   * (e.g. pending moves or the REST API) can add their reporters.
+   */
+  MemoryStats&
+  GetMemoryStats ()
+  {
+    return memoryStats;
+  }
+
+  /**
+   * Enables periodic logging of the memory stats, every given number
+   * of blocks.
+   */
+  void LogMemoryStats (unsigned interval);
+
+  /**
+   * Enables automatic catch-up mode when attaching blocks that are older
+   * than the given number of seconds.  Note that leaving catch-up mode
+   * rebuilds the RPC indices while attaching a block (see CatchUpMode).
+   */
+  void EnableCatchUpMode (unsigned threshold);
+
+  /**
+   * Returns true if we are currently catching up with blocks far behind
+   * the current time.  In that case, work that is only needed for serving
+   * up-to-date data to clients can be skipped.
+   */
+  bool
+  IsCatchingUp () const
+  {
+    return catchUp.IsActive ();
+  }
+
+  /**
+   * Enables reading custom state data (as used by the RPC and REST
+   * interfaces) from read-only snapshots of the database, so that those
+   * reads do not block block processing and can run concurrently.  At most
+   * the given number of idle connections are kept open.
+   *
+   * This must be called before the game is started.
+   */
+  void EnableSnapshotReads (unsigned maxIdle);
+
+  /**
+   * Starts recording the block data of all attached blocks to the given
+   * file, which can then be used with the replay tool for benchmarking.
+   * Blocks are appended to the file if it exists already.  Note that
+   * detached blocks are not recorded, so the recording is only consistent
+   * if there were no reorgs while it was running.
+   */
+  void RecordBlocks (const std::string& file);
+
+  /**
+   * Starts recording which entries of the game state are modified by
+   * each attached block, keeping the data for the given number of most
+   * recent blocks.  This must be called before the game is started.
+   */
+  void EnableStateChangeLog (unsigned blocks);
+
+  /**
+   * Returns the log of state changes, or null if it is not enabled.
+   */
+  const StateChangeLog*
+  GetStateChangeLog () const
+  {
+    return changeLog.get ();
+  }
+
+  /**
+   * Returns the full game state like Game::GetCurrentJsonState.  If snapshot
+   * reads are enabled, the sections are built in parallel on snapshots,
+   * without holding the game lock.
+   */
+  Json::Value GetFullState (xaya::Game& game);
+
   /**
    * Returns custom game-state data as JSON, with a callback that
    * directly receives the database (and does not go through the
@@ -180,6 +344,37 @@ public:
   Json::Value GetCustomStateData (xaya::Game& game,
                                   const JsonStateFromDatabase& cb);
 
+  /**
+   * Returns custom game-state data in serialised form, where the "data"
+   * field is streamed directly to the output by the callback.  The bytes
+   * written to serialised are exactly what SerialiseJson would produce
+   * for the corresponding GetCustomStateData result, but the "data" value
+   * is never built up as full JSON DOM.  The returned value contains all
+   * the other (small) fields like "state" and "blockhash".  If there is
+   * no current state yet, the callback is not invoked and serialised
+   * holds just the envelope without a "data" field.
+   */
+  Json::Value WriteCustomStateData (xaya::Game& game,
+                                    const JsonStateWriterWithBlock& cb,
+                                    std::string& serialised);
+
+  /**
+   * Variant of WriteCustomStateData with a callback that does not need
+   * block hash or height.
+   */
+  Json::Value WriteCustomStateData (xaya::Game& game,
+                                    const JsonStateWriter& cb,
+                                    std::string& serialised);
+
+  /**
+   * Fills in a binary state snapshot with the given callback, and sets the
+   * block hash and height it corresponds to.  Returns the "state" string
+   * as libxayagame reports it (e.g. "up-to-date").
+   */
+  std::string GetStateSnapshot (xaya::Game& game,
+                                const ProtoStateFromDatabase& cb,
+                                proto::StateSnapshot& out);
+
 };
 
 } // namespace pxd
@@ -0,0 +1,313 @@
+/*
+    GSP for the Taurion blockchain game
+    Copyright (C) 2021  Autonomous Worlds Ltd
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#include "logic.hpp"
+
+#include "buildings.hpp"
+#include "movement.hpp"
+#include "testutils.hpp"
+#include "worldgen.hpp"
+
+#include "database/building.hpp"
+#include "database/character.hpp"
+#include "database/dbtest.hpp"
+#include "database/inventory.hpp"
+#include "database/moneysupply.hpp"
+#include "database/schema.hpp"
+
+#include <xayautil/hash.hpp>
+#include <xayautil/random.hpp>
+
+#include <benchmark/benchmark.h>
+
+#include <json/json.h>
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace pxd
+{
+
+/**
+ * Helper class that gives the benchmarks access to the private
+ * PXLogic::UpdateState.
+ */
+class PXLogicBenchmark
+{
+
+public:
+
+  PXLogicBenchmark () = delete;
+
+  static void
+  UpdateState (Database& db, xaya::Random& rnd, const Context& ctx,
+               const Json::Value& blockData)
+  {
+    PXLogic::UpdateState (db, rnd, ctx.Chain (), ctx.Map (), blockData);
+  }
+
+};
+
+namespace
+{
+
+/** Raw material used for the refining operations.  */
+const std::string REFINED_ITEM = "raw a";
+
+/**
+ * Sets up a world for benchmarking whole blocks, and builds the moves
+ * of a block to process on it.
+ */
+class BlockBenchmark
+{
+
+private:
+
+  const Context& ctx;
+  xaya::Random& rnd;
+
+  TestDatabase& db;
+
+  /** The world generator (which also knows the generated entities).  */
+  WorldGenerator gen;
+
+  /** Buildings (ancient and generated) that offer refining.  */
+  std::vector<Database::IdT> refineries;
+
+  /**
+   * Returns a move for the given character to set waypoints towards a
+   * random nearby tile.
+   */
+  Json::Value
+  MovementMove (const Character& c)
+  {
+    constexpr HexCoord::IntT range = 10;
+    const auto& pos = c.GetPosition ();
+    const auto offset = [this] ()
+      {
+        return static_cast<int> (rnd.NextInt (2u * range + 1)) - range;
+      };
+    const HexCoord target(pos.GetX () + offset (), pos.GetY () + offset ());
+
+    Json::Value wpJson;
+    std::string encoded;
+    CHECK (EncodeWaypoints ({target}, wpJson, encoded));
+
+    Json::Value upd(Json::objectValue);
+    upd["wp"] = encoded;
+    return upd;
+  }
+
+  /**
+   * Returns a move to refine raw materials for the given account in one
+   * of the refining buildings.  This also gives the account the necessary
+   * items in the building.
+   */
+  Json::Value
+  RefiningMove (const std::string& account)
+  {
+    const auto building = refineries[rnd.NextInt (refineries.size ())];
+    const Quantity units
+        = ctx.RoConfig ().Item (REFINED_ITEM).refines ().input_units ();
+
+    BuildingInventoriesTable inv(db);
+    inv.Get (building, account)->GetInventory ()
+        .AddFungibleCount (REFINED_ITEM, units);
+
+    Json::Value op(Json::objectValue);
+    op["t"] = "ref";
+    op["b"] = static_cast<Json::Int64> (building);
+    op["i"] = REFINED_ITEM;
+    op["n"] = static_cast<Json::Int64> (units);
+
+    Json::Value res(Json::arrayValue);
+    res.append (op);
+    return res;
+  }
+
+  /**
+   * Returns a dex operation (bid) for a random item in one of the
+   * generated buildings.
+   */
+  Json::Value
+  DexMove ()
+  {
+    const auto& buildings = gen.GetBuildings ();
+
+    Json::Value op(Json::objectValue);
+    op["b"] = static_cast<Json::Int64> (
+        buildings[rnd.NextInt (buildings.size ())]);
+    op["i"] = REFINED_ITEM;
+    op["n"] = 1 + rnd.NextInt (10u);
+    op["bp"] = 1 + rnd.NextInt (1'000u);
+
+    Json::Value res(Json::arrayValue);
+    res.append (op);
+    return res;
+  }
+
+public:
+
+  explicit BlockBenchmark (TestDatabase& d, const Context& c,
+                           xaya::Random& r)
+    : ctx(c), rnd(r), db(d), gen(db, ctx, rnd)
+  {}
+
+  /**
+   * Generates the world with the given number of characters, scaling
+   * the other entity counts accordingly.
+   */
+  void
+  GenerateWorld (const unsigned numCharacters)
+  {
+    WorldParams params;
+    params.accounts = numCharacters / 10 + 1;
+    params.characters = numCharacters;
+    params.buildings = numCharacters / 100 + 1;
+    params.dexOrders = numCharacters / 10;
+    params.prospecting = numCharacters / 100;
+    params.prospectedRegions = numCharacters / 20;
+    params.clusters = numCharacters / 1'000 + 1;
+    params.clusterRadius = 20;
+    gen.Generate (params);
+
+    BuildingsTable buildings(db);
+    auto res = buildings.QueryAll ();
+    while (res.Step ())
+      {
+        auto b = buildings.GetFromResult (res);
+        const auto& roData = ctx.RoConfig ().Building (b->GetType ());
+        if (roData.offered_services ().refining ())
+          refineries.push_back (b->GetId ());
+      }
+    CHECK (!refineries.empty ());
+  }
+
+  /**
+   * Builds the data for a block with the given number of moves.  They are
+   * a mix of movement, mining, prospecting, dex and service operations.
+   * Combat happens on its own in clusters with mixed factions.
+   */
+  Json::Value
+  BuildBlock (const unsigned numMoves)
+  {
+    CharacterTable characters(db);
+    const auto& ids = gen.GetCharacters ();
+
+    Json::Value moves(Json::arrayValue);
+    for (unsigned i = 0; i < numMoves; ++i)
+      {
+        auto c = characters.GetById (ids[rnd.NextInt (ids.size ())]);
+        const std::string owner = c->GetOwner ();
+
+        Json::Value mv(Json::objectValue);
+        switch (i % 5)
+          {
+          case 0:
+            mv["c"][std::to_string (c->GetId ())] = MovementMove (*c);
+            break;
+          case 1:
+            mv["c"][std::to_string (c->GetId ())]["mine"]
+                = Json::Value (Json::objectValue);
+            break;
+          case 2:
+            mv["c"][std::to_string (c->GetId ())]["prospect"]
+                = Json::Value (Json::objectValue);
+            break;
+          case 3:
+            mv["x"] = DexMove ();
+            break;
+          case 4:
+            mv["s"] = RefiningMove (owner);
+            break;
+          default:
+            LOG (FATAL) << "Unexpected move type";
+          }
+
+        Json::Value entry(Json::objectValue);
+        entry["name"] = owner;
+        entry["move"] = mv;
+        moves.append (entry);
+      }
+
+    Json::Value blockData(Json::objectValue);
+    blockData["admin"] = Json::Value (Json::arrayValue);
+    blockData["moves"] = moves;
+
+    Json::Value meta(Json::objectValue);
+    meta["height"] = ctx.Height () + 1;
+    meta["timestamp"] = 1500000000;
+    blockData["block"] = meta;
+
+    return blockData;
+  }
+
+};
+
+/**
+ * Benchmarks the processing of a full block with PXLogic::UpdateState,
+ * in a generated world.  Each iteration processes the same block on the
+ * same initial state.
+ *
+ * The benchmark accepts the following arguments:
+ *  - Number of characters in the world
+ *  - Number of moves in the block
+ */
+void
+LogicFullBlock (benchmark::State& state)
+{
+  ContextForTesting ctx;
+  ctx.SetHeight (100);
+
+  TestDatabase db;
+  SetupDatabaseSchema (*db);
+  MoneySupply (db).InitialiseDatabase ();
+  InitialiseBuildings (db, ctx.Chain ());
+
+  xaya::SHA256 seed;
+  seed << "random seed";
+  xaya::Random rnd;
+  rnd.Seed (seed.Finalise ());
+
+  const unsigned numCharacters = state.range (0);
+  const unsigned numMoves = state.range (1);
+  LOG (INFO)
+      << "Benchmarking block with " << numMoves << " moves and "
+      << numCharacters << " characters";
+
+  BlockBenchmark bench(db, ctx, rnd);
+  bench.GenerateWorld (numCharacters);
+  const Json::Value blockData = bench.BuildBlock (numMoves);
+
+  for (auto _ : state)
+    {
+      TemporaryDatabaseChanges tmp(db, state);
+      PXLogicBenchmark::UpdateState (db, rnd, ctx, blockData);
+    }
+}
+BENCHMARK (LogicFullBlock)
+  ->Unit (benchmark::kMillisecond)
+  ->Args ({1'000, 10})
+  ->Args ({1'000, 100})
+  ->Args ({10'000, 100})
+  ->Args ({10'000, 1'000});
+
+} // anonymous namespace
+} // namespace pxd
@@ -19,6 +19,7 @@
 #include "logic.hpp"
 
 #include "fame_tests.hpp"
+#include "jsonstream.hpp"
 #include "jsonutils.hpp"
 #include "params.hpp"
 #include "protoutils.hpp"
@@ -40,6 +41,8 @@
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
+#include <xayagame/game.hpp>
+
 #include <json/json.h>
 
 #include <string>
@@ -1547,5 +1550,30 @@ TEST_F (ValidateStateTests, DexOrderLinks)
 
 /* ************************************************************************** */
 
+TEST (WriteCustomStateDataTests, NoCurrentState)
+{
+  xaya::Game game("tn");
+  PXLogic rules;
+  rules.Initialise (":memory:");
+  game.SetStorage (rules.GetStorage ());
+  game.SetGameLogic (rules);
+
+  bool called = false;
+  std::string serialised;
+  const Json::Value res = rules.WriteCustomStateData (game,
+      [&called] (GameStateJson& gsj, JsonStreamWriter& out)
+        {
+          called = true;
+          out.Value (Json::Value (42));
+        },
+      serialised);
+
+  EXPECT_FALSE (called);
+  EXPECT_FALSE (res.isMember ("data"));
+  EXPECT_EQ (serialised, SerialiseJson (res));
+}
+
+/* ************************************************************************** */
+
 } // anonymous namespace
 } // namespace pxd
@@ -25,6 +25,8 @@
 #include "rest.hpp"
 #include "version.hpp"
 
+#include "mapdata/datafile.hpp"
+
 #include <xayagame/defaultmain.hpp>
 #include <xayagame/game.hpp>
 
@@ -61,9 +63,31 @@ DEFINE_string (datadir, "",
                "base data directory for game data (will be extended by game ID"
                " and the chain)");
 
+DEFINE_int32 (snapshot_connections, 4,
+              "if non-zero, RPC and REST reads use read-only database"
+              " snapshots, and this many idle connections are kept open");
+
 DEFINE_bool (pending_moves, true,
              "whether or not pending moves should be tracked");
 
+DEFINE_int32 (memory_log_interval, 0,
+              "if non-zero, log the memory stats every this many blocks");
+
+DEFINE_int32 (catchup_threshold, 3'600,
+              "if non-zero, enter catch-up mode (skipping work only needed"
+              " for serving clients) while syncing blocks older than this"
+              " many seconds; leaving it rebuilds some database indices"
+              " while processing a block, which blocks the game (and RPC"
+              " calls) for a while on large databases");
+
+DEFINE_string (map_data_file, "",
+               "if set, memory-map the raw map data from this file instead"
+               " of using the data embedded into the binary");
+
+DEFINE_string (record_blocks, "",
+               "if set, append the data of all attached blocks to this file"
+               " for later replay with replayblocks");
+
 class PXInstanceFactory : public xaya::CustomisedInstanceFactory
 {
 
@@ -139,6 +163,14 @@ main (int argc, char** argv)
          " slow down syncing";
 #endif // ENABLE_SLOW_ASSERTS
 
+  if (!FLAGS_map_data_file.empty ()
+        && !pxd::tiledata::UseDataFile (FLAGS_map_data_file))
+    {
+      std::cerr << "Error: failed to load " << FLAGS_map_data_file
+                << std::endl;
+      return EXIT_FAILURE;
+    }
+
   auto charonClient = pxd::MaybeBuildCharonClient ();
   if (charonClient != nullptr)
     {
@@ -190,6 +222,15 @@ main (int argc, char** argv)
   config.MinXayaVersion = 1040000;
 
   pxd::PXLogic rules;
+  if (FLAGS_snapshot_connections > 0)
+    rules.EnableSnapshotReads (FLAGS_snapshot_connections);
+  if (FLAGS_memory_log_interval > 0)
+    rules.LogMemoryStats (FLAGS_memory_log_interval);
+  if (FLAGS_catchup_threshold > 0)
+    rules.EnableCatchUpMode (FLAGS_catchup_threshold);
+  if (!FLAGS_record_blocks.empty ())
+    rules.RecordBlocks (FLAGS_record_blocks);
+
   PXInstanceFactory instanceFact(rules);
   if (FLAGS_rest_port != 0)
     instanceFact.EnableRest (FLAGS_rest_port);
@@ -0,0 +1,145 @@
+/*
+    GSP for the Taurion blockchain game
+    Copyright (C) 2021  Autonomous Worlds Ltd
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#include "memorystats.hpp"
+
+#include "hexagonal/pathfinder.hpp"
+#include "mapdata/dyntiles.hpp"
+
+#include <glog/logging.h>
+
+namespace pxd
+{
+
+namespace
+{
+
+/**
+ * Converts a byte count to JSON.
+ */
+Json::Value
+BytesToJson (const uint64_t bytes)
+{
+  return static_cast<Json::UInt64> (bytes);
+}
+
+} // anonymous namespace
+
+Json::Value
+MemoryStats::BlockUsage::ToJson () const
+{
+  Json::Value res(Json::objectValue);
+  res["height"] = height;
+  res["arena"] = BytesToJson (arenaBytes);
+  res["dyntiles"] = BytesToJson (dynTilesBytes);
+  res["pathfinder"] = BytesToJson (pathFinderBytes);
+  res["total"] = BytesToJson (Total ());
+
+  return res;
+}
+
+void
+MemoryStats::Register (const std::string& name, const Reporter& r)
+{
+  std::lock_guard<std::mutex> lock(mut);
+  CHECK (reporters.emplace (name, r).second)
+      << "Memory reporter " << name << " is already registered";
+}
+
+void
+MemoryStats::Unregister (const std::string& name)
+{
+  std::lock_guard<std::mutex> lock(mut);
+  CHECK_EQ (reporters.erase (name), 1)
+      << "Memory reporter " << name << " is not registered";
+}
+
+void
+MemoryStats::StartBlock ()
+{
+  dyntiles::ResetPeakBucketBytes ();
+  PathFinder::ResetPeakWorkspaceBytes ();
+}
+
+MemoryStats::BlockUsage
+MemoryStats::FinishBlock (const unsigned height, const uint64_t arenaBytes)
+{
+  BlockUsage usage;
+  usage.height = height;
+  usage.arenaBytes = arenaBytes;
+  usage.dynTilesBytes = dyntiles::GetBucketUsage ().peakBytes;
+  usage.pathFinderBytes = PathFinder::GetWorkspaceUsage ().peakBytes;
+
+  std::lock_guard<std::mutex> lock(mut);
+  ++numBlocks;
+  last = usage;
+  if (usage.Total () >= max.Total ())
+    max = usage;
+
+  return usage;
+}
+
+MemoryStats::BlockUsage
+MemoryStats::GetLastBlock () const
+{
+  std::lock_guard<std::mutex> lock(mut);
+  return last;
+}
+
+Json::Value
+MemoryStats::ToJson () const
+{
+  Json::Value res(Json::objectValue);
+
+  const auto buckets = dyntiles::GetBucketUsage ();
+  Json::Value dyn(Json::objectValue);
+  dyn["buckets"] = static_cast<Json::UInt64> (buckets.buckets);
+  dyn["bytes"] = BytesToJson (buckets.bytes);
+  dyn["peakbytes"] = BytesToJson (buckets.peakBytes);
+  dyn["pooled"] = static_cast<Json::UInt64> (buckets.pooled);
+  dyn["pooledbytes"] = BytesToJson (buckets.pooledBytes);
+  res["dyntiles"] = dyn;
+
+  const auto workspace = PathFinder::GetWorkspaceUsage ();
+  Json::Value path(Json::objectValue);
+  path["maps"] = static_cast<Json::UInt64> (workspace.maps);
+  path["bytes"] = BytesToJson (workspace.bytes);
+  path["peakbytes"] = BytesToJson (workspace.peakBytes);
+  res["pathfinder"] = path;
+
+  std::lock_guard<std::mutex> lock(mut);
+
+  Json::Value blocks(Json::objectValue);
+  blocks["count"] = static_cast<Json::UInt64> (numBlocks);
+  if (numBlocks > 0)
+    {
+      blocks["last"] = last.ToJson ();
+      blocks["max"] = max.ToJson ();
+    }
+  res["blocks"] = blocks;
+
+  Json::Value components(Json::objectValue);
+  for (const auto& entry : reporters)
+    components[entry.first] = entry.second ();
+  res["components"] = components;
+
+  return res;
+}
+
+} // namespace pxd
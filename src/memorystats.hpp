@@ -0,0 +1,153 @@
+/*
+    GSP for the Taurion blockchain game
+    Copyright (C) 2021  Autonomous Worlds Ltd
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef PXD_MEMORYSTATS_HPP
+#define PXD_MEMORYSTATS_HPP
+
+#include <json/json.h>
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+
+namespace pxd
+{
+
+/**
+ * Accounting of the memory held by the various long-lived caches and the
+ * transient data structures of block processing.  Components with caches
+ * (e.g. the pending state or REST API) register a reporter callback, which
+ * returns their current counters.  The process-wide usage of DynTiles
+ * buckets and PathFinder workspaces is included always.
+ *
+ * For each processed block, the bytes allocated transiently (the database
+ * proto arena and the peaks of DynTiles and PathFinder) are recorded, so
+ * that it can be checked that per-block memory stays bounded.  Note that
+ * the DynTiles and PathFinder peaks are process-wide, and thus include also
+ * e.g. concurrent path finding from RPC calls.
+ *
+ * This class is thread-safe.
+ */
+class MemoryStats
+{
+
+public:
+
+  /** Callback that returns the current counters of some component.  */
+  using Reporter = std::function<Json::Value ()>;
+
+  /** Memory allocated transiently while processing one block.  */
+  struct BlockUsage
+  {
+
+    /** The block height.  */
+    unsigned height = 0;
+
+    /** Bytes allocated in the proto arena of the Database.  */
+    uint64_t arenaBytes = 0;
+
+    /** Peak bytes of DynTiles buckets.  */
+    uint64_t dynTilesBytes = 0;
+
+    /** Peak bytes of PathFinder distance maps.  */
+    uint64_t pathFinderBytes = 0;
+
+    /**
+     * Returns the total of all counters.
+     */
+    uint64_t
+    Total () const
+    {
+      return arenaBytes + dynTilesBytes + pathFinderBytes;
+    }
+
+    /**
+     * Returns the data as JSON.
+     */
+    Json::Value ToJson () const;
+
+  };
+
+private:
+
+  /** Lock for the data members.  */
+  mutable std::mutex mut;
+
+  /** Registered reporters by name.  */
+  std::map<std::string, Reporter> reporters;
+
+  /** Number of recorded blocks.  */
+  uint64_t numBlocks = 0;
+
+  /** Usage of the last recorded block.  */
+  BlockUsage last;
+
+  /** The block with the largest total usage so far.  */
+  BlockUsage max;
+
+public:
+
+  MemoryStats () = default;
+
+  MemoryStats (const MemoryStats&) = delete;
+  void operator= (const MemoryStats&) = delete;
+
+  /**
+   * Registers a reporter with the given name.  The name must not be
+   * registered already.
+   */
+  void Register (const std::string& name, const Reporter& r);
+
+  /**
+   * Removes the reporter with the given name.
+   */
+  void Unregister (const std::string& name);
+
+  /**
+   * Marks the start of processing a block.  This resets the peak counters
+   * of DynTiles and PathFinder.
+   */
+  void StartBlock ();
+
+  /**
+   * Records the usage for a block that has just been processed, with the
+   * given number of bytes allocated in the database arena.  Returns the
+   * usage recorded.
+   */
+  BlockUsage FinishBlock (unsigned height, uint64_t arenaBytes);
+
+  /**
+   * Returns the usage of the last recorded block.
+   */
+  BlockUsage GetLastBlock () const;
+
+  /**
+   * Returns all counters as JSON, including the output of all reporters
+   * (in the "components" object).  The reporters are called with the
+   * lock held, so they must not (un)register reporters themselves.
+   */
+  Json::Value ToJson () const;
+
+};
+
+} // namespace pxd
+
+#endif // PXD_MEMORYSTATS_HPP
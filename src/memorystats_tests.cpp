@@ -0,0 +1,111 @@
+/*
+    GSP for the Taurion blockchain game
+    Copyright (C) 2021  Autonomous Worlds Ltd
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#include "memorystats.hpp"
+
+#include "hexagonal/coord.hpp"
+#include "mapdata/dyntiles.hpp"
+
+#include <gtest/gtest.h>
+
+namespace pxd
+{
+namespace
+{
+
+class MemoryStatsTests : public testing::Test
+{
+
+protected:
+
+  MemoryStats stats;
+
+};
+
+TEST_F (MemoryStatsTests, BuiltinCounters)
+{
+  const auto res = stats.ToJson ();
+  EXPECT_TRUE (res["dyntiles"].isMember ("bytes"));
+  EXPECT_TRUE (res["dyntiles"].isMember ("pooledbytes"));
+  EXPECT_TRUE (res["pathfinder"].isMember ("bytes"));
+  EXPECT_EQ (res["blocks"]["count"].asInt (), 0);
+  EXPECT_FALSE (res["blocks"].isMember ("last"));
+  EXPECT_EQ (res["components"].size (), 0);
+}
+
+TEST_F (MemoryStatsTests, Reporters)
+{
+  int value = 5;
+  stats.Register ("foo", [&value] ()
+    {
+      return Json::Value (value);
+    });
+  stats.Register ("bar", [] ()
+    {
+      return Json::Value ("bar");
+    });
+
+  auto res = stats.ToJson ()["components"];
+  EXPECT_EQ (res["foo"].asInt (), 5);
+  EXPECT_EQ (res["bar"].asString (), "bar");
+
+  value = 10;
+  stats.Unregister ("bar");
+
+  res = stats.ToJson ()["components"];
+  EXPECT_EQ (res.size (), 1);
+  EXPECT_EQ (res["foo"].asInt (), 10);
+}
+
+TEST_F (MemoryStatsTests, DuplicateReporter)
+{
+  stats.Register ("foo", [] () { return Json::Value (); });
+  EXPECT_DEATH (stats.Register ("foo", [] () { return Json::Value (); }),
+                "already registered");
+}
+
+TEST_F (MemoryStatsTests, BlockUsage)
+{
+  stats.StartBlock ();
+  {
+    DynTiles<int> tiles(0);
+    tiles.Access (HexCoord (0, 0)) = 42;
+  }
+  const auto first = stats.FinishBlock (10, 100);
+  EXPECT_EQ (first.height, 10);
+  EXPECT_EQ (first.arenaBytes, 100);
+  EXPECT_GE (first.dynTilesBytes, dyntiles::BUCKET_SIZE * sizeof (int));
+
+  stats.StartBlock ();
+  const auto second = stats.FinishBlock (11, 50);
+  EXPECT_LT (second.dynTilesBytes, first.dynTilesBytes);
+  EXPECT_LT (second.Total (), first.Total ());
+
+  EXPECT_EQ (stats.GetLastBlock ().height, 11);
+
+  const auto res = stats.ToJson ()["blocks"];
+  EXPECT_EQ (res["count"].asInt (), 2);
+  EXPECT_EQ (res["last"]["height"].asInt (), 11);
+  EXPECT_EQ (res["last"]["arena"].asInt (), 50);
+  EXPECT_EQ (res["max"]["height"].asInt (), 10);
+  EXPECT_EQ (res["max"]["total"].asUInt64 (), first.Total ());
+}
+
+} // anonymous namespace
+} // namespace pxd
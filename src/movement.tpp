@@ -25,13 +25,17 @@ PathFinder::DistanceT
 MovementEdgeWeight (const BaseMap& map, const Faction f,
                     const HexCoord& from, const HexCoord& to)
 {
-  const auto baseWeight = map.GetEdgeWeight (from, to);
+  /* All static data we need about the target tile is fetched at once
+     from the packed attribute layer.  */
+  const auto attr = map.Attributes ().Get (to);
+
+  const auto baseWeight = BaseMap::GetEdgeWeight (attr);
   if (baseWeight == PathFinder::NO_CONNECTION)
     return PathFinder::NO_CONNECTION;
 
   /* Starter zones are obstacles to other factions, but allow 3x
      faster movement to the matching faction.  */
-  const auto toStarter = map.SafeZones ().StarterFor (to);
+  const auto toStarter = attr.StarterFor ();
   if (toStarter == Faction::INVALID)
     return baseWeight;
   if (toStarter == f)
@@ -50,7 +50,7 @@ UpdateBlueprintCopy (OngoingOperation& op, Building& b, const Context& ctx,
   CHECK_GE (cp.num_copies (), 1);
   const Quantity remaining = cp.num_copies () - 1;
 
-  LOG (INFO)
+  VLOG (1)
       << cp.account () << " copied one blueprint " << cp.original_type ()
       << " in building " << b.GetId ()
       << ", " << remaining << " units remaining in the queue";
@@ -88,7 +88,7 @@ UpdateItemConstruction (OngoingOperation& op, Building& b, const Context& ctx,
   CHECK_LE (finished, c.num_items ());
   const Quantity remaining = c.num_items () - finished;
 
-  LOG (INFO)
+  VLOG (1)
       << c.account () << " constructed "
       << finished << " " << c.output_type ()
       << " in building " << b.GetId ()
@@ -183,7 +183,7 @@ ProcessAllOngoings (Database& db, xaya::Random& rnd, const Context& ctx)
 
         case proto::OngoingOperation::kArmourRepair:
           CHECK (c != nullptr);
-          LOG (INFO) << "Finished armour repair of character " << c->GetId ();
+          VLOG (1) << "Finished armour repair of character " << c->GetId ();
           c->MutableHP ().set_armour (c->GetRegenData ().max_hp ().armour ());
           c->MutableProto ().clear_ongoing ();
           break;
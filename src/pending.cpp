@@ -37,12 +37,40 @@ PendingState::Clear ()
   characters.clear ();
   newCharacters.clear ();
   accounts.clear ();
+
+  buildingsJson.clear ();
+  charactersJson.clear ();
+  accountsJson.clear ();
+  cachedJson.reset ();
+}
+
+Json::Value
+PendingState::GetMemoryStats () const
+{
+  Json::Value res(Json::objectValue);
+  res["buildings"] = static_cast<Json::UInt64> (buildings.size ());
+  res["characters"] = static_cast<Json::UInt64> (characters.size ());
+  res["accounts"] = static_cast<Json::UInt64> (accounts.size ());
+
+  size_t newChars = 0;
+  for (const auto& entry : newCharacters)
+    newChars += entry.second.size ();
+  res["newcharacters"] = static_cast<Json::UInt64> (newChars);
+
+  const size_t cachedEntries = buildingsJson.size () + charactersJson.size ()
+                                  + accountsJson.size ();
+  res["cachedjson"] = static_cast<Json::UInt64> (cachedEntries);
+  res["cachedfull"] = (cachedJson != nullptr);
+
+  return res;
 }
 
 PendingState::BuildingState&
 PendingState::GetBuildingState (const Building& b)
 {
   const auto id = b.GetId ();
+  buildingsJson.erase (id);
+  cachedJson.reset ();
 
   const auto mit = buildings.find (id);
   if (mit == buildings.end ())
@@ -62,6 +90,8 @@ PendingState::CharacterState&
 PendingState::GetCharacterState (const Character& c)
 {
   const auto id = c.GetId ();
+  charactersJson.erase (id);
+  cachedJson.reset ();
 
   const auto mit = characters.find (id);
   if (mit == characters.end ())
@@ -81,6 +111,8 @@ PendingState::AccountState&
 PendingState::GetAccountState (const Account& a)
 {
   const auto& name = a.GetName ();
+  accountsJson.erase (name);
+  cachedJson.reset ();
 
   const auto mit = accounts.find (name);
   if (mit == accounts.end ())
@@ -311,6 +343,8 @@ PendingState::AddCharacterCreation (const std::string& name, const Faction f)
       << "Processing pending character creation for " << name
       << ": Faction " << FactionToString (f);
 
+  cachedJson.reset ();
+
   auto mit = newCharacters.find (name);
   if (mit == newCharacters.end ())
     {
@@ -493,21 +527,29 @@ namespace
 
 /**
  * Converts a map of entries (building, character, account states) to
- * a JSON array.
+ * a JSON array.  The JSON of each entry is taken from the cache if it is
+ * there, and otherwise computed and put into the cache.
  */
 template <typename Map>
   Json::Value
-  StateMapToJsonArray (const Map& m, const std::string& keyField)
+  StateMapToJsonArray (const Map& m,
+                       std::map<typename Map::key_type, Json::Value>& cache,
+                       const std::string& keyField)
 {
   Json::Value res(Json::arrayValue);
   for (const auto& entry : m)
     {
-      auto val = entry.second.ToJson ();
-      if (std::is_integral<typename Map::key_type>::value)
-        val[keyField] = IntToJson (entry.first);
-      else
-        val[keyField] = entry.first;
-      res.append (val);
+      auto mit = cache.find (entry.first);
+      if (mit == cache.end ())
+        {
+          auto val = entry.second.ToJson ();
+          if (std::is_integral<typename Map::key_type>::value)
+            val[keyField] = IntToJson (entry.first);
+          else
+            val[keyField] = entry.first;
+          mit = cache.emplace (entry.first, std::move (val)).first;
+        }
+      res.append (mit->second);
     }
   return res;
 }
@@ -517,11 +559,14 @@ template <typename Map>
 Json::Value
 PendingState::ToJson () const
 {
+  if (cachedJson != nullptr)
+    return *cachedJson;
+
   Json::Value res(Json::objectValue);
 
-  res["buildings"] = StateMapToJsonArray (buildings, "id");
-  res["characters"] = StateMapToJsonArray (characters, "id");
-  res["accounts"] = StateMapToJsonArray (accounts, "name");
+  res["buildings"] = StateMapToJsonArray (buildings, buildingsJson, "id");
+  res["characters"] = StateMapToJsonArray (characters, charactersJson, "id");
+  res["accounts"] = StateMapToJsonArray (accounts, accountsJson, "name");
 
   Json::Value newCh(Json::arrayValue);
   for (const auto& entry : newCharacters)
@@ -538,7 +583,8 @@ PendingState::ToJson () const
     }
   res["newcharacters"] = newCh;
 
-  return res;
+  cachedJson = std::make_unique<Json::Value> (std::move (res));
+  return *cachedJson;
 }
 
 /* ************************************************************************** */
@@ -686,21 +732,53 @@ PendingStateUpdater::ProcessMove (const Json::Value& moveObj)
 /* ************************************************************************** */
 
 PendingMoves::PendingMoves (PXLogic& rules)
-  : xaya::SQLiteGame::PendingMoves(rules)
-{}
+  : xaya::SQLiteGame::PendingMoves(rules), memoryStats(rules.GetMemoryStats ())
+{
+  UpdateMemoryCounters ();
+  memoryStats.Register ("pending", [this] ()
+    {
+      std::lock_guard<std::mutex> lock(mutMemory);
+      return memoryCounters;
+    });
+}
+
+PendingMoves::~PendingMoves ()
+{
+  memoryStats.Unregister ("pending");
+}
+
+void
+PendingMoves::UpdateMemoryCounters () const
+{
+  auto counters = state.GetMemoryStats ();
+  counters["dynobstacles"] = (dyn != nullptr);
+
+  std::lock_guard<std::mutex> lock(mutMemory);
+  memoryCounters = std::move (counters);
+}
 
 void
 PendingMoves::Clear ()
 {
   state.Clear ();
   dyn.reset ();
+  UpdateMemoryCounters ();
 }
 
 void
 PendingMoves::AddPendingMove (const Json::Value& mv)
 {
-  auto& db = const_cast<xaya::SQLiteDatabase&> (AccessConfirmedState ());
   PXLogic& rules = dynamic_cast<PXLogic&> (GetSQLiteGame ());
+
+  /* While catching up, the confirmed state is far behind the mempool,
+     so that the pending state would be meaningless anyway.  */
+  if (rules.IsCatchingUp ())
+    {
+      VLOG (1) << "Ignoring pending move while catching up:\n" << mv;
+      return;
+    }
+
+  auto& db = const_cast<xaya::SQLiteDatabase&> (AccessConfirmedState ());
   SQLiteGameDatabase dbObj(db, rules);
 
   const auto& blk = GetConfirmedBlock ();
@@ -715,12 +793,16 @@ PendingMoves::AddPendingMove (const Json::Value& mv)
 
   PendingStateUpdater updater(dbObj, *dyn, state, ctx);
   updater.ProcessMove (mv);
+
+  UpdateMemoryCounters ();
 }
 
 Json::Value
 PendingMoves::ToJson () const
 {
-  return state.ToJson ();
+  auto res = state.ToJson ();
+  UpdateMemoryCounters ();
+  return res;
 }
 
 /* ************************************************************************** */
@@ -21,6 +21,7 @@
 
 #include "context.hpp"
 #include "dynobstacles.hpp"
+#include "memorystats.hpp"
 #include "moveprocessor.hpp"
 #include "services.hpp"
 #include "trading.hpp"
@@ -36,7 +37,9 @@
 
 #include <json/json.h>
 
+#include <map>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 
@@ -196,6 +199,31 @@ private:
   /** Pending updates by account name.  */
   std::map<std::string, AccountState> accounts;
 
+  /*
+   * The JSON representation is cached, since it is typically requested
+   * much more often (by many clients polling the pending state) than the
+   * state changes.  The JSON of individual buildings, characters and
+   * accounts is cached as well, so that after a change only the affected
+   * entries have to be converted again.  An entry is invalidated by
+   * removing it from the cache, which the Get*State methods do for the
+   * entry they return.
+   *
+   * These are mutable as they are only caches; ToJson is called under the
+   * lock that also protects all modifications of the pending state.
+   */
+
+  /** Cached JSON of buildings by ID.  */
+  mutable std::map<Database::IdT, Json::Value> buildingsJson;
+
+  /** Cached JSON of characters by ID.  */
+  mutable std::map<Database::IdT, Json::Value> charactersJson;
+
+  /** Cached JSON of accounts by name.  */
+  mutable std::map<std::string, Json::Value> accountsJson;
+
+  /** The full JSON result, if it is up-to-date.  */
+  mutable std::unique_ptr<Json::Value> cachedJson;
+
   /**
    * Returns the pending building state for the given instance, creating
    * a new empty one if needed.
@@ -228,6 +256,12 @@ public:
    */
   void Clear ();
 
+  /**
+   * Returns the number of entries in the pending state and in its JSON
+   * caches, for memory accounting.
+   */
+  Json::Value GetMemoryStats () const;
+
   /**
    * Updates the state for a new building configuration being scheduled.
    */
@@ -403,6 +437,24 @@ private:
    */
   std::unique_ptr<DynObstacles> dyn;
 
+  /** The memory stats to which we report.  */
+  MemoryStats& memoryStats;
+
+  /** Lock for memoryCounters.  */
+  mutable std::mutex mutMemory;
+
+  /**
+   * Counters of the pending state for memory accounting.  They are updated
+   * whenever the state changes, so that the reporter does not have to access
+   * the state itself (which is protected by the lock in libxayagame).
+   */
+  mutable Json::Value memoryCounters;
+
+  /**
+   * Updates memoryCounters from the current state.
+   */
+  void UpdateMemoryCounters () const;
+
 protected:
 
   void Clear () override;
@@ -411,6 +463,7 @@ protected:
 public:
 
   explicit PendingMoves (PXLogic& rules);
+  ~PendingMoves ();
 
   Json::Value ToJson () const override;
 
@@ -143,6 +143,55 @@ TEST_F (PendingStateTests, Clear)
   )");
 }
 
+TEST_F (PendingStateTests, CachedJsonUpdated)
+{
+  auto c1 = characters.CreateNew ("domob", Faction::RED);
+  auto c2 = characters.CreateNew ("domob", Faction::RED);
+  ASSERT_EQ (c1->GetId (), 1);
+  ASSERT_EQ (c2->GetId (), 2);
+
+  state.AddCharacterDrop (*c1);
+  state.AddCharacterDrop (*c2);
+  ExpectStateJson (R"(
+    {
+      "characters":
+        [
+          {"id": 1, "drop": true, "pickup": false},
+          {"id": 2, "drop": true, "pickup": false}
+        ],
+      "newcharacters": []
+    }
+  )");
+
+  /* Requesting the JSON again without changes yields the same result.  */
+  ExpectStateJson (R"(
+    {
+      "characters":
+        [
+          {"id": 1, "drop": true, "pickup": false},
+          {"id": 2, "drop": true, "pickup": false}
+        ],
+      "newcharacters": []
+    }
+  )");
+
+  state.AddCharacterPickup (*c2);
+  state.AddCharacterCreation ("andy", Faction::GREEN);
+  ExpectStateJson (R"(
+    {
+      "characters":
+        [
+          {"id": 1, "drop": true, "pickup": false},
+          {"id": 2, "drop": true, "pickup": true}
+        ],
+      "newcharacters": [{"name": "andy"}]
+    }
+  )");
+
+  c1.reset ();
+  c2.reset ();
+}
+
 TEST_F (PendingStateTests, BuildingConfig)
 {
   auto b1 = buildings.CreateNew ("checkmark", "domob", Faction::RED);
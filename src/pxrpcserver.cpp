@@ -21,9 +21,12 @@
 #include "config.h"
 
 #include "buildings.hpp"
+#include "dbdump.hpp"
+#include "gamestatejson.hpp"
 #include "jsonutils.hpp"
 #include "movement.hpp"
 #include "services.hpp"
+#include "trace.hpp"
 #include "version.hpp"
 
 #include "database/itemcounts.hpp"
@@ -31,9 +34,12 @@
 
 #include <xayagame/gamerpcserver.hpp>
 
+#include <gflags/gflags.h>
 #include <glog/logging.h>
 
+#include <fstream>
 #include <limits>
+#include <set>
 #include <sstream>
 #include <string>
 
@@ -45,8 +51,17 @@ namespace pxd
 namespace
 {
 
-/** Maximum number of past blocks for which getregions can be called.  */
-constexpr int MAX_REGIONS_HEIGHT_DIFFERENCE = 2 * 60 * 24 * 3;
+DEFINE_string (snapshot_export_dir, "",
+               "if set, exportsnapshot writes its dumps into this directory"
+               " (the method is disabled otherwise); the export only runs"
+               " in parallel to block processing with --snapshot_connections"
+               " and a WAL database, and blocks the game state otherwise");
+
+/**
+ * Maximum L1 range for the area queries like getcharactersinrange.  Larger
+ * areas should just use the RPCs returning all entities.
+ */
+constexpr int MAX_AREA_L1RANGE = 1'000;
 
 /**
  * Error codes returned from the PX RPC server.  All values should have an
@@ -74,6 +89,9 @@ enum class ErrorCode
   /* Specific errors with getregions.  */
   GETREGIONS_FROM_TOO_LOW = 3,
 
+  /* Specific errors with exportsnapshot.  */
+  EXPORT_FAILED = 5,
+
 };
 
 /**
@@ -103,6 +121,46 @@ CheckIntBounds (const std::string& name, const int value,
   ReturnError (ErrorCode::INVALID_ARGUMENT, msg.str ());
 }
 
+/**
+ * Parses and validates the centre and L1 range of an area query.  Returns
+ * an INVALID_ARGUMENT error if they are not valid.
+ */
+HexCoord
+ParseAreaArguments (const Json::Value& centre, const int l1range)
+{
+  HexCoord res;
+  if (!CoordFromJson (centre, res))
+    ReturnError (ErrorCode::INVALID_ARGUMENT,
+                 "centre is not a valid coordinate");
+
+  CheckIntBounds ("l1range", l1range, 0, MAX_AREA_L1RANGE);
+
+  return res;
+}
+
+/**
+ * Parses the list of account names for per-owner queries.  Duplicate
+ * names are removed.  Returns an INVALID_ARGUMENT error if the value
+ * is not an array of strings.
+ */
+std::set<std::string>
+ParseOwnersArgument (const Json::Value& owners)
+{
+  if (!owners.isArray ())
+    ReturnError (ErrorCode::INVALID_ARGUMENT, "owners must be an array");
+
+  std::set<std::string> res;
+  for (const auto& entry : owners)
+    {
+      if (!entry.isString ())
+        ReturnError (ErrorCode::INVALID_ARGUMENT,
+                     "owners must be an array of strings");
+      res.insert (entry.asString ());
+    }
+
+  return res;
+}
+
 } // anonymous namespace
 
 /* ************************************************************************** */
@@ -166,7 +224,7 @@ NonStateRpcServer::AddBuildingsFromJson (const Json::Value& buildings,
         }
 
       for (const auto& tile : shape)
-        CHECK (dyn.buildingIds.emplace (tile, id).second);
+        CHECK (dyn.buildingIds.Insert (tile, id));
     }
 
   return true;
@@ -203,7 +261,8 @@ bool
 NonStateRpcServer::setpathdata (const Json::Value& buildings,
                                 const Json::Value& characters)
 {
-  LOG (INFO) << "RPC method called: setpathdata";
+  VLOG (1) << "RPC method called: setpathdata";
+  const TraceSpan trace("rpc", "setpathdata");
   VLOG (1) << "  Buildings data:\n" << buildings;
   VLOG (1) << "  Character data:\n" << characters;
 
@@ -236,12 +295,13 @@ NonStateRpcServer::findpath (const Json::Value& exbuildings,
                              const Json::Value& source,
                              const Json::Value& target)
 {
-  LOG (INFO)
+  VLOG (1)
       << "RPC method called: findpath\n"
       << "  l1range=" << l1range << ", faction=" << faction << "\n"
       << "  source=" << source << ",\n"
       << "  target=" << target << ",\n"
       << "  exbuildings=" << exbuildings;
+  const TraceSpan trace("rpc", "findpath");
 
   HexCoord sourceCoord;
   if (!CoordFromJson (source, sourceCoord))
@@ -305,9 +365,8 @@ NonStateRpcServer::findpath (const Json::Value& exbuildings,
          of the buildings we want to ignore or not.  */
       if (dynCopy->obstacles.IsBuilding (to))
         {
-          const auto mitTiles = dynCopy->buildingIds.find (to);
-          if (mitTiles == dynCopy->buildingIds.end ()
-                || exBuildingIds.count (mitTiles->second) == 0)
+          const auto* id = dynCopy->buildingIds.Find (to);
+          if (id == nullptr || exBuildingIds.count (*id) == 0)
             return PathFinder::NO_CONNECTION;
         }
 
@@ -316,8 +375,11 @@ NonStateRpcServer::findpath (const Json::Value& exbuildings,
 
       return base;
     };
-  const PathFinder::DistanceT dist = finder.Compute (edges, sourceCoord,
-                                                     l1range);
+  PathFinder::DistanceT dist;
+  {
+    const TraceSpan pathTrace("path", "Compute");
+    dist = finder.Compute (edges, sourceCoord, l1range);
+  }
 
   if (dist == PathFinder::NO_CONNECTION)
     ReturnError (ErrorCode::FINDPATH_NO_CONNECTION,
@@ -361,7 +423,8 @@ NonStateRpcServer::findpath (const Json::Value& exbuildings,
 std::string
 NonStateRpcServer::encodewaypoints (const Json::Value& wp)
 {
-  LOG (INFO) << "RPC method called: encodewaypoints\n" << wp;
+  VLOG (1) << "RPC method called: encodewaypoints\n" << wp;
+  const TraceSpan trace("rpc", "encodewaypoints");
 
   CHECK (wp.isArray ());
 
@@ -386,9 +449,10 @@ NonStateRpcServer::encodewaypoints (const Json::Value& wp)
 Json::Value
 NonStateRpcServer::getregionat (const Json::Value& coord)
 {
-  LOG (INFO)
+  VLOG (1)
       << "RPC method called: getregionat\n"
       << "  coord=" << coord;
+  const TraceSpan trace("rpc", "getregionat");
 
   HexCoord c;
   if (!CoordFromJson (coord, c))
@@ -417,10 +481,11 @@ Json::Value
 NonStateRpcServer::getbuildingshape (const Json::Value& centre, const int rot,
                                      const std::string& type)
 {
-  LOG (INFO)
+  VLOG (1)
       << "RPC method called: getbuildingshape " << type << "\n"
       << "  centre=" << centre << "\n"
       << "  rot=" << rot;
+  const TraceSpan trace("rpc", "getbuildingshape");
 
   HexCoord c;
   if (!CoordFromJson (centre, c))
@@ -447,7 +512,8 @@ NonStateRpcServer::getbuildingshape (const Json::Value& centre, const int rot,
 Json::Value
 NonStateRpcServer::getversion ()
 {
-  LOG (INFO) << "RPC method called: getversion";
+  VLOG (1) << "RPC method called: getversion";
+  const TraceSpan trace("rpc", "getversion");
 
   Json::Value res(Json::objectValue);
   res["package"] = PACKAGE_VERSION;
@@ -461,49 +527,60 @@ NonStateRpcServer::getversion ()
 void
 PXRpcServer::stop ()
 {
-  LOG (INFO) << "RPC method called: stop";
+  VLOG (1) << "RPC method called: stop";
+  const TraceSpan trace("rpc", "stop");
   game.RequestStop ();
 }
 
 Json::Value
 PXRpcServer::getcurrentstate ()
 {
-  LOG (INFO) << "RPC method called: getcurrentstate";
-  return game.GetCurrentJsonState ();
+  VLOG (1) << "RPC method called: getcurrentstate";
+  const TraceSpan trace("rpc", "getcurrentstate");
+
+  /* The RPC framework needs the full result as Json::Value, so this
+     cannot be streamed.  The REST endpoint /state.json.gz returns the
+     same data, but streamed directly into the response.  */
+  return logic.GetFullState (game);
 }
 
 Json::Value
 PXRpcServer::getnullstate ()
 {
-  LOG (INFO) << "RPC method called: getnullstate";
+  VLOG (1) << "RPC method called: getnullstate";
+  const TraceSpan trace("rpc", "getnullstate");
   return game.GetNullJsonState ();
 }
 
 Json::Value
 PXRpcServer::getpendingstate ()
 {
-  LOG (INFO) << "RPC method called: getpendingstate";
+  VLOG (1) << "RPC method called: getpendingstate";
+  const TraceSpan trace("rpc", "getpendingstate");
   return game.GetPendingJsonState ();
 }
 
 Json::Value
 PXRpcServer::waitforpendingchange (const int oldVersion)
 {
-  LOG (INFO) << "RPC method called: waitforpendingchange " << oldVersion;
+  VLOG (1) << "RPC method called: waitforpendingchange " << oldVersion;
+  const TraceSpan trace("rpc", "waitforpendingchange");
   return game.WaitForPendingChange (oldVersion);
 }
 
 std::string
 PXRpcServer::waitforchange (const std::string& knownBlock)
 {
-  LOG (INFO) << "RPC method called: waitforchange " << knownBlock;
+  VLOG (1) << "RPC method called: waitforchange " << knownBlock;
+  const TraceSpan trace("rpc", "waitforchange");
   return xaya::GameRpcServer::DefaultWaitForChange (game, knownBlock);
 }
 
 Json::Value
 PXRpcServer::getaccounts ()
 {
-  LOG (INFO) << "RPC method called: getaccounts";
+  VLOG (1) << "RPC method called: getaccounts";
+  const TraceSpan trace("rpc", "getaccounts");
   return logic.GetCustomStateData (game,
     [] (GameStateJson& gsj)
       {
@@ -514,7 +591,8 @@ PXRpcServer::getaccounts ()
 Json::Value
 PXRpcServer::getbuildings ()
 {
-  LOG (INFO) << "RPC method called: getbuildings";
+  VLOG (1) << "RPC method called: getbuildings";
+  const TraceSpan trace("rpc", "getbuildings");
   return logic.GetCustomStateData (game,
     [] (GameStateJson& gsj)
       {
@@ -525,7 +603,8 @@ PXRpcServer::getbuildings ()
 Json::Value
 PXRpcServer::getcharacters ()
 {
-  LOG (INFO) << "RPC method called: getcharacters";
+  VLOG (1) << "RPC method called: getcharacters";
+  const TraceSpan trace("rpc", "getcharacters");
   return logic.GetCustomStateData (game,
     [] (GameStateJson& gsj)
       {
@@ -536,7 +615,8 @@ PXRpcServer::getcharacters ()
 Json::Value
 PXRpcServer::getgroundloot ()
 {
-  LOG (INFO) << "RPC method called: getgroundloot";
+  VLOG (1) << "RPC method called: getgroundloot";
+  const TraceSpan trace("rpc", "getgroundloot");
   return logic.GetCustomStateData (game,
     [] (GameStateJson& gsj)
       {
@@ -547,7 +627,8 @@ PXRpcServer::getgroundloot ()
 Json::Value
 PXRpcServer::getongoings ()
 {
-  LOG (INFO) << "RPC method called: getongoings";
+  VLOG (1) << "RPC method called: getongoings";
+  const TraceSpan trace("rpc", "getongoings");
   return logic.GetCustomStateData (game,
     [] (GameStateJson& gsj)
       {
@@ -555,10 +636,81 @@ PXRpcServer::getongoings ()
       });
 }
 
+Json::Value
+PXRpcServer::getbuildingsinrange (const Json::Value& centre, const int l1range)
+{
+  VLOG (1)
+      << "RPC method called: getbuildingsinrange " << centre << " " << l1range;
+  const TraceSpan trace("rpc", "getbuildingsinrange");
+  const HexCoord c = ParseAreaArguments (centre, l1range);
+  return logic.GetCustomStateData (game,
+    [&c, l1range] (GameStateJson& gsj)
+      {
+        return gsj.BuildingsInRange (c, l1range);
+      });
+}
+
+Json::Value
+PXRpcServer::getcharactersinrange (const Json::Value& centre, const int l1range)
+{
+  VLOG (1)
+      << "RPC method called: getcharactersinrange "
+      << centre << " " << l1range;
+  const TraceSpan trace("rpc", "getcharactersinrange");
+  const HexCoord c = ParseAreaArguments (centre, l1range);
+  return logic.GetCustomStateData (game,
+    [&c, l1range] (GameStateJson& gsj)
+      {
+        return gsj.CharactersInRange (c, l1range);
+      });
+}
+
+Json::Value
+PXRpcServer::getgroundlootinrange (const Json::Value& centre, const int l1range)
+{
+  VLOG (1)
+      << "RPC method called: getgroundlootinrange "
+      << centre << " " << l1range;
+  const TraceSpan trace("rpc", "getgroundlootinrange");
+  const HexCoord c = ParseAreaArguments (centre, l1range);
+  return logic.GetCustomStateData (game,
+    [&c, l1range] (GameStateJson& gsj)
+      {
+        return gsj.GroundLootInRange (c, l1range);
+      });
+}
+
+Json::Value
+PXRpcServer::getcharactersbyowner (const Json::Value& owners)
+{
+  VLOG (1) << "RPC method called: getcharactersbyowner " << owners;
+  const TraceSpan trace("rpc", "getcharactersbyowner");
+  const auto parsed = ParseOwnersArgument (owners);
+  return logic.GetCustomStateData (game,
+    [&parsed] (GameStateJson& gsj)
+      {
+        return gsj.CharactersOfOwners (parsed);
+      });
+}
+
+Json::Value
+PXRpcServer::getbuildinginventoriesbyowner (const Json::Value& owners)
+{
+  VLOG (1) << "RPC method called: getbuildinginventoriesbyowner " << owners;
+  const TraceSpan trace("rpc", "getbuildinginventoriesbyowner");
+  const auto parsed = ParseOwnersArgument (owners);
+  return logic.GetCustomStateData (game,
+    [&parsed] (GameStateJson& gsj)
+      {
+        return gsj.BuildingInventoriesOfOwners (parsed);
+      });
+}
+
 Json::Value
 PXRpcServer::getregions (const int fromHeight)
 {
-  LOG (INFO) << "RPC method called: getregions " << fromHeight;
+  VLOG (1) << "RPC method called: getregions " << fromHeight;
+  const TraceSpan trace("rpc", "getregions");
 
   return logic.GetCustomStateData (game,
     [fromHeight] (GameStateJson& gsj, const xaya::uint256 hash,
@@ -581,7 +733,8 @@ PXRpcServer::getregions (const int fromHeight)
 Json::Value
 PXRpcServer::getmoneysupply ()
 {
-  LOG (INFO) << "RPC method called: getmoneysupply";
+  VLOG (1) << "RPC method called: getmoneysupply";
+  const TraceSpan trace("rpc", "getmoneysupply");
   return logic.GetCustomStateData (game,
     [] (GameStateJson& gsj)
       {
@@ -592,7 +745,8 @@ PXRpcServer::getmoneysupply ()
 Json::Value
 PXRpcServer::getprizestats ()
 {
-  LOG (INFO) << "RPC method called: getprizestats";
+  VLOG (1) << "RPC method called: getprizestats";
+  const TraceSpan trace("rpc", "getprizestats");
   return logic.GetCustomStateData (game,
     [] (GameStateJson& gsj)
       {
@@ -603,9 +757,10 @@ PXRpcServer::getprizestats ()
 Json::Value
 PXRpcServer::gettradehistory (const int building, const std::string& item)
 {
-  LOG (INFO)
+  VLOG (1)
       << "RPC method called: gettradehistory "
       << item << " " << building;
+  const TraceSpan trace("rpc", "gettradehistory");
   return logic.GetCustomStateData (game,
     [building, &item] (GameStateJson& gsj)
       {
@@ -616,7 +771,8 @@ PXRpcServer::gettradehistory (const int building, const std::string& item)
 Json::Value
 PXRpcServer::getbootstrapdata ()
 {
-  LOG (INFO) << "RPC method called: getbootstrapdata";
+  VLOG (1) << "RPC method called: getbootstrapdata";
+  const TraceSpan trace("rpc", "getbootstrapdata");
   return logic.GetCustomStateData (game,
     [] (GameStateJson& gsj)
       {
@@ -624,10 +780,85 @@ PXRpcServer::getbootstrapdata ()
       });
 }
 
+Json::Value
+PXRpcServer::getblockstats ()
+{
+  VLOG (1) << "RPC method called: getblockstats";
+  const TraceSpan trace("rpc", "getblockstats");
+  return logic.GetBlockStats ().ToJson ();
+}
+
+Json::Value
+PXRpcServer::getmemorystats ()
+{
+  VLOG (1) << "RPC method called: getmemorystats";
+  const TraceSpan trace("rpc", "getmemorystats");
+  return logic.GetMemoryStats ().ToJson ();
+}
+
+Json::Value
+PXRpcServer::exportsnapshot (const std::string& file)
+{
+  LOG (INFO) << "RPC method called: exportsnapshot " << file;
+  const TraceSpan trace("rpc", "exportsnapshot");
+
+  /* The file is written by the GSP process, so we only allow plain file
+     names inside the configured directory (and not arbitrary paths).  */
+  if (FLAGS_snapshot_export_dir.empty ())
+    ReturnError (ErrorCode::EXPORT_FAILED,
+                 "exportsnapshot is disabled, set --snapshot_export_dir");
+  if (file.empty () || file == "." || file == ".."
+        || file.find_first_of ("/\\") != std::string::npos)
+    ReturnError (ErrorCode::INVALID_ARGUMENT,
+                 "file must be a plain file name: " + file);
+  const std::string path = FLAGS_snapshot_export_dir + "/" + file;
+
+  std::ofstream out(path, std::ios::binary);
+  if (!out)
+    ReturnError (ErrorCode::EXPORT_FAILED, "failed to open " + path);
+
+  /* The dump is written from a read snapshot if those are enabled.
+     Otherwise it runs on the main database while holding the game lock,
+     so that block processing is stalled for the whole export.  */
+  const Json::Value res = logic.GetCustomStateData (game,
+    [&] (Database& db, const xaya::uint256& hash, const unsigned height)
+    {
+      DumpInfo info;
+      info.chain = xaya::ChainToString (logic.GetChain ());
+      info.hash = hash;
+      info.height = height;
+
+      WriteDatabaseDump (*db, info, out);
+      return info.ToJson ();
+    });
+
+  out.close ();
+  if (!out)
+    ReturnError (ErrorCode::EXPORT_FAILED, "failed to write " + path);
+
+  return res;
+}
+
+bool
+PXRpcServer::settracing (const bool enabled)
+{
+  LOG (INFO) << "RPC method called: settracing " << enabled;
+  TraceLog::Get ().SetEnabled (enabled);
+  return enabled;
+}
+
+Json::Value
+PXRpcServer::gettrace ()
+{
+  VLOG (1) << "RPC method called: gettrace";
+  return TraceLog::Get ().ToJson ();
+}
+
 Json::Value
 PXRpcServer::getserviceinfo (const std::string& name, const Json::Value& op)
 {
-  LOG (INFO) << "RPC method called: getserviceinfo " << name << "\n" << op;
+  VLOG (1) << "RPC method called: getserviceinfo " << name << "\n" << op;
+  const TraceSpan trace("rpc", "getserviceinfo");
   return logic.GetCustomStateData (game,
     [&] (Database& db, const xaya::uint256& hash, const unsigned height)
     {
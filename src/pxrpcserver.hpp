@@ -25,6 +25,7 @@
 #include "dynobstacles.hpp"
 #include "logic.hpp"
 
+#include "hexagonal/coordmap.hpp"
 #include "mapdata/basemap.hpp"
 
 #include <xayagame/game.hpp>
@@ -96,7 +97,7 @@ private:
      * to selectively exclude buildings by ID from the obstacle map, e.g.
      * when pathing "to" a building to enter it.
      */
-    std::unordered_map<HexCoord, Database::IdT> buildingIds;
+    HexCoordMap<Database::IdT> buildingIds;
 
     explicit PathingData (const xaya::Chain c)
       : obstacles(c)
@@ -204,12 +205,26 @@ public:
   Json::Value getcharacters () override;
   Json::Value getgroundloot () override;
   Json::Value getongoings () override;
+  Json::Value getbuildingsinrange (const Json::Value& centre,
+                                   int l1range) override;
+  Json::Value getcharactersinrange (const Json::Value& centre,
+                                    int l1range) override;
+  Json::Value getgroundlootinrange (const Json::Value& centre,
+                                    int l1range) override;
+  Json::Value getcharactersbyowner (const Json::Value& owners) override;
+  Json::Value getbuildinginventoriesbyowner (
+      const Json::Value& owners) override;
   Json::Value getregions (int fromHeight) override;
   Json::Value getmoneysupply () override;
   Json::Value getprizestats () override;
   Json::Value gettradehistory (int building, const std::string& item) override;
 
   Json::Value getbootstrapdata () override;
+  Json::Value getblockstats () override;
+  Json::Value getmemorystats () override;
+  Json::Value exportsnapshot (const std::string& file) override;
+  bool settracing (bool enabled) override;
+  Json::Value gettrace () override;
 
   Json::Value getserviceinfo (const std::string& name,
                               const Json::Value& op) override;
@@ -0,0 +1,153 @@
+/*
+    GSP for the Taurion blockchain game
+    Copyright (C) 2021  Autonomous Worlds Ltd
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#include "replay.hpp"
+
+#include "logic.hpp"
+
+#include <xayautil/uint256.hpp>
+
+#include <glog/logging.h>
+
+namespace pxd
+{
+
+namespace
+{
+
+/** Name of the main ID series (as used by SQLiteGameDatabase).  */
+const std::string SERIES_MAIN = "pxd";
+
+/** Name of the log ID series.  */
+const std::string SERIES_LOG = "log";
+
+/**
+ * Database result for the next value of an ID series.
+ */
+struct AutoIdResult : public Database::ResultType
+{
+  RESULT_COLUMN (int64_t, nextid, 1);
+};
+
+} // anonymous namespace
+
+ReplayDatabase::ReplayDatabase (xaya::SQLiteDatabase& d)
+{
+  SetDatabase (d);
+
+  /* This is the table that libxayagame's SQLiteGame uses for AutoIds.  It
+     exists already in snapshots of tauriond, but we create it if needed
+     so that the replay also works on a fresh database.  */
+  d.Execute (R"(
+    CREATE TABLE IF NOT EXISTS `xayagame_autoids` (
+      `key` TEXT PRIMARY KEY,
+      `nextid` INTEGER NOT NULL
+    )
+  )");
+
+  nextId = LoadSeries (SERIES_MAIN);
+  nextLogId = LoadSeries (SERIES_LOG);
+}
+
+Database::IdT
+ReplayDatabase::LoadSeries (const std::string& series)
+{
+  auto stmt = Prepare (R"(
+    SELECT `nextid`
+      FROM `xayagame_autoids`
+      WHERE `key` = ?1
+  )");
+  stmt.Bind (1, series);
+
+  auto res = stmt.Query<AutoIdResult> ();
+  if (!res.Step ())
+    return 1;
+
+  const IdT next = res.Get<AutoIdResult::nextid> ();
+  CHECK (!res.Step ());
+
+  return next;
+}
+
+void
+ReplayDatabase::StoreSeries (const std::string& series, const IdT next)
+{
+  auto stmt = Prepare (R"(
+    INSERT OR REPLACE INTO `xayagame_autoids`
+      (`key`, `nextid`) VALUES (?1, ?2)
+  )");
+  stmt.Bind (1, series);
+  stmt.Bind (2, next);
+  stmt.Execute ();
+}
+
+Database::IdT
+ReplayDatabase::GetNextId ()
+{
+  return nextId++;
+}
+
+Database::IdT
+ReplayDatabase::GetLogId ()
+{
+  return nextLogId++;
+}
+
+void
+ReplayDatabase::SyncIds ()
+{
+  StoreSeries (SERIES_MAIN, nextId);
+  StoreSeries (SERIES_LOG, nextLogId);
+}
+
+/* ************************************************************************** */
+
+BlockReplayer::BlockReplayer (xaya::SQLiteDatabase& d, const xaya::Chain c,
+                              const BaseMap& m, const size_t statsWindow)
+  : db(d), chain(c), map(m), stats(statsWindow)
+{}
+
+MemoryStats::BlockUsage
+BlockReplayer::ProcessBlock (const Json::Value& blockData)
+{
+  const auto& seedVal = blockData["block"]["rngseed"];
+  CHECK (seedVal.isString ()) << "Block data has no rngseed:\n" << blockData;
+  xaya::uint256 seed;
+  CHECK (seed.FromHex (seedVal.asString ()));
+
+  /* This is the same as libxayagame does for the random instance passed
+     to the state update.  */
+  xaya::Random rnd;
+  rnd.Seed (seed);
+
+  /* Like SQLiteGameDatabase in tauriond, the Database instance is created
+     per block, so that its proto arena is freed after each one.  */
+  memory.StartBlock ();
+  db.Execute ("BEGIN");
+  ReplayDatabase dbObj(db);
+  PXLogic::UpdateState (dbObj, rnd, chain, map, blockData, &stats);
+  dbObj.SyncIds ();
+  db.Execute ("COMMIT");
+
+  ++numBlocks;
+  const unsigned height = blockData["block"]["height"].asUInt ();
+  return memory.FinishBlock (height, dbObj.GetArenaBytes ());
+}
+
+} // namespace pxd
@@ -0,0 +1,158 @@
+/*
+    GSP for the Taurion blockchain game
+    Copyright (C) 2021  Autonomous Worlds Ltd
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef PXD_REPLAY_HPP
+#define PXD_REPLAY_HPP
+
+#include "blockstats.hpp"
+#include "memorystats.hpp"
+
+#include "database/database.hpp"
+#include "mapdata/basemap.hpp"
+
+#include <xayagame/sqlitestorage.hpp>
+#include <xayautil/random.hpp>
+
+#include <json/json.h>
+
+#include <string>
+
+namespace pxd
+{
+
+/**
+ * Database implementation used for replaying blocks outside of libxayagame.
+ * The ID series are read from and written back to the table that
+ * SQLiteGame uses for its AutoIds, so that a replay on a snapshot of
+ * tauriond's game state assigns exactly the same IDs as tauriond would.
+ */
+class ReplayDatabase : public Database
+{
+
+private:
+
+  /** The next free ID of the main series.  */
+  IdT nextId;
+
+  /** The next free ID of the log series.  */
+  IdT nextLogId;
+
+  /**
+   * Loads the next value of the given ID series from the database.
+   */
+  IdT LoadSeries (const std::string& series);
+
+  /**
+   * Stores the next value of the given ID series to the database.
+   */
+  void StoreSeries (const std::string& series, IdT next);
+
+public:
+
+  explicit ReplayDatabase (xaya::SQLiteDatabase& d);
+
+  ReplayDatabase () = delete;
+  ReplayDatabase (const ReplayDatabase&) = delete;
+  void operator= (const ReplayDatabase&) = delete;
+
+  IdT GetNextId () override;
+  IdT GetLogId () override;
+
+  /**
+   * Writes the current state of the ID series back to the database.
+   */
+  void SyncIds ();
+
+};
+
+/**
+ * Replays recorded blocks (the block data as passed to UpdateState) on
+ * a game-state database, without libxayagame and a Xaya node.  This is
+ * used to benchmark the throughput of the state transition.
+ */
+class BlockReplayer
+{
+
+private:
+
+  /** The underlying SQLite database.  */
+  xaya::SQLiteDatabase& db;
+
+  /** The chain the blocks are from.  */
+  const xaya::Chain chain;
+
+  /** The base map to use.  */
+  const BaseMap& map;
+
+  /** Statistics about the processed blocks.  */
+  BlockStats stats;
+
+  /** Memory accounting of the processed blocks.  */
+  MemoryStats memory;
+
+  /** Number of processed blocks.  */
+  unsigned numBlocks = 0;
+
+public:
+
+  explicit BlockReplayer (xaya::SQLiteDatabase& d, xaya::Chain c,
+                          const BaseMap& m, size_t statsWindow);
+
+  BlockReplayer () = delete;
+  BlockReplayer (const BlockReplayer&) = delete;
+  void operator= (const BlockReplayer&) = delete;
+
+  /**
+   * Processes the given block, in its own database transaction.  Returns
+   * the memory allocated transiently while processing it.
+   */
+  MemoryStats::BlockUsage ProcessBlock (const Json::Value& blockData);
+
+  /**
+   * Returns the statistics about the blocks processed so far.
+   */
+  const BlockStats&
+  GetStats () const
+  {
+    return stats;
+  }
+
+  /**
+   * Returns the memory accounting of the blocks processed so far.
+   */
+  const MemoryStats&
+  GetMemoryStats () const
+  {
+    return memory;
+  }
+
+  /**
+   * Returns the number of blocks processed so far.
+   */
+  unsigned
+  GetNumBlocks () const
+  {
+    return numBlocks;
+  }
+
+};
+
+} // namespace pxd
+
+#endif // PXD_REPLAY_HPP
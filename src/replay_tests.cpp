@@ -0,0 +1,132 @@
+/*
+    GSP for the Taurion blockchain game
+    Copyright (C) 2021  Autonomous Worlds Ltd
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#include "replay.hpp"
+
+#include "testutils.hpp"
+
+#include "database/account.hpp"
+#include "database/dbtest.hpp"
+
+#include <gtest/gtest.h>
+
+#include <json/json.h>
+
+namespace pxd
+{
+namespace
+{
+
+/* ************************************************************************** */
+
+using ReplayDatabaseTests = DBTestWithSchema;
+
+TEST_F (ReplayDatabaseTests, FreshIds)
+{
+  ReplayDatabase replayDb(*db);
+  EXPECT_EQ (replayDb.GetNextId (), 1);
+  EXPECT_EQ (replayDb.GetNextId (), 2);
+  EXPECT_EQ (replayDb.GetLogId (), 1);
+}
+
+TEST_F (ReplayDatabaseTests, IdsPersisted)
+{
+  {
+    ReplayDatabase replayDb(*db);
+    replayDb.GetNextId ();
+    replayDb.GetNextId ();
+    replayDb.GetLogId ();
+    replayDb.SyncIds ();
+  }
+
+  {
+    ReplayDatabase replayDb(*db);
+    EXPECT_EQ (replayDb.GetNextId (), 3);
+    EXPECT_EQ (replayDb.GetLogId (), 2);
+    /* Not synced, so this is not persisted.  */
+  }
+
+  ReplayDatabase replayDb(*db);
+  EXPECT_EQ (replayDb.GetNextId (), 3);
+}
+
+/* ************************************************************************** */
+
+class BlockReplayerTests : public DBTestWithSchema
+{
+
+protected:
+
+  ContextForTesting ctx;
+
+  BlockReplayer replayer;
+
+  BlockReplayerTests ()
+    : replayer(*db, xaya::Chain::REGTEST, ctx.Map (), 10)
+  {}
+
+  /**
+   * Returns block data for the given height with the given moves.
+   */
+  static Json::Value
+  BlockData (const unsigned height, const std::string& moves)
+  {
+    Json::Value res(Json::objectValue);
+    res["admin"] = Json::Value (Json::arrayValue);
+    res["moves"] = ParseJson (moves);
+
+    Json::Value meta(Json::objectValue);
+    meta["height"] = height;
+    meta["timestamp"] = 1500000000;
+    meta["rngseed"]
+        = "0000000000000000000000000000000000000000000000000000000000000000";
+    res["block"] = meta;
+
+    return res;
+  }
+
+};
+
+TEST_F (BlockReplayerTests, ProcessesBlocks)
+{
+  replayer.ProcessBlock (BlockData (10, "[]"));
+  replayer.ProcessBlock (BlockData (11, R"([
+    {"name": "domob", "move": {"a": {"init": {"faction": "r"}}}}
+  ])"));
+
+  EXPECT_EQ (replayer.GetNumBlocks (), 2);
+
+  const Json::Value stats = replayer.GetStats ().ToJson ();
+  EXPECT_EQ (stats["blocks"].asInt (), 2);
+  EXPECT_EQ (stats["last"]["height"].asUInt (), 11);
+
+  const Json::Value memory = replayer.GetMemoryStats ().ToJson ();
+  EXPECT_EQ (memory["blocks"]["count"].asInt (), 2);
+  EXPECT_EQ (memory["blocks"]["last"]["height"].asUInt (), 11);
+
+  AccountsTable accounts(db);
+  auto a = accounts.GetByName ("domob");
+  ASSERT_NE (a, nullptr);
+  EXPECT_EQ (a->GetFaction (), Faction::RED);
+}
+
+/* ************************************************************************** */
+
+} // anonymous namespace
+} // namespace pxd
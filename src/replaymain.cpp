@@ -0,0 +1,227 @@
+/*
+    GSP for the Taurion blockchain game
+    Copyright (C) 2021  Autonomous Worlds Ltd
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+/* Utility program that replays recorded blocks (as written by tauriond with
+   --record_blocks) on top of a game-state snapshot, without a running Xaya
+   node.  It processes them as fast as possible and reports the throughput,
+   the time spent in the individual phases of the state update and the
+   peak memory usage.  This is meant for benchmarking the state transition
+   and validating performance changes.  */
+
+#include "config.h"
+
+#include "replay.hpp"
+
+#include "mapdata/basemap.hpp"
+#include "mapdata/datafile.hpp"
+
+#include <xayagame/sqlitestorage.hpp>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+
+#include <google/protobuf/stubs/common.h>
+
+#include <json/json.h>
+
+#include <sqlite3.h>
+
+#include <sys/resource.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+
+DEFINE_string (snapshot, "",
+               "SQLite file with the game state to start from");
+DEFINE_string (blocks, "",
+               "file with the recorded block data to replay");
+DEFINE_string (output, "",
+               "if set, the resulting game state is written to this file;"
+               " otherwise the replay is done in memory");
+DEFINE_string (chain, "main",
+               "the chain (main, test or regtest) the blocks are from");
+DEFINE_string (map_data_file, "",
+               "if set, memory-map the raw map data from this file instead"
+               " of using the data embedded into the binary");
+DEFINE_int32 (max_blocks, 0,
+              "if positive, stop after replaying this many blocks");
+DEFINE_int32 (stats_window, 1'000,
+              "number of most recent blocks to include in the phase stats");
+DEFINE_int32 (progress_interval, 1'000,
+              "log progress every this many blocks (0 to disable)");
+DEFINE_int32 (max_block_memory_mb, 0,
+              "if positive, fail if the memory allocated transiently while"
+              " processing a single block exceeds this many MiB");
+
+namespace pxd
+{
+namespace
+{
+
+/**
+ * Parses the chain from its string name.
+ */
+xaya::Chain
+ParseChain (const std::string& name)
+{
+  if (name == "main")
+    return xaya::Chain::MAIN;
+  if (name == "test")
+    return xaya::Chain::TEST;
+  if (name == "regtest")
+    return xaya::Chain::REGTEST;
+
+  LOG (FATAL) << "Invalid chain: " << name;
+}
+
+/**
+ * Copies the full content of one SQLite database into another one.
+ */
+void
+CopyDatabase (xaya::SQLiteDatabase& from, xaya::SQLiteDatabase& to)
+{
+  sqlite3_backup* backup = sqlite3_backup_init (*to, "main", *from, "main");
+  CHECK (backup != nullptr) << sqlite3_errmsg (*to);
+  CHECK_EQ (sqlite3_backup_step (backup, -1), SQLITE_DONE);
+  CHECK_EQ (sqlite3_backup_finish (backup), SQLITE_OK);
+}
+
+/**
+ * Returns the peak resident memory of the process in KiB.
+ */
+long
+GetPeakMemory ()
+{
+  struct rusage usage;
+  CHECK_EQ (getrusage (RUSAGE_SELF, &usage), 0);
+  return usage.ru_maxrss;
+}
+
+} // anonymous namespace
+} // namespace pxd
+
+int
+main (int argc, char** argv)
+{
+  google::InitGoogleLogging (argv[0]);
+  GOOGLE_PROTOBUF_VERIFY_VERSION;
+
+  gflags::SetUsageMessage ("Replay recorded blocks for benchmarking");
+  gflags::SetVersionString (PACKAGE_VERSION);
+  gflags::ParseCommandLineFlags (&argc, &argv, true);
+
+  if (!FLAGS_map_data_file.empty ()
+        && !pxd::tiledata::UseDataFile (FLAGS_map_data_file))
+    {
+      std::cerr << "Error: failed to load " << FLAGS_map_data_file
+                << std::endl;
+      return EXIT_FAILURE;
+    }
+
+  if (FLAGS_snapshot.empty ())
+    {
+      std::cerr << "Error: --snapshot must be set" << std::endl;
+      return EXIT_FAILURE;
+    }
+  if (FLAGS_blocks.empty ())
+    {
+      std::cerr << "Error: --blocks must be set" << std::endl;
+      return EXIT_FAILURE;
+    }
+
+  const xaya::Chain chain = pxd::ParseChain (FLAGS_chain);
+
+  /* We never modify the snapshot itself, but copy it over to either
+     the output file or an in-memory database.  This also ensures that
+     the replay is not slowed down by I/O if it is done in memory.  */
+  std::unique_ptr<xaya::SQLiteDatabase> db;
+  {
+    xaya::SQLiteDatabase snapshot(FLAGS_snapshot, SQLITE_OPEN_READONLY);
+    if (FLAGS_output.empty ())
+      db = std::make_unique<xaya::SQLiteDatabase> (
+          "replay", SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE
+                      | SQLITE_OPEN_MEMORY);
+    else
+      db = std::make_unique<xaya::SQLiteDatabase> (
+          FLAGS_output, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE);
+
+    LOG (INFO) << "Copying snapshot " << FLAGS_snapshot << "...";
+    pxd::CopyDatabase (snapshot, *db);
+  }
+
+  std::ifstream in(FLAGS_blocks);
+  CHECK (in) << "Failed to open " << FLAGS_blocks;
+
+  const pxd::BaseMap map(chain);
+  pxd::BlockReplayer replayer(*db, chain, map, FLAGS_stats_window);
+
+  using Clock = std::chrono::steady_clock;
+  const auto start = Clock::now ();
+
+  std::string line;
+  while (std::getline (in, line))
+    {
+      if (line.empty ())
+        continue;
+      const unsigned maxBlocks = FLAGS_max_blocks;
+      if (FLAGS_max_blocks > 0 && replayer.GetNumBlocks () >= maxBlocks)
+        break;
+
+      Json::Value blockData;
+      std::istringstream lineIn(line);
+      lineIn >> blockData;
+
+      const auto usage = replayer.ProcessBlock (blockData);
+      const uint64_t maxBytes
+          = static_cast<uint64_t> (FLAGS_max_block_memory_mb) << 20;
+      CHECK (FLAGS_max_block_memory_mb <= 0 || usage.Total () <= maxBytes)
+          << "Block " << usage.height << " exceeded the memory bound:\n"
+          << usage.ToJson ();
+
+      const unsigned num = replayer.GetNumBlocks ();
+      if (FLAGS_progress_interval > 0
+            && num % static_cast<unsigned> (FLAGS_progress_interval) == 0)
+        LOG (INFO)
+            << "Replayed " << num << " blocks, now at height "
+            << blockData["block"]["height"].asUInt ();
+    }
+
+  const std::chrono::duration<double> duration = Clock::now () - start;
+  const unsigned num = replayer.GetNumBlocks ();
+
+  Json::Value res(Json::objectValue);
+  res["blocks"] = num;
+  res["seconds"] = duration.count ();
+  if (duration.count () > 0)
+    res["blockspersecond"] = num / duration.count ();
+  res["peakmemorykib"] = static_cast<Json::Int64> (pxd::GetPeakMemory ());
+  res["stats"] = replayer.GetStats ().ToJson ();
+  res["memory"] = replayer.GetMemoryStats ().ToJson ();
+
+  std::cout << res << std::endl;
+
+  db.reset ();
+  google::protobuf::ShutdownProtobufLibrary ();
+  return EXIT_SUCCESS;
+}
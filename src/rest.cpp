@@ -5,13 +5,24 @@
 #include "rest.hpp"
 
 #include "gamestatejson.hpp"
+#include "gamestateproto.hpp"
+#include "jsonstream.hpp"
+
+#include "proto/snapshot.pb.h"
+
+#include <xayagame/gamerpcserver.hpp>
 
 #include <microhttpd.h>
 
 #include <gflags/gflags.h>
 #include <glog/logging.h>
 
+#include <google/protobuf/arena.h>
+
 #include <chrono>
+#include <limits>
+#include <sstream>
+#include <string>
 
 namespace pxd
 {
@@ -20,19 +31,151 @@ namespace
 {
 
 DEFINE_int32 (rest_bootstrap_refresh_seconds, 60 * 60,
-              "the refresh interval for bootstrap data in seconds");
+              "the interval in seconds for fully recomputing the bootstrap"
+              " data (it is also updated incrementally with each block)");
+
+/** Content type for binary StateSnapshot results.  */
+const std::string PROTO_CONTENT_TYPE = "application/x-protobuf";
+
+/**
+ * Maximum number of results and their total size that we cache per block.
+ * This bounds the memory used for endpoints with arguments, e.g. trade
+ * history or regions.
+ */
+constexpr size_t MAX_CACHED_RESULTS = 1'000;
+constexpr size_t MAX_CACHED_RESULT_BYTES = 64 << 20;
+
+/** Extension of the per-block JSON endpoints.  */
+const std::string JSON_GZ_SUFFIX = ".json.gz";
+
+/**
+ * Checks if the string ends in the given suffix, and removes it if so.
+ */
+bool
+StripSuffix (std::string& str, const std::string& suffix)
+{
+  if (str.size () < suffix.size ())
+    return false;
+  if (str.compare (str.size () - suffix.size (), suffix.size (), suffix) != 0)
+    return false;
+
+  str.resize (str.size () - suffix.size ());
+  return true;
+}
+
+/**
+ * Parses an unsigned decimal integer that must make up the full string,
+ * and fit into the result type.
+ */
+template <typename T>
+  bool
+  ParseUnsigned (const std::string& str, T& val)
+{
+  if (str.empty () || str.size () > 19)
+    return false;
+  for (const char c : str)
+    if (c < '0' || c > '9')
+      return false;
+
+  const uint64_t parsed = std::stoull (str);
+  if (parsed > std::numeric_limits<T>::max ())
+    return false;
+
+  val = parsed;
+  return true;
+}
+
+/**
+ * The per-block endpoints without arguments, and the GameStateJson methods
+ * that write their data.
+ */
+const std::map<std::string, void (GameStateJson::*) (JsonStreamWriter&)>
+    STATE_ENDPOINTS =
+  {
+    {"/accounts.json.gz", &GameStateJson::WriteAccounts},
+    {"/buildings.json.gz", &GameStateJson::WriteBuildings},
+    {"/characters.json.gz", &GameStateJson::WriteCharacters},
+    {"/groundloot.json.gz", &GameStateJson::WriteGroundLoot},
+  };
 
 } // anonymous namespace
 
+void
+RestApi::SetCachedBlock (const std::string& hash)
+{
+  std::lock_guard<std::mutex> lock(mutBootstrap);
+  if (hash == cachedBlock)
+    return;
+
+  cachedBlock = hash;
+  blockResults.clear ();
+  blockResultBytes = 0;
+}
+
+std::shared_ptr<RestApi::SuccessResult>
+RestApi::GetPerBlockResult (const std::string& url,
+                            const PXLogic::JsonStateWriterWithBlock& cb)
+{
+  {
+    std::lock_guard<std::mutex> lock(mutBootstrap);
+    const auto mit = blockResults.find (url);
+    if (mit != blockResults.end ())
+      return mit->second;
+  }
+
+  std::string serialised;
+  const Json::Value val = logic.WriteCustomStateData (game, cb, serialised);
+  auto res = std::make_shared<SuccessResult> (
+      SuccessResult ("application/json", serialised).Gzip ());
+
+  /* Only cache the result if it is for the block the cache is currently
+     at.  Otherwise a computation that started before a block change could
+     put stale data into the cache after it has been cleared.  */
+  if (val["state"].asString () == "up-to-date")
+    {
+      std::lock_guard<std::mutex> lock(mutBootstrap);
+      const size_t bytes = res->GetPayload ().size ();
+      if (val["blockhash"].asString () == cachedBlock
+            && blockResults.size () < MAX_CACHED_RESULTS
+            && blockResultBytes + bytes <= MAX_CACHED_RESULT_BYTES
+            && blockResults.emplace (url, res).second)
+        blockResultBytes += bytes;
+    }
+
+  return res;
+}
+
+std::shared_ptr<RestApi::SuccessResult>
+RestApi::GetPerBlockResult (const std::string& url,
+                            const PXLogic::JsonStateWriter& cb)
+{
+  return GetPerBlockResult (url,
+    [&cb] (GameStateJson& gsj, const xaya::uint256& hash,
+           const unsigned height, JsonStreamWriter& out)
+    {
+      cb (gsj, out);
+    });
+}
+
 std::shared_ptr<RestApi::SuccessResult>
 RestApi::ComputeBootstrapData ()
 {
-  const Json::Value val = logic.GetCustomStateData (game,
-    [] (GameStateJson& gsj)
-      {
-        return gsj.BootstrapData ();
-      });
-  auto res = std::make_shared<SuccessResult> (SuccessResult (val).Gzip ());
+  std::string serialised;
+  Json::Value val;
+  {
+    std::lock_guard<std::mutex> lock(mutBootstrapRegions);
+    val = logic.WriteCustomStateData (game,
+      [this] (GameStateJson& gsj, const xaya::uint256& hash,
+              const unsigned height, JsonStreamWriter& out)
+        {
+          bootstrapRegions.Update (gsj, hash, height);
+          bootstrapRegionsBytes = bootstrapRegions.GetDataBytes ();
+          bootstrapRegions.Write (out);
+        },
+      serialised);
+  }
+  auto res = std::make_shared<SuccessResult> (
+      SuccessResult ("application/json", serialised).Gzip ());
 
   if (val["state"].asString () == "up-to-date")
     {
@@ -46,21 +189,166 @@ RestApi::ComputeBootstrapData ()
   return res;
 }
 
+std::shared_ptr<RestApi::SuccessResult>
+RestApi::ComputeBootstrapProto ()
+{
+  google::protobuf::Arena arena;
+  auto* snapshot
+      = google::protobuf::Arena::CreateMessage<proto::StateSnapshot> (&arena);
+  const std::string state = logic.GetStateSnapshot (game,
+    [snapshot] (GameStateProto& gsp)
+      {
+        gsp.BootstrapData (*snapshot);
+      },
+    *snapshot);
+
+  std::string serialised;
+  CHECK (snapshot->SerializeToString (&serialised));
+  auto res = std::make_shared<SuccessResult> (
+      SuccessResult (PROTO_CONTENT_TYPE, serialised).Gzip ());
+
+  if (state == "up-to-date")
+    {
+      LOG (INFO) << "Refreshing binary bootstrap-data cache";
+      std::lock_guard<std::mutex> lock(mutBootstrap);
+      bootstrapProto = res;
+    }
+  else
+    LOG (WARNING) << "We are still catching up, not caching bootstrap data";
+
+  return res;
+}
+
+std::shared_ptr<RestApi::SuccessResult>
+RestApi::GetCachedOrCompute (
+    const std::shared_ptr<SuccessResult>& cache,
+    std::shared_ptr<SuccessResult> (RestApi::*compute) ())
+{
+  std::shared_ptr<SuccessResult> res;
+  {
+    std::lock_guard<std::mutex> lock(mutBootstrap);
+    res = cache;
+  }
+  if (res == nullptr)
+    res = (this->*compute) ();
+  CHECK (res != nullptr);
+  return res;
+}
+
+RestApi::SuccessResult
+RestApi::ComputeStateProto ()
+{
+  google::protobuf::Arena arena;
+  auto* snapshot
+      = google::protobuf::Arena::CreateMessage<proto::StateSnapshot> (&arena);
+  logic.GetStateSnapshot (game,
+    [snapshot] (GameStateProto& gsp)
+      {
+        gsp.FullState (*snapshot);
+      },
+    *snapshot);
+
+  std::string serialised;
+  CHECK (snapshot->SerializeToString (&serialised));
+  return SuccessResult (PROTO_CONTENT_TYPE, serialised).Gzip ();
+}
+
+RestApi::SuccessResult
+RestApi::ComputeStateJson ()
+{
+  std::string serialised;
+  logic.WriteCustomStateData (game,
+    [] (GameStateJson& gsj, JsonStreamWriter& out)
+      {
+        gsj.WriteFullState (out);
+      },
+    serialised);
+
+  return SuccessResult ("application/json", serialised).Gzip ();
+}
+
 RestApi::SuccessResult
 RestApi::Process (const std::string& url)
 {
+  /* The upstream RestApi only gives us the URL, not the request headers.
+     Thus the encoding of the result is selected through the endpoint's
+     extension rather than an Accept header.  */
+
   std::string remainder;
   if (MatchEndpoint (url, "/bootstrap.json.gz", remainder) && remainder == "")
+    return *GetCachedOrCompute (bootstrapData, &RestApi::ComputeBootstrapData);
+  if (MatchEndpoint (url, "/bootstrap.pb.gz", remainder) && remainder == "")
+    return *GetCachedOrCompute (bootstrapProto,
+                                &RestApi::ComputeBootstrapProto);
+  if (MatchEndpoint (url, "/state.pb.gz", remainder) && remainder == "")
+    return ComputeStateProto ();
+  if (MatchEndpoint (url, "/state.json.gz", remainder) && remainder == "")
+    return ComputeStateJson ();
+  if (MatchEndpoint (url, "/metrics", remainder) && remainder == "")
+    return SuccessResult ("text/plain; version=0.0.4",
+                          logic.GetBlockStats ().ToPrometheus ());
+
+  const auto mit = STATE_ENDPOINTS.find (url);
+  if (mit != STATE_ENDPOINTS.end ())
     {
-      std::shared_ptr<SuccessResult> res;
-      {
-        std::lock_guard<std::mutex> lock(mutBootstrap);
-        res = bootstrapData;
-      }
-      if (res == nullptr)
-        res = ComputeBootstrapData ();
-      CHECK (res != nullptr);
-      return *res;
+      const auto method = mit->second;
+      return *GetPerBlockResult (url,
+        [method] (GameStateJson& gsj, JsonStreamWriter& out)
+          {
+            (gsj.*method) (out);
+          });
+    }
+
+  /* /regions/<height>.json.gz returns the regions modified since
+     the given height.  */
+  if (MatchEndpoint (url, "/regions/", remainder))
+    {
+      unsigned height;
+      if (!StripSuffix (remainder, JSON_GZ_SUFFIX)
+            || !ParseUnsigned (remainder, height))
+        throw HttpError (MHD_HTTP_BAD_REQUEST, "invalid height");
+
+      /* Like getregions, only recent heights are allowed.  Otherwise
+         clients could make us compute and cache the full regions for
+         many distinct heights.  */
+      return *GetPerBlockResult (url,
+        [height] (GameStateJson& gsj, const xaya::uint256& hash,
+                  const unsigned current, JsonStreamWriter& out)
+          {
+            if (static_cast<uint64_t> (height) + MAX_REGIONS_HEIGHT_DIFFERENCE
+                  < current)
+              {
+                std::ostringstream msg;
+                msg << "height " << height
+                    << " is too low for current block height " << current
+                    << ", needs to be at least "
+                    << current - MAX_REGIONS_HEIGHT_DIFFERENCE;
+                throw HttpError (MHD_HTTP_BAD_REQUEST, msg.str ());
+              }
+
+            gsj.WriteRegions (height, out);
+          });
+    }
+
+  /* /tradehistory/<building>/<item>.json.gz returns the trade history
+     for an item in a building.  */
+  if (MatchEndpoint (url, "/tradehistory/", remainder))
+    {
+      const size_t slash = remainder.find ('/');
+      Database::IdT building;
+      if (slash == std::string::npos
+            || !ParseUnsigned (remainder.substr (0, slash), building))
+        throw HttpError (MHD_HTTP_BAD_REQUEST, "invalid building ID");
+
+      std::string item = remainder.substr (slash + 1);
+      if (!StripSuffix (item, JSON_GZ_SUFFIX) || item.empty ())
+        throw HttpError (MHD_HTTP_BAD_REQUEST, "invalid item");
+
+      return *GetPerBlockResult (url,
+        [building, item] (GameStateJson& gsj, JsonStreamWriter& out)
+          {
+            out.Value (gsj.TradeHistory (item, building));
+          });
     }
 
   throw HttpError (MHD_HTTP_NOT_FOUND, "invalid API endpoint");
@@ -70,24 +358,75 @@ void
 RestApi::Start ()
 {
   xaya::RestApi::Start ();
+  logic.GetMemoryStats ().Register ("rest", [this] ()
+    {
+      return GetMemoryCounters ();
+    });
 
   std::lock_guard<std::mutex> lock(mutStop);
   shouldStop = false;
   CHECK (bootstrapRefresher == nullptr);
   bootstrapRefresher = std::make_unique<std::thread> ([this] ()
     {
+      using Clock = std::chrono::steady_clock;
       const auto intv
           = std::chrono::seconds (FLAGS_rest_bootstrap_refresh_seconds);
+
+      std::string knownBlock;
+      Clock::time_point nextFull = Clock::now ();
       while (true)
         {
-          ComputeBootstrapData ();
-
-          std::unique_lock<std::mutex> lock(mutStop);
-          if (shouldStop)
-            break;
-          cvStop.wait_for (lock, intv);
-          if (shouldStop)
-            break;
+          SetCachedBlock (knownBlock);
+
+          /* The incremental update of the JSON data cannot detect reorgs
+             that end at a larger block height.  Thus we still do a full
+             recomputation from time to time, in addition to the binary
+             data which is always computed from scratch.
+
+             While catching up, the data would be outdated right away
+             again.  It is still computed on demand if requested, but
+             we skip the refresh until we reach the tip (and then do a
+             full one).  */
+          if (logic.IsCatchingUp ())
+            nextFull = Clock::now ();
+          else
+            {
+              if (Clock::now () >= nextFull)
+                {
+                  {
+                    std::lock_guard<std::mutex> lock(mutBootstrapRegions);
+                    bootstrapRegions.Reset ();
+                    bootstrapRegionsBytes = 0;
+                  }
+                  ComputeBootstrapProto ();
+                  nextFull = Clock::now () + intv;
+                }
+              ComputeBootstrapData ();
+            }
+
+          {
+            std::lock_guard<std::mutex> lock(mutStop);
+            if (shouldStop)
+              break;
+          }
+
+          /* Wait for the next block.  This returns also after a timeout
+             of a few seconds, so that we notice if we should stop.  */
+          while (true)
+            {
+              const std::string newBlock
+                  = xaya::GameRpcServer::DefaultWaitForChange (game,
+                                                               knownBlock);
+
+              std::lock_guard<std::mutex> lock(mutStop);
+              if (shouldStop)
+                return;
+              if (newBlock != knownBlock || Clock::now () >= nextFull)
+                {
+                  knownBlock = newBlock;
+                  break;
+                }
+            }
         }
     });
 }
@@ -98,7 +437,6 @@ RestApi::Stop ()
   {
     std::lock_guard<std::mutex> lock(mutStop);
     shouldStop = true;
-    cvStop.notify_all ();
   }
 
   if (bootstrapRefresher != nullptr)
@@ -107,9 +445,35 @@ RestApi::Stop ()
       bootstrapRefresher.reset ();
     }
 
+  logic.GetMemoryStats ().Unregister ("rest");
   xaya::RestApi::Stop ();
 }
 
+Json::Value
+RestApi::GetMemoryCounters ()
+{
+  const auto resultBytes = [] (const std::shared_ptr<SuccessResult>& r)
+    {
+      return static_cast<Json::UInt64> (
+          r == nullptr ? 0 : r->GetPayload ().size ());
+    };
+
+  Json::Value res(Json::objectValue);
+
+  {
+    std::lock_guard<std::mutex> lock(mutBootstrap);
+    res["bootstrapjson"] = resultBytes (bootstrapData);
+    res["bootstrapproto"] = resultBytes (bootstrapProto);
+
+    res["blockresults"] = static_cast<Json::UInt64> (blockResults.size ());
+    res["blockresultbytes"] = static_cast<Json::UInt64> (blockResultBytes);
+  }
+  res["bootstrapregions"]
+      = static_cast<Json::UInt64> (bootstrapRegionsBytes.load ());
+
+  return res;
+}
+
 Json::Value
 RestClient::GetBootstrapData ()
 {
@@ -123,4 +487,17 @@ RestClient::GetBootstrapData ()
   return req.GetJson ();
 }
 
+Json::Value
+RestClient::GetState ()
+{
+  Request req(*this);
+  if (!req.Send ("/state.json.gz"))
+    throw std::runtime_error (req.GetError ());
+
+  if (req.GetType () != "application/json")
+    throw std::runtime_error ("response is not JSON");
+
+  return req.GetJson ();
+}
+
 } // namespace pxd
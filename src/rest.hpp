@@ -5,14 +5,18 @@
 #ifndef PXD_REST_HPP
 #define PXD_REST_HPP
 
+#include "bootstrapcache.hpp"
 #include "logic.hpp"
 
 #include <xayagame/game.hpp>
 #include <xayagame/rest.hpp>
 
-#include <condition_variable>
+#include <atomic>
+#include <cstdint>
+#include <map>
 #include <memory>
 #include <mutex>
+#include <string>
 #include <thread>
 
 namespace pxd
@@ -39,19 +43,52 @@ private:
    */
   std::shared_ptr<SuccessResult> bootstrapData;
 
-  /** Lock for the bootstrap data cache.  */
+  /** The cached bootstrap data in binary (protobuf) form, if any.  */
+  std::shared_ptr<SuccessResult> bootstrapProto;
+
+  /**
+   * Cached results of the per-block endpoints (like /characters.json.gz),
+   * keyed by URL.  They are valid for the block in cachedBlock only, and
+   * cleared by the refresher thread whenever a new block arrives.
+   */
+  std::map<std::string, std::shared_ptr<SuccessResult>> blockResults;
+
+  /** Total payload size of the results in blockResults.  */
+  size_t blockResultBytes = 0;
+
+  /** The block hash (as hex) to which blockResults correspond.  */
+  std::string cachedBlock;
+
+  /** Lock for the bootstrap data and per-block caches.  */
   std::mutex mutBootstrap;
 
+  /**
+   * Serialised region data, from which the bootstrap JSON is assembled.
+   * This is updated incrementally with each new block.
+   */
+  BootstrapRegionsCache bootstrapRegions;
+
+  /** Lock for bootstrapRegions.  */
+  std::mutex mutBootstrapRegions;
+
+  /**
+   * Size of the bootstrapRegions data in bytes, for memory accounting.
+   * This is updated together with the cache, and can be read without
+   * mutBootstrapRegions (which is held for a long time while computing).
+   */
+  std::atomic<uint64_t> bootstrapRegionsBytes;
+
   /** Set to true if we should stop.  */
   bool shouldStop;
 
-  /** Condition variable that is signaled if shouldStop is set.  */
-  std::condition_variable cvStop;
-
-  /** Mutex for the stop flag and condition variable.  */
+  /** Mutex for the stop flag.  */
   std::mutex mutStop;
 
-  /** Thread running the bootstrap data update.  */
+  /**
+   * Thread running the bootstrap data update.  It refreshes the JSON data
+   * on every new block, and the binary data (as well as the JSON data
+   * from scratch) in the configured interval.
+   */
   std::unique_ptr<std::thread> bootstrapRefresher;
 
   /**
@@ -60,6 +97,61 @@ private:
    */
   std::shared_ptr<SuccessResult> ComputeBootstrapData ();
 
+  /**
+   * Computes the bootstrap data as binary StateSnapshot, and caches it
+   * if we are up-to-date (like ComputeBootstrapData).
+   */
+  std::shared_ptr<SuccessResult> ComputeBootstrapProto ();
+
+  /**
+   * Returns the cached result from the given cache field if there is one,
+   * and otherwise computes it with the given method.
+   */
+  std::shared_ptr<SuccessResult> GetCachedOrCompute (
+      const std::shared_ptr<SuccessResult>& cache,
+      std::shared_ptr<SuccessResult> (RestApi::*compute) ());
+
+  /**
+   * Returns the result for a per-block endpoint from the cache if possible.
+   * Otherwise, the data is written with the given callback, and the result
+   * is cached if it corresponds to the current block.  The results cached
+   * per block are bounded by count and total size.
+   */
+  std::shared_ptr<SuccessResult> GetPerBlockResult (
+      const std::string& url, const PXLogic::JsonStateWriterWithBlock& cb);
+
+  /**
+   * Variant of GetPerBlockResult with a callback that does not need
+   * block hash or height.
+   */
+  std::shared_ptr<SuccessResult> GetPerBlockResult (
+      const std::string& url, const PXLogic::JsonStateWriter& cb);
+
+  /**
+   * Marks the given block as the current one for the per-block cache,
+   * clearing all results cached for a previous block.
+   */
+  void SetCachedBlock (const std::string& hash);
+
+  /**
+   * Computes the full game state as binary StateSnapshot.  This is not
+   * cached, as it is meant for occasional use only.
+   */
+  SuccessResult ComputeStateProto ();
+
+  /**
+   * Computes the full game state as JSON.  This is the same data as
+   * the getcurrentstate RPC method returns, but it is streamed row by row
+   * instead of built up as DOM.  It is not cached either.
+   */
+  SuccessResult ComputeStateJson ();
+
+  /**
+   * Returns the sizes of the bootstrap and per-block caches, for
+   * memory accounting.
+   */
+  Json::Value GetMemoryCounters ();
+
 protected:
 
   SuccessResult Process (const std::string& url) override;
@@ -67,7 +159,7 @@ protected:
 public:
 
   explicit RestApi (xaya::Game& g, PXLogic& l, const int p)
-    : xaya::RestApi(p), game(g), logic(l)
+    : xaya::RestApi(p), game(g), logic(l), bootstrapRegionsBytes(0)
   {}
 
   void Start () override;
@@ -91,6 +183,12 @@ public:
    */
   Json::Value GetBootstrapData ();
 
+  /**
+   * Queries for the full game state (as returned from /state.json.gz).
+   * May throw a std::runtime_error if the request fails.
+   */
+  Json::Value GetState ();
+
 };
 
 } // namespace pxd
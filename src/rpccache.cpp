@@ -0,0 +1,170 @@
+/*
+    GSP for the Taurion blockchain game
+    Copyright (C) 2021  Autonomous Worlds Ltd
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#include "rpccache.hpp"
+
+#include "jsonstream.hpp"
+
+#include <glog/logging.h>
+
+#include <exception>
+#include <utility>
+
+namespace pxd
+{
+
+void
+RpcResultCache::SetBlock (const std::string& hash)
+{
+  std::lock_guard<std::mutex> lock(mut);
+  if (hash == block)
+    return;
+
+  VLOG (1)
+      << "New block " << hash << ", dropping " << results.size ()
+      << " cached RPC results";
+
+  block = hash;
+  ++generation;
+  results.clear ();
+  lru.clear ();
+  totalBytes = 0;
+
+  /* Ongoing computations are for the old block, so later callers must not
+     wait for them.  Those already waiting hold a copy of the future.  */
+  inFlight.clear ();
+}
+
+void
+RpcResultCache::AddResult (const std::string& key, const Json::Value& value)
+{
+  const size_t size = key.size () + SerialiseJson (value).size ();
+  if (size > maxBytes || maxEntries == 0)
+    {
+      VLOG (1) << "Result of size " << size << " is too large to cache";
+      return;
+    }
+
+  /* Keep the existing entry if the result is cached already, so that the
+     size accounting stays consistent.  */
+  if (results.count (key) > 0)
+    return;
+
+  while (!lru.empty ()
+          && (results.size () >= maxEntries || totalBytes + size > maxBytes))
+    {
+      const auto mit = results.find (lru.back ());
+      CHECK (mit != results.end ());
+      totalBytes -= mit->second.size;
+      results.erase (mit);
+      lru.pop_back ();
+    }
+
+  lru.push_front (key);
+
+  CachedResult entry;
+  entry.value = value;
+  entry.size = size;
+  entry.lruPos = lru.begin ();
+  results.emplace (key, std::move (entry));
+  totalBytes += size;
+}
+
+Json::Value
+RpcResultCache::Get (const std::string& method, const Json::Value& params,
+                     const Compute& compute)
+{
+  const std::string key = method + SerialiseJson (params);
+
+  std::promise<Json::Value> promise;
+  unsigned startGeneration;
+  {
+    std::unique_lock<std::mutex> lock(mut);
+
+    const auto mit = results.find (key);
+    if (mit != results.end ())
+      {
+        lru.splice (lru.begin (), lru, mit->second.lruPos);
+        return mit->second.value;
+      }
+
+    const auto fit = inFlight.find (key);
+    if (fit != inFlight.end ())
+      {
+        CHECK_EQ (fit->second.generation, generation);
+        auto future = fit->second.result;
+        lock.unlock ();
+        VLOG (1) << "Waiting for ongoing call of " << method;
+        return future.get ();
+      }
+
+    startGeneration = generation;
+    InFlightCall call;
+    call.generation = startGeneration;
+    call.result = promise.get_future ().share ();
+    inFlight.emplace (key, std::move (call));
+  }
+
+  /* Removes our entry from inFlight, unless it has been dropped already
+     due to a block change (and possibly replaced by a newer call).  */
+  const auto removeInFlight = [&] ()
+    {
+      const auto fit = inFlight.find (key);
+      if (fit != inFlight.end () && fit->second.generation == startGeneration)
+        inFlight.erase (fit);
+    };
+
+  Json::Value res;
+  try
+    {
+      res = compute ();
+    }
+  catch (...)
+    {
+      promise.set_exception (std::current_exception ());
+      std::lock_guard<std::mutex> lock(mut);
+      removeInFlight ();
+      throw;
+    }
+
+  promise.set_value (res);
+
+  std::lock_guard<std::mutex> lock(mut);
+  removeInFlight ();
+  if (!block.empty () && generation == startGeneration)
+    AddResult (key, res);
+
+  return res;
+}
+
+size_t
+RpcResultCache::GetNumCached ()
+{
+  std::lock_guard<std::mutex> lock(mut);
+  return results.size ();
+}
+
+size_t
+RpcResultCache::GetCachedBytes ()
+{
+  std::lock_guard<std::mutex> lock(mut);
+  return totalBytes;
+}
+
+} // namespace pxd
@@ -0,0 +1,172 @@
+/*
+    GSP for the Taurion blockchain game
+    Copyright (C) 2021  Autonomous Worlds Ltd
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef PXD_RPCCACHE_HPP
+#define PXD_RPCCACHE_HPP
+
+#include <json/json.h>
+
+#include <cstddef>
+#include <functional>
+#include <future>
+#include <list>
+#include <map>
+#include <mutex>
+#include <string>
+
+namespace pxd
+{
+
+/**
+ * Cache for results of state RPC methods, keyed by method name and
+ * parameters.  Results are only valid for the block they were computed at,
+ * and the cache is cleared whenever a new block is set.  Concurrent calls
+ * for the same method and parameters that are not yet cached are coalesced,
+ * so that only one of them actually computes the result and the others
+ * wait for it.
+ *
+ * This is used in the Charon client, so that multiple local consumers
+ * asking for the same data in the same block lead to just one request
+ * forwarded through Charon.
+ *
+ * The cache is bounded both in the number of results and their total
+ * size (as serialised JSON).  If a new result exceeds the bounds, the
+ * least-recently used ones are evicted.
+ */
+class RpcResultCache
+{
+
+public:
+
+  /** Callback that computes a result if it is not cached.  */
+  using Compute = std::function<Json::Value ()>;
+
+private:
+
+  /** A cached result.  */
+  struct CachedResult
+  {
+
+    /** The result value.  */
+    Json::Value value;
+
+    /** Size of the result as serialised JSON.  */
+    size_t size;
+
+    /** Position of the key in the LRU list.  */
+    std::list<std::string>::iterator lruPos;
+
+  };
+
+  /** An ongoing computation.  */
+  struct InFlightCall
+  {
+
+    /** The generation in which the computation was started.  */
+    unsigned generation;
+
+    /** The future for the result.  */
+    std::shared_future<Json::Value> result;
+
+  };
+
+  /** Maximum number of cached results.  */
+  const size_t maxEntries;
+
+  /** Maximum total size of the cached results.  */
+  const size_t maxBytes;
+
+  /** Lock for all the members.  */
+  std::mutex mut;
+
+  /**
+   * The current block hash.  If this is empty, then we do not know the
+   * current block yet, and do not cache anything.
+   */
+  std::string block;
+
+  /**
+   * Counter incremented each time the block changes.  This is used to
+   * detect computations that started before a block change, whose result
+   * must then not be cached.
+   */
+  unsigned generation = 0;
+
+  /** Cached results by key.  */
+  std::map<std::string, CachedResult> results;
+
+  /** Keys of the cached results, most-recently used first.  */
+  std::list<std::string> lru;
+
+  /** Total size of all cached results.  */
+  size_t totalBytes = 0;
+
+  /**
+   * Ongoing computations by key, which other callers can wait for.  This
+   * only contains computations started in the current generation, so that
+   * callers after a block change do not receive results for an old block.
+   */
+  std::map<std::string, InFlightCall> inFlight;
+
+  /**
+   * Adds a newly computed result to the cache, evicting old results
+   * as needed.  Must be called with the lock held.
+   */
+  void AddResult (const std::string& key, const Json::Value& value);
+
+public:
+
+  explicit RpcResultCache (const size_t e, const size_t b)
+    : maxEntries(e), maxBytes(b)
+  {}
+
+  RpcResultCache () = delete;
+  RpcResultCache (const RpcResultCache&) = delete;
+  void operator= (const RpcResultCache&) = delete;
+
+  /**
+   * Sets the current block hash.  If it is different from the previous one,
+   * all cached results are dropped.
+   */
+  void SetBlock (const std::string& hash);
+
+  /**
+   * Returns the result for the given method and parameters, either from
+   * the cache, by waiting for an ongoing computation of it, or by calling
+   * the compute function.  Exceptions thrown by compute are passed on to
+   * all callers waiting for it.
+   */
+  Json::Value Get (const std::string& method, const Json::Value& params,
+                   const Compute& compute);
+
+  /**
+   * Returns the number of currently cached results.
+   */
+  size_t GetNumCached ();
+
+  /**
+   * Returns the total size of all currently cached results.
+   */
+  size_t GetCachedBytes ();
+
+};
+
+} // namespace pxd
+
+#endif // PXD_RPCCACHE_HPP
@@ -0,0 +1,277 @@
+/*
+    GSP for the Taurion blockchain game
+    Copyright (C) 2021  Autonomous Worlds Ltd
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#include "rpccache.hpp"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace pxd
+{
+namespace
+{
+
+class RpcResultCacheTests : public testing::Test
+{
+
+protected:
+
+  RpcResultCache cache;
+
+  /** Number of times a result has been computed.  */
+  std::atomic<unsigned> computed;
+
+  RpcResultCacheTests ()
+    : cache(10, 1'000), computed(0)
+  {}
+
+  /**
+   * Returns a compute function that counts the calls and returns
+   * the given value.
+   */
+  RpcResultCache::Compute
+  Value (const int val)
+  {
+    return [this, val] ()
+      {
+        ++computed;
+        return Json::Value (val);
+      };
+  }
+
+};
+
+TEST_F (RpcResultCacheTests, NoCachingWithoutBlock)
+{
+  EXPECT_EQ (cache.Get ("foo", Json::Value (), Value (1)), 1);
+  EXPECT_EQ (cache.Get ("foo", Json::Value (), Value (2)), 2);
+  EXPECT_EQ (computed, 2);
+  EXPECT_EQ (cache.GetNumCached (), 0);
+}
+
+TEST_F (RpcResultCacheTests, CachedPerMethodAndParams)
+{
+  cache.SetBlock ("a");
+
+  Json::Value params(Json::arrayValue);
+  params.append (42);
+
+  EXPECT_EQ (cache.Get ("foo", Json::Value (), Value (1)), 1);
+  EXPECT_EQ (cache.Get ("foo", Json::Value (), Value (2)), 1);
+  EXPECT_EQ (cache.Get ("foo", params, Value (3)), 3);
+  EXPECT_EQ (cache.Get ("bar", Json::Value (), Value (4)), 4);
+  EXPECT_EQ (cache.Get ("foo", params, Value (5)), 3);
+
+  EXPECT_EQ (computed, 3);
+  EXPECT_EQ (cache.GetNumCached (), 3);
+}
+
+TEST_F (RpcResultCacheTests, NewBlockInvalidates)
+{
+  cache.SetBlock ("a");
+  EXPECT_EQ (cache.Get ("foo", Json::Value (), Value (1)), 1);
+
+  cache.SetBlock ("a");
+  EXPECT_EQ (cache.Get ("foo", Json::Value (), Value (2)), 1);
+
+  cache.SetBlock ("b");
+  EXPECT_EQ (cache.GetNumCached (), 0);
+  EXPECT_EQ (cache.Get ("foo", Json::Value (), Value (3)), 3);
+}
+
+TEST_F (RpcResultCacheTests, ExceptionsNotCached)
+{
+  cache.SetBlock ("a");
+  EXPECT_THROW (cache.Get ("foo", Json::Value (), [] () -> Json::Value
+    {
+      throw std::runtime_error ("failed");
+    }), std::runtime_error);
+  EXPECT_EQ (cache.Get ("foo", Json::Value (), Value (1)), 1);
+}
+
+TEST_F (RpcResultCacheTests, ConcurrentCallsCoalesced)
+{
+  cache.SetBlock ("a");
+
+  std::mutex mut;
+  std::condition_variable cv;
+  bool release = false;
+
+  const auto blocking = [&] ()
+    {
+      ++computed;
+      std::unique_lock<std::mutex> lock(mut);
+      cv.wait (lock, [&release] () { return release; });
+      return Json::Value (42);
+    };
+
+  std::vector<std::thread> threads;
+  std::atomic<unsigned> correct(0);
+  for (unsigned i = 0; i < 5; ++i)
+    threads.emplace_back ([&] ()
+      {
+        if (cache.Get ("foo", Json::Value (), blocking) == 42)
+          ++correct;
+      });
+
+  /* Give all threads the chance to start and queue up for the result.  */
+  std::this_thread::sleep_for (std::chrono::milliseconds (10));
+  {
+    std::lock_guard<std::mutex> lock(mut);
+    release = true;
+    cv.notify_all ();
+  }
+
+  for (auto& t : threads)
+    t.join ();
+
+  EXPECT_EQ (correct, 5);
+  EXPECT_EQ (computed, 1);
+}
+
+TEST_F (RpcResultCacheTests, BlockChangeDuringCompute)
+{
+  cache.SetBlock ("a");
+  EXPECT_EQ (cache.Get ("foo", Json::Value (), [this] ()
+    {
+      cache.SetBlock ("b");
+      return Json::Value (1);
+    }), 1);
+  EXPECT_EQ (cache.GetNumCached (), 0);
+}
+
+TEST_F (RpcResultCacheTests, LateCallerAfterBlockChange)
+{
+  cache.SetBlock ("a");
+
+  std::mutex mut;
+  std::condition_variable cv;
+  bool release = false;
+
+  std::thread first([&] ()
+    {
+      EXPECT_EQ (cache.Get ("foo", Json::Value (), [&] ()
+        {
+          ++computed;
+          std::unique_lock<std::mutex> lock(mut);
+          cv.wait (lock, [&release] () { return release; });
+          return Json::Value (1);
+        }), 1);
+    });
+
+  /* Wait until the first call is ongoing, then switch the block.  A new call
+     must not wait for the old computation, but compute its own result.  */
+  while (computed == 0)
+    std::this_thread::sleep_for (std::chrono::milliseconds (1));
+  cache.SetBlock ("b");
+  EXPECT_EQ (cache.Get ("foo", Json::Value (), Value (2)), 2);
+
+  {
+    std::lock_guard<std::mutex> lock(mut);
+    release = true;
+    cv.notify_all ();
+  }
+  first.join ();
+
+  EXPECT_EQ (computed, 2);
+  EXPECT_EQ (cache.Get ("foo", Json::Value (), Value (3)), 2);
+}
+
+class RpcResultCacheLimitTests : public RpcResultCacheTests
+{
+
+protected:
+
+  /**
+   * Returns a compute function that yields a string of the given length.
+   */
+  static RpcResultCache::Compute
+  String (const size_t len)
+  {
+    return [len] ()
+      {
+        return Json::Value (std::string (len, 'x'));
+      };
+  }
+
+};
+
+TEST_F (RpcResultCacheLimitTests, MaxEntries)
+{
+  cache.SetBlock ("a");
+  for (int i = 0; i < 15; ++i)
+    cache.Get ("foo", i, Value (i));
+  EXPECT_EQ (cache.GetNumCached (), 10);
+
+  /* The oldest results have been evicted.  */
+  EXPECT_EQ (cache.Get ("foo", 14, Value (-1)), 14);
+  EXPECT_EQ (cache.Get ("foo", 5, Value (-1)), 5);
+  EXPECT_EQ (cache.Get ("foo", 4, Value (-1)), -1);
+}
+
+TEST_F (RpcResultCacheLimitTests, LeastRecentlyUsedEvicted)
+{
+  cache.SetBlock ("a");
+  for (int i = 0; i < 10; ++i)
+    cache.Get ("foo", i, Value (i));
+
+  /* Use the first entry again, so that the second one is evicted
+     by the next new result.  */
+  EXPECT_EQ (cache.Get ("foo", 0, Value (-1)), 0);
+  cache.Get ("foo", 10, Value (10));
+
+  EXPECT_EQ (cache.Get ("foo", 0, Value (-1)), 0);
+  EXPECT_EQ (cache.Get ("foo", 1, Value (-1)), -1);
+}
+
+TEST_F (RpcResultCacheLimitTests, MaxBytes)
+{
+  cache.SetBlock ("a");
+  cache.Get ("a", Json::Value (), String (400));
+  cache.Get ("b", Json::Value (), String (400));
+  EXPECT_EQ (cache.GetNumCached (), 2);
+
+  cache.Get ("c", Json::Value (), String (400));
+  EXPECT_EQ (cache.GetNumCached (), 2);
+  EXPECT_LE (cache.GetCachedBytes (), 1'000);
+  EXPECT_EQ (cache.Get ("a", Json::Value (), Value (1)), 1);
+}
+
+TEST_F (RpcResultCacheLimitTests, TooLargeResult)
+{
+  cache.SetBlock ("a");
+  cache.Get ("a", Json::Value (), String (100));
+  EXPECT_EQ (cache.Get ("b", Json::Value (), String (2'000)).asString ().size (),
+             2'000);
+  EXPECT_EQ (cache.GetNumCached (), 1);
+
+  cache.SetBlock ("b");
+  EXPECT_EQ (cache.GetNumCached (), 0);
+  EXPECT_EQ (cache.GetCachedBytes (), 0);
+}
+
+} // anonymous namespace
+} // namespace pxd
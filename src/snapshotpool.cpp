@@ -0,0 +1,107 @@
+/*
+    GSP for the Taurion blockchain game
+    Copyright (C) 2021  Autonomous Worlds Ltd
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#include "snapshotpool.hpp"
+
+#include <glog/logging.h>
+
+#include <sqlite3.h>
+
+namespace pxd
+{
+
+SnapshotPool::SnapshotPool (const std::string& f, const unsigned n)
+  : file(f), maxIdle(n)
+{
+  LOG (INFO)
+      << "Using read-only snapshots of " << file
+      << " with up to " << maxIdle << " idle connections";
+}
+
+std::unique_ptr<SnapshotPool::Snapshot>
+SnapshotPool::Acquire ()
+{
+  std::unique_ptr<xaya::SQLiteDatabase> conn;
+  {
+    std::lock_guard<std::mutex> lock(mut);
+    if (!idle.empty ())
+      {
+        conn = std::move (idle.back ());
+        idle.pop_back ();
+      }
+  }
+
+  if (conn == nullptr)
+    {
+      VLOG (1) << "Opening new read-only connection to " << file;
+      conn = std::make_unique<xaya::SQLiteDatabase> (
+          file, SQLITE_OPEN_READONLY | SQLITE_OPEN_NOMUTEX);
+    }
+
+  /* In WAL mode, the snapshot a read transaction sees is fixed by its
+     first read rather than the BEGIN, so we need to read something.  */
+  conn->Execute (R"(
+    BEGIN;
+    SELECT COUNT (*) FROM `sqlite_master`;
+  )");
+
+  return std::unique_ptr<Snapshot> (new Snapshot (*this, std::move (conn)));
+}
+
+void
+SnapshotPool::Release (std::unique_ptr<xaya::SQLiteDatabase> conn)
+{
+  std::lock_guard<std::mutex> lock(mut);
+  if (idle.size () < maxIdle)
+    idle.push_back (std::move (conn));
+}
+
+unsigned
+SnapshotPool::GetNumIdle ()
+{
+  std::lock_guard<std::mutex> lock(mut);
+  return idle.size ();
+}
+
+SnapshotPool::Snapshot::Snapshot (SnapshotPool& p,
+                                  std::unique_ptr<xaya::SQLiteDatabase> c)
+  : pool(p), conn(std::move (c))
+{
+  SetDatabase (*conn);
+}
+
+SnapshotPool::Snapshot::~Snapshot ()
+{
+  conn->Execute ("ROLLBACK");
+  pool.Release (std::move (conn));
+}
+
+Database::IdT
+SnapshotPool::Snapshot::GetNextId ()
+{
+  LOG (FATAL) << "Database snapshots cannot give out IDs";
+}
+
+Database::IdT
+SnapshotPool::Snapshot::GetLogId ()
+{
+  LOG (FATAL) << "Database snapshots cannot give out IDs";
+}
+
+} // namespace pxd
@@ -0,0 +1,141 @@
+/*
+    GSP for the Taurion blockchain game
+    Copyright (C) 2021  Autonomous Worlds Ltd
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef PXD_SNAPSHOTPOOL_HPP
+#define PXD_SNAPSHOTPOOL_HPP
+
+#include "database/database.hpp"
+
+#include <xayagame/sqlitestorage.hpp>
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace pxd
+{
+
+/**
+ * Pool of read-only SQLite connections to the game-state database file.
+ * Each connection handed out is inside a read transaction, so that it
+ * sees the database as it was when acquired, even while new blocks
+ * are written through the main connection.  This requires the database
+ * to be in WAL mode.
+ *
+ * Connections are opened on demand; up to a fixed number of idle ones are
+ * kept around for reuse (together with their prepared statements).
+ */
+class SnapshotPool
+{
+
+public:
+
+  class Snapshot;
+
+private:
+
+  /** The database file to open.  */
+  const std::string file;
+
+  /** Maximum number of idle connections to keep.  */
+  const unsigned maxIdle;
+
+  /** Lock for the list of idle connections.  */
+  std::mutex mut;
+
+  /** Idle connections that can be reused.  */
+  std::vector<std::unique_ptr<xaya::SQLiteDatabase>> idle;
+
+  /**
+   * Puts a connection (with the read transaction already ended) back
+   * into the idle list, or closes it if there are enough idle ones.
+   */
+  void Release (std::unique_ptr<xaya::SQLiteDatabase> conn);
+
+public:
+
+  explicit SnapshotPool (const std::string& f, unsigned n);
+
+  SnapshotPool () = delete;
+  SnapshotPool (const SnapshotPool&) = delete;
+  void operator= (const SnapshotPool&) = delete;
+
+  /**
+   * Returns a snapshot of the current database state.  To make sure the
+   * snapshot corresponds to the last committed block, this must be called
+   * while the main connection has no write transaction open (i.e. with
+   * the game lock held).  The returned instance can then be used without
+   * holding any lock.
+   */
+  std::unique_ptr<Snapshot> Acquire ();
+
+  /**
+   * Returns the maximum number of idle connections kept.  Callers that
+   * need several snapshots at once should not use more than this, so that
+   * the connections are reused rather than opened and closed each time.
+   */
+  unsigned
+  GetMaxIdle () const
+  {
+    return maxIdle;
+  }
+
+  /**
+   * Returns the number of currently idle connections.  This is mainly
+   * useful for testing.
+   */
+  unsigned GetNumIdle ();
+
+};
+
+/**
+ * A read-only snapshot of the database, backed by a connection from
+ * a SnapshotPool.  When destructed, the read transaction is ended and
+ * the connection returned to the pool.
+ */
+class SnapshotPool::Snapshot : public Database
+{
+
+private:
+
+  /** The pool this belongs to.  */
+  SnapshotPool& pool;
+
+  /** The connection with an open read transaction.  */
+  std::unique_ptr<xaya::SQLiteDatabase> conn;
+
+  explicit Snapshot (SnapshotPool& p,
+                     std::unique_ptr<xaya::SQLiteDatabase> c);
+
+  friend class SnapshotPool;
+
+public:
+
+  ~Snapshot ();
+
+  /* Snapshots are read-only, so no IDs can be handed out.  */
+  IdT GetNextId () override;
+  IdT GetLogId () override;
+
+};
+
+} // namespace pxd
+
+#endif // PXD_SNAPSHOTPOOL_HPP
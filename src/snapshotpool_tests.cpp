@@ -0,0 +1,146 @@
+/*
+    GSP for the Taurion blockchain game
+    Copyright (C) 2021  Autonomous Worlds Ltd
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#include "snapshotpool.hpp"
+
+#include <gtest/gtest.h>
+
+#include <glog/logging.h>
+
+#include <sqlite3.h>
+
+#include <cstdio>
+#include <string>
+
+namespace pxd
+{
+namespace
+{
+
+struct CountResult : public Database::ResultType
+{
+  RESULT_COLUMN (int64_t, cnt, 1);
+};
+
+class SnapshotPoolTests : public testing::Test
+{
+
+protected:
+
+  /** Temporary database file used for the test.  */
+  const std::string file;
+
+  /** Main read-write connection to the database.  */
+  std::unique_ptr<xaya::SQLiteDatabase> main;
+
+  SnapshotPool pool;
+
+  SnapshotPoolTests ()
+    : file(testing::TempDir () + "snapshotpool_tests.sqlite"),
+      pool(file, 2)
+  {
+    std::remove (file.c_str ());
+    main = std::make_unique<xaya::SQLiteDatabase> (
+        file, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE);
+    main->Execute (R"(
+      PRAGMA `journal_mode` = WAL;
+      CREATE TABLE `test` (`id` INTEGER PRIMARY KEY);
+    )");
+  }
+
+  ~SnapshotPoolTests ()
+  {
+    main.reset ();
+    for (const std::string suffix : {"", "-wal", "-shm"})
+      std::remove ((file + suffix).c_str ());
+  }
+
+  /**
+   * Inserts a new row into the test table on the main connection.
+   */
+  void
+  Insert ()
+  {
+    main->Execute ("INSERT INTO `test` DEFAULT VALUES");
+  }
+
+  /**
+   * Counts the rows in the test table as seen by a snapshot.
+   */
+  static int64_t
+  CountRows (Database& db)
+  {
+    auto stmt = db.Prepare ("SELECT COUNT (*) AS `cnt` FROM `test`");
+    auto res = stmt.Query<CountResult> ();
+    CHECK (res.Step ());
+    const int64_t cnt = res.Get<CountResult::cnt> ();
+    CHECK (!res.Step ());
+    return cnt;
+  }
+
+};
+
+TEST_F (SnapshotPoolTests, SeesStateWhenAcquired)
+{
+  Insert ();
+  auto snapshot = pool.Acquire ();
+
+  Insert ();
+  Insert ();
+  EXPECT_EQ (CountRows (*snapshot), 1);
+
+  auto snapshot2 = pool.Acquire ();
+  EXPECT_EQ (CountRows (*snapshot2), 3);
+
+  Insert ();
+  EXPECT_EQ (CountRows (*snapshot), 1);
+  EXPECT_EQ (CountRows (*snapshot2), 3);
+}
+
+TEST_F (SnapshotPoolTests, WritesNotBlocked)
+{
+  auto snapshot = pool.Acquire ();
+  EXPECT_EQ (CountRows (*snapshot), 0);
+
+  main->Execute ("BEGIN");
+  Insert ();
+  main->Execute ("COMMIT");
+
+  EXPECT_EQ (CountRows (*snapshot), 0);
+}
+
+TEST_F (SnapshotPoolTests, ConnectionReuse)
+{
+  EXPECT_EQ (pool.GetNumIdle (), 0);
+
+  {
+    auto s1 = pool.Acquire ();
+    auto s2 = pool.Acquire ();
+    auto s3 = pool.Acquire ();
+  }
+  EXPECT_EQ (pool.GetNumIdle (), 2);
+
+  Insert ();
+  auto snapshot = pool.Acquire ();
+  EXPECT_EQ (pool.GetNumIdle (), 1);
+  EXPECT_EQ (CountRows (*snapshot), 1);
+}
+
+} // anonymous namespace
+} // namespace pxd
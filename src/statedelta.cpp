@@ -0,0 +1,290 @@
+/*
+    GSP for the Taurion blockchain game
+    Copyright (C) 2021  Autonomous Worlds Ltd
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#include "statedelta.hpp"
+
+#include "jsonstream.hpp"
+#include "jsonutils.hpp"
+
+#include <glog/logging.h>
+
+#include <algorithm>
+#include <iterator>
+#include <set>
+#include <utility>
+#include <vector>
+
+namespace pxd
+{
+
+void
+StateChangeLog::Record (const xaya::uint256& hash, const xaya::uint256& parent,
+                        StateChanges&& changes)
+{
+  std::lock_guard<std::mutex> lock(mut);
+
+  Block b;
+  b.hash = hash;
+  b.parent = parent;
+  b.changes = std::move (changes);
+  blocks.push_back (std::move (b));
+
+  while (blocks.size () > maxBlocks)
+    blocks.pop_front ();
+}
+
+bool
+StateChangeLog::Collect (const xaya::uint256& from, const xaya::uint256& to,
+                         StateChanges& out) const
+{
+  std::lock_guard<std::mutex> lock(mut);
+
+  /* We walk back from "to" along the parent links.  If a block was attached
+     more than once (after a reorg), the newest entry is the relevant one,
+     so we search from the back.  Each step goes back at least one block
+     in height, so we can stop after as many steps as blocks are kept.  */
+  xaya::uint256 cur = to;
+  for (size_t steps = 0; steps <= blocks.size (); ++steps)
+    {
+      if (cur == from)
+        return true;
+
+      auto it = blocks.rbegin ();
+      while (it != blocks.rend () && !(it->hash == cur))
+        ++it;
+      if (it == blocks.rend ())
+        return false;
+
+      out.Merge (it->changes);
+      cur = it->parent;
+    }
+
+  return false;
+}
+
+const std::map<std::string, std::string>&
+StateDeltaTracker::Sections ()
+{
+  static const std::map<std::string, std::string> sections = {
+    {"accounts", "name"},
+    {"buildings", "id"},
+    {"characters", "id"},
+    {"groundloot", "position"},
+    {"regions", "id"},
+  };
+
+  return sections;
+}
+
+namespace
+{
+
+/**
+ * Returns the JSON values of the keys (as used in the state JSON)
+ * of the changed entries of each section.
+ */
+std::map<std::string, std::vector<Json::Value>>
+ChangedKeys (const StateChanges& changes)
+{
+  std::map<std::string, std::vector<Json::Value>> res;
+
+  auto& accounts = res["accounts"];
+  for (const auto& name : changes.accounts)
+    accounts.push_back (name);
+
+  auto& buildings = res["buildings"];
+  for (const auto id : changes.buildings)
+    buildings.push_back (IntToJson (id));
+
+  auto& characters = res["characters"];
+  for (const auto id : changes.characters)
+    characters.push_back (IntToJson (id));
+
+  auto& loot = res["groundloot"];
+  for (const auto& pos : changes.groundLoot)
+    loot.push_back (CoordToJson (pos));
+
+  auto& regions = res["regions"];
+  for (const auto id : changes.regions)
+    regions.push_back (IntToJson (id));
+
+  return res;
+}
+
+/**
+ * Compares two keys of entries in a state section in the order in which
+ * the database queries return them:  Account names as strings, IDs
+ * numerically and ground-loot positions by x and then y.
+ */
+bool
+StateKeyLess (const Json::Value& a, const Json::Value& b)
+{
+  if (a.isObject ())
+    {
+      const Json::Int64 ax = a["x"].asInt64 ();
+      const Json::Int64 bx = b["x"].asInt64 ();
+      if (ax != bx)
+        return ax < bx;
+      return a["y"].asInt64 () < b["y"].asInt64 ();
+    }
+
+  if (a.isString ())
+    return a.asString () < b.asString ();
+
+  return a.asUInt64 () < b.asUInt64 ();
+}
+
+} // anonymous namespace
+
+const Json::Value&
+StateDeltaTracker::Update (GameStateJson& gsj, const xaya::uint256& hash,
+                           const unsigned height)
+{
+  if (hasLastBlock && hash == lastBlock)
+    return lastDelta;
+
+  lastDelta = Json::Value (Json::objectValue);
+  lastDelta["blockhash"] = hash.ToHex ();
+  lastDelta["height"] = IntToJson (height);
+  lastDelta["previous"] = Json::Value ();
+
+  StateChanges changes;
+  const bool haveChanges
+      = hasLastBlock && log.Collect (lastBlock, hash, changes);
+
+  const xaya::uint256 previous = lastBlock;
+  hasLastBlock = true;
+  lastBlock = hash;
+
+  if (!haveChanges)
+    {
+      VLOG (1) << "No state changes known up to block " << hash.ToHex ();
+      return lastDelta;
+    }
+  if (changes.Size () > maxEntries)
+    {
+      VLOG (1)
+          << "Too many changed entries (" << changes.Size ()
+          << ") for state delta to block " << hash.ToHex ();
+      return lastDelta;
+    }
+
+  const Json::Value entries = gsj.StateEntries (changes);
+  const auto keys = ChangedKeys (changes);
+
+  Json::Value sections(Json::objectValue);
+  for (const auto& sec : Sections ())
+    {
+      const Json::Value& updated = entries[sec.first];
+      std::set<std::string> existing;
+      for (const auto& entry : updated)
+        existing.insert (SerialiseJson (entry[sec.second]));
+
+      Json::Value removed(Json::arrayValue);
+      for (const auto& key : keys.at (sec.first))
+        if (existing.count (SerialiseJson (key)) == 0)
+          removed.append (key);
+
+      if (updated.empty () && removed.empty ())
+        continue;
+
+      Json::Value secDelta(Json::objectValue);
+      secDelta["updated"] = updated;
+      secDelta["removed"] = removed;
+      sections[sec.first] = secDelta;
+    }
+
+  lastDelta["previous"] = previous.ToHex ();
+  lastDelta["delta"] = sections;
+
+  return lastDelta;
+}
+
+bool
+ApplyStateDelta (const Json::Value& delta, Json::Value& state)
+{
+  const Json::Value& previous = delta["previous"];
+  if (previous.isNull () || !state.isObject ()
+        || state["blockhash"] != previous)
+    return false;
+
+  Json::Value& data = state["data"];
+  const Json::Value& sections = delta["delta"];
+  for (const auto& sec : StateDeltaTracker::Sections ())
+    {
+      if (!sections.isMember (sec.first))
+        continue;
+      const Json::Value& secDelta = sections[sec.first];
+
+      std::set<std::string> removed;
+      for (const auto& key : secDelta["removed"])
+        removed.insert (SerialiseJson (key));
+
+      std::map<std::string, const Json::Value*> updated;
+      for (const auto& entry : secDelta["updated"])
+        updated.emplace (SerialiseJson (entry[sec.second]), &entry);
+
+      std::vector<const Json::Value*> kept;
+      for (const auto& entry : data[sec.first])
+        {
+          const std::string key = SerialiseJson (entry[sec.second]);
+          if (removed.count (key) > 0)
+            continue;
+
+          const auto mit = updated.find (key);
+          if (mit == updated.end ())
+            kept.push_back (&entry);
+          else
+            {
+              kept.push_back (mit->second);
+              updated.erase (mit);
+            }
+        }
+
+      /* Entries that are left in updated are new.  They are merged in at
+         the position that the server's ORDER BY would put them, so that
+         locally answered queries match the forwarded ones.  */
+      const auto less = [&sec] (const Json::Value* a, const Json::Value* b)
+        {
+          return StateKeyLess ((*a)[sec.second], (*b)[sec.second]);
+        };
+      std::vector<const Json::Value*> added;
+      for (const auto& entry : secDelta["updated"])
+        if (updated.count (SerialiseJson (entry[sec.second])) > 0)
+          added.push_back (&entry);
+      std::sort (added.begin (), added.end (), less);
+
+      std::vector<const Json::Value*> merged;
+      merged.reserve (kept.size () + added.size ());
+      std::merge (kept.begin (), kept.end (), added.begin (), added.end (),
+                  std::back_inserter (merged), less);
+
+      Json::Value result(Json::arrayValue);
+      for (const auto* entry : merged)
+        result.append (*entry);
+      data[sec.first] = result;
+    }
+
+  state["blockhash"] = delta["blockhash"];
+  state["height"] = delta["height"];
+
+  return true;
+}
+
+} // namespace pxd
@@ -0,0 +1,192 @@
+/*
+    GSP for the Taurion blockchain game
+    Copyright (C) 2021  Autonomous Worlds Ltd
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef PXD_STATEDELTA_HPP
+#define PXD_STATEDELTA_HPP
+
+#include "gamestatejson.hpp"
+
+#include "database/statechanges.hpp"
+
+#include <xayautil/uint256.hpp>
+
+#include <json/json.h>
+
+#include <cstddef>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+
+namespace pxd
+{
+
+/**
+ * Log of the StateChanges recorded while processing the most recent blocks,
+ * keyed by block hash.  This is filled in by PXLogic when attaching blocks
+ * and used to compute deltas of the state between two blocks.  Only a fixed
+ * number of blocks is kept.
+ *
+ * This class is thread-safe.
+ */
+class StateChangeLog
+{
+
+private:
+
+  /** Data stored about each block.  */
+  struct Block
+  {
+
+    /** The block's hash.  */
+    xaya::uint256 hash;
+
+    /** The block's parent hash.  */
+    xaya::uint256 parent;
+
+    /** The changes done when attaching the block.  */
+    StateChanges changes;
+
+  };
+
+  /** Maximum number of blocks to keep.  */
+  const size_t maxBlocks;
+
+  /** The recorded blocks, oldest first.  */
+  std::deque<Block> blocks;
+
+  /** Lock for this instance.  */
+  mutable std::mutex mut;
+
+public:
+
+  explicit StateChangeLog (const size_t n)
+    : maxBlocks(n)
+  {}
+
+  StateChangeLog () = delete;
+  StateChangeLog (const StateChangeLog&) = delete;
+  void operator= (const StateChangeLog&) = delete;
+
+  /**
+   * Records the changes done when attaching a block.
+   */
+  void Record (const xaya::uint256& hash, const xaya::uint256& parent,
+               StateChanges&& changes);
+
+  /**
+   * Collects the changes done by all blocks on the chain leading from
+   * "from" (exclusive) to "to" (inclusive) into out.  Returns false if
+   * that chain is not fully in the log, e.g. because "from" is too old
+   * or was detached in a reorg.
+   */
+  bool Collect (const xaya::uint256& from, const xaya::uint256& to,
+                StateChanges& out) const;
+
+};
+
+/**
+ * Computes deltas of the game state between blocks (of the sections with
+ * entries that can be identified by some key, like characters).  The deltas
+ * are based on the entries that were modified according to a
+ * StateChangeLog, so only those entries are read from the database.
+ * The deltas can then be sent to clients, which apply them to their cached
+ * state with ApplyStateDelta instead of fetching the full state again.
+ *
+ * A delta has the form:
+ *
+ *  {
+ *    "blockhash": "new block",
+ *    "height": 42,
+ *    "previous": "block the delta is relative to, or null",
+ *    "delta":
+ *      {
+ *        "characters": {"updated": [...entries...], "removed": [...keys...]},
+ *        ...
+ *      }
+ *  }
+ *
+ * Only sections with changes are included.  If "previous" is null, then
+ * there is no "delta" either.  This is sent whenever no delta can be
+ * computed (e.g. for the first update, after reorgs or if there are too
+ * many changes), and clients have to fetch the full state themselves.
+ */
+class StateDeltaTracker
+{
+
+private:
+
+  /** The log of changes we use.  */
+  const StateChangeLog& log;
+
+  /**
+   * Maximum number of changed entries in a delta.  If there are more,
+   * we send a delta without data instead, to bound the message size.
+   */
+  const size_t maxEntries;
+
+  /** Whether or not there was an update already.  */
+  bool hasLastBlock = false;
+
+  /** The block hash of the last update.  */
+  xaya::uint256 lastBlock;
+
+  /** The delta returned from the last update.  */
+  Json::Value lastDelta;
+
+public:
+
+  explicit StateDeltaTracker (const StateChangeLog& l, const size_t m)
+    : log(l), maxEntries(m)
+  {}
+
+  StateDeltaTracker () = delete;
+  StateDeltaTracker (const StateDeltaTracker&) = delete;
+  void operator= (const StateDeltaTracker&) = delete;
+
+  /**
+   * Returns the tracked sections of the game state, mapped to the name of
+   * the field in each entry that identifies it.
+   */
+  static const std::map<std::string, std::string>& Sections ();
+
+  /**
+   * Returns the delta from the last update to the state at the given block,
+   * which is read from the GameStateJson instance.  If the block is the
+   * same as in the last update, the last delta is returned again.
+   */
+  const Json::Value& Update (GameStateJson& gsj, const xaya::uint256& hash,
+                             unsigned height);
+
+};
+
+/**
+ * Applies a delta as produced by StateDeltaTracker to a cached state, which
+ * has the form of a custom-state result with "blockhash", "height" and the
+ * sections in "data".  Returns false (and leaves the state unchanged) if the
+ * delta is not relative to the cached state's block, in which case the full
+ * state needs to be fetched again.  The arrays are kept in the order in
+ * which the server returns them (by the section's key), so new entries
+ * are inserted at their sorted position.
+ */
+bool ApplyStateDelta (const Json::Value& delta, Json::Value& state);
+
+} // namespace pxd
+
+#endif // PXD_STATEDELTA_HPP
@@ -0,0 +1,363 @@
+/*
+    GSP for the Taurion blockchain game
+    Copyright (C) 2021  Autonomous Worlds Ltd
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "statedelta.hpp"
+
+#include "testutils.hpp"
+
+#include "database/account.hpp"
+#include "database/character.hpp"
+#include "database/dbtest.hpp"
+#include "database/inventory.hpp"
+
+#include <xayautil/hash.hpp>
+
+#include <gtest/gtest.h>
+
+#include <json/json.h>
+
+namespace pxd
+{
+namespace
+{
+
+/**
+ * Returns a fake block hash for the given name.
+ */
+xaya::uint256
+Block (const std::string& name)
+{
+  return xaya::SHA256::Hash (name);
+}
+
+/* ************************************************************************** */
+
+class StateChangeLogTests : public testing::Test
+{
+
+protected:
+
+  StateChangeLog log;
+
+  StateChangeLogTests ()
+    : log(3)
+  {}
+
+  /**
+   * Records a block with the given characters changed.
+   */
+  void
+  Record (const std::string& hash, const std::string& parent,
+          const std::set<Database::IdT>& characters)
+  {
+    StateChanges changes;
+    changes.characters = characters;
+    log.Record (Block (hash), Block (parent), std::move (changes));
+  }
+
+  /**
+   * Collects the changed characters between two blocks, expecting that
+   * it succeeds.
+   */
+  std::set<Database::IdT>
+  Collect (const std::string& from, const std::string& to)
+  {
+    StateChanges changes;
+    EXPECT_TRUE (log.Collect (Block (from), Block (to), changes));
+    return changes.characters;
+  }
+
+  /**
+   * Returns true if changes can be collected between the blocks.
+   */
+  bool
+  CanCollect (const std::string& from, const std::string& to)
+  {
+    StateChanges changes;
+    return log.Collect (Block (from), Block (to), changes);
+  }
+
+};
+
+TEST_F (StateChangeLogTests, Chain)
+{
+  Record ("b", "a", {1});
+  Record ("c", "b", {2});
+  Record ("d", "c", {1, 3});
+
+  EXPECT_EQ (Collect ("d", "d"), std::set<Database::IdT> ({}));
+  EXPECT_EQ (Collect ("c", "d"), std::set<Database::IdT> ({1, 3}));
+  EXPECT_EQ (Collect ("b", "d"), std::set<Database::IdT> ({1, 2, 3}));
+  EXPECT_EQ (Collect ("a", "c"), std::set<Database::IdT> ({1, 2}));
+
+  EXPECT_FALSE (CanCollect ("d", "c"));
+  EXPECT_FALSE (CanCollect ("x", "d"));
+}
+
+TEST_F (StateChangeLogTests, OldBlocksDropped)
+{
+  Record ("b", "a", {1});
+  Record ("c", "b", {2});
+  Record ("d", "c", {3});
+  Record ("e", "d", {4});
+
+  EXPECT_FALSE (CanCollect ("a", "e"));
+  EXPECT_EQ (Collect ("b", "e"), std::set<Database::IdT> ({2, 3, 4}));
+}
+
+TEST_F (StateChangeLogTests, Reorg)
+{
+  Record ("b", "a", {1});
+  Record ("c", "b", {2});
+  Record ("c2", "b", {3});
+
+  EXPECT_FALSE (CanCollect ("c", "c2"));
+  EXPECT_EQ (Collect ("b", "c2"), std::set<Database::IdT> ({3}));
+
+  /* Attaching the same block again replaces the older data.  */
+  Record ("c", "b", {4});
+  EXPECT_EQ (Collect ("b", "c"), std::set<Database::IdT> ({4}));
+}
+
+/* ************************************************************************** */
+
+class StateDeltaTests : public DBTestWithSchema
+{
+
+protected:
+
+  ContextForTesting ctx;
+  GameStateJson gsj;
+
+  StateChangeLog log;
+  StateDeltaTracker tracker;
+
+  AccountsTable accounts;
+  CharacterTable characters;
+  GroundLootTable loot;
+
+  /** Changes recorded for the next block.  */
+  StateChanges changes;
+
+  /** Height of the last block.  */
+  unsigned height = 10;
+
+  /** The last block hash.  */
+  std::string lastBlock = "genesis";
+
+  StateDeltaTests ()
+    : gsj(db, ctx), log(10), tracker(log, 10),
+      accounts(db), characters(db), loot(db)
+  {
+    db.TrackChanges (&changes);
+  }
+
+  ~StateDeltaTests ()
+  {
+    db.TrackChanges (nullptr);
+  }
+
+  /**
+   * Finishes the current block, recording it in the log and returning
+   * the delta for it from the tracker.
+   */
+  Json::Value
+  FinishBlock (const std::string& hash)
+  {
+    log.Record (Block (hash), Block (lastBlock), std::move (changes));
+    changes = StateChanges ();
+
+    lastBlock = hash;
+    ++height;
+
+    return tracker.Update (gsj, Block (hash), height);
+  }
+
+  /**
+   * Returns the current state in the form of a custom-state result with
+   * the tracked sections.
+   */
+  Json::Value
+  CurrentState ()
+  {
+    Json::Value res(Json::objectValue);
+    res["blockhash"] = Block (lastBlock).ToHex ();
+    res["height"] = height;
+    res["data"] = Json::Value (Json::objectValue);
+    res["data"]["accounts"] = gsj.Accounts ();
+    res["data"]["buildings"] = gsj.Buildings ();
+    res["data"]["characters"] = gsj.Characters ();
+    res["data"]["groundloot"] = gsj.GroundLoot ();
+    res["data"]["regions"] = gsj.Regions (0);
+
+    return res;
+  }
+
+};
+
+TEST_F (StateDeltaTests, FirstUpdateHasNoData)
+{
+  accounts.CreateNew ("domob");
+  const Json::Value delta = FinishBlock ("a");
+
+  EXPECT_EQ (delta["blockhash"], Block ("a").ToHex ());
+  EXPECT_EQ (delta["height"].asUInt (), 11);
+  EXPECT_TRUE (delta["previous"].isNull ());
+  EXPECT_FALSE (delta.isMember ("delta"));
+
+  Json::Value cached = CurrentState ();
+  EXPECT_FALSE (ApplyStateDelta (delta, cached));
+}
+
+TEST_F (StateDeltaTests, ChangedEntries)
+{
+  accounts.CreateNew ("domob");
+  const auto id1 = characters.CreateNew ("domob", Faction::RED)->GetId ();
+  const auto id2 = characters.CreateNew ("domob", Faction::RED)->GetId ();
+  FinishBlock ("a");
+  Json::Value cached = CurrentState ();
+
+  characters.GetById (id2)->MutableHP ().set_armour (42);
+  characters.DeleteById (id1);
+  const auto id3 = characters.CreateNew ("domob", Faction::RED)->GetId ();
+  loot.GetByCoord (HexCoord (1, 2))->GetInventory ()
+      .AddFungibleCount ("foo", 5);
+
+  const Json::Value delta = FinishBlock ("b");
+  EXPECT_EQ (delta["previous"], Block ("a").ToHex ());
+  EXPECT_EQ (delta["blockhash"], Block ("b").ToHex ());
+
+  const auto& sections = delta["delta"];
+  EXPECT_FALSE (sections.isMember ("accounts"));
+  EXPECT_FALSE (sections.isMember ("regions"));
+  const auto& chars = sections["characters"];
+  ASSERT_EQ (chars["updated"].size (), 2);
+  EXPECT_EQ (chars["updated"][0]["id"].asUInt64 (), id2);
+  EXPECT_EQ (chars["updated"][1]["id"].asUInt64 (), id3);
+  ASSERT_EQ (chars["removed"].size (), 1);
+  EXPECT_EQ (chars["removed"][0].asUInt64 (), id1);
+  EXPECT_TRUE (PartialJsonEqual (sections["groundloot"], ParseJson (R"({
+    "updated": [{"position": {"x": 1, "y": 2}}],
+    "removed": []
+  })")));
+
+  ASSERT_TRUE (ApplyStateDelta (delta, cached));
+  EXPECT_EQ (cached, CurrentState ());
+}
+
+TEST_F (StateDeltaTests, RemovedGroundLoot)
+{
+  const HexCoord pos(1, 2);
+  loot.GetByCoord (pos)->GetInventory ().AddFungibleCount ("foo", 5);
+  FinishBlock ("a");
+  Json::Value cached = CurrentState ();
+
+  loot.GetByCoord (pos)->GetInventory ().SetFungibleCount ("foo", 0);
+  const Json::Value delta = FinishBlock ("b");
+  EXPECT_EQ (delta["delta"], ParseJson (R"({
+    "groundloot": {"updated": [], "removed": [{"x": 1, "y": 2}]}
+  })"));
+
+  ASSERT_TRUE (ApplyStateDelta (delta, cached));
+  EXPECT_EQ (cached, CurrentState ());
+}
+
+TEST_F (StateDeltaTests, NewEntriesInServerOrder)
+{
+  accounts.CreateNew ("bob");
+  accounts.CreateNew ("dave");
+  loot.GetByCoord (HexCoord (1, 2))->GetInventory ()
+      .AddFungibleCount ("foo", 5);
+  FinishBlock ("a");
+  Json::Value cached = CurrentState ();
+
+  accounts.CreateNew ("eve");
+  accounts.CreateNew ("alice");
+  accounts.CreateNew ("carol");
+  for (const auto& pos : {HexCoord (2, 0), HexCoord (1, -1), HexCoord (0, 5)})
+    loot.GetByCoord (pos)->GetInventory ().AddFungibleCount ("foo", 1);
+
+  const Json::Value delta = FinishBlock ("b");
+  ASSERT_TRUE (ApplyStateDelta (delta, cached));
+  EXPECT_EQ (cached, CurrentState ());
+}
+
+TEST_F (StateDeltaTests, SameBlock)
+{
+  FinishBlock ("a");
+  accounts.CreateNew ("domob");
+  const Json::Value first = FinishBlock ("b");
+  const Json::Value second = tracker.Update (gsj, Block ("b"), height);
+  EXPECT_EQ (first, second);
+  EXPECT_EQ (first["previous"], Block ("a").ToHex ());
+}
+
+TEST_F (StateDeltaTests, TooManyChanges)
+{
+  FinishBlock ("a");
+  for (unsigned i = 0; i < 11; ++i)
+    accounts.CreateNew ("account " + std::to_string (i));
+
+  const Json::Value delta = FinishBlock ("b");
+  EXPECT_TRUE (delta["previous"].isNull ());
+  EXPECT_FALSE (delta.isMember ("delta"));
+}
+
+TEST_F (StateDeltaTests, SkippedBlocks)
+{
+  FinishBlock ("a");
+  Json::Value cached = CurrentState ();
+
+  accounts.CreateNew ("domob");
+  log.Record (Block ("b"), Block ("a"), std::move (changes));
+  changes = StateChanges ();
+  lastBlock = "b";
+  ++height;
+
+  accounts.CreateNew ("andy");
+  const Json::Value delta = FinishBlock ("c");
+  EXPECT_EQ (delta["previous"], Block ("a").ToHex ());
+  EXPECT_EQ (delta["delta"]["accounts"]["updated"].size (), 2);
+
+  ASSERT_TRUE (ApplyStateDelta (delta, cached));
+  EXPECT_EQ (cached, CurrentState ());
+}
+
+TEST_F (StateDeltaTests, MismatchedPrevious)
+{
+  FinishBlock ("a");
+  Json::Value cached = CurrentState ();
+
+  accounts.CreateNew ("domob");
+  FinishBlock ("b");
+  accounts.CreateNew ("andy");
+  const Json::Value delta = FinishBlock ("c");
+  EXPECT_EQ (delta["previous"], Block ("b").ToHex ());
+
+  const Json::Value before = cached;
+  EXPECT_FALSE (ApplyStateDelta (delta, cached));
+  EXPECT_EQ (cached, before);
+
+  Json::Value empty;
+  EXPECT_FALSE (ApplyStateDelta (delta, empty));
+}
+
+/* ************************************************************************** */
+
+} // anonymous namespace
+} // namespace pxd
@@ -45,7 +45,7 @@ namespace
 /**
  * Global test environment that constructs BaseMap instances for all
  * possible chains.  Since this construction takes some time (due to the
- * SafeZones), we do it only once rather than in each test.
+ * TileAttributes), we do it only once rather than in each test.
  */
 class BaseMapInstances : public testing::Environment
 {
@@ -0,0 +1,207 @@
+/*
+    GSP for the Taurion blockchain game
+    Copyright (C) 2021  Autonomous Worlds Ltd
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#include "trace.hpp"
+
+#include <glog/logging.h>
+
+namespace pxd
+{
+
+constexpr size_t TraceLog::DEFAULT_CAPACITY;
+
+TraceLog::TraceLog (const size_t cap)
+  : enabled(false), reference(Clock::now ()), capacity(cap)
+{
+  CHECK_GT (capacity, 0);
+}
+
+TraceLog&
+TraceLog::Get ()
+{
+  static TraceLog instance;
+  return instance;
+}
+
+unsigned
+TraceLog::GetThreadId ()
+{
+  static std::atomic<unsigned> nextId(1);
+  thread_local const unsigned id = nextId++;
+  return id;
+}
+
+void
+TraceLog::SetEnabled (const bool en, const size_t cap)
+{
+  std::lock_guard<std::mutex> lock(mut);
+
+  if (en)
+    {
+      CHECK_GT (cap, 0);
+      capacity = cap;
+      events.clear ();
+      events.reserve (capacity);
+      next = 0;
+    }
+
+  LOG (INFO) << "Tracing " << (en ? "enabled" : "disabled");
+  enabled = en;
+}
+
+void
+TraceLog::Record (const char* category, const std::string& name,
+                  const Clock::time_point start, const Clock::time_point end)
+{
+  if (!IsEnabled ())
+    return;
+
+  using std::chrono::duration_cast;
+  using std::chrono::microseconds;
+
+  Event ev;
+  ev.category = category;
+  ev.name = name;
+  ev.start = duration_cast<microseconds> (start - reference).count ();
+  ev.duration = duration_cast<microseconds> (end - start).count ();
+  ev.thread = GetThreadId ();
+
+  std::lock_guard<std::mutex> lock(mut);
+  if (events.size () < capacity)
+    events.push_back (std::move (ev));
+  else
+    events[next] = std::move (ev);
+  next = (next + 1) % capacity;
+}
+
+size_t
+TraceLog::GetNumEvents () const
+{
+  std::lock_guard<std::mutex> lock(mut);
+  return events.size ();
+}
+
+Json::Value
+TraceLog::ToJson () const
+{
+  std::lock_guard<std::mutex> lock(mut);
+
+  Json::Value arr(Json::arrayValue);
+
+  /* If the buffer is full, the oldest entry is the one that will be
+     overwritten next.  Otherwise, the events start at index zero.  */
+  const size_t first = (events.size () < capacity ? 0 : next);
+  for (size_t i = 0; i < events.size (); ++i)
+    {
+      const auto& ev = events[(first + i) % events.size ()];
+
+      Json::Value cur(Json::objectValue);
+      cur["name"] = ev.name;
+      cur["cat"] = ev.category;
+      cur["ph"] = "X";
+      cur["ts"] = static_cast<Json::Int64> (ev.start);
+      cur["dur"] = static_cast<Json::Int64> (ev.duration);
+      cur["pid"] = 1;
+      cur["tid"] = ev.thread;
+
+      arr.append (cur);
+    }
+
+  Json::Value res(Json::objectValue);
+  res["traceEvents"] = arr;
+  res["displayTimeUnit"] = "ms";
+
+  return res;
+}
+
+/* ************************************************************************** */
+
+bool
+TraceSpan::Start ()
+{
+  auto& global = TraceLog::Get ();
+  if (!global.IsEnabled ())
+    return false;
+
+  log = &global;
+  start = TraceLog::Clock::now ();
+  return true;
+}
+
+TraceSpan::TraceSpan (const char* cat, const char* nm)
+  : log(nullptr), category(cat)
+{
+  if (Start ())
+    name = nm;
+}
+
+TraceSpan::TraceSpan (const char* cat, const std::string& nm)
+  : log(nullptr), category(cat)
+{
+  if (Start ())
+    name = nm;
+}
+
+TraceSpan::~TraceSpan ()
+{
+  if (log != nullptr)
+    log->Record (category, name, start, TraceLog::Clock::now ());
+}
+
+/* ************************************************************************** */
+
+namespace
+{
+
+/**
+ * SQLite trace callback for SQLITE_TRACE_PROFILE events, which are
+ * triggered when a statement finishes and include its runtime.
+ */
+int
+SqliteProfileCallback (const unsigned type, void* ctx, void* p, void* x)
+{
+  if (type != SQLITE_TRACE_PROFILE)
+    return 0;
+
+  auto* stmt = static_cast<sqlite3_stmt*> (p);
+  const auto nanos = *static_cast<const sqlite3_int64*> (x);
+
+  const auto end = TraceLog::Clock::now ();
+  const auto start = end - std::chrono::nanoseconds (nanos);
+
+  const char* sql = sqlite3_sql (stmt);
+  TraceLog::Get ().Record ("sql", sql == nullptr ? "" : sql, start, end);
+
+  return 0;
+}
+
+} // anonymous namespace
+
+void
+TraceSqliteStatements (sqlite3* db, const bool enable)
+{
+  if (enable)
+    CHECK_EQ (sqlite3_trace_v2 (db, SQLITE_TRACE_PROFILE,
+                                &SqliteProfileCallback, nullptr),
+              SQLITE_OK);
+  else
+    CHECK_EQ (sqlite3_trace_v2 (db, 0, nullptr, nullptr), SQLITE_OK);
+}
+
+} // namespace pxd
@@ -0,0 +1,192 @@
+/*
+    GSP for the Taurion blockchain game
+    Copyright (C) 2021  Autonomous Worlds Ltd
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef PXD_TRACE_HPP
+#define PXD_TRACE_HPP
+
+#include <json/json.h>
+
+#include <sqlite3.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace pxd
+{
+
+/**
+ * Collector for trace events (timed spans of things like block-processing
+ * phases, RPC calls, SQL statements and path finding).  The events are kept
+ * in a fixed-size ring buffer, and can be exported in the Chrome trace-event
+ * JSON format (which can be loaded in chrome://tracing or Perfetto).
+ *
+ * Tracing is disabled by default and can be toggled at runtime.  While it
+ * is disabled, the cost of a span is a single atomic load.
+ */
+class TraceLog
+{
+
+public:
+
+  using Clock = std::chrono::steady_clock;
+
+  /** Default capacity of the ring buffer.  */
+  static constexpr size_t DEFAULT_CAPACITY = 100'000;
+
+private:
+
+  /** Data for a recorded event.  */
+  struct Event
+  {
+
+    /** Category of the event (must be a static string).  */
+    const char* category;
+
+    /** Name of the event.  */
+    std::string name;
+
+    /** Start time in microseconds since the reference time.  */
+    int64_t start;
+
+    /** Duration in microseconds.  */
+    int64_t duration;
+
+    /** ID of the thread the event was recorded on.  */
+    unsigned thread;
+
+  };
+
+  /** Whether or not tracing is enabled.  */
+  std::atomic<bool> enabled;
+
+  /** Reference time for the event timestamps.  */
+  const Clock::time_point reference;
+
+  /** The ring buffer of events.  */
+  std::vector<Event> events;
+
+  /** Maximum number of events to keep.  */
+  size_t capacity;
+
+  /** Index of the next event to write in the ring buffer.  */
+  size_t next = 0;
+
+  /** Lock for the ring buffer.  */
+  mutable std::mutex mut;
+
+  /**
+   * Returns a small integer ID for the calling thread.
+   */
+  static unsigned GetThreadId ();
+
+public:
+
+  explicit TraceLog (size_t cap = DEFAULT_CAPACITY);
+
+  TraceLog (const TraceLog&) = delete;
+  void operator= (const TraceLog&) = delete;
+
+  /**
+   * Returns the process-wide instance.
+   */
+  static TraceLog& Get ();
+
+  bool
+  IsEnabled () const
+  {
+    return enabled.load (std::memory_order_relaxed);
+  }
+
+  /**
+   * Enables or disables tracing.  When it is enabled, the ring buffer is
+   * cleared and resized to the given capacity.
+   */
+  void SetEnabled (bool en, size_t cap = DEFAULT_CAPACITY);
+
+  /**
+   * Records an event with the given start and end time, if tracing
+   * is enabled.
+   */
+  void Record (const char* category, const std::string& name,
+               Clock::time_point start, Clock::time_point end);
+
+  /**
+   * Returns the number of events currently in the buffer.
+   */
+  size_t GetNumEvents () const;
+
+  /**
+   * Exports all recorded events (oldest first) as Chrome trace JSON.
+   */
+  Json::Value ToJson () const;
+
+};
+
+/**
+ * RAII span that records a trace event from its construction to its
+ * destruction (if tracing is enabled when it is constructed).
+ */
+class TraceSpan
+{
+
+private:
+
+  /** The trace log to record to, or null if tracing is disabled.  */
+  TraceLog* log;
+
+  /** Category of the event.  */
+  const char* category;
+
+  /** Name of the event.  */
+  std::string name;
+
+  /** Start time of the span.  */
+  TraceLog::Clock::time_point start;
+
+  /**
+   * Starts the span if tracing is enabled, and returns true in that case.
+   */
+  bool Start ();
+
+public:
+
+  explicit TraceSpan (const char* cat, const char* nm);
+  explicit TraceSpan (const char* cat, const std::string& nm);
+
+  ~TraceSpan ();
+
+  TraceSpan () = delete;
+  TraceSpan (const TraceSpan&) = delete;
+  void operator= (const TraceSpan&) = delete;
+
+};
+
+/**
+ * Installs (or removes) an SQLite profiling callback on the given connection
+ * that records each executed statement as trace event.
+ */
+void TraceSqliteStatements (sqlite3* db, bool enable);
+
+} // namespace pxd
+
+#endif // PXD_TRACE_HPP
@@ -0,0 +1,156 @@
+/*
+    GSP for the Taurion blockchain game
+    Copyright (C) 2021  Autonomous Worlds Ltd
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#include "trace.hpp"
+
+#include <gtest/gtest.h>
+
+#include <sqlite3.h>
+
+#include <string>
+
+namespace pxd
+{
+namespace
+{
+
+/**
+ * Test fixture that enables the global trace log for the duration
+ * of the test, with a small capacity.
+ */
+class TraceTests : public testing::Test
+{
+
+protected:
+
+  TraceLog& log;
+
+  TraceTests ()
+    : log(TraceLog::Get ())
+  {
+    log.SetEnabled (true, 3);
+  }
+
+  ~TraceTests ()
+  {
+    log.SetEnabled (false);
+  }
+
+  /**
+   * Records an event with the given name (and zero duration).
+   */
+  void
+  RecordEvent (const std::string& name)
+  {
+    const auto now = TraceLog::Clock::now ();
+    log.Record ("test", name, now, now);
+  }
+
+};
+
+TEST_F (TraceTests, DisabledIsNoop)
+{
+  log.SetEnabled (false);
+  RecordEvent ("foo");
+  {
+    const TraceSpan span("test", "bar");
+  }
+  EXPECT_EQ (log.GetNumEvents (), 0);
+}
+
+TEST_F (TraceTests, EnablingClearsBuffer)
+{
+  RecordEvent ("foo");
+  EXPECT_EQ (log.GetNumEvents (), 1);
+  log.SetEnabled (true, 3);
+  EXPECT_EQ (log.GetNumEvents (), 0);
+}
+
+TEST_F (TraceTests, RingBuffer)
+{
+  for (const std::string name : {"a", "b", "c", "d", "e"})
+    RecordEvent (name);
+  EXPECT_EQ (log.GetNumEvents (), 3);
+
+  const auto events = log.ToJson ()["traceEvents"];
+  ASSERT_EQ (events.size (), 3);
+  EXPECT_EQ (events[0]["name"], "c");
+  EXPECT_EQ (events[1]["name"], "d");
+  EXPECT_EQ (events[2]["name"], "e");
+}
+
+TEST_F (TraceTests, JsonFormat)
+{
+  const auto start = TraceLog::Clock::now ();
+  log.Record ("cat", "foo", start, start + std::chrono::milliseconds (5));
+
+  const auto res = log.ToJson ();
+  EXPECT_EQ (res["displayTimeUnit"], "ms");
+  ASSERT_EQ (res["traceEvents"].size (), 1);
+
+  const auto& ev = res["traceEvents"][0];
+  EXPECT_EQ (ev["name"], "foo");
+  EXPECT_EQ (ev["cat"], "cat");
+  EXPECT_EQ (ev["ph"], "X");
+  EXPECT_EQ (ev["dur"].asInt64 (), 5'000);
+  EXPECT_GE (ev["ts"].asInt64 (), 0);
+  EXPECT_EQ (ev["pid"].asInt (), 1);
+  EXPECT_TRUE (ev["tid"].isUInt ());
+}
+
+TEST_F (TraceTests, Span)
+{
+  {
+    const TraceSpan span("rpc", std::string ("foo"));
+  }
+  {
+    const TraceSpan span("block", "bar");
+  }
+
+  const auto events = log.ToJson ()["traceEvents"];
+  ASSERT_EQ (events.size (), 2);
+  EXPECT_EQ (events[0]["name"], "foo");
+  EXPECT_EQ (events[0]["cat"], "rpc");
+  EXPECT_EQ (events[1]["name"], "bar");
+  EXPECT_EQ (events[1]["cat"], "block");
+  EXPECT_GE (events[1]["ts"].asInt64 (), events[0]["ts"].asInt64 ());
+}
+
+TEST_F (TraceTests, SqliteStatements)
+{
+  sqlite3* db;
+  ASSERT_EQ (sqlite3_open (":memory:", &db), SQLITE_OK);
+
+  TraceSqliteStatements (db, true);
+  ASSERT_EQ (sqlite3_exec (db, "SELECT 42", nullptr, nullptr, nullptr),
+             SQLITE_OK);
+  TraceSqliteStatements (db, false);
+  ASSERT_EQ (sqlite3_exec (db, "SELECT 1", nullptr, nullptr, nullptr),
+             SQLITE_OK);
+
+  const auto events = log.ToJson ()["traceEvents"];
+  ASSERT_EQ (events.size (), 1);
+  EXPECT_EQ (events[0]["name"], "SELECT 42");
+  EXPECT_EQ (events[0]["cat"], "sql");
+
+  sqlite3_close (db);
+}
+
+} // anonymous namespace
+} // namespace pxd
@@ -0,0 +1,351 @@
+/*
+    GSP for the Taurion blockchain game
+    Copyright (C) 2021  Autonomous Worlds Ltd
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#include "worldgen.hpp"
+
+#include "buildings.hpp"
+#include "resourcedist.hpp"
+#include "spawn.hpp"
+
+#include "database/account.hpp"
+#include "database/building.hpp"
+#include "database/character.hpp"
+#include "database/dex.hpp"
+#include "database/inventory.hpp"
+#include "database/ongoing.hpp"
+#include "database/region.hpp"
+#include "mapdata/tiledata.hpp"
+
+#include <glog/logging.h>
+
+#include <algorithm>
+#include <map>
+#include <sstream>
+
+namespace pxd
+{
+
+namespace
+{
+
+/**
+ * Number of attempts we make to find a free tile in a cluster before
+ * falling back to a uniformly chosen one.
+ */
+constexpr unsigned CLUSTER_ATTEMPTS = 100;
+
+/** Initial balance given to each generated account.  */
+constexpr Amount INITIAL_BALANCE = 1'000'000;
+
+/**
+ * Returns a random integer in the range [from, to].
+ */
+int
+RandomInRange (xaya::Random& rnd, const int from, const int to)
+{
+  CHECK_LE (from, to);
+  return from + static_cast<int> (rnd.NextInt<uint32_t> (to - from + 1));
+}
+
+} // anonymous namespace
+
+WorldGenerator::WorldGenerator (Database& d, const Context& c,
+                                xaya::Random& r)
+  : db(d), ctx(c), rnd(r), dyn(db, ctx)
+{}
+
+HexCoord
+WorldGenerator::RandomCoord ()
+{
+  using namespace tiledata;
+
+  const int y = RandomInRange (rnd, minY, maxY);
+  const int yInd = y - minY;
+  const int x = RandomInRange (rnd, minX[yInd], maxX[yInd]);
+
+  return HexCoord (x, y);
+}
+
+HexCoord
+WorldGenerator::RandomFreeTile (const bool clustered)
+{
+  const auto isFree = [this] (const HexCoord& c)
+    {
+      return ctx.Map ().IsOnMap (c) && ctx.Map ().IsPassable (c)
+                && dyn.IsFree (c);
+    };
+
+  if (clustered && !clusterCentres.empty ())
+    {
+      const auto& centre
+          = clusterCentres[rnd.NextInt (clusterCentres.size ())];
+      for (unsigned i = 0; i < CLUSTER_ATTEMPTS; ++i)
+        {
+          const auto r = clusterRadius;
+          const HexCoord c(centre.GetX () + RandomInRange (rnd, -r, r),
+                           centre.GetY () + RandomInRange (rnd, -r, r));
+          if (HexCoord::DistanceL1 (c, centre) <= r && isFree (c))
+            return c;
+        }
+    }
+
+  while (true)
+    {
+      const HexCoord c = RandomCoord ();
+      if (isFree (c))
+        return c;
+    }
+}
+
+void
+WorldGenerator::GenerateAccounts (const WorldParams& params)
+{
+  static const Faction ALL_FACTIONS[] =
+    {
+      Faction::RED, Faction::GREEN, Faction::BLUE,
+    };
+
+  AccountsTable tbl(db);
+  for (unsigned i = 0; i < params.accounts; ++i)
+    {
+      std::ostringstream name;
+      name << "player " << (accounts.size () + 1);
+
+      const Faction f = ALL_FACTIONS[rnd.NextInt<unsigned> (3)];
+      auto a = tbl.CreateNew (name.str ());
+      a->SetFaction (f);
+      a->AddBalance (INITIAL_BALANCE);
+
+      accounts.push_back (name.str ());
+      factions.push_back (f);
+    }
+}
+
+void
+WorldGenerator::GenerateBuildings (const WorldParams& params)
+{
+  /* Collect the building types that players can construct, per faction.
+     We sort them so that the result does not depend on the iteration
+     order of the protobuf map.  */
+  std::map<std::string, std::vector<std::string>> types;
+  for (const auto& entry : ctx.RoConfig ()->building_types ())
+    {
+      const auto& data = ctx.RoConfig ().Building (entry.first);
+      if (data.has_construction () && data.construction ().has_faction ())
+        types[data.construction ().faction ()].push_back (entry.first);
+    }
+  for (auto& entry : types)
+    std::sort (entry.second.begin (), entry.second.end ());
+
+  BuildingsTable tbl(db);
+  for (unsigned i = 0; i < params.buildings; ++i)
+    {
+      const size_t owner = rnd.NextInt (accounts.size ());
+      const auto& ownTypes = types[FactionToString (factions[owner])];
+      CHECK (!ownTypes.empty ());
+      const auto& type = ownTypes[rnd.NextInt (ownTypes.size ())];
+
+      proto::ShapeTransformation trafo;
+      trafo.set_rotation_steps (rnd.NextInt<unsigned> (6));
+
+      /* Buildings are large, so the clusters may fill up (or be in a safe
+         zone).  Thus we fall back to placing them anywhere after some
+         failed attempts.  */
+      HexCoord pos;
+      unsigned attempts = 0;
+      do
+        pos = RandomFreeTile (attempts++ < CLUSTER_ATTEMPTS);
+      while (!CanPlaceBuilding (type, trafo, pos, dyn, ctx));
+
+      auto b = tbl.CreateNew (type, accounts[owner], factions[owner]);
+      b->SetCentre (pos);
+      auto& pb = b->MutableProto ();
+      *pb.mutable_shape_trafo () = trafo;
+      pb.mutable_age_data ()->set_founded_height (ctx.Height ());
+      pb.mutable_age_data ()->set_finished_height (ctx.Height ());
+      UpdateBuildingStats (*b, ctx.Chain ());
+
+      dyn.AddBuilding (*b);
+      buildings.push_back (b->GetId ());
+    }
+}
+
+void
+WorldGenerator::GenerateCharacters (const WorldParams& params)
+{
+  CharacterTable tbl(db);
+  for (unsigned i = 0; i < params.characters; ++i)
+    {
+      const size_t owner = rnd.NextInt (accounts.size ());
+      auto c = SpawnCharacter (accounts[owner], factions[owner], tbl, ctx);
+
+      const bool clustered
+          = rnd.ProbabilityRoll (params.clusteredPercent, 100);
+      const HexCoord pos = RandomFreeTile (clustered);
+      c->SetPosition (pos);
+      dyn.AddVehicle (pos);
+
+      characters.push_back (c->GetId ());
+    }
+}
+
+void
+WorldGenerator::GenerateDexOrders (const WorldParams& params)
+{
+  if (buildings.empty ())
+    return;
+
+  std::vector<std::string> items;
+  for (const auto& entry : ctx.RoConfig ()->fungible_items ())
+    items.push_back (entry.first);
+  std::sort (items.begin (), items.end ());
+  CHECK (!items.empty ());
+
+  AccountsTable accountsTbl(db);
+  BuildingInventoriesTable inventories(db);
+  DexOrderTable tbl(db);
+  for (unsigned i = 0; i < params.dexOrders; ++i)
+    {
+      const auto building = buildings[rnd.NextInt (buildings.size ())];
+      const auto& account = accounts[rnd.NextInt (accounts.size ())];
+      const auto& item = items[rnd.NextInt (items.size ())];
+      const auto type = rnd.ProbabilityRoll (1, 2)
+                          ? DexOrder::Type::BID : DexOrder::Type::ASK;
+      const Quantity quantity = RandomInRange (rnd, 1, 100);
+      const Amount price = RandomInRange (rnd, 1, 1'000);
+
+      /* The coins or items of an order are reserved when it is placed
+         (just like in trading.cpp), so that filling or cancelling it later
+         does not create them out of thin air.  For asks, the seller first
+         gets some stock in the building, from which the order's items
+         are then taken.  Bids that the account cannot afford are skipped.  */
+      switch (type)
+        {
+        case DexOrder::Type::BID:
+          {
+            const Amount cost = QuantityProduct (quantity, price).Extract ();
+            auto a = accountsTbl.GetByName (account);
+            if (a->GetBalance () < cost)
+              continue;
+            a->AddBalance (-cost);
+            break;
+          }
+
+        case DexOrder::Type::ASK:
+          {
+            auto inv = inventories.Get (building, account);
+            auto& stock = inv->GetInventory ();
+            stock.AddFungibleCount (item,
+                                    quantity + RandomInRange (rnd, 0, 100));
+            stock.AddFungibleCount (item, -quantity);
+            break;
+          }
+
+        default:
+          LOG (FATAL) << "Unexpected order type";
+        }
+
+      tbl.CreateNew (building, account, type, item, quantity, price);
+    }
+}
+
+void
+WorldGenerator::GenerateProspecting (const WorldParams& params)
+{
+  CharacterTable chars(db);
+  OngoingsTable ongoings(db);
+  RegionsTable regions(db, ctx.Height ());
+
+  /* Characters are placed randomly, so we can just use the first ones
+     that are in a region not yet being prospected.  */
+  unsigned started = 0;
+  for (unsigned i = 0;
+       i < characters.size () && started < params.prospecting; ++i)
+    {
+      auto c = chars.GetById (characters[i]);
+      const auto regionId
+          = ctx.Map ().Regions ().GetRegionId (c->GetPosition ());
+
+      auto r = regions.GetById (regionId);
+      if (r->GetProto ().has_prospecting_character ())
+        continue;
+      r->MutableProto ().set_prospecting_character (c->GetId ());
+
+      auto op = ongoings.CreateNew (ctx.Height ());
+      c->MutableProto ().set_ongoing (op->GetId ());
+      op->SetHeight (ctx.Height () + RandomInRange (rnd, 1, 10));
+      op->SetCharacterId (c->GetId ());
+      op->MutableProto ().mutable_prospection ();
+      ++started;
+    }
+}
+
+void
+WorldGenerator::GenerateProspectedRegions (const WorldParams& params)
+{
+  RegionsTable regions(db, ctx.Height ());
+
+  for (unsigned i = 0; i < params.prospectedRegions; ++i)
+    {
+      const HexCoord pos = RandomFreeTile (true);
+      const auto regionId = ctx.Map ().Regions ().GetRegionId (pos);
+
+      auto r = regions.GetById (regionId);
+      auto& pb = r->MutableProto ();
+      if (pb.has_prospection () || pb.has_prospecting_character ())
+        continue;
+
+      auto* prosp = pb.mutable_prospection ();
+      prosp->set_name (accounts[rnd.NextInt (accounts.size ())]);
+      prosp->set_height (ctx.Height ());
+
+      std::string type;
+      Quantity amount;
+      DetectResource (pos, *ctx.RoConfig (), rnd, type, amount);
+      prosp->set_resource (type);
+      r->SetResourceLeft (amount);
+    }
+}
+
+void
+WorldGenerator::Generate (const WorldParams& params)
+{
+  CHECK_GT (params.accounts, 0) << "World needs at least one account";
+  CHECK_LE (params.clusteredPercent, 100);
+  CHECK_NE (ctx.Height (), RegionsTable::HEIGHT_READONLY)
+      << "World generation needs a context with proper block height";
+
+  LOG (INFO)
+      << "Generating world with " << params.accounts << " accounts, "
+      << params.characters << " characters and "
+      << params.buildings << " buildings...";
+
+  clusterRadius = params.clusterRadius;
+  for (unsigned i = 0; i < params.clusters; ++i)
+    clusterCentres.push_back (RandomFreeTile (false));
+
+  GenerateAccounts (params);
+  GenerateBuildings (params);
+  GenerateCharacters (params);
+  GenerateDexOrders (params);
+  GenerateProspecting (params);
+  GenerateProspectedRegions (params);
+}
+
+} // namespace pxd
@@ -0,0 +1,186 @@
+/*
+    GSP for the Taurion blockchain game
+    Copyright (C) 2021  Autonomous Worlds Ltd
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef PXD_WORLDGEN_HPP
+#define PXD_WORLDGEN_HPP
+
+#include "context.hpp"
+#include "dynobstacles.hpp"
+
+#include "database/database.hpp"
+#include "database/faction.hpp"
+#include "hexagonal/coord.hpp"
+
+#include <xayautil/random.hpp>
+
+#include <string>
+#include <vector>
+
+namespace pxd
+{
+
+/**
+ * Parameters for the world generated by WorldGenerator.
+ */
+struct WorldParams
+{
+
+  /** Number of player accounts.  */
+  unsigned accounts = 100;
+
+  /** Number of characters on the map.  */
+  unsigned characters = 1'000;
+
+  /** Number of player-owned buildings.  */
+  unsigned buildings = 10;
+
+  /** Number of open dex orders (in the generated buildings).  */
+  unsigned dexOrders = 100;
+
+  /** Number of characters that are prospecting (with an ongoing).  */
+  unsigned prospecting = 10;
+
+  /** Number of regions that are already prospected.  */
+  unsigned prospectedRegions = 100;
+
+  /** Number of "hot spots" around which characters are clustered.  */
+  unsigned clusters = 10;
+
+  /** L1 radius of each cluster.  */
+  HexCoord::IntT clusterRadius = 30;
+
+  /**
+   * Percentage of characters that are placed in one of the clusters.  The
+   * others are placed uniformly on the map.
+   */
+  unsigned clusteredPercent = 80;
+
+};
+
+/**
+ * Utility class that populates a database with a synthetic but realistic
+ * game world (accounts, characters on passable tiles, buildings, dex orders,
+ * ongoing operations and prospected regions).  This is used to run
+ * benchmarks against large worlds.  All randomness comes from the passed-in
+ * xaya::Random, so the generated world is deterministic for a given seed.
+ *
+ * The database must already have the game-state schema, and the context
+ * must have a block height set (as regions are modified).
+ */
+class WorldGenerator
+{
+
+private:
+
+  /** The database to populate.  */
+  Database& db;
+
+  /** Context to use (mainly for the map and roconfig).  */
+  const Context& ctx;
+
+  /** Random instance used for generating the world.  */
+  xaya::Random& rnd;
+
+  /** Dynamic obstacles, to ensure we only place things on free tiles.  */
+  DynObstacles dyn;
+
+  /** Centres of the clusters.  */
+  std::vector<HexCoord> clusterCentres;
+
+  /** L1 radius of the clusters.  */
+  HexCoord::IntT clusterRadius = 0;
+
+  /** Generated account names.  */
+  std::vector<std::string> accounts;
+
+  /** Factions of the generated accounts.  */
+  std::vector<Faction> factions;
+
+  /** IDs of the generated characters.  */
+  std::vector<Database::IdT> characters;
+
+  /** IDs of the generated buildings.  */
+  std::vector<Database::IdT> buildings;
+
+  /**
+   * Returns a uniformly random coordinate on the map (which may not be
+   * passable).
+   */
+  HexCoord RandomCoord ();
+
+  /**
+   * Returns a random tile that is passable and free of any vehicles and
+   * buildings.  If clustered is true, the tile is chosen in one of the
+   * clusters (if possible).
+   */
+  HexCoord RandomFreeTile (bool clustered);
+
+  void GenerateAccounts (const WorldParams& params);
+  void GenerateBuildings (const WorldParams& params);
+  void GenerateCharacters (const WorldParams& params);
+  void GenerateDexOrders (const WorldParams& params);
+  void GenerateProspecting (const WorldParams& params);
+  void GenerateProspectedRegions (const WorldParams& params);
+
+public:
+
+  explicit WorldGenerator (Database& d, const Context& c, xaya::Random& r);
+
+  WorldGenerator () = delete;
+  WorldGenerator (const WorldGenerator&) = delete;
+  void operator= (const WorldGenerator&) = delete;
+
+  /**
+   * Generates a world with the given parameters and inserts it into
+   * the database.
+   */
+  void Generate (const WorldParams& params);
+
+  const std::vector<std::string>&
+  GetAccounts () const
+  {
+    return accounts;
+  }
+
+  const std::vector<Database::IdT>&
+  GetCharacters () const
+  {
+    return characters;
+  }
+
+  const std::vector<Database::IdT>&
+  GetBuildings () const
+  {
+    return buildings;
+  }
+
+  /**
+   * Returns the positions of the cluster centres.
+   */
+  const std::vector<HexCoord>&
+  GetClusterCentres () const
+  {
+    return clusterCentres;
+  }
+
+};
+
+} // namespace pxd
+
+#endif // PXD_WORLDGEN_HPP
@@ -0,0 +1,241 @@
+/*
+    GSP for the Taurion blockchain game
+    Copyright (C) 2021  Autonomous Worlds Ltd
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#include "worldgen.hpp"
+
+#include "testutils.hpp"
+
+#include "database/account.hpp"
+#include "database/building.hpp"
+#include "database/character.hpp"
+#include "database/dbtest.hpp"
+#include "database/dex.hpp"
+#include "database/inventory.hpp"
+#include "database/ongoing.hpp"
+#include "database/region.hpp"
+#include "database/schema.hpp"
+
+#include <gtest/gtest.h>
+
+#include <set>
+
+namespace pxd
+{
+namespace
+{
+
+class WorldGeneratorTests : public DBTestWithSchema
+{
+
+protected:
+
+  ContextForTesting ctx;
+  TestRandom rnd;
+
+  WorldParams params;
+
+  WorldGeneratorTests ()
+  {
+    ctx.SetHeight (100);
+
+    params.accounts = 10;
+    params.characters = 200;
+    params.buildings = 5;
+    params.dexOrders = 20;
+    params.prospecting = 5;
+    params.prospectedRegions = 10;
+    params.clusters = 3;
+    params.clusterRadius = 10;
+    params.clusteredPercent = 100;
+  }
+
+  /**
+   * Counts the rows returned by the given query.
+   */
+  template <typename R>
+    static unsigned
+    CountRows (Database::Result<R>&& res)
+  {
+    unsigned cnt = 0;
+    while (res.Step ())
+      ++cnt;
+    return cnt;
+  }
+
+};
+
+TEST_F (WorldGeneratorTests, EntityCounts)
+{
+  WorldGenerator gen(db, ctx, rnd);
+  gen.Generate (params);
+
+  AccountsTable accounts(db);
+  BuildingsTable buildings(db);
+  CharacterTable characters(db);
+  DexOrderTable orders(db);
+  OngoingsTable ongoings(db);
+
+  EXPECT_EQ (CountRows (accounts.QueryAll ()), 10);
+  EXPECT_EQ (CountRows (buildings.QueryAll ()), 5);
+  EXPECT_EQ (CountRows (characters.QueryAll ()), 200);
+  EXPECT_EQ (CountRows (orders.QueryAll ()), 20);
+  EXPECT_EQ (CountRows (ongoings.QueryAll ()), 5);
+
+  EXPECT_EQ (gen.GetAccounts ().size (), 10);
+  EXPECT_EQ (gen.GetBuildings ().size (), 5);
+  EXPECT_EQ (gen.GetCharacters ().size (), 200);
+}
+
+TEST_F (WorldGeneratorTests, DexOrdersReserved)
+{
+  WorldGenerator gen(db, ctx, rnd);
+  gen.Generate (params);
+
+  AccountsTable accounts(db);
+  BuildingInventoriesTable inventories(db);
+  DexOrderTable orders(db);
+
+  /* All coins reserved by bids must have been deducted from the balances,
+     so that the total is still the initial balance of all accounts.  */
+  Amount total = 0;
+  auto res = accounts.QueryAll ();
+  while (res.Step ())
+    total += accounts.GetFromResult (res)->GetBalance ();
+
+  unsigned asks = 0;
+  auto orderRes = orders.QueryAll ();
+  while (orderRes.Step ())
+    {
+      auto o = orders.GetFromResult (orderRes);
+      switch (o->GetType ())
+        {
+        case DexOrder::Type::BID:
+          total += QuantityProduct (o->GetQuantity (), o->GetPrice ())
+                      .Extract ();
+          break;
+
+        case DexOrder::Type::ASK:
+          ++asks;
+          break;
+
+        default:
+          FAIL () << "Unexpected order type";
+        }
+    }
+
+  EXPECT_EQ (total, 10 * 1'000'000);
+  EXPECT_GT (asks, 0);
+
+  /* The items of asks must have been taken out of the building inventories.
+     What is left there is just the additional stock of at most 100 per ask.  */
+  Quantity stock = 0;
+  auto invRes = inventories.QueryAll ();
+  while (invRes.Step ())
+    for (const auto& entry : inventories.GetFromResult (invRes)
+                                ->GetInventory ().GetFungible ())
+      stock += entry.second;
+  EXPECT_LE (stock, 100 * asks);
+}
+
+TEST_F (WorldGeneratorTests, CharactersOnFreeTiles)
+{
+  WorldGenerator gen(db, ctx, rnd);
+  gen.Generate (params);
+
+  CharacterTable characters(db);
+  std::set<HexCoord> seen;
+  auto res = characters.QueryAll ();
+  while (res.Step ())
+    {
+      auto c = characters.GetFromResult (res);
+      ASSERT_FALSE (c->IsInBuilding ());
+
+      const auto& pos = c->GetPosition ();
+      EXPECT_TRUE (ctx.Map ().IsPassable (pos));
+      EXPECT_TRUE (seen.insert (pos).second) << "Duplicate position " << pos;
+
+      bool inCluster = false;
+      for (const auto& centre : gen.GetClusterCentres ())
+        if (HexCoord::DistanceL1 (pos, centre) <= params.clusterRadius)
+          inCluster = true;
+      EXPECT_TRUE (inCluster) << "Not in any cluster: " << pos;
+    }
+}
+
+TEST_F (WorldGeneratorTests, BuildingsOutsideFullClusters)
+{
+  params.clusters = 1;
+  params.clusterRadius = 3;
+  params.characters = 10;
+
+  WorldGenerator gen(db, ctx, rnd);
+  gen.Generate (params);
+
+  EXPECT_EQ (gen.GetBuildings ().size (), 5);
+}
+
+TEST_F (WorldGeneratorTests, ProspectedRegions)
+{
+  WorldGenerator gen(db, ctx, rnd);
+  gen.Generate (params);
+
+  RegionsTable regions(db, ctx.Height ());
+  unsigned prospected = 0;
+  unsigned prospecting = 0;
+  auto res = regions.QueryNonTrivial ();
+  while (res.Step ())
+    {
+      auto r = regions.GetFromResult (res);
+      if (r->GetProto ().has_prospection ())
+        {
+          ++prospected;
+          EXPECT_GT (r->GetResourceLeft (), 0);
+        }
+      if (r->GetProto ().has_prospecting_character ())
+        ++prospecting;
+    }
+
+  EXPECT_GT (prospected, 0);
+  EXPECT_LE (prospected, params.prospectedRegions);
+  EXPECT_GT (prospecting, 0);
+  EXPECT_LE (prospecting, params.prospecting);
+}
+
+TEST_F (WorldGeneratorTests, Deterministic)
+{
+  TestDatabase otherDb;
+  SetupDatabaseSchema (*otherDb);
+  TestRandom otherRnd;
+
+  WorldGenerator gen1(db, ctx, rnd);
+  gen1.Generate (params);
+  WorldGenerator gen2(otherDb, ctx, otherRnd);
+  gen2.Generate (params);
+
+  EXPECT_EQ (gen1.GetClusterCentres (), gen2.GetClusterCentres ());
+
+  CharacterTable chars1(db);
+  CharacterTable chars2(otherDb);
+  for (const auto id : gen1.GetCharacters ())
+    EXPECT_EQ (chars1.GetById (id)->GetPosition (),
+               chars2.GetById (id)->GetPosition ());
+}
+
+} // anonymous namespace
+} // namespace pxd